@@ -0,0 +1,152 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+
+#include "inmost.h"
+using namespace INMOST;
+
+// Measures the throughput of the assembly of residual and jacobian with
+// automatic differentiation for a nonlinear two-point flux problem
+// on a structured n x n x n grid with m unknowns per cell.
+// Each row of the jacobian has up to 7*m entries.
+// With frozen = 1 the pattern of the jacobian is recorded on the first
+// assembly and later assemblies only write values, see Residual::FreezePattern.
+// With compiled = 1 the flux is recorded once into CompiledExpression and
+// evaluated for all the faces in a batch, see ExpressionBatch.
+//
+// Usage: ADBenchmark [n = 40] [repeats = 5] [m = 2] [frozen = 0] [compiled = 0]
+
+const int shift[6][3] = {{-1,0,0},{1,0,0},{0,-1,0},{0,1,0},{0,0,-1},{0,0,1}};
+
+// Find neighbour of the cell in direction s, returns false at the boundary.
+bool neighbour(int n, int ci, int cj, int ck, int s, INMOST_DATA_ENUM_TYPE & nb)
+{
+	int ni = ci + shift[s][0], nj = cj + shift[s][1], nk = ck + shift[s][2];
+	if( ni < 0 || ni >= n || nj < 0 || nj >= n || nk < 0 || nk >= n ) return false;
+	nb = (ni*n + nj)*n + nk;
+	return true;
+}
+
+int main(int argc, char ** argv)
+{
+	int n = argc > 1 ? atoi(argv[1]) : 40;
+	int repeats = argc > 2 ? atoi(argv[2]) : 5;
+	int m = argc > 3 ? atoi(argv[3]) : 2;
+	int frozen = argc > 4 ? atoi(argv[4]) : 0;
+	int compiled = argc > 5 ? atoi(argv[5]) : 0;
+	if( n < 1 || repeats < 1 || m < 1 )
+	{
+		printf("Usage: %s [n = 40] [repeats = 5] [m = 2] [frozen = 0] [compiled = 0]\n",argv[0]);
+		return -1;
+	}
+	Solver::Initialize(&argc,&argv,"");
+	{
+		const double T = 1.0, phi = 0.1;
+		INMOST_DATA_ENUM_TYPE cells = n*n*n, size = cells*m;
+		std::vector<double> x(size), x0(size);
+		for(INMOST_DATA_ENUM_TYPE k = 0; k < size; ++k)
+		{
+			x[k] = 0.5 + 0.25*sin(0.1*k);
+			x0[k] = 0.5;
+		}
+		//flux with inputs: unknowns of the cell, of the neighbour and of the upstream cell
+		CompiledExpression flux;
+		std::vector<code_variable> xc(m), xn(m), xu(m);
+		for(int q = 0; q < m; ++q) xc[q] = flux.Input();
+		for(int q = 0; q < m; ++q) xn[q] = flux.Input();
+		for(int q = 0; q < m; ++q) xu[q] = flux.Input();
+		code_variable cmob = flux.Constant(1.0);
+		for(int l = 0; l < m; ++l)
+			cmob *= pow(xu[l],2.0) + 0.1;
+		for(int q = 0; q < m; ++q)
+			flux.Output(T*(xc[q] - xn[q])*cmob);
+		ExpressionBatch batch(flux);
+		if( compiled )
+		{
+			INMOST_DATA_ENUM_TYPE faces = 0, nb;
+			for(int ci = 0; ci < n; ++ci)
+			for(int cj = 0; cj < n; ++cj)
+			for(int ck = 0; ck < n; ++ck)
+			for(int s = 0; s < 6; ++s)
+				if( neighbour(n,ci,cj,ck,s,nb) ) faces++;
+			batch.Resize(faces);
+		}
+		Residual R("",0,size);
+		double tbest = 1.0e+20, ttotal = 0;
+		for(int r = 0; r < repeats; ++r)
+		{
+			double t = Timer();
+			R.Clear();
+			if( compiled )
+			{
+				INMOST_DATA_ENUM_TYPE p = 0, nb;
+				for(int ci = 0; ci < n; ++ci)
+				for(int cj = 0; cj < n; ++cj)
+				for(int ck = 0; ck < n; ++ck)
+				for(int s = 0; s < 6; ++s) if( neighbour(n,ci,cj,ck,s,nb) )
+				{
+					INMOST_DATA_ENUM_TYPE c = (ci*n + cj)*n + ck;
+					INMOST_DATA_ENUM_TYPE up = x[c*m] > x[nb*m] ? c : nb;
+					for(int q = 0; q < m; ++q)
+					{
+						batch.SetInput(p,q,x[c*m+q],c*m+q);
+						batch.SetInput(p,m+q,x[nb*m+q],nb*m+q);
+						batch.SetInput(p,2*m+q,x[up*m+q],up*m+q);
+					}
+					p++;
+				}
+				batch.Evaluate();
+			}
+			INMOST_DATA_ENUM_TYPE p = 0;
+			for(int ci = 0; ci < n; ++ci)
+			for(int cj = 0; cj < n; ++cj)
+			for(int ck = 0; ck < n; ++ck)
+			{
+				INMOST_DATA_ENUM_TYPE c = (ci*n + cj)*n + ck;
+				for(int q = 0; q < m; ++q)
+				{
+					INMOST_DATA_ENUM_TYPE row = c*m+q;
+					R[row] = (unknown(x[row],row) - x0[row])*phi;
+				}
+				for(int s = 0; s < 6; ++s)
+				{
+					INMOST_DATA_ENUM_TYPE nb;
+					if( !neighbour(n,ci,cj,ck,s,nb) ) continue;
+					if( compiled )
+					{
+						for(int q = 0; q < m; ++q)
+							R[c*m+q] += batch(p,q);
+						p++;
+						continue;
+					}
+					INMOST_DATA_ENUM_TYPE up = x[c*m] > x[nb*m] ? c : nb;
+					//mobility depends on all the unknowns of the upstream cell
+					variable mob(1.0);
+					for(int l = 0; l < m; ++l)
+						mob *= pow(unknown(x[up*m+l],up*m+l),2.0) + 0.1;
+					for(int q = 0; q < m; ++q)
+						R[c*m+q] += T*(unknown(x[c*m+q],c*m+q) - unknown(x[nb*m+q],nb*m+q))*mob;
+				}
+			}
+			t = Timer() - t;
+			if( frozen && !R.isPatternFrozen() ) 
+			{
+				//first assembly records the pattern and is not accounted
+				R.FreezePattern();
+				r--;
+				continue;
+			}
+			ttotal += t;
+			if( t < tbest ) tbest = t;
+		}
+		INMOST_DATA_ENUM_TYPE nnz = 0;
+		for(INMOST_DATA_ENUM_TYPE k = 0; k < size; ++k)
+			nnz += R.GetJacobian()[k].Size();
+		printf("rows %u nonzeros %u repeats %d%s%s\n",size,nnz,repeats,frozen ? " frozen pattern" : "",compiled ? " compiled flux" : "");
+		printf("assembly time best %g average %g seconds\n",tbest,ttotal/repeats);
+		printf("throughput %g rows/s %g nonzeros/s\n",size/tbest,nnz/tbest);
+	}
+	Solver::Finalize();
+	return 0;
+}
@@ -46,6 +46,56 @@ Storage::real func_rhs(Storage::real x[3], Storage::real tmp)
 }
 
 
+// Computes two-point flux on the face and adds it to the residuals of adjacent cells
+struct FluxKernel
+{
+	Residual & R;
+	Automatizator & aut;
+	dynamic_variable & Phi;
+	INMOST_DATA_ENUM_TYPE iphi;
+	Tag tensor_K;
+	FluxKernel(Residual & R, Automatizator & aut, dynamic_variable & Phi, INMOST_DATA_ENUM_TYPE iphi, Tag tensor_K)
+	: R(R), aut(aut), Phi(Phi), iphi(iphi), tensor_K(tensor_K) {}
+	void operator()(Element e)
+	{
+		Face face = e.getAsFace();
+		Element::Status s1,s2;
+		Cell r1 = face->BackCell();
+		Cell r2 = face->FrontCell();
+		if( ((!r1->isValid() || (s1 = r1->GetStatus()) == Element::Ghost)?0:1) +
+			((!r2->isValid() || (s2 = r2->GetStatus()) == Element::Ghost)?0:1) == 0) return;
+		Storage::integer i1 = aut.GetIndex(r1,iphi), i2;
+		Storage::real f_nrm[3], r1_cnt[3], r2_cnt[3], f_cnt[3], d1, d2, D, v[3], T;
+		Storage::real f_area = face->Area(); // Get the face area
+		face->UnitNormal(f_nrm); // Get the face normal
+		r1->Centroid(r1_cnt);  // Get the barycenter of the cell
+		face->Centroid(f_cnt); // Get the barycenter of the face
+		if( !r2->isValid() ) // boundary condition
+		{
+			Storage::real bnd_pnt[3], dist;
+			make_vec(f_cnt,r1_cnt,v);
+			dist = dot_prod(f_nrm,v);
+			// bnd_pnt is a projection of the cell center to the face
+			bnd_pnt[0] = r1_cnt[0] + dist * f_nrm[0];
+			bnd_pnt[1] = r1_cnt[1] + dist * f_nrm[1];
+			bnd_pnt[2] = r1_cnt[2] + dist * f_nrm[2];
+			T = r1->Real(tensor_K) * f_area / dist;
+			R[i1] -=  T * (func(bnd_pnt,0) - Phi(r1));
+		}
+		else
+		{
+			i2 = aut.GetIndex(r2,iphi);
+			r2->Centroid(r2_cnt);
+			D = dot_prod(f_nrm,f_cnt);
+			d1 = fabs(dot_prod(r1_cnt,f_nrm) - D);
+			d2 = fabs(dot_prod(r2_cnt,f_nrm) - D);
+			T = 1.0 / (d1/r1->Real(tensor_K) + d2/r2->Real(tensor_K)) * f_area;
+			variable flux = T * (Phi(r2) - Phi(r1));
+			if( s1 != Element::Ghost ) R[i1] -= flux;
+			if( s2 != Element::Ghost ) R[i2] += flux;
+		}
+	}
+};
 
 int main(int argc,char ** argv)
 {
@@ -132,7 +182,6 @@ int main(int argc,char ** argv)
 		S.SetParameter("absolute_tolerance", "1e-8");
 		S.SetParameter("schwartz_overlap", "2");
     	Residual R; // Residual vector
-    	Sparse::LockService Locks;
 		Sparse::Vector Update; // Declare the solution and the right-hand side vectors
 
 		Mesh::GeomParam table;
@@ -143,6 +192,9 @@ int main(int argc,char ** argv)
 		table[MEASURE] = CELL | FACE;
 		table[BARYCENTER] = CELL | FACE;
 		m->PrepareGeometricData(table);
+		// Faces of one color share no cell, so that colors are assembled in parallel without locks,
+		// the coloring depends only on the mesh and is computed once
+		ElementColoring colors(m,FACE,CELL);
 		//~ BARRIER
 		//~ if( m->GetProcessorRank() == 0 ) std::cout << "Prepare geometric data: " << Timer()-ttt << std::endl;
 		{
@@ -153,74 +205,12 @@ int main(int argc,char ** argv)
 
 			// Set the indeces intervals for the matrix and vectors
 			R.SetInterval(aut.GetFirstIndex(),aut.GetLastIndex());
-			R.InitLocks();
 			Update.SetInterval(aut.GetFirstIndex(),aut.GetLastIndex());
 			//~ std::cout << m->GetProcessorRank() << " A,x,b interval " << idmin << ":" << idmax << " size " << idmax-idmin << std::endl;
 			dynamic_variable Phi(aut,iphi);
 			// Solve \nabla \cdot \nabla phi = f equation
-			//for( Mesh::iteratorFace face = m->BeginFace(); face != m->EndFace(); ++face )
-#if defined(USE_OMP)
-#pragma omp parallel
-#endif
-			{
-				variable flux; //should be more efficient to define here to avoid multiple memory allocations if storage for variations should be expanded
-#if defined(USE_OMP)
-#pragma omp for
-#endif
-				for(Storage::integer iface = 0; iface < m->FaceLastLocalID(); ++iface ) if( m->isValidFace(iface) )
-				{
-					Face face = Face(m,ComposeFaceHandle(iface));
-					Element::Status s1,s2;
-					Cell r1 = face->BackCell();
-					Cell r2 = face->FrontCell();
-					if( ((!r1->isValid() || (s1 = r1->GetStatus()) == Element::Ghost)?0:1) +
-						((!r2->isValid() || (s2 = r2->GetStatus()) == Element::Ghost)?0:1) == 0) continue;
-					Storage::integer i1 = aut.GetIndex(r1,iphi), i2;
-					Storage::real f_nrm[3], r1_cnt[3], r2_cnt[3], f_cnt[3], d1, d2, D, v[3], T;
-					Storage::real f_area = face->Area(); // Get the face area
-					face->UnitNormal(f_nrm); // Get the face normal
-					r1->Centroid(r1_cnt);  // Get the barycenter of the cell
-					face->Centroid(f_cnt); // Get the barycenter of the face
-					if( !r2->isValid() ) // boundary condition
-					{
-						Storage::real bnd_pnt[3], dist;
-						make_vec(f_cnt,r1_cnt,v);
-						dist = dot_prod(f_nrm,v);
-						// bnd_pnt is a projection of the cell center to the face
-						bnd_pnt[0] = r1_cnt[0] + dist * f_nrm[0];
-						bnd_pnt[1] = r1_cnt[1] + dist * f_nrm[1];
-						bnd_pnt[2] = r1_cnt[2] + dist * f_nrm[2];
-						T = r1->Real(tensor_K) * f_area / dist;
-						//flux =  T * (func(bnd_pnt,0) - variable(aut,r1,iphi));
-						R.Lock(i1);
-						R[i1] -=  T * (func(bnd_pnt,0) - Phi(r1));
-						R.UnLock(i1);
-					}
-					else
-					{
-						i2 = aut.GetIndex(r2,iphi);
-						r2->Centroid(r2_cnt);
-						D = dot_prod(f_nrm,f_cnt);
-						d1 = fabs(dot_prod(r1_cnt,f_nrm) - D);
-						d2 = fabs(dot_prod(r2_cnt,f_nrm) - D);
-						T = 1.0 / (d1/r1->Real(tensor_K) + d2/r2->Real(tensor_K)) * f_area;
-						//flux = T * (variable(aut,r2,iphi) - variable(aut,r1,iphi));//(unknown(aut,r2,iphi) - unknown(aut,r1,iphi));
-						flux = T * (Phi(r2) - Phi(r1));
-						if( s1 != Element::Ghost )
-						{
-							R.Lock(i1);
-							R[i1] -= flux;
-							R.UnLock(i1);
-						}
-						if( s2 != Element::Ghost )
-						{
-							R.Lock(i2);
-							R[i2] += flux;
-							R.UnLock(i2);
-						}
-					}
-				}
-			}
+			FluxKernel flux(R,aut,Phi,iphi,tensor_K);
+			colors.Apply(flux);
 #if defined(USE_OMP)
 #pragma omp parallel for
 #endif
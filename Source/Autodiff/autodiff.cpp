@@ -38,6 +38,14 @@ namespace INMOST
 		merger.Clear();
 	}
 
+	void AddPatternExpression(Sparse::Row & entries, INMOST_DATA_REAL_TYPE multme, INMOST_DATA_REAL_TYPE multit, const basic_expression & expr)
+	{
+		Sparse::RowMerger & merger = Automatizator::GetCurrent()->GetMerger();
+		expr.GetJacobian(multit,merger);
+		merger.AddToRow(multme,entries);
+		merger.Clear();
+	}
+
 	void FromGetJacobian(const basic_expression & expr, INMOST_DATA_REAL_TYPE mult, Sparse::Row & r)
 	{
 		Sparse::RowMerger & merger = Automatizator::GetCurrent()->GetMerger();
@@ -50,11 +58,236 @@ namespace INMOST
 	bool CheckCurrentAutomatizator() {return false;}
 	void FromBasicExpression(Sparse::Row & entries, const basic_expression & expr) {}
 	void AddBasicExpression(Sparse::Row & entries, INMOST_DATA_REAL_TYPE multme, INMOST_DATA_REAL_TYPE multit, const basic_expression & expr) {}
+	void AddPatternExpression(Sparse::Row & entries, INMOST_DATA_REAL_TYPE multme, INMOST_DATA_REAL_TYPE multit, const basic_expression & expr) {}
 	void FromGetJacobian(const basic_expression & expr, INMOST_DATA_REAL_TYPE mult, Sparse::Row & r) {}
 #endif //USE_MESH
 	
+	Tape::Tape() : seeded(ENUMUNDEF), recording(false), seeding(false)
+	{
+		leafs_offset.push_back(0);
+		links_offset.push_back(0);
+	}
+	
+	INMOST_DATA_ENUM_TYPE Tape::Record(const basic_expression & expr, INMOST_DATA_REAL_TYPE multit, INMOST_DATA_ENUM_TYPE prev, INMOST_DATA_REAL_TYPE multprev)
+	{
+		assert(!recording);
+		if( prev != ENUMUNDEF && multprev != 0.0 ) Link(prev,multprev);
+		if( multit != 0.0 )
+		{
+			//variables on this tape report links, unknowns are gathered into the row
+			recording = true;
+			gather.Clear();
+			if( CheckCurrentAutomatizator() )
+				FromGetJacobian(expr,multit,gather);
+			else
+				expr.GetJacobian(multit,gather);
+			recording = false;
+			for(Sparse::Row::iterator it = gather.Begin(); it != gather.End(); ++it)
+				leafs.push_back(*it);
+		}
+		leafs_offset.push_back(static_cast<INMOST_DATA_ENUM_TYPE>(leafs.size()));
+		links_offset.push_back(static_cast<INMOST_DATA_ENUM_TYPE>(links.size()));
+		return Size()-1;
+	}
+	
+	void Tape::Clear()
+	{
+		leafs.clear();
+		links.clear();
+		leafs_offset.resize(1);
+		links_offset.resize(1);
+	}
+	
+	/// Appends contributions to the row without search, duplicates are merged afterwards.
+	class RowGather
+	{
+		Sparse::Row & r;
+	public:
+		class entry
+		{
+			Sparse::Row & r;
+			INMOST_DATA_ENUM_TYPE pos;
+		public:
+			entry(Sparse::Row & _r, INMOST_DATA_ENUM_TYPE _pos) : r(_r), pos(_pos) {}
+			entry & operator +=(INMOST_DATA_REAL_TYPE v) {r.Push(pos,v); return *this;}
+		};
+		RowGather(Sparse::Row & _r) : r(_r) {}
+		entry operator [](INMOST_DATA_ENUM_TYPE pos) {return entry(r,pos);}
+	};
+	
+	static bool CompareEntryIndex(const Sparse::Row::entry & a, const Sparse::Row::entry & b) {return a.first < b.first;}
+	
+	void Tape::Sweep(Sparse::Row & r) const
+	{
+		RowGather g(gather);
+		gather.Clear();
+		Sweep(g);
+		if( gather.Size() == 0 ) return;
+		std::sort(gather.Begin(),gather.End(),CompareEntryIndex);
+		INMOST_DATA_ENUM_TYPE last = 0;
+		for(INMOST_DATA_ENUM_TYPE k = 1; k < gather.Size(); ++k)
+		{
+			if( gather.GetIndex(k) == gather.GetIndex(last) )
+				gather.GetValue(last) += gather.GetValue(k);
+			else
+			{
+				++last;
+				gather.GetIndex(last) = gather.GetIndex(k);
+				gather.GetValue(last) = gather.GetValue(k);
+			}
+		}
+		gather.Resize(last+1);
+		if( r.Size() == 0 )
+		{
+			for(Sparse::Row::iterator it = gather.Begin(); it != gather.End(); ++it)
+				r.Push(it->first,it->second);
+		}
+		else
+		{
+			for(Sparse::Row::iterator it = gather.Begin(); it != gather.End(); ++it)
+				r[it->first] += it->second;
+		}
+	}
+	
+	code_variable CompiledExpression::Input()
+	{
+		assert(outputs.empty());
+		inputs.push_back(Size());
+		return Emit(OpInput,GetInputs()-1);
+	}
+	
+	void CompiledExpression::Output(const code_variable & v)
+	{
+		assert(v.GetCode() == this);
+		outputs.push_back(v.GetRegister());
+		//mark instructions reachable from the output
+		std::vector<char> reach(v.GetRegister()+1,0);
+		reach[v.GetRegister()] = 1;
+		for(INMOST_DATA_ENUM_TYPE i = v.GetRegister()+1; i-- > 0; ) if( reach[i] )
+		{
+			const instruction & q = code[i];
+			if( q.op == OpInput || q.op == OpConst ) continue;
+			reach[q.a] = 1;
+			if( q.b != ENUMUNDEF ) reach[q.b] = 1;
+		}
+		for(INMOST_DATA_ENUM_TYPE k = 0; k < GetInputs(); ++k)
+			dependencies.push_back(inputs[k] < reach.size() ? reach[inputs[k]] : 0);
+	}
+	
+	code_variable CompiledExpression::Emit(Operation op, INMOST_DATA_ENUM_TYPE a, INMOST_DATA_ENUM_TYPE b, INMOST_DATA_REAL_TYPE c)
+	{
+		//replace powers that have cheaper equivalents
+		if( op == OpPowConst )
+		{
+			if( c == 1.0 ) return code_variable(this,a);
+			if( c == 2.0 ) op = OpMul, b = a;
+			else if( c == 0.5 ) op = OpSqrt;
+		}
+		instruction i;
+		i.op = op;
+		i.a = a;
+		i.b = b;
+		i.c = c;
+		code.push_back(i);
+		return code_variable(this,Size()-1);
+	}
+	
+	void CompiledExpression::Clear()
+	{
+		code.clear();
+		inputs.clear();
+		outputs.clear();
+		dependencies.clear();
+	}
+	
+	void CompiledExpression::Evaluate(INMOST_DATA_ENUM_TYPE n, const INMOST_DATA_REAL_TYPE * in, INMOST_DATA_REAL_TYPE * values, INMOST_DATA_REAL_TYPE * derivatives) const
+	{
+		const INMOST_DATA_ENUM_TYPE B = BlockSize, nc = Size(), ni = GetInputs(), no = GetOutputs();
+		//values and adjoints of all instructions for a block of sets
+		std::vector<INMOST_DATA_REAL_TYPE> work(2*nc*B+1);
+		INMOST_DATA_REAL_TYPE * val = &work[0], * adj = &work[nc*B];
+		for(INMOST_DATA_ENUM_TYPE l0 = 0; l0 < n; l0 += B)
+		{
+			const INMOST_DATA_ENUM_TYPE m = std::min(B,n-l0);
+			//forward pass, values
+			for(INMOST_DATA_ENUM_TYPE i = 0; i < nc; ++i)
+			{
+				const instruction & q = code[i];
+				const INMOST_DATA_REAL_TYPE c = q.c;
+				INMOST_DATA_REAL_TYPE * v = val + i*B;
+				const INMOST_DATA_REAL_TYPE * a = (q.op == OpInput || q.op == OpConst) ? NULL : val + q.a*B;
+				const INMOST_DATA_REAL_TYPE * b = q.b == ENUMUNDEF ? NULL : val + q.b*B;
+				switch(q.op)
+				{
+				case OpInput: a = in + q.a*n + l0; for(INMOST_DATA_ENUM_TYPE l = 0; l < m; ++l) v[l] = a[l]; break;
+				case OpConst: for(INMOST_DATA_ENUM_TYPE l = 0; l < m; ++l) v[l] = c; break;
+				case OpAdd: for(INMOST_DATA_ENUM_TYPE l = 0; l < m; ++l) v[l] = a[l] + b[l]; break;
+				case OpSub: for(INMOST_DATA_ENUM_TYPE l = 0; l < m; ++l) v[l] = a[l] - b[l]; break;
+				case OpMul: for(INMOST_DATA_ENUM_TYPE l = 0; l < m; ++l) v[l] = a[l] * b[l]; break;
+				case OpDiv: for(INMOST_DATA_ENUM_TYPE l = 0; l < m; ++l) v[l] = a[l] / b[l]; break;
+				case OpAddConst: for(INMOST_DATA_ENUM_TYPE l = 0; l < m; ++l) v[l] = a[l] + c; break;
+				case OpMulConst: for(INMOST_DATA_ENUM_TYPE l = 0; l < m; ++l) v[l] = a[l] * c; break;
+				case OpConstDiv: for(INMOST_DATA_ENUM_TYPE l = 0; l < m; ++l) v[l] = c / a[l]; break;
+				case OpPowConst: for(INMOST_DATA_ENUM_TYPE l = 0; l < m; ++l) v[l] = ::pow(a[l],c); break;
+				case OpConstPow: for(INMOST_DATA_ENUM_TYPE l = 0; l < m; ++l) v[l] = ::pow(c,a[l]); break;
+				case OpPow: for(INMOST_DATA_ENUM_TYPE l = 0; l < m; ++l) v[l] = ::pow(a[l],b[l]); break;
+				case OpAbs: for(INMOST_DATA_ENUM_TYPE l = 0; l < m; ++l) v[l] = ::fabs(a[l]); break;
+				case OpExp: for(INMOST_DATA_ENUM_TYPE l = 0; l < m; ++l) v[l] = ::exp(a[l]); break;
+				case OpLog: for(INMOST_DATA_ENUM_TYPE l = 0; l < m; ++l) v[l] = ::log(a[l]); break;
+				case OpSin: for(INMOST_DATA_ENUM_TYPE l = 0; l < m; ++l) v[l] = ::sin(a[l]); break;
+				case OpCos: for(INMOST_DATA_ENUM_TYPE l = 0; l < m; ++l) v[l] = ::cos(a[l]); break;
+				case OpSqrt: for(INMOST_DATA_ENUM_TYPE l = 0; l < m; ++l) v[l] = ::sqrt(a[l]); break;
+				}
+			}
+			//backward pass for each output, derivatives with respect to inputs
+			for(INMOST_DATA_ENUM_TYPE o = 0; o < no; ++o)
+			{
+				const INMOST_DATA_ENUM_TYPE last = outputs[o];
+				for(INMOST_DATA_ENUM_TYPE l = 0; l < m; ++l) values[o*n+l0+l] = val[last*B+l];
+				std::fill(adj,adj+last*B,0.0);
+				std::fill(adj+last*B,adj+(last+1)*B,1.0);
+				for(INMOST_DATA_ENUM_TYPE i = last+1; i-- > 0; )
+				{
+					const instruction & q = code[i];
+					if( q.op == OpInput || q.op == OpConst ) continue;
+					const INMOST_DATA_REAL_TYPE c = q.c;
+					const INMOST_DATA_REAL_TYPE * w = adj + i*B, * v = val + i*B, * a = val + q.a*B;
+					const INMOST_DATA_REAL_TYPE * b = q.b == ENUMUNDEF ? NULL : val + q.b*B;
+					INMOST_DATA_REAL_TYPE * wa = adj + q.a*B, * wb = q.b == ENUMUNDEF ? NULL : adj + q.b*B;
+					switch(q.op)
+					{
+					case OpInput: case OpConst: break;
+					case OpAdd: for(INMOST_DATA_ENUM_TYPE l = 0; l < m; ++l) {wa[l] += w[l]; wb[l] += w[l];} break;
+					case OpSub: for(INMOST_DATA_ENUM_TYPE l = 0; l < m; ++l) {wa[l] += w[l]; wb[l] -= w[l];} break;
+					case OpMul: for(INMOST_DATA_ENUM_TYPE l = 0; l < m; ++l) {wa[l] += w[l]*b[l]; wb[l] += w[l]*a[l];} break;
+					case OpDiv: for(INMOST_DATA_ENUM_TYPE l = 0; l < m; ++l) {wa[l] += w[l]/b[l]; wb[l] -= w[l]*v[l]/b[l];} break;
+					case OpAddConst: for(INMOST_DATA_ENUM_TYPE l = 0; l < m; ++l) wa[l] += w[l]; break;
+					case OpMulConst: for(INMOST_DATA_ENUM_TYPE l = 0; l < m; ++l) wa[l] += w[l]*c; break;
+					case OpConstDiv: for(INMOST_DATA_ENUM_TYPE l = 0; l < m; ++l) wa[l] -= w[l]*v[l]/a[l]; break;
+					case OpPowConst: for(INMOST_DATA_ENUM_TYPE l = 0; l < m; ++l) if( a[l] != 0 ) wa[l] += w[l]*v[l]*c/a[l]; break;
+					case OpConstPow: if( c != 0 ) for(INMOST_DATA_ENUM_TYPE l = 0; l < m; ++l) wa[l] += w[l]*v[l]*::log(c); break;
+					case OpPow: for(INMOST_DATA_ENUM_TYPE l = 0; l < m; ++l) if( a[l] != 0 ) {wa[l] += w[l]*v[l]*b[l]/a[l]; wb[l] += w[l]*v[l]*::log(a[l]);} break;
+					case OpAbs: for(INMOST_DATA_ENUM_TYPE l = 0; l < m; ++l) wa[l] += a[l] < 0.0 ? -w[l] : w[l]; break;
+					case OpExp: for(INMOST_DATA_ENUM_TYPE l = 0; l < m; ++l) wa[l] += w[l]*v[l]; break;
+					case OpLog: for(INMOST_DATA_ENUM_TYPE l = 0; l < m; ++l) wa[l] += w[l]/a[l]; break;
+					case OpSin: for(INMOST_DATA_ENUM_TYPE l = 0; l < m; ++l) wa[l] += w[l]*::cos(a[l]); break;
+					case OpCos: for(INMOST_DATA_ENUM_TYPE l = 0; l < m; ++l) wa[l] -= w[l]*::sin(a[l]); break;
+					case OpSqrt: for(INMOST_DATA_ENUM_TYPE l = 0; l < m; ++l) wa[l] += 0.5*w[l]/v[l]; break;
+					}
+				}
+				for(INMOST_DATA_ENUM_TYPE k = 0; k < ni; ++k)
+				{
+					INMOST_DATA_REAL_TYPE * d = derivatives + (o*ni+k)*n + l0;
+					if( inputs[k] > last )
+						std::fill(d,d+m,0.0);
+					else for(INMOST_DATA_ENUM_TYPE l = 0; l < m; ++l) d[l] = adj[inputs[k]*B+l];
+				}
+			}
+		}
+	}
+	
 #if defined(USE_MESH)
-	Automatizator::Automatizator(const Automatizator & b) : name(b.name+"_copy")
+	Automatizator::Automatizator(const Automatizator & b) : name(b.name+"_copy"), first_num(0), last_num(0), order(b.order)
 	{
 		std::vector<INMOST_DATA_ENUM_TYPE> regs = b.ListRegisteredEntries();
 		for(std::vector<INMOST_DATA_ENUM_TYPE>::iterator kt = regs.begin(); kt != regs.end(); ++kt)
@@ -66,6 +299,7 @@ namespace INMOST
 		if( &b != this )
 		{
 			name = b.name+"_copy";
+			order = b.order;
 			for (unsigned k = 0; k < reg_blocks.size(); k++)
 				if( isRegisteredEntry(k) ) UnregisterEntry(k);
 			del_blocks.clear();
@@ -78,7 +312,7 @@ namespace INMOST
 		}
 		return *this;
 	}
-	Automatizator::Automatizator(std::string _name) :name(_name), first_num(0), last_num(0) {}
+	Automatizator::Automatizator(std::string _name) :name(_name), first_num(0), last_num(0), order(EnumerateBlocks) {}
 	Automatizator::~Automatizator()
 	{
 		for (unsigned k = 0; k < reg_blocks.size(); k++) 
@@ -167,20 +401,76 @@ namespace INMOST
 				}
 		}
 
-		for (unsigned it = 0; it < reg_blocks.size(); ++it) if( act_blocks[it] )
+		if( order == EnumerateBlocks )
 		{
-			AbstractEntry & b = *reg_blocks[it];
-			TagInteger offset_tag = b.GetOffsetTag();
-			Mesh * m = offset_tag.GetMeshLink();
-			for (ElementType etype = MESH; etype >= NODE; etype = PrevElementType(etype)) if( b.GetElementType() & etype )
+			for (unsigned it = 0; it < reg_blocks.size(); ++it) if( act_blocks[it] )
 			{
-				for(int kt = 0; kt < m->LastLocalID(etype); ++kt) if( m->isValidElement(etype,kt) )
+				AbstractEntry & b = *reg_blocks[it];
+				TagInteger offset_tag = b.GetOffsetTag();
+				Mesh * m = offset_tag.GetMeshLink();
+				for (ElementType etype = MESH; etype >= NODE; etype = PrevElementType(etype)) if( b.GetElementType() & etype )
 				{
-					Element jt = m->ElementByLocalID(etype,kt);
-					if ((!(etype & paralleltypes) || (jt.GetStatus() != Element::Ghost)) && b.isValid(jt) && b.Size(jt))
+					for(int kt = 0; kt < m->LastLocalID(etype); ++kt) if( m->isValidElement(etype,kt) )
 					{
-						offset_tag[jt] = last_num;
-						last_num += b.Size(jt);
+						Element jt = m->ElementByLocalID(etype,kt);
+						if ((!(etype & paralleltypes) || (jt.GetStatus() != Element::Ghost)) && b.isValid(jt) && b.Size(jt))
+						{
+							offset_tag[jt] = last_num;
+							last_num += b.Size(jt);
+						}
+					}
+				}
+			}
+		}
+		else
+		{
+			//group entries by mesh, entries on each element follow the order of registration
+			std::vector<Mesh *> meshes;
+			std::vector< std::vector<AbstractEntry *> > blocks;
+			for (unsigned it = 0; it < reg_blocks.size(); ++it) if( act_blocks[it] )
+			{
+				Mesh * m = reg_blocks[it]->GetOffsetTag().GetMeshLink();
+				size_t q = std::find(meshes.begin(),meshes.end(),m) - meshes.begin();
+				if( q == meshes.size() )
+				{
+					meshes.push_back(m);
+					blocks.push_back(std::vector<AbstractEntry *>());
+				}
+				blocks[q].push_back(reg_blocks[it]);
+			}
+			for(size_t q = 0; q < meshes.size(); ++q)
+			{
+				Mesh * m = meshes[q];
+				ElementType etypes = NONE;
+				for(size_t it = 0; it < blocks[q].size(); ++it)
+					etypes |= blocks[q][it]->GetElementType();
+				//sets and the mesh are numbered first, as with EnumerateBlocks
+				Mesh::element_set global, local;
+				for (ElementType etype = MESH; etype >= NODE; etype = PrevElementType(etype)) if( etypes & etype )
+				{
+					for(int kt = 0; kt < m->LastLocalID(etype); ++kt) if( m->isValidElement(etype,kt) )
+					{
+						Element jt = m->ElementByLocalID(etype,kt);
+						if( !(etype & paralleltypes) )
+							global.push_back(jt.GetHandle());
+						else if( jt.GetStatus() != Element::Ghost )
+							local.push_back(jt.GetHandle());
+					}
+				}
+				if( order == EnumerateInterleavedCurve )
+					m->OrderAlongCurve(local);
+				global.insert(global.end(),local.begin(),local.end());
+				for(Mesh::element_set::iterator kt = global.begin(); kt != global.end(); ++kt)
+				{
+					Element jt(m,*kt);
+					for(size_t it = 0; it < blocks[q].size(); ++it)
+					{
+						AbstractEntry & b = *blocks[q][it];
+						if( b.isValid(jt) && b.Size(jt) )
+						{
+							b.GetOffsetTag()[jt] = last_num;
+							last_num += b.Size(jt);
+						}
 					}
 				}
 			}
@@ -272,6 +562,90 @@ namespace INMOST
 		return ret;
 	}
 	
+#if defined(USE_SOLVER)
+	void Automatizator::UpdateSolution(const Sparse::Vector & update, INMOST_DATA_REAL_TYPE alpha)
+	{
+		std::map<Mesh *,std::vector<Tag> > exch_tags;
+		std::map<Mesh *,ElementType> exch_mask;
+		for (unsigned it = 0; it < reg_blocks.size(); ++it) if( act_blocks[it] )
+		{
+			AbstractEntry & b = *reg_blocks[it];
+			Mesh * m = b.GetOffsetTag().GetMeshLink();
+			for (ElementType etype = NODE; etype <= MESH; etype = NextElementType(etype)) if( b.GetElementType() & etype )
+			{
+#if defined(USE_OMP)
+#pragma omp parallel for
+#endif //USE_OMP
+				for(int kt = 0; kt < m->LastLocalID(etype); ++kt) if( m->isValidElement(etype,kt) )
+				{
+					Element jt = m->ElementByLocalID(etype,kt);
+					if( b.isValid(jt) )
+					{
+						for(unsigned q = 0; q < b.MatrixSize(jt); ++q)
+						{
+							INMOST_DATA_ENUM_TYPE ind = b.Index(jt,q);
+							if( ind != ENUMUNDEF && ind >= first_num && ind < last_num )
+								b.Value(jt,q) += alpha*update[ind];
+						}
+					}
+				}
+			}
+			for(unsigned unk = 0; unk < b.Size(); ++unk)
+				exch_tags[m].push_back(b.GetValueTag(unk));
+			exch_mask[m] |= b.GetElementType();
+		}
+		for(std::map<Mesh *,std::vector<Tag> >::iterator it = exch_tags.begin(); it != exch_tags.end(); ++it)
+			it->first->ExchangeData(it->second, exch_mask[it->first] & (NODE | EDGE | FACE | CELL), 0);
+	}
+#endif //USE_SOLVER
+	
+	void ElementColoring::Build(Mesh * _m, ElementType etype, ElementType shared, MarkerType mask)
+	{
+		m = _m;
+		elements.clear();
+		offsets.assign(1,0);
+		//color is stored with shift by one, zero means that the element was not colored yet
+		TagInteger color = m->CreateTag("TEMPORARY_ELEMENT_COLORING",DATA_INTEGER,etype,NONE,1);
+		std::vector<INMOST_DATA_ENUM_TYPE> stamp; //last element that forbids the color
+		std::vector<INMOST_DATA_ENUM_TYPE> count; //number of elements of the color
+		std::vector<HandleType> order;
+		for(ElementType q = NODE; q <= MESH; q = NextElementType(q)) if( q & etype )
+		{
+			for(Storage::integer id = 0; id < m->LastLocalID(q); ++id) if( m->isValidElement(q,id) )
+			{
+				Element e = m->ElementByLocalID(q,id);
+				if( mask && !e.GetMarker(mask) ) continue;
+				INMOST_DATA_ENUM_TYPE pos = static_cast<INMOST_DATA_ENUM_TYPE>(order.size()), c = 0;
+				ElementArray<Element> adj = e.getAdjElements(shared);
+				for(ElementArray<Element>::iterator it = adj.begin(); it != adj.end(); ++it)
+				{
+					ElementArray<Element> nbr = it->getAdjElements(etype);
+					for(ElementArray<Element>::iterator jt = nbr.begin(); jt != nbr.end(); ++jt)
+						if( color[*jt] ) stamp[color[*jt]-1] = pos;
+				}
+				while( c < stamp.size() && stamp[c] == pos ) ++c;
+				if( c == stamp.size() )
+				{
+					stamp.push_back(ENUMUNDEF);
+					count.push_back(0);
+				}
+				color[e] = c+1;
+				count[c]++;
+				order.push_back(e.GetHandle());
+			}
+		}
+		offsets.resize(count.size()+1);
+		for(INMOST_DATA_ENUM_TYPE c = 0; c < count.size(); ++c)
+		{
+			offsets[c+1] = offsets[c]+count[c];
+			count[c] = offsets[c];
+		}
+		elements.resize(order.size());
+		for(std::vector<HandleType>::iterator it = order.begin(); it != order.end(); ++it)
+			elements[count[color[*it]-1]++] = *it;
+		m->DeleteTag(color);
+	}
+	
 	void BlockEntry::AddTag(Tag value, INMOST_DATA_ENUM_TYPE comp)
 	{
 		assert(unknown_tags.empty() || GetMeshLink() == value.GetMeshLink());
@@ -476,6 +850,17 @@ namespace INMOST
 	{
 		jacobian.SetInterval(beg,end);
 		residual.SetInterval(beg,end);
+		if( direction ) tangent.SetInterval(beg,end);
+	}
+	void Residual::SetDirection(const Sparse::Direction * d)
+	{
+		direction = d;
+		if( direction )
+		{
+			tangent.SetInterval(GetFirstIndex(),GetLastIndex());
+			std::fill(tangent.Begin(),tangent.End(),0.0);
+		}
+		else tangent.Clear();
 	}
 	void Residual::ClearResidual()
 	{
@@ -483,7 +868,21 @@ namespace INMOST
 	}
 	void Residual::ClearJacobian()
 	{
-		for(Sparse::Matrix::iterator it = jacobian.Begin(); it != jacobian.End(); ++it) it->Clear();
+		if( direction )
+			std::fill(tangent.Begin(),tangent.End(),0.0);
+		if( frozen )
+			for(Sparse::Matrix::iterator it = jacobian.Begin(); it != jacobian.End(); ++it) it->Zero();
+		else
+			for(Sparse::Matrix::iterator it = jacobian.Begin(); it != jacobian.End(); ++it) it->Clear();
+	}
+	void Residual::FreezePattern()
+	{
+#if defined(USE_OMP)
+#pragma omp parallel for
+#endif //USE_OMP
+		for(int k = (int)GetFirstIndex(); k < (int)GetLastIndex(); ++k)
+			if( !jacobian[k].isSorted() ) std::sort(jacobian[k].Begin(),jacobian[k].End());
+		frozen = true;
 	}
 	void Residual::ClearHessian()
 	{
@@ -497,7 +896,14 @@ namespace INMOST
 		for(int k = (int)GetFirstIndex(); k < (int)GetLastIndex(); ++k) 
 		{
 			residual[k] = 0.0;
-			if( !jacobian.Empty() ) jacobian[k].Clear();
+			if( direction ) tangent[k] = 0.0;
+			if( !jacobian.Empty() ) 
+			{
+				if( frozen )
+					jacobian[k].Zero();
+				else
+					jacobian[k].Clear();
+			}
 			if( !hessian.Empty() ) hessian[k].Clear();
 		}
 	}
@@ -520,6 +926,9 @@ namespace INMOST
 		hessian = other.hessian;
 		jacobian = other.jacobian;
 		residual = other.residual;
+		frozen = other.frozen;
+		tangent = other.tangent;
+		direction = other.direction;
 		return *this;
 	}
 	void Residual::Rescale(INMOST_DATA_ENUM_TYPE p)
@@ -555,20 +964,43 @@ namespace INMOST
 		}
 	}
 	Residual::Residual(std::string name, INMOST_DATA_ENUM_TYPE start, INMOST_DATA_ENUM_TYPE end, INMOST_MPI_Comm _comm)
-	: jacobian(name,start,end,_comm),residual(name,start,end,_comm), hessian(name,0,0,_comm)
+	: jacobian(name,start,end,_comm),residual(name,start,end,_comm), hessian(name,0,0,_comm), frozen(false), tangent(name,0,0,_comm), direction(NULL)
 	{
 	}
 	Residual::Residual(const Residual & other) 
-	: jacobian(other.jacobian), residual(other.residual), hessian(other.hessian)
+	: jacobian(other.jacobian), residual(other.residual), hessian(other.hessian), frozen(other.frozen), tangent(other.tangent), direction(other.direction)
 	{
 	}
 
+	JacobianOperator::JacobianOperator(INMOST_DATA_ENUM_TYPE start, INMOST_DATA_ENUM_TYPE end, const std::vector<INMOST_DATA_ENUM_TYPE> & Pre, const std::vector<INMOST_DATA_ENUM_TYPE> & Post, INMOST_MPI_Comm _comm)
+	: value("",start,end,_comm), tangent("",start,end,_comm), direction(start,end,Pre,Post,_comm)
+	{
+	}
+	JacobianOperator::JacobianOperator(const Sparse::RowMerger & m, INMOST_MPI_Comm _comm)
+	: value("",m.GetFirstIndex(),m.GetLastIndex(),_comm), tangent("",m.GetFirstIndex(),m.GetLastIndex(),_comm), direction(m.GetFirstIndex(),m.GetLastIndex(),m.GetNonlocalPre(),m.GetNonlocalPost(),_comm)
+	{
+	}
+	void JacobianOperator::MatVec(INMOST_DATA_REAL_TYPE alpha, Sparse::Vector & x, INMOST_DATA_REAL_TYPE beta, Sparse::Vector & y)
+	{
+		//the residual is evaluated by one thread, assembly may open a nested parallel region
+#if defined(USE_OMP)
+#pragma omp single
+#endif //USE_OMP
+		{
+			direction.SetValues(x);
+			std::fill(value.Begin(),value.End(),0.0);
+			std::fill(tangent.Begin(),tangent.End(),0.0);
+			Assemble();
+			for(INMOST_DATA_ENUM_TYPE k = GetFirstIndex(); k < GetLastIndex(); ++k)
+				y[k] = beta*y[k] + alpha*tangent[k];
+		}
+	}
 	Matrix<multivar_expression_reference> Residual::operator [](const AbstractMatrix<INMOST_DATA_INTEGER_TYPE> & rows)	
 	{
 		Matrix<multivar_expression_reference> ret(rows.Rows(),rows.Cols());
 		for(INMOST_DATA_ENUM_TYPE i = 0; i < rows.Rows(); ++i)
 			for(INMOST_DATA_ENUM_TYPE j = 0; j < rows.Cols(); ++j)
-				ret(i,j) = multivar_expression_reference(residual[rows(i,j)],&jacobian[rows(i,j)]);
+				ret(i,j) = direction ? multivar_expression_reference(residual[rows(i,j)],&tangent[rows(i,j)],direction) : multivar_expression_reference(residual[rows(i,j)],&jacobian[rows(i,j)],frozen);
 		return ret;
 	}
 #endif //USE_SOLVER
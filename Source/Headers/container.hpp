@@ -1933,6 +1933,210 @@ namespace INMOST
 		}
 	};
 	
+	// notice: small_array keeps up to stacked elements inside of the object and
+	//         allocates memory only for longer arrays, the memory is kept on clear;
+	//         it is intended for plain data, elements are copied with memcpy
+	//         and never constructed or destroyed
+	// notice: unlike dynarray the class does not point into itself and
+	//         can be relocated in memory by array, interval and tag storage
+	template<typename element, unsigned int stacked>
+	class small_array
+	{
+	public:
+		typedef unsigned size_type;
+		typedef typename array<element>::iterator iterator;
+		typedef typename array<element>::const_iterator const_iterator;
+		typedef typename array<element>::reverse_iterator reverse_iterator;
+		typedef typename array<element>::const_reverse_iterator const_reverse_iterator;
+	private:
+		union storage
+		{
+			element * heap;
+			element stack[stacked];
+		} m_data;
+		size_type m_size;
+		size_type m_capacity; //equals to stacked while elements are inside of the object
+		__INLINE bool on_stack() const {return m_capacity == stacked;}
+		__INLINE element * ptr() {return on_stack() ? m_data.stack : m_data.heap;}
+		__INLINE const element * ptr() const {return on_stack() ? m_data.stack : m_data.heap;}
+		__INLINE static size_type growth_formula(size_type future_size)
+		{
+			size_type c = stacked;
+			while( c < future_size ) c <<= 1;
+			return c;
+		}
+		/// Allocate space for n elements, the contents is lost.
+		void preallocate(size_type n)
+		{
+			if( n > m_capacity )
+			{
+				if( !on_stack() ) free(m_data.heap);
+				m_capacity = growth_formula(n);
+				m_data.heap = static_cast<element *>(malloc(sizeof(element)*m_capacity));
+				assert(m_data.heap != NULL);
+			}
+		}
+	public:
+		__INLINE element * data() {return ptr();}
+		__INLINE const element * data() const {return ptr();}
+		small_array() : m_size(0), m_capacity(stacked) {}
+		small_array(size_type n, element c = element()) : m_size(0), m_capacity(stacked)
+		{
+			preallocate(n);
+			element * p = ptr();
+			for(size_type i = 0; i < n; i++) p[i] = c;
+			m_size = n;
+		}
+		template<class InputIterator>
+		small_array(InputIterator first, InputIterator last) : m_size(0), m_capacity(stacked)
+		{
+			size_type n = static_cast<size_type>(std::distance(first,last));
+			preallocate(n);
+			element * p = ptr();
+			while(first != last) *p++ = *first++;
+			m_size = n;
+		}
+		small_array(const small_array & other) : m_size(0), m_capacity(stacked)
+		{
+			preallocate(other.m_size);
+			memcpy(static_cast<void *>(ptr()),static_cast<const void *>(other.ptr()),sizeof(element)*other.m_size);
+			m_size = other.m_size;
+		}
+		~small_array()
+		{
+			if( !on_stack() ) free(m_data.heap);
+		}
+		/// Copy contents of other array, memory is reused if it is sufficient.
+		small_array & operator =(small_array const & other)
+		{
+			if( this != &other )
+			{
+				preallocate(other.m_size);
+				memcpy(static_cast<void *>(ptr()),static_cast<const void *>(other.ptr()),sizeof(element)*other.m_size);
+				m_size = other.m_size;
+			}
+			return *this;
+		}
+		__INLINE const element & operator [] (size_type n) const 
+		{
+			assert(n < m_size);
+			return ptr()[n];
+		}
+		__INLINE element & operator [] (size_type n) 
+		{
+			assert(n < m_size);
+			return ptr()[n];
+		}
+		/// Make place for at least n elements, preserving the contents.
+		void reserve(size_type n)
+		{
+			if( n > m_capacity )
+			{
+				size_type c = growth_formula(n);
+				if( on_stack() )
+				{
+					element * h = static_cast<element *>(malloc(sizeof(element)*c));
+					assert(h != NULL);
+					memcpy(static_cast<void *>(h),static_cast<const void *>(m_data.stack),sizeof(element)*m_size);
+					m_data.heap = h;
+				}
+				else
+				{
+					m_data.heap = static_cast<element *>(realloc(m_data.heap,sizeof(element)*c));
+					assert(m_data.heap != NULL);
+				}
+				m_capacity = c;
+			}
+		}
+		__INLINE void push_back(const element & e)
+		{
+			if( m_size == m_capacity ) reserve(m_size+1);
+			ptr()[m_size++] = e;
+		}
+		__INLINE void pop_back()
+		{
+			assert(m_size > 0);
+			m_size--;
+		}
+		__INLINE element & back() {assert(m_size > 0); return ptr()[m_size-1];}
+		__INLINE const element & back() const {assert(m_size > 0); return ptr()[m_size-1];}
+		__INLINE element & front() {assert(m_size > 0); return ptr()[0];}
+		__INLINE const element & front() const {assert(m_size > 0); return ptr()[0];}
+		__INLINE size_type capacity() const { return m_capacity; }
+		__INLINE size_type size() const {return m_size;}
+		__INLINE bool empty() const { return m_size == 0; }
+		void resize(size_type n, element c = element())
+		{
+			reserve(n);
+			element * p = ptr();
+			for(size_type i = m_size; i < n; i++) p[i] = c;
+			m_size = n;
+		}
+		/// Remove all elements, allocated memory is kept for reuse.
+		__INLINE void clear() { m_size = 0; }
+		/// Remove all elements and release allocated memory.
+		void shrink()
+		{
+			if( !on_stack() ) free(m_data.heap);
+			m_size = 0;
+			m_capacity = stacked;
+		}
+		void swap(small_array<element,stacked> & other)
+		{
+			if( !on_stack() && !other.on_stack() )
+			{
+				element * t = m_data.heap;
+				m_data.heap = other.m_data.heap;
+				other.m_data.heap = t;
+			}
+			else if( on_stack() && other.on_stack() )
+			{
+				size_type n = std::max(m_size,other.m_size);
+				for(size_type i = 0; i < n; i++)
+				{
+					element t = m_data.stack[i];
+					m_data.stack[i] = other.m_data.stack[i];
+					other.m_data.stack[i] = t;
+				}
+			}
+			else
+			{
+				small_array<element,stacked> & s = on_stack() ? *this : other;
+				small_array<element,stacked> & h = on_stack() ? other : *this;
+				element * t = h.m_data.heap;
+				memcpy(static_cast<void *>(h.m_data.stack),static_cast<const void *>(s.m_data.stack),sizeof(element)*s.m_size);
+				s.m_data.heap = t;
+			}
+			std::swap(m_size,other.m_size);
+			std::swap(m_capacity,other.m_capacity);
+		}
+		/// Move contents into other array, leaving this array empty.
+		/// Allocated memory is passed to other array without copy.
+		void move(small_array<element,stacked> & other)
+		{
+			if( this == &other ) return;
+			if( on_stack() )
+				other = *this;
+			else
+			{
+				other.shrink();
+				other.m_data.heap = m_data.heap;
+				other.m_size = m_size;
+				other.m_capacity = m_capacity;
+				m_capacity = stacked;
+			}
+			m_size = 0;
+		}
+		__INLINE iterator begin() { return ptr(); }
+		__INLINE iterator end() { return ptr()+m_size; }
+		__INLINE const_iterator begin() const { return ptr(); }
+		__INLINE const_iterator end() const { return ptr()+m_size; }
+		__INLINE reverse_iterator rbegin() { return reverse_iterator(ptr()+m_size-1); }
+		__INLINE reverse_iterator rend() { return reverse_iterator(ptr()-1); }
+		__INLINE const_reverse_iterator rbegin() const { return const_reverse_iterator(ptr()+m_size-1); }
+		__INLINE const_reverse_iterator rend() const { return const_reverse_iterator(ptr()-1); }
+	};
+	
 	template<class key,class value, unsigned int stacked>
 	class tiny_map
 	{
@@ -3,6 +3,7 @@
 #define INMOST_H_INCLUDED
 
 #include "inmost_common.h"
+#include "inmost_trace.h"
 #include "inmost_mesh.h"
 #include "inmost_dense.h"
 #include "inmost_solver.h"
@@ -34,6 +34,9 @@ namespace INMOST
 		Sparse::Matrix jacobian; ///< Jacobian matrix.
 		Sparse::Vector residual; ///< Right hand side vector.
 		Sparse::LockService locks; ///< Array of locks for openmp shared access.
+		bool frozen; ///< Jacobian pattern is kept between assemblies, only values are rewritten.
+		Sparse::Vector tangent; ///< Derivatives of residual along the direction.
+		const Sparse::Direction * direction; ///< Direction of differentiation, jacobian is not assembled if set.
 	public:
 		/// Constructor
 		/// @param name Name for the matrix and right hand side. Can be used to set options for linear solver.
@@ -63,7 +66,10 @@ namespace INMOST
 		/// @param row Equation number.
 		/// @return A structure that can be used in or assigned an automatic differentiation expression.
 		__INLINE multivar_expression_reference operator [](INMOST_DATA_ENUM_TYPE row)
-		{return multivar_expression_reference(residual[row],&jacobian[row]);}
+		{
+			if( direction ) return multivar_expression_reference(residual[row],&tangent[row],direction);
+			return multivar_expression_reference(residual[row],&jacobian[row],frozen);
+		}
 		/// Retrive a vector of entries in residual, corresponding to a set of equations.
 		/// @param rows A row-vector of equation numbers.
 		/// @param A structure that can be used in or assigned an automatic differentiation matrix expression.
@@ -83,11 +89,36 @@ namespace INMOST
 		/// Zero out right hand side vector.
 		void ClearResidual();
 		/// Remove all entries in jacobian matrix.
+		/// If the pattern is frozen, the entries are kept and set to zero.
+		/// Derivatives along the direction are set to zero.
 		void ClearJacobian();
 		/// Remove all entries in hessian matrix.
 		void ClearHessian();
 		/// Zero out right hand side vector and remove all entries in jacobian matrix.
+		/// If the pattern is frozen, the entries of jacobian are kept and set to zero.
 		void Clear();
+		/// Keep the current sparsity pattern of the jacobian between assemblies.
+		/// Consequent calls to Clear and ClearJacobian only zero out the values and
+		/// the assembly writes derivatives into the entries already present in the rows.
+		/// Entries that are missing in the pattern are still added.
+		/// Pass ModifiedPattern = false to Solver::SetMatrix to let the solver reuse the structure.
+		void FreezePattern();
+		/// Return to the default mode, when jacobian rows are rebuilt on each assembly.
+		void UnfreezePattern() {frozen = false;}
+		/// Check whether the sparsity pattern of the jacobian is frozen.
+		bool isPatternFrozen() const {return frozen;}
+		/// Evaluate derivatives of the residual along the direction instead of the jacobian.
+		/// In this mode jacobian rows are not assembled, the product of the jacobian with
+		/// the direction is accumulated into the vector available with Residual::GetDirectional.
+		/// The direction should outlive the assembly.
+		/// @param d Direction of differentiation or NULL to return to assembly of the jacobian.
+		void SetDirection(const Sparse::Direction * d);
+		/// Retrive the direction of differentiation, NULL if jacobian is assembled.
+		const Sparse::Direction * GetDirection() const {return direction;}
+		/// Retrive the product of jacobian with the direction, see Residual::SetDirection.
+		Sparse::Vector & GetDirectional() {return tangent;}
+		/// Retrive the product of jacobian with the direction without right of modification.
+		const Sparse::Vector & GetDirectional() const {return tangent;}
 		/// Compute the second norm of the right hand side vector over all of the processors.
 		INMOST_DATA_REAL_TYPE Norm();
 		/// Normalize jacobian rows to unit p-norms and scale right hand side accordingly.
@@ -106,6 +137,54 @@ namespace INMOST
 		/// @return True if equation was locked.
 		__INLINE bool TestLock(INMOST_DATA_ENUM_TYPE pos) {if(!locks.Empty()) return locks.TestLock(pos); return false;}
 	};
+	
+	/// Matrix-free operator with the jacobian of the residual.
+	/// The product of the jacobian with a vector is obtained by evaluation of the residual
+	/// with derivatives along the vector, so the jacobian is never stored.
+	/// Only the values of the residual and their derivatives along the vector are kept.
+	/// Derive from the class and implement JacobianOperator::Assemble that evaluates the residual
+	/// at the current state with JacobianOperator::operator [] in the same way as with Residual::operator [].
+	/// Provide the operator to Solver::SetOperator and an approximate matrix for the preconditioner
+	/// to Solver::SetMatrix to run Jacobian-free Newton-Krylov method.
+	class JacobianOperator : public Sparse::AbstractOperator
+	{
+		Sparse::Vector value; ///< Residual evaluated at the last product.
+		Sparse::Vector tangent; ///< Derivatives of the residual along the direction.
+		Sparse::Direction direction; ///< Direction of differentiation.
+	public:
+		/// Constructor.
+		/// Collective operation in parallel, see Sparse::Direction::Resize.
+		/// @param start First index of the equation in the local partition. Use Automatizator::GetFirstIndex.
+		/// @param end Last index of the equation in the local partition. Use Automatizator::GetLastIndex.
+		/// @param Pre Sorted indices of unknowns of other processors that go before the first index.
+		/// @param Post Sorted indices of unknowns of other processors that follow the last index.
+		/// @param _comm MPI Communicator.
+		JacobianOperator(INMOST_DATA_ENUM_TYPE start, INMOST_DATA_ENUM_TYPE end, const std::vector<INMOST_DATA_ENUM_TYPE> & Pre = std::vector<INMOST_DATA_ENUM_TYPE>(), const std::vector<INMOST_DATA_ENUM_TYPE> & Post = std::vector<INMOST_DATA_ENUM_TYPE>(), INMOST_MPI_Comm _comm = INMOST_MPI_COMM_WORLD);
+		/// Constructor that takes indices from the row merger.
+		/// Collective operation in parallel, see Sparse::Direction::Resize.
+		/// @param m Row merger with non-local indices. Use Automatizator::GetMerger.
+		/// @param _comm MPI Communicator.
+		JacobianOperator(const Sparse::RowMerger & m, INMOST_MPI_Comm _comm = INMOST_MPI_COMM_WORLD);
+		/// Evaluate the residual, the derivatives along the direction are computed on assignment
+		/// into JacobianOperator::operator [].
+		virtual void Assemble() = 0;
+		/// Product with the jacobian of the form: y = alpha*J*x + beta * y.
+		/// Each product requires one evaluation of the residual.
+		void MatVec(INMOST_DATA_REAL_TYPE alpha, Sparse::Vector & x, INMOST_DATA_REAL_TYPE beta, Sparse::Vector & y);
+		/// Retrive a residual value and its derivative along the direction corresponding to certain equation.
+		/// @param row Equation number.
+		/// @return A structure that can be assigned an automatic differentiation expression.
+		__INLINE multivar_expression_reference operator [](INMOST_DATA_ENUM_TYPE row) {return multivar_expression_reference(value[row],&tangent[row],&direction);}
+		/// Retrive the first index of the equations in the local partition.
+		INMOST_DATA_ENUM_TYPE GetFirstIndex() const {return value.GetFirstIndex();}
+		/// Retrive the last index of the equations in the local partition.
+		INMOST_DATA_ENUM_TYPE GetLastIndex() const {return value.GetLastIndex();}
+		/// Retrive the residual evaluated at the last product.
+		Sparse::Vector & GetResidual() {return value;}
+		/// Retrive the product of jacobian with the direction at the last product.
+		Sparse::Vector & GetDirectional() {return tangent;}
+		virtual ~JacobianOperator() {}
+	};
 #endif //USE_SOLVER
 	
 #if defined(USE_MESH)
@@ -435,6 +514,16 @@ namespace INMOST
 		act_enum              act_blocks; ///< Deactivated blocks since they were deleted
 		INMOST_DATA_ENUM_TYPE first_num; ///< First index in unknowns of locally owned elements.
 		INMOST_DATA_ENUM_TYPE last_num; ///< Last index in unknowns of locally owned elements.
+	public:
+		/// Order in which Automatizator::EnumerateEntries numbers unknowns of each processor.
+		enum EnumerationOrder
+		{
+			EnumerateBlocks,           ///< all unknowns of one entry are numbered before unknowns of the next entry
+			EnumerateInterleaved,      ///< unknowns of all entries on one element are numbered together, elements follow the storage order
+			EnumerateInterleavedCurve  ///< unknowns of all entries on one element are numbered together, elements follow the Morton curve through their centroids
+		};
+	private:
+		EnumerationOrder      order; ///< Order of enumeration of unknowns.
 	public:
 		/// Make a copy.
 		/// \warning
@@ -475,7 +564,20 @@ namespace INMOST
 		/// 1. Have to call Automatizator::EnumerateEntries to recompute indices.
 		void UnregisterEntry(INMOST_DATA_ENUM_TYPE ind);
 		/// Set index for every data entry of dynamic tag.
+		/// The order of indices is selected with Automatizator::SetEnumerationOrder.
 		void EnumerateEntries();
+		/// Set the order in which Automatizator::EnumerateEntries numbers unknowns.
+		/// With EnumerateInterleaved or EnumerateInterleavedCurve the unknowns of all the entries on an element
+		/// receive consecutive indices, so that the jacobian has the natural block structure of the element
+		/// unknowns and the couplings of neighbouring elements stay close to the diagonal.
+		/// Unknowns of each entry on an element remain consecutive in any order, so that
+		/// Automatizator::GetIndex and Automatizator::GetUnknown are not affected.
+		/// @param _order One of EnumerateBlocks (default), EnumerateInterleaved or EnumerateInterleavedCurve.
+		/// \warning
+		/// 1. Have to call Automatizator::EnumerateEntries to recompute indices.
+		void SetEnumerationOrder(EnumerationOrder _order) {order = _order;}
+		/// Get the order in which unknowns are numbered.
+		EnumerationOrder GetEnumerationOrder() const {return order;}
 		/// Check whether the tag is still registered.
 		/// @param True if tag is still registered.
 		__INLINE bool isRegisteredEntry(INMOST_DATA_ENUM_TYPE ind) const {return act_blocks[ind];}
@@ -503,6 +605,70 @@ namespace INMOST
 		/// Lists all the indices of registered tags.
 		/// @return An array with indices corresponding to all registered tags.
 		std::vector<INMOST_DATA_ENUM_TYPE> ListRegisteredEntries() const;
+#if defined(USE_SOLVER)
+		/// Change values of unknowns of all registered entries: x = x + alpha*update.
+		/// Only unknowns with indices in the local partition are changed,
+		/// then the values are synchronized on ghost elements.
+		/// @param update Vector with the interval of the local partition, for example solution of the linear system.
+		/// @param alpha Multiplier for the update, Newton update with the solution of J*dx = R is obtained with -1.
+		void UpdateSolution(const Sparse::Vector & update, INMOST_DATA_REAL_TYPE alpha = 1.0);
+#endif //USE_SOLVER
+	};
+	
+	/// This class splits elements into colors, so that the elements of the same color
+	/// are not adjacent to the same element of a given type, i.e. faces of one color share no cell.
+	/// The loop over elements of one color writes into distinct rows of Residual and can run
+	/// in parallel without Residual::Lock.
+	/// The order of colors and of elements within each color is fixed, each row receives
+	/// contributions in the same order on any number of threads, so the assembled
+	/// residual and jacobian do not depend on the number of threads.
+	/// This order differs from the order of local identificators, thus a row sums the same
+	/// contributions as in the plain loop over elements, but the result may differ by rounding.
+	/// The coloring depends only on the mesh, it should be computed once and reused by assemblies.
+	class ElementColoring
+	{
+		Mesh * m; ///< Mesh of the colored elements.
+		std::vector<HandleType> elements; ///< Elements ordered by colors.
+		std::vector<INMOST_DATA_ENUM_TYPE> offsets; ///< Position of the first element of each color in elements.
+	public:
+		/// Empty coloring.
+		ElementColoring() : m(NULL), elements(), offsets(1,0) {}
+		/// Compute the coloring, see ElementColoring::Build.
+		ElementColoring(Mesh * m, ElementType etype = FACE, ElementType shared = CELL, MarkerType mask = 0) : m(NULL), elements(), offsets(1,0) {Build(m,etype,shared,mask);}
+		/// Greedy coloring of the elements in the order of local identificators.
+		/// @param m Mesh of the elements.
+		/// @param etype Types of the elements to be colored.
+		/// @param shared Elements adjacent to the same element of this type receive different colors.
+		/// @param mask If nonzero, only elements with this marker are colored.
+		void Build(Mesh * m, ElementType etype = FACE, ElementType shared = CELL, MarkerType mask = 0);
+		/// Retrive the number of colors.
+		INMOST_DATA_ENUM_TYPE GetColors() const {return static_cast<INMOST_DATA_ENUM_TYPE>(offsets.size()-1);}
+		/// Retrive the number of elements in the color.
+		INMOST_DATA_ENUM_TYPE Size(INMOST_DATA_ENUM_TYPE color) const {return offsets[color+1]-offsets[color];}
+		/// Retrive the total number of colored elements.
+		INMOST_DATA_ENUM_TYPE Size() const {return static_cast<INMOST_DATA_ENUM_TYPE>(elements.size());}
+		/// Retrive an element of the color.
+		/// @param color Color number.
+		/// @param k Position of the element within the color.
+		Element GetElement(INMOST_DATA_ENUM_TYPE color, INMOST_DATA_ENUM_TYPE k) const {return Element(m,elements[offsets[color]+k]);}
+		/// Retrive the mesh.
+		Mesh * GetMeshLink() const {return m;}
+		/// Call kernel(Element) for every colored element.
+		/// Colors are processed one after another, elements of one color are shared between openmp threads.
+		/// Kernel should only write into rows of the elements adjacent to the current element via shared type.
+		/// Should be called outside of openmp parallel region.
+		template<typename Kernel>
+		void Apply(Kernel & kernel) const
+		{
+			for(INMOST_DATA_ENUM_TYPE c = 0; c < GetColors(); ++c)
+			{
+#if defined(USE_OMP)
+#pragma omp parallel for schedule(static)
+#endif //USE_OMP
+				for(Storage::integer k = (Storage::integer)offsets[c]; k < (Storage::integer)offsets[c+1]; ++k)
+					kernel(Element(m,elements[k]));
+			}
+		}
 	};
 #endif //USE_MESH
 } //namespace INMOST
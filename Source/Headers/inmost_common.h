@@ -35,6 +35,7 @@
 //#define USE_MPI_P2P //use (probably) more effective mpi-2 algorithms
 //#define USE_MPI_FILE //use MPI_File_xxx functionality
 //#define USE_MPI2 //set of your version produce warnings
+//#define USE_MPI_SHMEM //use MPI-3 shared memory windows between processors of the same node
 #endif //INMOST_OPTIONS_CMAKE_INCLUDED
 
 
@@ -53,7 +54,8 @@
 
 // output xml files for debugging of parallel algorithms
 // search for style.xsl within examples for comfortable
-// view of generated xml files
+// view of generated xml files, when disabled
+// the same functions are traced at runtime by INMOST::Trace
 //#define USE_PARALLEL_WRITE_TIME
 
 // this will revert Mesh::PrepareReceiveInner to always
@@ -75,6 +77,15 @@
 // this will force array class to use 12 bytes instead of 16 bytes
 #define PACK_ARRAY
 
+// number of entries that Sparse::Row keeps inside of the object,
+// only longer rows allocate memory; this is also the size of every
+// row of Sparse::Matrix and of every variable: a row takes 12 bytes
+// with 0, 40 bytes with 2 and 264 bytes with 16 entries kept inside;
+// assembly of rows that fit is about twice faster, see Examples/ADBenchmark
+#if !defined(SPARSE_ROW_STACKED)
+#define SPARSE_ROW_STACKED 0
+#endif
+
 #define __INLINE inline
 
 #if defined(USE_OMP)
@@ -86,6 +97,11 @@
 #if !defined(MSMPI_VER) && !defined(MPIO_INCLUDE) && defined(USE_MPI_FILE) && !defined(OMPI_PROVIDE_MPI_FILE_INTERFACE)
 #include <mpio.h> //some versions of MPI doesn't include that
 #endif
+#if defined(USE_MPI_SHMEM) && (!defined(MPI_VERSION) || MPI_VERSION < 3)
+#undef USE_MPI_SHMEM //shared memory windows appeared in MPI-3
+#endif
+#else
+#undef USE_MPI_SHMEM
 #endif
 
 #include <string>
@@ -221,6 +237,8 @@ namespace INMOST
 		NoParallelMode,
 		BadParameter,
 		TopologyCheckError,
+		JacobianNotStored,
+		MapMismatch,
 		
 		/// The list of errors may occur in the Linear Solver.
 		ErrorInSolver = 400,
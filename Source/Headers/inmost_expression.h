@@ -38,13 +38,21 @@ namespace INMOST
 		virtual INMOST_DATA_REAL_TYPE GetValue() const = 0;
 		virtual void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowMerger & r) const = 0;
 		virtual void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::Row & r) const = 0;
+		/// Retrive directional derivative with multiplier into Sparse::RowTangent structure.
+		/// Expressions that do not provide it throw NotImplemented.
+		virtual void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowTangent & r) const {(void)mult; (void)r; throw NotImplemented;}
 		virtual void GetHessian(INMOST_DATA_REAL_TYPE multJ, Sparse::Row & J, INMOST_DATA_REAL_TYPE multH, Sparse::HessianRow & H) const = 0;
+		/// Evaluate the derivative of the expression along the direction,
+		/// that is the product of the row of derivatives with the direction vector.
+		/// The row of derivatives is not formed.
+		INMOST_DATA_REAL_TYPE GetDirectional(const Sparse::Direction & d) const {Sparse::RowTangent t(d); GetJacobian(1.0,t); return t.GetValue();}
 		virtual ~basic_expression() {}//if( GetAutodiffPrint() ) std::cout << this << " Destroied" << std::endl;}
 	};
 	
 	bool CheckCurrentAutomatizator();
 	void FromBasicExpression(Sparse::Row & entries, const basic_expression & expr);
 	void AddBasicExpression(Sparse::Row & entries, INMOST_DATA_REAL_TYPE multme, INMOST_DATA_REAL_TYPE multit, const basic_expression & expr);
+	void AddPatternExpression(Sparse::Row & entries, INMOST_DATA_REAL_TYPE multme, INMOST_DATA_REAL_TYPE multit, const basic_expression & expr);
 	void FromGetJacobian(const basic_expression & expr, INMOST_DATA_REAL_TYPE mult, Sparse::Row & r);
 	//bool GetAutodiffPrint();
 	//void SetAutodiffPrint(bool set);
@@ -58,6 +66,7 @@ namespace INMOST
 		__INLINE virtual INMOST_DATA_REAL_TYPE GetValue() const {return static_cast<const Derived *>(this)->GetValue(); }
 		__INLINE virtual void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowMerger & r) const { return static_cast<const Derived *>(this)->GetJacobian(mult,r); }
 		__INLINE virtual void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::Row & r) const { return static_cast<const Derived *>(this)->GetJacobian(mult,r); }
+		__INLINE virtual void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowTangent & r) const { return static_cast<const Derived *>(this)->GetJacobian(mult,r); }
 		__INLINE virtual void GetHessian(INMOST_DATA_REAL_TYPE multJ, Sparse::Row & J, INMOST_DATA_REAL_TYPE multH, Sparse::HessianRow & H) const {return static_cast<const Derived *>(this)->GetHessian(multJ,J,multH,H); }
 		operator Derived & () {return *static_cast<Derived *>(this);}
 		operator const Derived & () const {return *static_cast<const Derived *>(this);}
@@ -75,6 +84,7 @@ namespace INMOST
 		const_expression(INMOST_DATA_REAL_TYPE pvalue) : value(pvalue) {}
 		__INLINE INMOST_DATA_REAL_TYPE GetValue() const { return value; }
 		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowMerger & r) const {(void)mult; (void)r;}
+		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowTangent & r) const {(void)mult; (void)r;}
 		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::Row & r) const {(void)mult; (void)r;}
 		__INLINE void GetHessian(INMOST_DATA_REAL_TYPE multJ, Sparse::Row & J, INMOST_DATA_REAL_TYPE multH, Sparse::HessianRow & H) const {(void)multJ; (void)J; (void)multH; (void)H;}
 		__INLINE const_expression & operator =(const_expression const & other)
@@ -97,6 +107,7 @@ namespace INMOST
 		__INLINE void SetValue(INMOST_DATA_REAL_TYPE val) { value = val; }
 		__INLINE INMOST_DATA_REAL_TYPE GetValue() const { return value; }
 		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowMerger & r) const {if( index != ENUMUNDEF ) r[index] += mult;}
+		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowTangent & r) const {if( index != ENUMUNDEF ) r[index] += mult;}
 		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::Row & r) const {if( index != ENUMUNDEF ) r[index] += mult;}
 		__INLINE void GetHessian(INMOST_DATA_REAL_TYPE multJ, Sparse::Row & J, INMOST_DATA_REAL_TYPE multH, Sparse::HessianRow & H) const {if( index != ENUMUNDEF ) J.Push(index,multJ);  (void)multH; (void)H;}
 		__INLINE var_expression & operator =(var_expression const & other)
@@ -117,6 +128,222 @@ namespace INMOST
 		}
 	};
 	
+	/// A class that represents a variable with a fixed number of
+	/// first order variations (a dual number).
+	///
+	/// Derivatives are kept in a dense array of N slots, each slot corresponds
+	/// to a global unknown through a local-to-global map. Arithmetic between
+	/// such variables runs over the dense array without any allocation and
+	/// without the RowMerger, so cell-local kernels (equations of state,
+	/// relative permeabilities, etc) stay in registers. Derivatives are scattered
+	/// into the sparse row only when the variable is assigned to a variable,
+	/// a residual entry or used within a regular expression.
+	///
+	/// The map is not copied, it is referenced and should outlive all the variables
+	/// that use it. All the variables in the expression should share the same map
+	/// (constants have no map), otherwise MapMismatch is thrown.
+	/// Map entries equal to ENUMUNDEF are skipped on scatter.
+	///
+	/// Example:
+	/// \code
+	/// INMOST_DATA_ENUM_TYPE map[2] = {aut.GetIndex(c,reg,0), aut.GetIndex(c,reg,1)};
+	/// fixed_multivar_expression<2> p(c->RealArray(tag)[0],0,map), s(c->RealArray(tag)[1],1,map);
+	/// R[map[0]] = p*pow(s,2) - 1;
+	/// \endcode
+	template<int N>
+	class fixed_multivar_expression : public shell_expression< fixed_multivar_expression<N> >
+	{
+		INMOST_DATA_REAL_TYPE value; //< Value of the variable.
+		INMOST_DATA_REAL_TYPE deriv[N]; //< Dense vector of variations.
+		const INMOST_DATA_ENUM_TYPE * map; //< Global indices of variations.
+		/// Select the map for the result of the operation between two variables.
+		/// Slots of variables with different maps correspond to different unknowns and can not be combined.
+		__INLINE static const INMOST_DATA_ENUM_TYPE * merge_map(const INMOST_DATA_ENUM_TYPE * a, const INMOST_DATA_ENUM_TYPE * b)
+		{
+			if( a && b && a != b ) throw MapMismatch;
+			return a ? a : b;
+		}
+	public:
+		/// Create zero constant.
+		fixed_multivar_expression() : value(0), map(NULL) { for(int k = 0; k < N; ++k) deriv[k] = 0; }
+		/// Create constant.
+		fixed_multivar_expression(INMOST_DATA_REAL_TYPE pvalue) : value(pvalue), map(NULL) { for(int k = 0; k < N; ++k) deriv[k] = 0; }
+		/// Create an unknown in the local slot.
+		/// @param pvalue Value of the unknown.
+		/// @param pslot Position of the unknown in the map, should be less then N, otherwise MapMismatch is thrown.
+		/// @param pmap Local-to-global map of N entries.
+		/// @param pdmult Variation of the unknown.
+		fixed_multivar_expression(INMOST_DATA_REAL_TYPE pvalue, int pslot, const INMOST_DATA_ENUM_TYPE * pmap, INMOST_DATA_REAL_TYPE pdmult = 1.0)
+		: value(pvalue), map(pmap)
+		{
+			if( pslot < 0 || pslot >= N ) throw MapMismatch;
+			for(int k = 0; k < N; ++k) deriv[k] = 0;
+			deriv[pslot] = pdmult;
+		}
+		/// Evaluate regular expression and gather its variations into the slots.
+		/// All the variations of the expression should be present in the map, otherwise MapMismatch is thrown.
+		/// @param expr Expression.
+		/// @param pmap Local-to-global map of N entries.
+		fixed_multivar_expression(const basic_expression & expr, const INMOST_DATA_ENUM_TYPE * pmap)
+		: value(expr.GetValue()), map(pmap)
+		{
+			Sparse::Row tmp;
+			expr.GetJacobian(1.0,tmp);
+			for(int k = 0; k < N; ++k) deriv[k] = 0;
+			for(Sparse::Row::iterator it = tmp.Begin(); it != tmp.End(); ++it)
+			{
+				int k = 0;
+				while( k < N && map[k] != it->first ) ++k;
+				if( k == N ) throw MapMismatch; //variation is not in the map
+				deriv[k] += it->second;
+			}
+		}
+		fixed_multivar_expression(const fixed_multivar_expression & other) : value(other.value), map(other.map)
+		{
+			for(int k = 0; k < N; ++k) deriv[k] = other.deriv[k];
+		}
+		__INLINE fixed_multivar_expression & operator = (fixed_multivar_expression const & other)
+		{
+			value = other.value;
+			map = other.map;
+			for(int k = 0; k < N; ++k) deriv[k] = other.deriv[k];
+			return *this;
+		}
+		__INLINE fixed_multivar_expression & operator = (INMOST_DATA_REAL_TYPE pvalue)
+		{
+			value = pvalue;
+			map = NULL;
+			for(int k = 0; k < N; ++k) deriv[k] = 0;
+			return *this;
+		}
+		__INLINE INMOST_DATA_REAL_TYPE GetValue() const { return value; }
+		__INLINE void SetValue(INMOST_DATA_REAL_TYPE val) { value = val; }
+		/// Retrive variation in the local slot.
+		__INLINE INMOST_DATA_REAL_TYPE GetDerivative(int k) const { return deriv[k]; }
+		/// Set variation in the local slot.
+		__INLINE void SetDerivative(int k, INMOST_DATA_REAL_TYPE val) { deriv[k] = val; }
+		/// Retrive local-to-global map, NULL for constants.
+		__INLINE const INMOST_DATA_ENUM_TYPE * GetMap() const { return map; }
+		/// Set local-to-global map.
+		__INLINE void SetMap(const INMOST_DATA_ENUM_TYPE * pmap) { map = pmap; }
+		/// Number of slots.
+		__INLINE static int Size() { return N; }
+		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowMerger & r) const
+		{
+			if( map ) for(int k = 0; k < N; ++k) if( map[k] != ENUMUNDEF ) r[map[k]] += deriv[k]*mult;
+		}
+		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowTangent & r) const
+		{
+			if( map ) for(int k = 0; k < N; ++k) if( map[k] != ENUMUNDEF ) r[map[k]] += deriv[k]*mult;
+		}
+		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::Row & r) const
+		{
+			if( map ) for(int k = 0; k < N; ++k) if( map[k] != ENUMUNDEF ) r[map[k]] += deriv[k]*mult;
+		}
+		__INLINE void GetHessian(INMOST_DATA_REAL_TYPE multJ, Sparse::Row & J, INMOST_DATA_REAL_TYPE multH, Sparse::HessianRow & H) const
+		{
+			GetRow(J,multJ);
+			H.Clear();
+			(void)multH;
+		}
+		/// Replace the contents of the row with sorted variations.
+		/// @param r Row to be filled.
+		/// @param mult Multiplier for the variations.
+		__INLINE void GetRow(Sparse::Row & r, INMOST_DATA_REAL_TYPE mult = 1.0) const
+		{
+			r.Clear();
+			if( map ) for(int k = 0; k < N; ++k) if( map[k] != ENUMUNDEF ) r.Push(map[k],deriv[k]*mult);
+			if( !r.isSorted() ) std::sort(r.Begin(),r.End());
+		}
+		/// Result of a function of this variable with provided value and derivative.
+		/// @param fvalue Value of the function.
+		/// @param fdmult Derivative of the function with respect to this variable.
+		__INLINE fixed_multivar_expression Compose(INMOST_DATA_REAL_TYPE fvalue, INMOST_DATA_REAL_TYPE fdmult) const
+		{
+			fixed_multivar_expression ret(*this);
+			ret.value = fvalue;
+			for(int k = 0; k < N; ++k) ret.deriv[k] *= fdmult;
+			return ret;
+		}
+		/// Result of a function of two variables with provided value and derivatives.
+		/// @param other Second argument of the function.
+		/// @param fvalue Value of the function.
+		/// @param ldmult Derivative of the function with respect to this variable.
+		/// @param rdmult Derivative of the function with respect to the other variable.
+		__INLINE fixed_multivar_expression Compose(const fixed_multivar_expression & other, INMOST_DATA_REAL_TYPE fvalue, INMOST_DATA_REAL_TYPE ldmult, INMOST_DATA_REAL_TYPE rdmult) const
+		{
+			fixed_multivar_expression ret;
+			ret.value = fvalue;
+			ret.map = merge_map(map,other.map);
+			for(int k = 0; k < N; ++k) ret.deriv[k] = deriv[k]*ldmult + other.deriv[k]*rdmult;
+			return ret;
+		}
+		__INLINE fixed_multivar_expression & operator +=(fixed_multivar_expression const & other)
+		{
+			value += other.value;
+			map = merge_map(map,other.map);
+			for(int k = 0; k < N; ++k) deriv[k] += other.deriv[k];
+			return *this;
+		}
+		__INLINE fixed_multivar_expression & operator -=(fixed_multivar_expression const & other)
+		{
+			value -= other.value;
+			map = merge_map(map,other.map);
+			for(int k = 0; k < N; ++k) deriv[k] -= other.deriv[k];
+			return *this;
+		}
+		__INLINE fixed_multivar_expression & operator *=(fixed_multivar_expression const & other)
+		{
+			map = merge_map(map,other.map);
+			for(int k = 0; k < N; ++k) deriv[k] = deriv[k]*other.value + value*other.deriv[k];
+			value *= other.value;
+			return *this;
+		}
+		__INLINE fixed_multivar_expression & operator /=(fixed_multivar_expression const & other)
+		{
+			INMOST_DATA_REAL_TYPE reciprocial_rval = 1.0/other.value;
+			value *= reciprocial_rval;
+			map = merge_map(map,other.map);
+			for(int k = 0; k < N; ++k) deriv[k] = (deriv[k] - value*other.deriv[k])*reciprocial_rval;
+			return *this;
+		}
+		__INLINE fixed_multivar_expression & operator +=(INMOST_DATA_REAL_TYPE right)
+		{
+			value += right;
+			return *this;
+		}
+		__INLINE fixed_multivar_expression & operator -=(INMOST_DATA_REAL_TYPE right)
+		{
+			value -= right;
+			return *this;
+		}
+		__INLINE fixed_multivar_expression & operator *=(INMOST_DATA_REAL_TYPE right)
+		{
+			value *= right;
+			for(int k = 0; k < N; ++k) deriv[k] *= right;
+			return *this;
+		}
+		__INLINE fixed_multivar_expression & operator /=(INMOST_DATA_REAL_TYPE right)
+		{
+			INMOST_DATA_REAL_TYPE reciprocial_rval = 1.0/right;
+			value *= reciprocial_rval;
+			for(int k = 0; k < N; ++k) deriv[k] *= reciprocial_rval;
+			return *this;
+		}
+		bool check_nans() const
+		{
+			if( value != value ) return true;
+			for(int k = 0; k < N; ++k) if( deriv[k] != deriv[k] ) return true;
+			return false;
+		}
+		void Print() const
+		{
+			std::cout << value << std::endl;
+			for(int k = 0; k < N; ++k) std::cout << "(" << (map ? map[k] : ENUMUNDEF) << "," << deriv[k] << ") ";
+			std::cout << std::endl;
+		}
+	};
+	
 #if defined(PACK_ARRAY)
 #pragma pack(push,r1,4)
 #endif
@@ -147,6 +374,12 @@ namespace INMOST
 				FromBasicExpression(entries,expr); //Optimized version
 			else expr.GetJacobian(1.0,entries);
 		}
+		template<int N>
+		multivar_expression(const fixed_multivar_expression<N> & expr)
+		{
+			value = expr.GetValue();
+			expr.GetRow(entries);
+		}
 		__INLINE INMOST_DATA_REAL_TYPE GetValue() const { return value; }
 		__INLINE void SetValue(INMOST_DATA_REAL_TYPE val) { value = val; }
 		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowMerger & r) const
@@ -154,6 +387,11 @@ namespace INMOST
 			for(Sparse::Row::const_iterator it = entries.Begin(); it != entries.End(); ++it)
 				r[it->first] += it->second*mult;
 		}
+		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowTangent & r) const
+		{
+			for(Sparse::Row::const_iterator it = entries.Begin(); it != entries.End(); ++it)
+				r[it->first] += it->second*mult;
+		}
 		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::Row & r) const
 		{
 			if( CheckCurrentAutomatizator() )
@@ -196,6 +434,29 @@ namespace INMOST
 			entries = other.entries;
 			return *this;
 		}
+		template<int N>
+		__INLINE multivar_expression & operator = (fixed_multivar_expression<N> const & expr)
+		{
+			value = expr.GetValue();
+			expr.GetRow(entries);
+			return *this;
+		}
+		template<int N>
+		__INLINE multivar_expression & operator +=(fixed_multivar_expression<N> const & expr)
+		{
+			value += expr.GetValue();
+			expr.GetJacobian(1.0,entries);
+			if( !entries.isSorted() ) std::sort(entries.Begin(),entries.End());
+			return *this;
+		}
+		template<int N>
+		__INLINE multivar_expression & operator -=(fixed_multivar_expression<N> const & expr)
+		{
+			value -= expr.GetValue();
+			expr.GetJacobian(-1.0,entries);
+			if( !entries.isSorted() ) std::sort(entries.Begin(),entries.End());
+			return *this;
+		}
 		__INLINE Sparse::Row & GetRow() {return entries;}
 		__INLINE const Sparse::Row & GetRow() const {return entries;}
 		__INLINE multivar_expression & operator +=(basic_expression const & expr)
@@ -392,6 +653,11 @@ namespace INMOST
 			for(Sparse::Row::const_iterator it = entries.Begin(); it != entries.End(); ++it)
 				r[it->first] += it->second*mult;
 		}
+		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowTangent & r) const
+		{
+			for(Sparse::Row::const_iterator it = entries.Begin(); it != entries.End(); ++it)
+				r[it->first] += it->second*mult;
+		}
 		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::Row & r) const
 		{
 			if( CheckCurrentAutomatizator() )
@@ -565,31 +831,77 @@ namespace INMOST
 	{
 		INMOST_DATA_REAL_TYPE & value;
 		Sparse::Row * entries;
+		bool fixed_pattern; ///< Derivatives are written into the entries already present in the row.
+		INMOST_DATA_REAL_TYPE * tangent; ///< Derivative along the direction, used instead of the row.
+		const Sparse::Direction * direction; ///< Direction of differentiation, the row is not stored if set.
+		/// Scale the entries of the row and add derivatives of the expression with multiplier into them.
+		/// Performs operation entries=multme*entries+multit*expr keeping the pattern of the row.
+		/// With Automatizator the derivatives are gathered in its RowMerger and written into the entries of the row.
+		/// Without it they are added directly into the row when it is not scaled, otherwise a temporary row is used,
+		/// since the expression may refer to the row itself.
+		__INLINE void AddFixedPattern(INMOST_DATA_REAL_TYPE multme, INMOST_DATA_REAL_TYPE multit, basic_expression const & expr)
+		{
+			if( CheckCurrentAutomatizator() )
+				AddPatternExpression(*entries,multme,multit,expr);
+			else if( multme == 1.0 )
+			{
+				expr.GetJacobian(multit,*entries);
+				if( !entries->isSorted() ) std::sort(entries->Begin(),entries->End());
+			}
+			else
+			{
+				Sparse::Row tmp;
+				expr.GetJacobian(multit,tmp);
+				if( multme == 0.0 )
+					entries->Zero();
+				else
+					for(Sparse::Row::iterator it = entries->Begin(); it != entries->End(); ++it) it->second *= multme;
+				entries->AddToPattern(1.0,tmp);
+			}
+		}
 	public:
 		/// Default constructor
-		multivar_expression_reference() : value(stub_multivar_expression_reference_value), entries(NULL) {}
+		multivar_expression_reference() : value(stub_multivar_expression_reference_value), entries(NULL), fixed_pattern(false), tangent(NULL), direction(NULL) {}
 		/// Constructor, set links to the provided value and entries
-		multivar_expression_reference(INMOST_DATA_REAL_TYPE & _value, Sparse::Row * _entries)
-		: value(_value), entries(_entries) {}
+		/// @param _fixed_pattern Keep the pattern of the row, write derivatives into existing entries.
+		multivar_expression_reference(INMOST_DATA_REAL_TYPE & _value, Sparse::Row * _entries, bool _fixed_pattern = false)
+		: value(_value), entries(_entries), fixed_pattern(_fixed_pattern), tangent(NULL), direction(NULL) {}
+		/// Constructor for evaluation of derivative along the direction, the row of derivatives is not stored.
+		/// @param _tangent Storage for the derivative of the value along the direction.
+		/// @param _direction Direction of differentiation.
+		multivar_expression_reference(INMOST_DATA_REAL_TYPE & _value, INMOST_DATA_REAL_TYPE * _tangent, const Sparse::Direction * _direction)
+		: value(_value), entries(NULL), fixed_pattern(false), tangent(_tangent), direction(_direction) {}
 		/// Copy constructor, sets links to the same reference of value and entries
 		multivar_expression_reference(const multivar_expression_reference & other)
-		: value(other.value), entries(other.entries) {}
+		: value(other.value), entries(other.entries), fixed_pattern(other.fixed_pattern), tangent(other.tangent), direction(other.direction) {}
 		/// Copy constructor from multivar_expression, sets links to the same reference of value and entries
 		multivar_expression_reference(multivar_expression & other)
-		: value(other.value), entries(&other.entries) {}
+		: value(other.value), entries(&other.entries), fixed_pattern(false), tangent(NULL), direction(NULL) {}
 		/// Retrive value
 		__INLINE INMOST_DATA_REAL_TYPE GetValue() const { return value; }
 		/// Set value without changing derivatives
 		__INLINE void SetValue(INMOST_DATA_REAL_TYPE val) { value = val; }
 		/// Retrive derivatives with multiplier into Sparse::RowMerger structure.
+		/// Throws JacobianNotStored for evaluation along the direction.
 		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowMerger & r) const
 		{
+			if( direction ) throw JacobianNotStored;
 			for(Sparse::Row::iterator it = entries->Begin(); it != entries->End(); ++it)
 				r[it->first] += it->second*mult;
 		}
+		/// Retrive directional derivative with multiplier into Sparse::RowTangent structure.
+		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowTangent & r) const
+		{
+			if( direction )
+				r.Add(*tangent*mult);
+			else for(Sparse::Row::iterator it = entries->Begin(); it != entries->End(); ++it)
+				r[it->first] += it->second*mult;
+		}
 		/// Retrive derivatives with multiplier into Sparse::Row structure.
+		/// Throws JacobianNotStored for evaluation along the direction.
 		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::Row & r) const
 		{
+			if( direction ) throw JacobianNotStored;
 			if( CheckCurrentAutomatizator() )
 				FromGetJacobian(*this,mult,r);
 			else
@@ -598,8 +910,10 @@ namespace INMOST
 					r[it->first] += it->second*mult;
 			}
 		}
+		/// Throws JacobianNotStored for evaluation along the direction.
 		__INLINE void GetHessian(INMOST_DATA_REAL_TYPE multJ, Sparse::Row & J,INMOST_DATA_REAL_TYPE multH, Sparse::HessianRow & H) const
 		{
+			if( direction ) throw JacobianNotStored;
 			J = *entries;
 			if( !J.isSorted() ) std::sort(J.Begin(),J.End());
 			for(Sparse::Row::iterator it = J.Begin(); it != J.End(); ++it) it->second *= multJ;
@@ -608,13 +922,22 @@ namespace INMOST
 		__INLINE multivar_expression_reference & operator = (INMOST_DATA_REAL_TYPE pvalue)
 		{
 			value = pvalue;
-			entries->Clear();
+			if( direction )
+				*tangent = 0.0;
+			else if( fixed_pattern )
+				entries->Zero();
+			else
+				entries->Clear();
 			return *this;
 		}
 		__INLINE multivar_expression_reference & operator = (basic_expression const & expr)
 		{
 			value = expr.GetValue();
-			if( CheckCurrentAutomatizator() )
+			if( direction )
+				*tangent = expr.GetDirectional(*direction);
+			else if( fixed_pattern )
+				AddFixedPattern(0.0,1.0,expr);
+			else if( CheckCurrentAutomatizator() )
 				FromBasicExpression(*entries,expr);
 			else
 			{
@@ -627,21 +950,76 @@ namespace INMOST
 		__INLINE multivar_expression_reference & operator = (multivar_expression_reference const & other)
 		{
 			value = other.GetValue();
-			*entries = other.GetRow();
+			if( direction )
+				*tangent = other.GetDirectional(*direction);
+			else if( fixed_pattern )
+				AddFixedPattern(0.0,1.0,other);
+			else *entries = other.GetRow();
 			return *this;
 		}
 		__INLINE multivar_expression_reference & operator = (multivar_expression const & other)
 		{
 			value = other.GetValue();
-			*entries = other.GetRow();
+			if( direction )
+				*tangent = other.GetDirectional(*direction);
+			else if( fixed_pattern )
+				AddFixedPattern(0.0,1.0,other);
+			else *entries = other.GetRow();
 			return *this;
 		}
-		__INLINE Sparse::Row & GetRow() {return *entries;}
-		__INLINE const Sparse::Row & GetRow() const {return *entries;}
+		template<int N>
+		__INLINE multivar_expression_reference & operator = (fixed_multivar_expression<N> const & expr)
+		{
+			value = expr.GetValue();
+			if( direction )
+				*tangent = expr.GetDirectional(*direction);
+			else if( fixed_pattern )
+			{
+				entries->Zero();
+				expr.GetJacobian(1.0,*entries);
+				if( !entries->isSorted() ) std::sort(entries->Begin(),entries->End());
+			}
+			else expr.GetRow(*entries);
+			return *this;
+		}
+		template<int N>
+		__INLINE multivar_expression_reference & operator +=(fixed_multivar_expression<N> const & expr)
+		{
+			value += expr.GetValue();
+			if( direction )
+				*tangent += expr.GetDirectional(*direction);
+			else
+			{
+				expr.GetJacobian(1.0,*entries);
+				if( !entries->isSorted() ) std::sort(entries->Begin(),entries->End());
+			}
+			return *this;
+		}
+		template<int N>
+		__INLINE multivar_expression_reference & operator -=(fixed_multivar_expression<N> const & expr)
+		{
+			value -= expr.GetValue();
+			if( direction )
+				*tangent -= expr.GetDirectional(*direction);
+			else
+			{
+				expr.GetJacobian(-1.0,*entries);
+				if( !entries->isSorted() ) std::sort(entries->Begin(),entries->End());
+			}
+			return *this;
+		}
+		/// Retrive the row of derivatives, throws JacobianNotStored for evaluation along the direction.
+		__INLINE Sparse::Row & GetRow() {if( direction ) throw JacobianNotStored; return *entries;}
+		/// Retrive the row of derivatives, throws JacobianNotStored for evaluation along the direction.
+		__INLINE const Sparse::Row & GetRow() const {if( direction ) throw JacobianNotStored; return *entries;}
 		__INLINE multivar_expression_reference & operator +=(basic_expression const & expr)
 		{
 			value += expr.GetValue();
-			if( CheckCurrentAutomatizator() )
+			if( direction )
+				*tangent += expr.GetDirectional(*direction);
+			else if( fixed_pattern )
+				AddFixedPattern(1.0,1.0,expr);
+			else if( CheckCurrentAutomatizator() )
 				AddBasicExpression(*entries,1.0,1.0,expr);
 			else
 			{
@@ -654,7 +1032,11 @@ namespace INMOST
 		__INLINE multivar_expression_reference & operator -=(basic_expression const & expr)
 		{
 			value -= expr.GetValue();
-			if( CheckCurrentAutomatizator() )
+			if( direction )
+				*tangent -= expr.GetDirectional(*direction);
+			else if( fixed_pattern )
+				AddFixedPattern(1.0,-1.0,expr);
+			else if( CheckCurrentAutomatizator() )
 				AddBasicExpression(*entries,1.0,-1.0,expr);
 			else
 			{
@@ -667,7 +1049,11 @@ namespace INMOST
 		__INLINE multivar_expression_reference & operator *=(basic_expression const & expr)
 		{
 			INMOST_DATA_REAL_TYPE lval = value, rval = expr.GetValue();
-			if( CheckCurrentAutomatizator() )
+			if( direction )
+				*tangent = *tangent*rval + lval*expr.GetDirectional(*direction);
+			else if( fixed_pattern )
+				AddFixedPattern(rval,lval,expr);
+			else if( CheckCurrentAutomatizator() )
 				AddBasicExpression(*entries,rval,lval,expr);
 			else
 			{
@@ -684,7 +1070,11 @@ namespace INMOST
 			INMOST_DATA_REAL_TYPE rval = expr.GetValue();
 			INMOST_DATA_REAL_TYPE reciprocial_rval = 1.0/rval;
 			value *= reciprocial_rval;
-			if( CheckCurrentAutomatizator() )
+			if( direction )
+				*tangent = (*tangent - value*expr.GetDirectional(*direction))*reciprocial_rval;
+			else if( fixed_pattern )
+				AddFixedPattern(reciprocial_rval,-value*reciprocial_rval,expr);
+			else if( CheckCurrentAutomatizator() )
 				AddBasicExpression(*entries,reciprocial_rval,-value*reciprocial_rval,expr);
 			else
 			{
@@ -708,18 +1098,23 @@ namespace INMOST
 		__INLINE multivar_expression_reference & operator *=(INMOST_DATA_REAL_TYPE right)
 		{
 			value *= right;
-			for(Sparse::Row::iterator it = entries->Begin(); it != entries->End(); ++it) it->second *= right;
+			if( direction )
+				*tangent *= right;
+			else for(Sparse::Row::iterator it = entries->Begin(); it != entries->End(); ++it) it->second *= right;
 			return *this;
 		}
 		__INLINE multivar_expression_reference & operator /=(INMOST_DATA_REAL_TYPE right)
 		{
 			value /= right;
-			for(Sparse::Row::iterator it = entries->Begin(); it != entries->End(); ++it) it->second /= right;
+			if( direction )
+				*tangent /= right;
+			else for(Sparse::Row::iterator it = entries->Begin(); it != entries->End(); ++it) it->second /= right;
 			return *this;
 		}
 		bool check_nans() const
 		{
 			if( value != value ) return true;
+			if( direction ) return *tangent != *tangent;
 			for(Sparse::Row::iterator it = entries->Begin(); it != entries->End(); ++it)
 				if( it->second != it->second ) return true;
 			return false;
@@ -753,6 +1148,12 @@ namespace INMOST
 			for(Sparse::Row::iterator it = entries->Begin(); it != entries->End(); ++it)
 				r[it->first] += it->second*mult;
 		}
+		/// Retrive directional derivative with multiplier into Sparse::RowTangent structure.
+		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowTangent & r) const
+		{
+			for(Sparse::Row::iterator it = entries->Begin(); it != entries->End(); ++it)
+				r[it->first] += it->second*mult;
+		}
 		/// Retrive derivatives with multiplier into Sparse::Row structure.
 		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::Row & r) const
 		{
@@ -949,6 +1350,10 @@ namespace INMOST
 		{
 			arg.GetJacobian(mult*dmult,r);
 		}
+		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowTangent & r) const
+		{
+			arg.GetJacobian(mult*dmult,r);
+		}
 		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::Row & r) const
 		{
 			arg.GetJacobian(mult*dmult,r);
@@ -975,6 +1380,10 @@ namespace INMOST
 		{
 			arg.GetJacobian(mult*dmult,r);
 		}
+		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowTangent & r) const
+		{
+			arg.GetJacobian(mult*dmult,r);
+		}
 		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::Row & r) const
 		{
 			arg.GetJacobian(mult*dmult,r);
@@ -1003,6 +1412,10 @@ namespace INMOST
 		{
 			arg.GetJacobian(mult*dmult,r);
 		}
+		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowTangent & r) const
+		{
+			arg.GetJacobian(mult*dmult,r);
+		}
 		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::Row & r) const
 		{
 			arg.GetJacobian(mult*dmult,r);
@@ -1029,6 +1442,10 @@ namespace INMOST
 		{
 			arg.GetJacobian(mult,r);
 		}
+		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowTangent & r) const
+		{
+			arg.GetJacobian(mult,r);
+		}
 		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::Row & r) const
 		{
 			arg.GetJacobian(mult,r);
@@ -1055,6 +1472,10 @@ namespace INMOST
 		{
 			arg.GetJacobian(-mult,r);
 		}
+		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowTangent & r) const
+		{
+			arg.GetJacobian(-mult,r);
+		}
 		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::Row & r) const
 		{
 			arg.GetJacobian(-mult,r);
@@ -1085,6 +1506,10 @@ namespace INMOST
 		{
 			arg.GetJacobian(-mult*value*reciprocial_val,r);
 		}
+		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowTangent & r) const
+		{
+			arg.GetJacobian(-mult*value*reciprocial_val,r);
+		}
 		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::Row & r) const
 		{
 			arg.GetJacobian(-mult*value*reciprocial_val,r);
@@ -1113,6 +1538,10 @@ namespace INMOST
 		{
 			arg.GetJacobian(-mult,r);
 		}
+		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowTangent & r) const
+		{
+			arg.GetJacobian(-mult,r);
+		}
 		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::Row & r) const
 		{
 			arg.GetJacobian(-mult,r);
@@ -1136,6 +1565,10 @@ namespace INMOST
 		{
 			arg.GetJacobian(mult,r);
 		}
+		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowTangent & r) const
+		{
+			arg.GetJacobian(mult,r);
+		}
 		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::Row & r) const
 		{
 			arg.GetJacobian(mult,r);
@@ -1164,6 +1597,10 @@ namespace INMOST
 		{
 			arg.GetJacobian( (value == 0 ? (mult < 0.0 ? -1 : 1) : 1) * mult * dmult, r);
 		}
+		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowTangent & r) const
+		{
+			arg.GetJacobian( (value == 0 ? (mult < 0.0 ? -1 : 1) : 1) * mult * dmult, r);
+		}
 		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::Row & r) const
 		{
 			arg.GetJacobian( (value == 0 ? (mult < 0.0 ? -1 : 1) : 1) * mult * dmult, r);
@@ -1194,6 +1631,10 @@ namespace INMOST
 		{
 			arg.GetJacobian( mult * value, r);
 		}
+		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowTangent & r) const
+		{
+			arg.GetJacobian( mult * value, r);
+		}
 		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::Row & r) const
 		{
 			arg.GetJacobian( mult * value, r);
@@ -1227,6 +1668,10 @@ namespace INMOST
 		{
 			arg.GetJacobian(mult*dmult,r);
 		}
+		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowTangent & r) const
+		{
+			arg.GetJacobian(mult*dmult,r);
+		}
 		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::Row & r) const
 		{
 			arg.GetJacobian(mult*dmult,r);
@@ -1261,6 +1706,10 @@ namespace INMOST
 		{
 			arg.GetJacobian(mult*dmult,r);
 		}
+		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowTangent & r) const
+		{
+			arg.GetJacobian(mult*dmult,r);
+		}
 		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::Row & r) const
 		{
 			arg.GetJacobian(mult*dmult,r);
@@ -1295,6 +1744,10 @@ namespace INMOST
 		{
 			arg.GetJacobian(mult*dmult,r);
 		}
+		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowTangent & r) const
+		{
+			arg.GetJacobian(mult*dmult,r);
+		}
 		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::Row & r) const
 		{
 			arg.GetJacobian(mult*dmult,r);
@@ -1325,6 +1778,10 @@ namespace INMOST
 		{
 			arg.GetJacobian(0.5*mult/value,r);
 		}
+		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowTangent & r) const
+		{
+			arg.GetJacobian(0.5*mult/value,r);
+		}
 		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::Row & r) const
 		{
 			arg.GetJacobian(0.5*mult/value,r);
@@ -1360,6 +1817,10 @@ namespace INMOST
 		{
 			arg.GetJacobian(mult*dmult,r);
 		}
+		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowTangent & r) const
+		{
+			arg.GetJacobian(mult*dmult,r);
+		}
 		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::Row & r) const
 		{
 			arg.GetJacobian(mult*dmult,r);
@@ -1390,6 +1851,10 @@ namespace INMOST
 		{
 			arg.GetJacobian(mult*dmult,r);
 		}
+		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowTangent & r) const
+		{
+			arg.GetJacobian(mult*dmult,r);
+		}
 		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::Row & r) const
 		{
 			arg.GetJacobian(mult*dmult,r);
@@ -1423,6 +1888,11 @@ namespace INMOST
 			left.GetJacobian(mult*ldmult,r);
 			right.GetJacobian(mult*rdmult,r);
 		}
+		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowTangent & r) const
+		{
+			left.GetJacobian(mult*ldmult,r);
+			right.GetJacobian(mult*rdmult,r);
+		}
 		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::Row & r) const
 		{
 			left.GetJacobian(mult*ldmult,r);
@@ -1457,6 +1927,11 @@ namespace INMOST
 			left.GetJacobian(mult*ldmult,r);
 			right.GetJacobian(mult*rdmult,r);
 		}
+		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowTangent & r) const
+		{
+			left.GetJacobian(mult*ldmult,r);
+			right.GetJacobian(mult*rdmult,r);
+		}
 		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::Row & r) const
 		{
 			left.GetJacobian(mult*ldmult,r);
@@ -1488,6 +1963,11 @@ namespace INMOST
 			left.GetJacobian(mult*right.GetValue(),r);
 			right.GetJacobian(mult*left.GetValue(),r);
 		}
+		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowTangent & r) const
+		{
+			left.GetJacobian(mult*right.GetValue(),r);
+			right.GetJacobian(mult*left.GetValue(),r);
+		}
 		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::Row & r) const
 		{
 			left.GetJacobian(mult*right.GetValue(),r);
@@ -1538,6 +2018,11 @@ namespace INMOST
 			left.GetJacobian(mult * reciprocal_rval,r);
 			right.GetJacobian(- mult * value * reciprocal_rval,r);
 		}
+		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowTangent & r) const
+		{
+			left.GetJacobian(mult * reciprocal_rval,r);
+			right.GetJacobian(- mult * value * reciprocal_rval,r);
+		}
 		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::Row & r) const
 		{
 			left.GetJacobian(mult * reciprocal_rval,r);
@@ -1580,6 +2065,11 @@ namespace INMOST
 			left.GetJacobian(mult,r);
 			right.GetJacobian(mult,r);
 		}
+		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowTangent & r) const
+		{
+			left.GetJacobian(mult,r);
+			right.GetJacobian(mult,r);
+		}
 		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::Row & r) const
 		{
 			left.GetJacobian(mult,r);
@@ -1621,6 +2111,11 @@ namespace INMOST
 			left.GetJacobian(mult,r);
 			right.GetJacobian(-mult,r);
 		}
+		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowTangent & r) const
+		{
+			left.GetJacobian(mult,r);
+			right.GetJacobian(-mult,r);
+		}
 		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::Row & r) const
 		{
 			left.GetJacobian(mult,r);
@@ -1670,6 +2165,11 @@ namespace INMOST
 			left.GetJacobian(mult*ldmult,r);
 			right.GetJacobian(mult*rdmult,r);
 		}
+		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowTangent & r) const
+		{
+			left.GetJacobian(mult*ldmult,r);
+			right.GetJacobian(mult*rdmult,r);
+		}
 		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::Row & r) const
 		{
 			left.GetJacobian(mult*ldmult,r);
@@ -1706,6 +2206,11 @@ namespace INMOST
 			left.GetJacobian(mult*ldmult,r);
 			right.GetJacobian(mult*rdmult,r);
 		}
+		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowTangent & r) const
+		{
+			left.GetJacobian(mult*ldmult,r);
+			right.GetJacobian(mult*rdmult,r);
+		}
 		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::Row & r) const
 		{
 			left.GetJacobian(mult*ldmult,r);
@@ -1742,6 +2247,10 @@ namespace INMOST
 		{
 			left.GetJacobian(mult*ldmult,r);
 		}
+		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowTangent & r) const
+		{
+			left.GetJacobian(mult*ldmult,r);
+		}
 		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::Row & r) const
 		{
 			left.GetJacobian(mult*ldmult,r);
@@ -1780,6 +2289,10 @@ namespace INMOST
 		{
 			right.GetJacobian(mult*rdmult,r);
 		}
+		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowTangent & r) const
+		{
+			right.GetJacobian(mult*rdmult,r);
+		}
 		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::Row & r) const
 		{
 			right.GetJacobian(mult*rdmult,r);
@@ -1814,6 +2327,13 @@ namespace INMOST
 			else
 				right.GetJacobian(mult,r);
 		}
+		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowTangent & r) const
+		{
+			if( cond_value >= 0.0 )
+				left.GetJacobian(mult,r);
+			else
+				right.GetJacobian(mult,r);
+		}
 		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::Row & r) const
 		{
 			if( cond_value >= 0.0 )
@@ -1857,6 +2377,13 @@ namespace INMOST
 			else
 				right.GetJacobian(mult,r);
 		}
+		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowTangent & r) const
+		{
+			if( cond )
+				left.GetJacobian(mult,r);
+			else
+				right.GetJacobian(mult,r);
+		}
 		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::Row & r) const
 		{
 			if( cond )
@@ -1894,28 +2421,36 @@ namespace INMOST
 		__INLINE INMOST_DATA_REAL_TYPE GetValue() const { return value; }
 		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowMerger & r) const
 		{
-			for(typename dynarray< const_multiplication_expression<A>, 64 >::iterator it = arg.begin(); it != arg.end(); ++it)
+			for(typename dynarray< const_multiplication_expression<A>, 64 >::const_iterator it = arg.begin(); it != arg.end(); ++it)
+				it->GetJacobian(mult,r);
+		}
+		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowTangent & r) const
+		{
+			for(typename dynarray< const_multiplication_expression<A>, 64 >::const_iterator it = arg.begin(); it != arg.end(); ++it)
 				it->GetJacobian(mult,r);
 		}
 		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::Row & r) const
 		{
-			for(typename dynarray< const_multiplication_expression<A>, 64 >::iterator it = arg.begin(); it != arg.end(); ++it)
+			for(typename dynarray< const_multiplication_expression<A>, 64 >::const_iterator it = arg.begin(); it != arg.end(); ++it)
 				it->GetJacobian(mult,r);
 		}
 		__INLINE void GetHessian(INMOST_DATA_REAL_TYPE multJ, Sparse::Row & J, INMOST_DATA_REAL_TYPE multH, Sparse::HessianRow & H) const
 		{
+			// hessian rows of the terms are gathered and compressed once
 			Sparse::Row tmpJ, curJ;
-			Sparse::HessianRow tmpH, curH;
-			for(typename dynarray< const_multiplication_expression<A>, 64 >::iterator it = arg.begin(); it != arg.end(); ++it)
+			Sparse::HessianRow curH;
+			Sparse::HessianRowMerger merger;
+			merger.AddRow(1.0,H);
+			for(typename dynarray< const_multiplication_expression<A>, 64 >::const_iterator it = arg.begin(); it != arg.end(); ++it)
 			{
 				curJ.Clear();
 				curH.Clear();
 				it->GetHessian(multJ,curJ,multH,curH);
 				Sparse::Row::MergeSortedRows(1.0,curJ,1.0,J,tmpJ);
-				Sparse::HessianRow::MergeSortedRows(1.0,curH,1.0,H,tmpH);
+				merger.AddRow(1.0,curH);
 				J.Swap(tmpJ);
-				H.Swap(tmpH);
 			}
+			merger.RetrieveRow(H);
 		}
 	};
 	
@@ -1937,6 +2472,10 @@ namespace INMOST
 		{
 			arg.GetJacobian(mult*dmult,r);
 		}
+		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowTangent & r) const
+		{
+			arg.GetJacobian(mult*dmult,r);
+		}
 		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::Row & r) const
 		{
 			arg.GetJacobian(mult*dmult,r);
@@ -2048,6 +2587,441 @@ namespace INMOST
 		INMOST_DATA_ENUM_TYPE GetSize() const {return size;}
 	};
 	
+	/// Tape for reverse mode (adjoint) differentiation.
+	///
+	/// Every assignment to tape_variable records a node on the tape that keeps
+	/// partial derivatives of the assigned expression with respect to unknowns and
+	/// with respect to previously recorded nodes. Partial derivatives of a single
+	/// statement are obtained with the usual sweep over the expression template,
+	/// so intermediate variables do not carry full rows of variations as
+	/// multivar_expression does. Gradient of any node with respect to unknowns
+	/// is then obtained with a single backward pass over the recorded nodes.
+	///
+	/// Nodes are stored in contiguous arrays that retain memory on Tape::Clear,
+	/// so that the tape can be reused for repeated evaluations without reallocation.
+	/// Tape should not be shared between threads.
+	class Tape
+	{
+		std::vector<Sparse::Row::entry> leafs; ///< Partial derivatives of all nodes with respect to unknowns.
+		std::vector<Sparse::Row::entry> links; ///< Partial derivatives of all nodes with respect to previous nodes.
+		std::vector<INMOST_DATA_ENUM_TYPE> leafs_offset; ///< Node k owns leafs in [leafs_offset[k],leafs_offset[k+1]).
+		std::vector<INMOST_DATA_ENUM_TYPE> links_offset; ///< Node k owns links in [links_offset[k],links_offset[k+1]).
+		mutable std::vector<INMOST_DATA_REAL_TYPE> adjoints; ///< Adjoints of nodes, kept zero between backward passes.
+		mutable Sparse::Row gather; ///< Temporary storage for gradient.
+		mutable INMOST_DATA_ENUM_TYPE seeded; ///< Last node with nonzero adjoint or ENUMUNDEF.
+		bool recording; ///< Statement is being recorded.
+		mutable bool seeding; ///< Uses of variables are seeded into adjoints, the backward pass is delayed.
+		Tape(const Tape & other);
+		Tape & operator =(const Tape & other);
+		/// Backward pass from the last seeded node that adds gradients of all seeded nodes into r.
+		template<typename RowType>
+		void Sweep(RowType & r) const
+		{
+			if( seeded == ENUMUNDEF ) return;
+			for(INMOST_DATA_ENUM_TYPE k = seeded+1; k-- > 0; )
+			{
+				INMOST_DATA_REAL_TYPE a = adjoints[k];
+				if( a == 0.0 ) continue;
+				adjoints[k] = 0.0;
+				for(INMOST_DATA_ENUM_TYPE q = leafs_offset[k]; q < leafs_offset[k+1]; ++q)
+					r[leafs[q].first] += a*leafs[q].second;
+				for(INMOST_DATA_ENUM_TYPE q = links_offset[k]; q < links_offset[k+1]; ++q)
+					adjoints[links[q].first] += a*links[q].second;
+			}
+			seeded = ENUMUNDEF;
+		}
+		/// Backward pass into a row, entries are gathered and merged to avoid search in the row.
+		void Sweep(Sparse::Row & r) const;
+	public:
+		Tape();
+		/// Record a new node with value prev*multprev + expr*multit.
+		/// @param expr Expression of unknowns and variables on the tape.
+		/// @param multit Multiplier for the expression.
+		/// @param prev Previously recorded node or ENUMUNDEF.
+		/// @param multprev Multiplier for the previously recorded node.
+		/// @return Position of the new node.
+		INMOST_DATA_ENUM_TYPE Record(const basic_expression & expr, INMOST_DATA_REAL_TYPE multit = 1.0, INMOST_DATA_ENUM_TYPE prev = ENUMUNDEF, INMOST_DATA_REAL_TYPE multprev = 0.0);
+		/// Is a statement being recorded. Used by tape_variable to decide how to report derivatives.
+		__INLINE bool isRecording() const {return recording;}
+		/// Are the uses of variables seeded for a delayed backward pass, see Tape::Gradient.
+		__INLINE bool isSeeding() const {return seeding;}
+		/// Add dependency of the node being recorded on the node.
+		__INLINE void Link(INMOST_DATA_ENUM_TYPE node, INMOST_DATA_REAL_TYPE mult) {links.push_back(Sparse::Row::make_entry(node,mult));}
+		/// Add multiplier to the adjoint of the node for the delayed backward pass.
+		__INLINE void Seed(INMOST_DATA_ENUM_TYPE node, INMOST_DATA_REAL_TYPE mult) const
+		{
+			assert(node < Size());
+			if( adjoints.size() < leafs_offset.size() ) adjoints.resize(leafs_offset.size(),0.0);
+			adjoints[node] += mult;
+			if( seeded == ENUMUNDEF || node > seeded ) seeded = node;
+		}
+		/// Number of recorded nodes.
+		__INLINE INMOST_DATA_ENUM_TYPE Size() const {return static_cast<INMOST_DATA_ENUM_TYPE>(leafs_offset.size()-1);}
+		/// Remove all the nodes, memory is retained.
+		void Clear();
+		/// Backward pass that adds the gradient of the node multiplied by mult into r.
+		/// @param node Position of the node on the tape.
+		/// @param mult Multiplier for the gradient.
+		/// @param r Row, merger or tangent accumulator.
+		template<typename RowType>
+		void Gradient(INMOST_DATA_ENUM_TYPE node, INMOST_DATA_REAL_TYPE mult, RowType & r) const
+		{
+			Seed(node,mult);
+			Sweep(r);
+		}
+		/// Add the gradient of the expression multiplied by mult into r with a single backward pass.
+		/// All the uses of variables of this tape in the expression are seeded first, so that
+		/// the variables used several times or sharing earlier nodes are swept once.
+		/// Otherwise each use of tape_variable in the expression performs its own backward pass.
+		/// @param expr Expression of unknowns and variables on the tape.
+		/// @param mult Multiplier for the gradient.
+		/// @param r Row, merger or tangent accumulator.
+		template<typename RowType>
+		void Gradient(const basic_expression & expr, INMOST_DATA_REAL_TYPE mult, RowType & r) const
+		{
+			assert(!recording && !seeding);
+			seeding = true;
+			expr.GetJacobian(mult,r);
+			seeding = false;
+			Sweep(r);
+		}
+	};
+	
+	/// A variable recorded on the Tape for reverse mode differentiation.
+	/// Stores only the value and the position of the node on the tape,
+	/// variations are obtained from the tape with the backward pass.
+	/// Each use of the variable in an expression performs its own backward pass,
+	/// differentiate the expression with Tape::Gradient or record it on the tape
+	/// to obtain the derivatives of all the uses with a single backward pass.
+	/// Second order variations are not recorded.
+	class tape_variable : public shell_expression<tape_variable>
+	{
+		INMOST_DATA_REAL_TYPE value; //< Value of the variable.
+		INMOST_DATA_ENUM_TYPE node; //< Position on the tape, ENUMUNDEF for constant.
+		Tape * tape; //< Tape where the variable is recorded.
+		template<typename RowType>
+		__INLINE void Propagate(INMOST_DATA_REAL_TYPE mult, RowType & r) const
+		{
+			if( node == ENUMUNDEF ) return;
+			if( tape->isRecording() )
+				tape->Link(node,mult);
+			else if( tape->isSeeding() )
+				tape->Seed(node,mult);
+			else
+				tape->Gradient(node,mult,r);
+		}
+	public:
+		tape_variable(Tape & t, INMOST_DATA_REAL_TYPE pvalue = 0.0) : value(pvalue), node(ENUMUNDEF), tape(&t) {}
+		tape_variable(Tape & t, const basic_expression & expr) : value(expr.GetValue()), node(t.Record(expr)), tape(&t) {}
+		tape_variable(const tape_variable & other) : value(other.value), node(other.node), tape(other.tape) {}
+		__INLINE INMOST_DATA_REAL_TYPE GetValue() const { return value; }
+		/// Position of the node on the tape, ENUMUNDEF for constant.
+		__INLINE INMOST_DATA_ENUM_TYPE GetNode() const { return node; }
+		__INLINE Tape & GetTape() const { return *tape; }
+		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowMerger & r) const {Propagate(mult,r);}
+		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowTangent & r) const {Propagate(mult,r);}
+		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::Row & r) const {Propagate(mult,r);}
+		__INLINE void GetHessian(INMOST_DATA_REAL_TYPE multJ, Sparse::Row & J, INMOST_DATA_REAL_TYPE multH, Sparse::HessianRow & H) const
+		{
+			(void)multH;
+			J.Clear();
+			H.Clear();
+			if( node != ENUMUNDEF ) tape->Gradient(node,multJ,J);
+		}
+		__INLINE tape_variable & operator = (INMOST_DATA_REAL_TYPE pvalue)
+		{
+			value = pvalue;
+			node = ENUMUNDEF;
+			return *this;
+		}
+		__INLINE tape_variable & operator = (basic_expression const & expr)
+		{
+			node = tape->Record(expr);
+			value = expr.GetValue();
+			return *this;
+		}
+		__INLINE tape_variable & operator = (tape_variable const & other)
+		{
+			value = other.value;
+			node = other.node;
+			tape = other.tape;
+			return *this;
+		}
+		__INLINE tape_variable & operator +=(basic_expression const & expr)
+		{
+			node = tape->Record(expr,1.0,node,1.0);
+			value += expr.GetValue();
+			return *this;
+		}
+		__INLINE tape_variable & operator -=(basic_expression const & expr)
+		{
+			node = tape->Record(expr,-1.0,node,1.0);
+			value -= expr.GetValue();
+			return *this;
+		}
+		__INLINE tape_variable & operator *=(basic_expression const & expr)
+		{
+			INMOST_DATA_REAL_TYPE rval = expr.GetValue();
+			node = tape->Record(expr,value,node,rval);
+			value *= rval;
+			return *this;
+		}
+		__INLINE tape_variable & operator /=(basic_expression const & expr)
+		{
+			INMOST_DATA_REAL_TYPE rval = expr.GetValue(), reciprocial_rval = 1.0/rval;
+			value *= reciprocial_rval;
+			node = tape->Record(expr,-value*reciprocial_rval,node,reciprocial_rval);
+			return *this;
+		}
+		__INLINE tape_variable & operator +=(INMOST_DATA_REAL_TYPE right)
+		{
+			value += right;
+			return *this;
+		}
+		__INLINE tape_variable & operator -=(INMOST_DATA_REAL_TYPE right)
+		{
+			value -= right;
+			return *this;
+		}
+		__INLINE tape_variable & operator *=(INMOST_DATA_REAL_TYPE right)
+		{
+			if( node != ENUMUNDEF ) node = tape->Record(const_expression(0.0),0.0,node,right);
+			value *= right;
+			return *this;
+		}
+		__INLINE tape_variable & operator /=(INMOST_DATA_REAL_TYPE right)
+		{
+			if( node != ENUMUNDEF ) node = tape->Record(const_expression(0.0),0.0,node,1.0/right);
+			value /= right;
+			return *this;
+		}
+		bool check_nans() const
+		{
+			return value != value;
+		}
+	};
+	
+	class CompiledExpression;
+	
+	/// A variable used to record an expression into CompiledExpression.
+	/// Arithmetic operations and functions on code_variable do not compute
+	/// anything, they append instructions to the code of the expression.
+	/// Write the expression as a template function of the variable type,
+	/// so that the same code can be evaluated with variable or recorded with code_variable.
+	class code_variable
+	{
+		CompiledExpression * code; //< Code where the instructions are recorded.
+		INMOST_DATA_ENUM_TYPE reg; //< Instruction that computes the variable.
+	public:
+		code_variable() : code(NULL), reg(ENUMUNDEF) {}
+		code_variable(CompiledExpression * code, INMOST_DATA_ENUM_TYPE reg) : code(code), reg(reg) {}
+		code_variable(const code_variable & other) : code(other.code), reg(other.reg) {}
+		code_variable & operator =(const code_variable & other) {code = other.code; reg = other.reg; return *this;}
+		__INLINE CompiledExpression * GetCode() const {return code;}
+		__INLINE INMOST_DATA_ENUM_TYPE GetRegister() const {return reg;}
+		__INLINE code_variable & operator +=(const code_variable & other);
+		__INLINE code_variable & operator -=(const code_variable & other);
+		__INLINE code_variable & operator *=(const code_variable & other);
+		__INLINE code_variable & operator /=(const code_variable & other);
+		__INLINE code_variable & operator +=(INMOST_DATA_REAL_TYPE other);
+		__INLINE code_variable & operator -=(INMOST_DATA_REAL_TYPE other);
+		__INLINE code_variable & operator *=(INMOST_DATA_REAL_TYPE other);
+		__INLINE code_variable & operator /=(INMOST_DATA_REAL_TYPE other);
+	};
+	
+	/// Expression recorded once into a compact code and evaluated for many sets of inputs.
+	///
+	/// Inputs are placeholders, for example for values of unknowns on the cells
+	/// adjacent to a face. The code is a sequence of instructions, each instruction
+	/// computes one intermediate value from previous ones. CompiledExpression::Evaluate
+	/// runs every instruction in a plain loop over a block of input sets, then
+	/// obtains derivatives of outputs with respect to inputs with a backward pass
+	/// over the instructions. There is no virtual call and no expression rebuilt per set,
+	/// and the loops over sets can be vectorized by the compiler.
+	///
+	/// Example of recording:
+	/// \code
+	/// CompiledExpression flux;
+	/// code_variable p1 = flux.Input(), p2 = flux.Input(), T = flux.Input();
+	/// flux.Output(T*(p1-p2)*exp(p1));
+	/// \endcode
+	/// Use ExpressionBatch to evaluate the recorded expression and to add the results into the residual.
+	class CompiledExpression
+	{
+	public:
+		/// Operations of instructions.
+		enum Operation
+		{
+			OpInput,    ///< value of input with number a
+			OpConst,    ///< constant c
+			OpAdd,      ///< a + b
+			OpSub,      ///< a - b
+			OpMul,      ///< a * b
+			OpDiv,      ///< a / b
+			OpAddConst, ///< a + c
+			OpMulConst, ///< a * c
+			OpConstDiv, ///< c / a
+			OpPowConst, ///< a ^ c
+			OpConstPow, ///< c ^ a
+			OpPow,      ///< a ^ b
+			OpAbs,      ///< |a|
+			OpExp,      ///< exp(a)
+			OpLog,      ///< log(a)
+			OpSin,      ///< sin(a)
+			OpCos,      ///< cos(a)
+			OpSqrt      ///< sqrt(a)
+		};
+		/// Number of input sets processed together by CompiledExpression::Evaluate.
+		static const INMOST_DATA_ENUM_TYPE BlockSize = 64;
+	private:
+		typedef struct instruction_s
+		{
+			Operation op; ///< Operation.
+			INMOST_DATA_ENUM_TYPE a; ///< First argument, instruction or input number.
+			INMOST_DATA_ENUM_TYPE b; ///< Second argument, instruction.
+			INMOST_DATA_REAL_TYPE c; ///< Constant argument.
+		} instruction;
+		std::vector<instruction> code; ///< Instructions in the order of execution.
+		std::vector<INMOST_DATA_ENUM_TYPE> inputs; ///< Instructions that load inputs.
+		std::vector<INMOST_DATA_ENUM_TYPE> outputs; ///< Instructions that compute outputs.
+		std::vector<char> dependencies; ///< Output o depends on input k if dependencies[o*GetInputs()+k] is nonzero.
+	public:
+		CompiledExpression() {}
+		/// Add a new input, inputs are numbered in the order of creation.
+		code_variable Input();
+		/// Record a constant.
+		code_variable Constant(INMOST_DATA_REAL_TYPE c) {return Emit(OpConst,ENUMUNDEF,ENUMUNDEF,c);}
+		/// Mark the variable as the next output, outputs are numbered in the order of marking.
+		/// All inputs should be added before the first output.
+		void Output(const code_variable & v);
+		/// Retrive flags of dependency of the output on inputs, nonzero if the output depends on the input.
+		/// Only dependent inputs contribute to the jacobian, as with expression templates.
+		const char * GetDependencies(INMOST_DATA_ENUM_TYPE o) const {return &dependencies[o*GetInputs()];}
+		/// Append instruction, used by operations on code_variable.
+		code_variable Emit(Operation op, INMOST_DATA_ENUM_TYPE a, INMOST_DATA_ENUM_TYPE b = ENUMUNDEF, INMOST_DATA_REAL_TYPE c = 0.0);
+		/// Number of inputs.
+		INMOST_DATA_ENUM_TYPE GetInputs() const {return static_cast<INMOST_DATA_ENUM_TYPE>(inputs.size());}
+		/// Number of outputs.
+		INMOST_DATA_ENUM_TYPE GetOutputs() const {return static_cast<INMOST_DATA_ENUM_TYPE>(outputs.size());}
+		/// Number of instructions.
+		INMOST_DATA_ENUM_TYPE Size() const {return static_cast<INMOST_DATA_ENUM_TYPE>(code.size());}
+		/// Remove all the instructions, inputs and outputs.
+		void Clear();
+		/// Compute values and derivatives of outputs for n sets of inputs.
+		/// Arrays are stored by components: value of input k for set l is in[k*n+l].
+		/// @param n Number of sets of inputs.
+		/// @param in Inputs, array of size GetInputs()*n.
+		/// @param values Outputs, value of output o for set l is values[o*n+l], array of size GetOutputs()*n.
+		/// @param derivatives Derivatives of outputs with respect to inputs, derivative of output o with respect
+		/// to input k for set l is derivatives[(o*GetInputs()+k)*n+l], array of size GetOutputs()*GetInputs()*n.
+		void Evaluate(INMOST_DATA_ENUM_TYPE n, const INMOST_DATA_REAL_TYPE * in, INMOST_DATA_REAL_TYPE * values, INMOST_DATA_REAL_TYPE * derivatives) const;
+	};
+	
+	__INLINE code_variable & code_variable::operator +=(const code_variable & other) {return *this = code->Emit(CompiledExpression::OpAdd,reg,other.reg);}
+	__INLINE code_variable & code_variable::operator -=(const code_variable & other) {return *this = code->Emit(CompiledExpression::OpSub,reg,other.reg);}
+	__INLINE code_variable & code_variable::operator *=(const code_variable & other) {return *this = code->Emit(CompiledExpression::OpMul,reg,other.reg);}
+	__INLINE code_variable & code_variable::operator /=(const code_variable & other) {return *this = code->Emit(CompiledExpression::OpDiv,reg,other.reg);}
+	__INLINE code_variable & code_variable::operator +=(INMOST_DATA_REAL_TYPE other) {return *this = code->Emit(CompiledExpression::OpAddConst,reg,ENUMUNDEF,other);}
+	__INLINE code_variable & code_variable::operator -=(INMOST_DATA_REAL_TYPE other) {return *this = code->Emit(CompiledExpression::OpAddConst,reg,ENUMUNDEF,-other);}
+	__INLINE code_variable & code_variable::operator *=(INMOST_DATA_REAL_TYPE other) {return *this = code->Emit(CompiledExpression::OpMulConst,reg,ENUMUNDEF,other);}
+	__INLINE code_variable & code_variable::operator /=(INMOST_DATA_REAL_TYPE other) {return *this = code->Emit(CompiledExpression::OpMulConst,reg,ENUMUNDEF,1.0/other);}
+	
+	/// Result of CompiledExpression for one set of inputs, see ExpressionBatch.
+	/// Derivatives with respect to inputs are translated into derivatives with respect
+	/// to unknowns with the indices of inputs, so that the result can be used in expressions
+	/// and added into the residual.
+	class compiled_value : public shell_expression<compiled_value>
+	{
+		INMOST_DATA_REAL_TYPE value; //< Value of the output.
+		const INMOST_DATA_REAL_TYPE * derivatives; //< Derivative with respect to input k is derivatives[k*stride].
+		const INMOST_DATA_ENUM_TYPE * indices; //< Index of input k is indices[k*stride].
+		const char * dependencies; //< Output depends on input k if dependencies[k] is nonzero.
+		INMOST_DATA_ENUM_TYPE inputs; //< Number of inputs.
+		INMOST_DATA_ENUM_TYPE stride; //< Distance between components.
+		template<typename RowType>
+		__INLINE void Propagate(INMOST_DATA_REAL_TYPE mult, RowType & r) const
+		{
+			for(INMOST_DATA_ENUM_TYPE k = 0; k < inputs; ++k)
+				if( dependencies[k] && indices[k*stride] != ENUMUNDEF ) r[indices[k*stride]] += mult*derivatives[k*stride];
+		}
+	public:
+		compiled_value(INMOST_DATA_REAL_TYPE value, const INMOST_DATA_REAL_TYPE * derivatives, const INMOST_DATA_ENUM_TYPE * indices, const char * dependencies, INMOST_DATA_ENUM_TYPE inputs, INMOST_DATA_ENUM_TYPE stride)
+		: value(value), derivatives(derivatives), indices(indices), dependencies(dependencies), inputs(inputs), stride(stride) {}
+		compiled_value(const compiled_value & other)
+		: value(other.value), derivatives(other.derivatives), indices(other.indices), dependencies(other.dependencies), inputs(other.inputs), stride(other.stride) {}
+		__INLINE INMOST_DATA_REAL_TYPE GetValue() const { return value; }
+		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowMerger & r) const {Propagate(mult,r);}
+		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowTangent & r) const {Propagate(mult,r);}
+		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::Row & r) const
+		{
+			if( CheckCurrentAutomatizator() )
+				FromGetJacobian(*this,mult,r);
+			else
+				Propagate(mult,r);
+		}
+		/// Second order derivatives are not computed by CompiledExpression, throws NotImplemented.
+		__INLINE void GetHessian(INMOST_DATA_REAL_TYPE multJ, Sparse::Row & J, INMOST_DATA_REAL_TYPE multH, Sparse::HessianRow & H) const
+		{
+			(void)multJ; (void)J; (void)multH; (void)H;
+			throw NotImplemented;
+		}
+	};
+	
+	/// Storage for inputs and results of CompiledExpression evaluated for many sets of inputs.
+	/// Each set of inputs provides values and indices of inputs, inputs with index ENUMUNDEF
+	/// are parameters and do not contribute to derivatives of the results.
+	class ExpressionBatch
+	{
+		const CompiledExpression * code; ///< Evaluated expression.
+		INMOST_DATA_ENUM_TYPE size; ///< Number of sets of inputs.
+		std::vector<INMOST_DATA_REAL_TYPE> inputs; ///< Values of inputs, see CompiledExpression::Evaluate.
+		std::vector<INMOST_DATA_ENUM_TYPE> indices; ///< Indices of inputs, same layout as values.
+		std::vector<INMOST_DATA_REAL_TYPE> values; ///< Values of outputs.
+		std::vector<INMOST_DATA_REAL_TYPE> derivatives; ///< Derivatives of outputs with respect to inputs.
+	public:
+		/// Constructor.
+		/// @param code Recorded expression, should not change while the batch is used.
+		/// @param size Number of sets of inputs.
+		ExpressionBatch(const CompiledExpression & code, INMOST_DATA_ENUM_TYPE size = 0) : code(&code), size(0) {Resize(size);}
+		/// Change the number of sets of inputs, all inputs are reset.
+		void Resize(INMOST_DATA_ENUM_TYPE _size)
+		{
+			size = _size;
+			inputs.assign(code->GetInputs()*size,0.0);
+			indices.assign(code->GetInputs()*size,ENUMUNDEF);
+			values.assign(code->GetOutputs()*size,0.0);
+			derivatives.assign(code->GetOutputs()*code->GetInputs()*size,0.0);
+		}
+		/// Number of sets of inputs.
+		INMOST_DATA_ENUM_TYPE Size() const {return size;}
+		/// Set the input of the set.
+		/// @param l Number of the set.
+		/// @param k Number of the input.
+		/// @param value Value of the input.
+		/// @param index Index of the unknown for the input or ENUMUNDEF for a parameter.
+		void SetInput(INMOST_DATA_ENUM_TYPE l, INMOST_DATA_ENUM_TYPE k, INMOST_DATA_REAL_TYPE value, INMOST_DATA_ENUM_TYPE index = ENUMUNDEF)
+		{
+			assert(l < size && k < code->GetInputs());
+			inputs[k*size+l] = value;
+			indices[k*size+l] = index;
+		}
+		/// Evaluate outputs and their derivatives for all the sets.
+		void Evaluate()
+		{
+			if( size ) code->Evaluate(size,&inputs[0],&values[0],&derivatives[0]);
+		}
+		/// Value of the output for the set.
+		INMOST_DATA_REAL_TYPE GetValue(INMOST_DATA_ENUM_TYPE l, INMOST_DATA_ENUM_TYPE o = 0) const {return values[o*size+l];}
+		/// Derivative of the output with respect to the input for the set.
+		INMOST_DATA_REAL_TYPE GetDerivative(INMOST_DATA_ENUM_TYPE l, INMOST_DATA_ENUM_TYPE k, INMOST_DATA_ENUM_TYPE o = 0) const {return derivatives[(o*code->GetInputs()+k)*size+l];}
+		/// Output for the set with derivatives with respect to unknowns, valid until the next Resize.
+		compiled_value operator ()(INMOST_DATA_ENUM_TYPE l, INMOST_DATA_ENUM_TYPE o = 0) const
+		{
+			assert(l < size && o < code->GetOutputs());
+			return compiled_value(values[o*size+l],&derivatives[o*code->GetInputs()*size+l],&indices[l],code->GetDependencies(o),code->GetInputs(),size);
+		}
+	};
+	
 	typedef multivar_expression variable;
 	typedef hessian_multivar_expression hessian_variable;
 	typedef var_expression unknown;
@@ -2184,6 +3158,73 @@ template<class A>          __INLINE                 INMOST::function_expression<
 	return INMOST::function_expression<A>(Arg,both.first,both.second);
 }
 __INLINE                          INMOST_DATA_REAL_TYPE get_table(INMOST_DATA_REAL_TYPE Arg, const INMOST::keyval_table & Table) {return Table.GetValue(Arg);}
+template<int N>            __INLINE                                          bool check_nans(INMOST::fixed_multivar_expression<N> const & e) {return e.check_nans();}
+template<int N>            __INLINE                                          void set_value(INMOST::fixed_multivar_expression<N> & Arg, INMOST_DATA_REAL_TYPE Val) {Arg.SetValue(Val);}
+template<int N>            __INLINE                                          void    assign(INMOST::fixed_multivar_expression<N> & Arg, const INMOST::fixed_multivar_expression<N> & Val) {Arg = Val;}
+template<int N>            __INLINE                                          void    assign(INMOST::fixed_multivar_expression<N> & Arg, INMOST_DATA_REAL_TYPE Val) {Arg = Val;}
+template<int N>            __INLINE      INMOST::fixed_multivar_expression<N> operator-(INMOST::fixed_multivar_expression<N> const & Arg) { return Arg.Compose(-Arg.GetValue(),-1.0); }
+template<int N>            __INLINE      INMOST::fixed_multivar_expression<N> operator+(INMOST::fixed_multivar_expression<N> const & Arg) { return Arg; }
+template<int N>            __INLINE      INMOST::fixed_multivar_expression<N> operator+(INMOST::fixed_multivar_expression<N> const & Left, INMOST::fixed_multivar_expression<N> const & Right) { INMOST::fixed_multivar_expression<N> ret(Left); ret += Right; return ret; }
+template<int N>            __INLINE      INMOST::fixed_multivar_expression<N> operator-(INMOST::fixed_multivar_expression<N> const & Left, INMOST::fixed_multivar_expression<N> const & Right) { INMOST::fixed_multivar_expression<N> ret(Left); ret -= Right; return ret; }
+template<int N>            __INLINE      INMOST::fixed_multivar_expression<N> operator*(INMOST::fixed_multivar_expression<N> const & Left, INMOST::fixed_multivar_expression<N> const & Right) { INMOST::fixed_multivar_expression<N> ret(Left); ret *= Right; return ret; }
+template<int N>            __INLINE      INMOST::fixed_multivar_expression<N> operator/(INMOST::fixed_multivar_expression<N> const & Left, INMOST::fixed_multivar_expression<N> const & Right) { INMOST::fixed_multivar_expression<N> ret(Left); ret /= Right; return ret; }
+template<int N>            __INLINE      INMOST::fixed_multivar_expression<N> operator+(INMOST::fixed_multivar_expression<N> const & Left, INMOST_DATA_REAL_TYPE Right) { INMOST::fixed_multivar_expression<N> ret(Left); ret += Right; return ret; }
+template<int N>            __INLINE      INMOST::fixed_multivar_expression<N> operator-(INMOST::fixed_multivar_expression<N> const & Left, INMOST_DATA_REAL_TYPE Right) { INMOST::fixed_multivar_expression<N> ret(Left); ret -= Right; return ret; }
+template<int N>            __INLINE      INMOST::fixed_multivar_expression<N> operator*(INMOST::fixed_multivar_expression<N> const & Left, INMOST_DATA_REAL_TYPE Right) { INMOST::fixed_multivar_expression<N> ret(Left); ret *= Right; return ret; }
+template<int N>            __INLINE      INMOST::fixed_multivar_expression<N> operator/(INMOST::fixed_multivar_expression<N> const & Left, INMOST_DATA_REAL_TYPE Right) { INMOST::fixed_multivar_expression<N> ret(Left); ret /= Right; return ret; }
+template<int N>            __INLINE      INMOST::fixed_multivar_expression<N> operator+(INMOST_DATA_REAL_TYPE Left, INMOST::fixed_multivar_expression<N> const & Right) { INMOST::fixed_multivar_expression<N> ret(Right); ret += Left; return ret; }
+template<int N>            __INLINE      INMOST::fixed_multivar_expression<N> operator-(INMOST_DATA_REAL_TYPE Left, INMOST::fixed_multivar_expression<N> const & Right) { return Right.Compose(Left-Right.GetValue(),-1.0); }
+template<int N>            __INLINE      INMOST::fixed_multivar_expression<N> operator*(INMOST_DATA_REAL_TYPE Left, INMOST::fixed_multivar_expression<N> const & Right) { INMOST::fixed_multivar_expression<N> ret(Right); ret *= Left; return ret; }
+template<int N>            __INLINE      INMOST::fixed_multivar_expression<N> operator/(INMOST_DATA_REAL_TYPE Left, INMOST::fixed_multivar_expression<N> const & Right) { INMOST_DATA_REAL_TYPE rval = 1.0/Right.GetValue(); return Right.Compose(Left*rval,-Left*rval*rval); }
+template<int N>            __INLINE      INMOST::fixed_multivar_expression<N>      fabs(INMOST::fixed_multivar_expression<N> const & Arg) { INMOST_DATA_REAL_TYPE val = Arg.GetValue(); return Arg.Compose(::fabs(val),val < 0.0 ? -1.0 : 1.0); }
+template<int N>            __INLINE      INMOST::fixed_multivar_expression<N>       exp(INMOST::fixed_multivar_expression<N> const & Arg) { INMOST_DATA_REAL_TYPE val = ::exp(Arg.GetValue()); return Arg.Compose(val,val); }
+template<int N>            __INLINE      INMOST::fixed_multivar_expression<N>       log(INMOST::fixed_multivar_expression<N> const & Arg) { INMOST_DATA_REAL_TYPE val = Arg.GetValue(); return Arg.Compose(::log(val),1.0/val); }
+template<int N>            __INLINE      INMOST::fixed_multivar_expression<N>       sin(INMOST::fixed_multivar_expression<N> const & Arg) { INMOST_DATA_REAL_TYPE val = Arg.GetValue(); return Arg.Compose(::sin(val),::cos(val)); }
+template<int N>            __INLINE      INMOST::fixed_multivar_expression<N>       cos(INMOST::fixed_multivar_expression<N> const & Arg) { INMOST_DATA_REAL_TYPE val = Arg.GetValue(); return Arg.Compose(::cos(val),-::sin(val)); }
+template<int N>            __INLINE      INMOST::fixed_multivar_expression<N>      sqrt(INMOST::fixed_multivar_expression<N> const & Arg) { INMOST_DATA_REAL_TYPE val = ::sqrt(Arg.GetValue()); return Arg.Compose(val,0.5/val); }
+template<int N>            __INLINE      INMOST::fixed_multivar_expression<N> variation(INMOST::fixed_multivar_expression<N> const & Arg, INMOST_DATA_REAL_TYPE Mult) { return Arg.Compose(Arg.GetValue(),Mult); }
+template<int N>            __INLINE      INMOST::fixed_multivar_expression<N>       pow(INMOST::fixed_multivar_expression<N> const & Left, INMOST_DATA_REAL_TYPE Right) { INMOST_DATA_REAL_TYPE lval = Left.GetValue(), val = ::pow(lval,Right); return Left.Compose(val,lval != 0 ? val*Right/lval : 0.0); }
+template<int N>            __INLINE      INMOST::fixed_multivar_expression<N>       pow(INMOST_DATA_REAL_TYPE Left, INMOST::fixed_multivar_expression<N> const & Right) { INMOST_DATA_REAL_TYPE val = ::pow(Left,Right.GetValue()); return Right.Compose(val,Left != 0 ? val*::log(Left) : 0.0); }
+template<int N>            __INLINE      INMOST::fixed_multivar_expression<N>       pow(INMOST::fixed_multivar_expression<N> const & Left, INMOST::fixed_multivar_expression<N> const & Right)
+{
+	INMOST_DATA_REAL_TYPE lval = Left.GetValue(), rval = Right.GetValue(), val = ::pow(lval,rval);
+	if( lval != 0 ) return Left.Compose(Right,val,val*rval/lval,val*::log(lval));
+	return Left.Compose(Right,val,0.0,0.0);
+}
+template<int N>            __INLINE      INMOST::fixed_multivar_expression<N>     atan2(INMOST::fixed_multivar_expression<N> const & Left, INMOST::fixed_multivar_expression<N> const & Right)
+{
+	INMOST_DATA_REAL_TYPE lval = Left.GetValue(), rval = Right.GetValue(), den = 1.0/(lval*lval+rval*rval);
+	return Left.Compose(Right,::atan2(lval,rval),rval*den,-lval*den);
+}
+template<int N>            __INLINE      INMOST::fixed_multivar_expression<N> get_table(INMOST::fixed_multivar_expression<N> const & Arg, const INMOST::keyval_table & Table)
+{
+	std::pair<INMOST_DATA_REAL_TYPE, INMOST_DATA_REAL_TYPE> both = Table.GetBoth(Arg.GetValue());
+	return Arg.Compose(both.first,both.second);
+}
+
+__INLINE                                    INMOST::code_variable operator-(INMOST::code_variable const & Arg) { return Arg.GetCode()->Emit(INMOST::CompiledExpression::OpMulConst,Arg.GetRegister(),ENUMUNDEF,-1.0); }
+__INLINE                                    INMOST::code_variable operator+(INMOST::code_variable const & Arg) { return Arg; }
+__INLINE                                    INMOST::code_variable operator+(INMOST::code_variable const & Left, INMOST::code_variable const & Right) { return Left.GetCode()->Emit(INMOST::CompiledExpression::OpAdd,Left.GetRegister(),Right.GetRegister()); }
+__INLINE                                    INMOST::code_variable operator-(INMOST::code_variable const & Left, INMOST::code_variable const & Right) { return Left.GetCode()->Emit(INMOST::CompiledExpression::OpSub,Left.GetRegister(),Right.GetRegister()); }
+__INLINE                                    INMOST::code_variable operator*(INMOST::code_variable const & Left, INMOST::code_variable const & Right) { return Left.GetCode()->Emit(INMOST::CompiledExpression::OpMul,Left.GetRegister(),Right.GetRegister()); }
+__INLINE                                    INMOST::code_variable operator/(INMOST::code_variable const & Left, INMOST::code_variable const & Right) { return Left.GetCode()->Emit(INMOST::CompiledExpression::OpDiv,Left.GetRegister(),Right.GetRegister()); }
+__INLINE                                    INMOST::code_variable operator+(INMOST::code_variable const & Left, INMOST_DATA_REAL_TYPE Right) { return Left.GetCode()->Emit(INMOST::CompiledExpression::OpAddConst,Left.GetRegister(),ENUMUNDEF,Right); }
+__INLINE                                    INMOST::code_variable operator-(INMOST::code_variable const & Left, INMOST_DATA_REAL_TYPE Right) { return Left.GetCode()->Emit(INMOST::CompiledExpression::OpAddConst,Left.GetRegister(),ENUMUNDEF,-Right); }
+__INLINE                                    INMOST::code_variable operator*(INMOST::code_variable const & Left, INMOST_DATA_REAL_TYPE Right) { return Left.GetCode()->Emit(INMOST::CompiledExpression::OpMulConst,Left.GetRegister(),ENUMUNDEF,Right); }
+__INLINE                                    INMOST::code_variable operator/(INMOST::code_variable const & Left, INMOST_DATA_REAL_TYPE Right) { return Left.GetCode()->Emit(INMOST::CompiledExpression::OpMulConst,Left.GetRegister(),ENUMUNDEF,1.0/Right); }
+__INLINE                                    INMOST::code_variable operator+(INMOST_DATA_REAL_TYPE Left, INMOST::code_variable const & Right) { return Right.GetCode()->Emit(INMOST::CompiledExpression::OpAddConst,Right.GetRegister(),ENUMUNDEF,Left); }
+__INLINE                                    INMOST::code_variable operator-(INMOST_DATA_REAL_TYPE Left, INMOST::code_variable const & Right) { return -Right + Left; }
+__INLINE                                    INMOST::code_variable operator*(INMOST_DATA_REAL_TYPE Left, INMOST::code_variable const & Right) { return Right.GetCode()->Emit(INMOST::CompiledExpression::OpMulConst,Right.GetRegister(),ENUMUNDEF,Left); }
+__INLINE                                    INMOST::code_variable operator/(INMOST_DATA_REAL_TYPE Left, INMOST::code_variable const & Right) { return Right.GetCode()->Emit(INMOST::CompiledExpression::OpConstDiv,Right.GetRegister(),ENUMUNDEF,Left); }
+__INLINE                                    INMOST::code_variable      fabs(INMOST::code_variable const & Arg) { return Arg.GetCode()->Emit(INMOST::CompiledExpression::OpAbs,Arg.GetRegister()); }
+__INLINE                                    INMOST::code_variable       exp(INMOST::code_variable const & Arg) { return Arg.GetCode()->Emit(INMOST::CompiledExpression::OpExp,Arg.GetRegister()); }
+__INLINE                                    INMOST::code_variable       log(INMOST::code_variable const & Arg) { return Arg.GetCode()->Emit(INMOST::CompiledExpression::OpLog,Arg.GetRegister()); }
+__INLINE                                    INMOST::code_variable       sin(INMOST::code_variable const & Arg) { return Arg.GetCode()->Emit(INMOST::CompiledExpression::OpSin,Arg.GetRegister()); }
+__INLINE                                    INMOST::code_variable       cos(INMOST::code_variable const & Arg) { return Arg.GetCode()->Emit(INMOST::CompiledExpression::OpCos,Arg.GetRegister()); }
+__INLINE                                    INMOST::code_variable      sqrt(INMOST::code_variable const & Arg) { return Arg.GetCode()->Emit(INMOST::CompiledExpression::OpSqrt,Arg.GetRegister()); }
+__INLINE                                    INMOST::code_variable       pow(INMOST::code_variable const & Left, INMOST_DATA_REAL_TYPE Right) { return Left.GetCode()->Emit(INMOST::CompiledExpression::OpPowConst,Left.GetRegister(),ENUMUNDEF,Right); }
+__INLINE                                    INMOST::code_variable       pow(INMOST_DATA_REAL_TYPE Left, INMOST::code_variable const & Right) { return Right.GetCode()->Emit(INMOST::CompiledExpression::OpConstPow,Right.GetRegister(),ENUMUNDEF,Left); }
+__INLINE                                    INMOST::code_variable       pow(INMOST::code_variable const & Left, INMOST::code_variable const & Right) { return Left.GetCode()->Emit(INMOST::CompiledExpression::OpPow,Left.GetRegister(),Right.GetRegister()); }
 
 
 #else //USE_AUTODIFF
@@ -2197,6 +2197,13 @@ namespace INMOST
 		//implemented in mesh_parallel.cpp
 		enum Action  {AGhost, AMigrate};
 		enum Prepare {UnknownSize, UnknownSource};
+		/// Order in which Mesh::AssignGlobalID and Mesh::Enumerate number elements of each processor.
+		enum NumberingOrder
+		{
+			NumberingDefault,           ///< AssignGlobalID follows the storage order, Enumerate numbers owned elements before shared
+			NumberingStorage,           ///< elements are numbered in the order they are stored
+			NumberingSpaceFillingCurve  ///< elements are numbered along the Morton curve through their centroids
+		};
 		typedef void (*ReduceOperation)(const Tag & tag, const Element & element, const INMOST_DATA_BULK_TYPE * recv_data, INMOST_DATA_ENUM_TYPE recv_size);
 		typedef std::vector<Tag>                                             tag_set;
 		typedef std::vector<HandleType>                                  element_set;
@@ -2245,9 +2252,24 @@ namespace INMOST
 #if defined(USE_MPI_P2P)
 		INMOST_MPI_Win                      window;
 		unsigned *                          shared_space;
+#endif
+#if defined(USE_MPI_SHMEM)
+		INMOST_MPI_Comm                     node_comm;
+		INMOST_MPI_Win                      node_window;
+		INMOST_DATA_BULK_TYPE *             node_space;
+		INMOST_DATA_ENUM_TYPE               node_space_size;
+		std::vector<int>                    node_ranks;
+		std::vector<INMOST_DATA_BULK_TYPE *> node_bases;
 #endif
 		int                                 parallel_strategy;
 		int                                 parallel_file_strategy;
+		bool                                shared_memory_exchange;
+		bool                                message_compression;
+		INMOST_DATA_ENUM_TYPE               compression_threshold;
+		NumberingOrder                      numbering_order;
+		std::map<int, std::vector<element_set> > ghost_layers_sent; //cells sent to remote processor at each layer, used by AddGhostLayer
+		std::vector<element_set>            ghost_layers_recv; //ghost cells at each layer counted from local cells
+		bool                                ghost_layers_valid; //ghost_layers_sent correspond to current layers
 	private:
 		void                              ComputeSharedProcs ();
 		proc_elements                     ComputeSharedSkinSet(ElementType bridge);
@@ -2259,7 +2281,14 @@ namespace INMOST
 		void                              ExchangeDataInnerBegin(const tag_set & tag, const parallel_storage & from, const parallel_storage & to, ElementType mask, MarkerType select, exchange_data & storage);
 		void                              ExchangeDataInnerEnd(const tag_set & tag, const parallel_storage & from, const parallel_storage & to, ElementType mask, MarkerType select, ReduceOperation op, exchange_data & storage);
 		void                              ExchangeBuffersInner(exch_buffer_type & send_bufs, exch_buffer_type & recv_bufs,std::vector<INMOST_MPI_Request> & send_reqs, std::vector<INMOST_MPI_Request> & recv_reqs);
+		bool                              OnSameNode         (int proc) const;
+		void                              ExchangeBuffersNode(exch_buffer_type & send_bufs, exch_buffer_type & recv_bufs,std::vector<INMOST_MPI_Request> & send_reqs, std::vector<INMOST_MPI_Request> & recv_reqs);
+		void                              AllocateNodeSpace  (INMOST_DATA_ENUM_TYPE size);
+		void                              FreeNodeSpace      ();
 		std::vector<int>                  FinishRequests     (std::vector<INMOST_MPI_Request> & recv_reqs);
+		void                              ComputeGhostLayersRecv(integer layers, ElementType bridge);
+		void                              OrderForNumbering  (element_set & elements, bool owned_first);
+		integer                           EnumerateInner     (const element_set & elements, const Tag & num_tag, integer start, ElementType mask);
 		void                              SortParallelStorage(parallel_storage & ghost, parallel_storage & shared,ElementType mask);
 		void                              GatherParallelStorage(parallel_storage & ghost, parallel_storage & shared, ElementType mask);
 	public:
@@ -2361,47 +2390,97 @@ namespace INMOST
 		/// This strategy correspond only to internal ".pmf" mesh format.
 		/// There are two availible strategies for ".pmf" files loading and saving:
 		///
+		/// In both strategies the data is never staged in memory as a whole, it is streamed
+		/// by chunks of fixed size set by "PMF_BUFFER_SIZE" file option, see Mesh::SetFileOption.
+		/// On save the local data is serialized twice: the first pass only counts it's size.
+		///
 		/// strategy = 0
 		/// - on save 
-		///   1. every processor gather local data to some buffer
+		///   1. every processor counts the size of local data
 		///   2. MPI_Gather to obtain sizes of data among processors
-		///   3. MPI_Gatherv to obtain the whole data on zeros processor
-		///   4. the first processor writes all the data to disk by std::fstream
+		///   3. the first processor writes the header with offsets and local data by std::fstream
+		///   4. other processors one by one send their data by chunks to the first processor that writes it
 		/// - on load
-		///   1. first processors reads the whole file by std::fstream
+		///   1. first processors reads the header of the file by std::fstream
 		///   2. MPI_Scatter distributes block sizes among processors
-		///   3. MPI_Scatterv distributes blocks among processors
-		///   4. Each processor parses it's block
+		///   3. the first processor sends blocks by chunks to other processors in turn
+		///   4. Each processor parses it's block as chunks arrive, the first processor parses it's
+		///      block after all other blocks were sent
 		///
-		/// This strategy requires one processor to hold all the data, which
-		/// is quite bad for large files. New strategy may be created from this one in future
-		/// when each processors consequently obtain access to the file using std::fstream and
-		/// writes the data.
+		/// This strategy requires one processor to perform all the input and output.
 		///
 		/// strategy = 1
 		/// - on save it will perform:
-		///   1. MPI_Gather to obtain sizes of data among processors on zeroth processor
+		///   1. every processor counts the size of local data
 		///   2. MPI_File_open to get parallel handle for the file
-		///   3. MPI_File_write_shared called by processor with zeroth rank to write header
-		///   4. MPI_File_write_ordered to write contents of individual data
-		///   5. MPI_File_close to close parallel file handle
+		///   3. MPI_File_write_at called by processor with zeroth rank to write header
+		///   4. MPI_Exscan to compute offset of local data in the file
+		///   5. MPI_File_write_at_all to write the entry of the table of offsets by every processor
+		///   6. MPI_File_write_at_all to write chunks of individual data
+		///   7. MPI_File_close to close parallel file handle
 		/// - on load it will perform
 		///   1. MPI_File_open to open the file in parallel
-		///   2. MPI_File_read_shared to get contents of header on zeroth processor
-		///   3. MPI_Scatter to distribute block sizes among processors
-		///   4. MPI_File_read_ordered to obtain contents
-		///   5. MPI_File_close to close parallel file handle
+		///   2. MPI_File_read_at_all to get the header and entries of the table of offsets by every processor
+		///   3. MPI_File_read_at_all to obtain chunks of contents as they are parsed
+		///   4. MPI_File_close to close parallel file handle
+		///
+		/// No shared file pointers are used, so that collective buffering and striping of the parallel
+		/// file system may be used, see "PMF_STRIPING_FACTOR" and "PMF_STRIPING_UNIT" in Mesh::SetFileOption.
+		///
+		/// The file starts with the table of offsets of the data of every processor, the table
+		/// holds 8-byte little endian numbers and it's last entry is the end of the data.
+		/// Older files with the table of sizes of the data instead of offsets can still be read.
 		///
 		///  Availible only when USE_MPI_P2P is set because it rely on MPI-2 api that begins with MPI_File_xxx
 		///  some MPI-1 standards contain this api as extension.
 		///
 		/// The strategy 1 appeared to be considerably slower on INM cluster then strategy 0, this may
 		/// happen due to lack of read-write devices that able to work in parallel. On IBM Bluegene/p
-		/// strategy 1 was not working due to same old problem with shared file pointers in their MPI realization
+		/// strategy 1 was not working due to same old problem with shared file pointers in their MPI realization,
+		/// shared file pointers are not used since files with the table of offsets were introduced.
 		void                              SetParallelFileStrategy(int strategy){assert( !(strategy < 0 || strategy > 1) ); parallel_file_strategy = strategy;}
 		/// Retrieve currently set parallel strategy for ".pmf" files
 		/// @see Mesh::GetParallelStrategy
 		int                               GetParallelFileStrategy() const {return parallel_file_strategy;}
+		/// Enable exchange of buffers through MPI-3 shared memory windows between
+		/// processors that reside on the same node.
+		///
+		/// When enabled, every exchange with parallel strategy 1 or 2 splits the messages into
+		/// ones that go to the processors on the same node and ones that go to other nodes.
+		/// Messages within the node are written once into the shared memory segment of the sender
+		/// and copied once by the receiver directly into it's receive buffer, messages between nodes
+		/// follow the usual MPI path. Shared segment grows on demand and is reused between exchanges.
+		///
+		/// All processors of the communicator should set the same value.
+		/// Has effect only when USE_MPI_SHMEM is set and MPI library supports MPI-3.
+		///
+		/// @param use true to route exchanges within the node through shared memory
+		/// @see Mesh::SetParallelStrategy
+		void                              SetSharedMemoryExchange(bool use) {shared_memory_exchange = use;}
+		/// Check whether exchanges through shared memory within the node were requested.
+		/// @see Mesh::SetSharedMemoryExchange
+		bool                              GetSharedMemoryExchange() const {return shared_memory_exchange;}
+		/// Compress buffers with elements and their data sent by Mesh::ExchangeMarked, that is used
+		/// by Mesh::ExchangeGhost and Mesh::Redistribute. Buffers are split into blocks and each block
+		/// is stored as is, as delta-encoded 32-bit words written as varints, suitable for handles,
+		/// connectivity and global identificators, or as 64-bit words xored with previous word with
+		/// leading zero bytes dropped, suitable for real data, whichever is the smallest.
+		/// Compression is lossless, all the data is restored bit-exact.
+		///
+		/// Every message tells the receiver whether it was compressed, so that messages that are
+		/// smaller then the threshold or do not compress are sent as is.
+		///
+		/// All processors of the communicator should set the same value of use.
+		///
+		/// @param use true to compress buffers
+		/// @param threshold size of the buffer in bytes starting from which compression is attempted
+		void                              SetMessageCompression(bool use, enumerator threshold = 65536) {message_compression = use; compression_threshold = threshold;}
+		/// Check whether buffers are compressed.
+		/// @see Mesh::SetMessageCompression
+		bool                              GetMessageCompression() const {return message_compression;}
+		/// Get number of processors of the communicator that share memory with current processor,
+		/// returns 1 if USE_MPI_SHMEM is not set.
+		int                               GetNodeProcessorsNumber() const;
 		/// Get rank of current processor
 		int                               GetProcessorRank   () const;
 		/// Get number of processors
@@ -2455,6 +2534,21 @@ namespace INMOST
 		///        such flags along with updating geometrical data which seems to be maintained fairly well
 		///        during mesh modification
 		void                              AssignGlobalID     (ElementType mask);
+		/// Set the order in which Mesh::AssignGlobalID and Mesh::Enumerate number elements of each processor.
+		/// Elements of each processor always receive a contiguous range of numbers, the order within the range
+		/// affects locality of the numbering, for example the bandwidth of the matrix assembled with it.
+		///
+		/// All processors of the communicator should set the same value.
+		///
+		/// @param order one of NumberingDefault, NumberingStorage or NumberingSpaceFillingCurve
+		void                              SetNumberingOrder  (NumberingOrder order) {numbering_order = order;}
+		/// Get the order in which elements are numbered.
+		/// @see Mesh::SetNumberingOrder
+		NumberingOrder                    GetNumberingOrder  () const {return numbering_order;}
+		/// Sort elements along the Morton curve through their centroids.
+		/// This is the order used with NumberingSpaceFillingCurve, the curve spans the bounding box of the elements.
+		/// @param elements handles of elements of any types except MESH
+		void                              OrderAlongCurve    (element_set & elements);
 		/// Update data from Shared elements to Ghost elements. For backward direction please see Mesh::ReduceData.
 		/// If you have a tag of DATA_BULK type and you store your own custom data structure in it, it is highly
 		/// recomended that you provide MPI information about your structure through Tag::SetBulkDataType,
@@ -2675,6 +2769,36 @@ namespace INMOST
 		/// @see Mesh::ExchangeMarked
 		/// @see Mesh::Redistribute
 		void                              ExchangeGhost      (integer layers, ElementType bridge);
+		/// Add one more layer of ghosted cells on top of the layers formed by Mesh::ExchangeGhost.
+		/// Only the outermost layer is traversed to select the cells, and only the cells of the new layer
+		/// are sent, while Mesh::ExchangeGhost traverses and sends all the layers again.
+		/// The exchange itself is done by Mesh::ExchangeMarked, that still passes over all the elements
+		/// of the mesh to gather marked elements and to recompute parallel storage, so the cost is not
+		/// proportional to the size of the new layer alone.
+		/// Cells sent to each processor at each layer are remembered for the next call, this takes memory
+		/// proportional to the number of ghosted cells on remote processors.
+		///
+		/// If there are no layers yet, the bridge must be provided and the function is equivalent to
+		/// Mesh::ExchangeGhost(1,bridge). If bridge differs from the current one or the layers were
+		/// altered by Mesh::Redistribute, Mesh::RemoveGhost or Mesh::ReorderEmpty, the function falls
+		/// back to Mesh::ExchangeGhost.
+		///
+		/// Collective point-2-point.
+		///
+		/// @param bridge type of elements through which layers are formed, NONE to keep current bridge
+		/// @see Mesh::ExchangeGhost
+		/// @see Mesh::RemoveGhostLayer
+		void                              AddGhostLayer      (ElementType bridge = NONE);
+		/// Remove the outermost layer of ghosted cells formed by Mesh::ExchangeGhost or Mesh::AddGhostLayer.
+		/// Ghosted cells of the outermost layer are determined locally without rebuilding the other layers.
+		/// Removal is done by Mesh::RemoveGhostElements, that passes over all the faces, edges and nodes
+		/// of the mesh to find the elements left without adjacent cells.
+		///
+		/// Collective point-2-point.
+		///
+		/// @see Mesh::AddGhostLayer
+		/// @see Mesh::RemoveGhostElements
+		void                              RemoveGhostLayer   ();
 		/// Migrate all the elements to the new owners prescribed in data corresponding to RedistributeTag.
 		/// This will perform all the actions to send mesh elements and data and reproduce new mesh partitions
 		/// on remote elements and correctly resolve parallel state of the mesh. If you have priviously
@@ -3009,6 +3133,8 @@ namespace INMOST
 		/// - "VTK_GRID_DIMS"    - Set "2" for two-dimensional vtk grids, "3" for three-dimensional vtk grids
 		///                        or "AUTO" for automatic detection.
 		/// - "VTK_OUTPUT_FACES" - Set "1" for vtk output of values on faces
+		/// - "VTK_BINARY"       - Set "1" to write legacy ".vtk" files in binary format, numbers are
+		///                        written without text formatting. Default: "0".
 		///
 		/// - "ECL_SPLIT_GLUED"  - Set "TRUE" to triangulate faces of the blocks that degenerate on three pillars.
 		/// - "ECL_PROJECT_PERM" - Set "TRUE" to project permeability tensor from grid block coordinates
@@ -3023,9 +3149,32 @@ namespace INMOST
 		///                        warnings if layers of the mesh enter each other and the grid cannot be
 		///                        considered conformal. Default: "FALSE".
 		///
+		/// - "GMSH_PARTITION"   - Set "TRUE" to load ".msh" files by all processors of the communicator. Elements of
+		///                        the highest dimension of MSH 4.1 files are split into contiguous ranges, each processor
+		///                        reads its range and the nodes it needs, shared elements are then resolved with
+		///                        Mesh::ResolveShared. Files of older versions are loaded on the first processor.
+		///                        Default: "FALSE".
+		///
+		/// - "PMF_BUFFER_SIZE"  - Size in bytes of the buffer used to stream ".pmf" files, the data
+		///                        is written and read directly from the file by chunks of this size.
+		///                        Default: "4194304".
+		///
+		/// - "PMF_STRIPING_FACTOR",
+		///   "PMF_STRIPING_UNIT" - Number of devices and size in bytes of stripes passed as "striping_factor"
+		///                        and "striping_unit" hints to MPI_File_open for ".pmf" files written
+		///                        with parallel file strategy 1, see Mesh::SetParallelFileStrategy.
+		/// - "PMF_ASYNC_LIMIT"  - Size in bytes of memory held by snapshots of pending outputs started by
+		///                        Mesh::SaveAsync, exceeding it makes Mesh::SaveAsync wait for older outputs.
+		///                        Default: "1073741824".
+		/// - "SET_TAGS_LOAD"    - Names of tags separated by commas or spaces to be loaded from ".pmf" files,
+		///                        the data of other tags is skipped without parsing, topology, tags already
+		///                        present in the mesh and protected tags are always loaded. Data sections of
+		///                        files written by older versions have no sizes and are parsed and dropped.
+		///                        By default all the tags are loaded.
+		///
 		/// \todo
-		///      introduce "SET_TAGS_LOAD", "SET_TAGS_SAVE" to explicitly provide set of tags to write
-		///      or "SKIP_TAGS_LOAD", "SKIP_TAGS_SAVE" tags to skip
+		///      introduce "SET_TAGS_SAVE" to explicitly provide set of tags to write
+		///      or "SKIP_TAGS_LOAD", "SKIP_TAGS_SAVE" tags to skip, "SET_TAGS_LOAD" for other formats
 		void         SetFileOption(std::string,std::string);
 		/// Get current option corresponding to key.
 		/// @param key options for which options should be retrieven
@@ -3033,9 +3182,12 @@ namespace INMOST
 		/// Acceptable file formats for reading
 		/// - ".vtk"    - legacy vtk format for unstructured grid
 		/// - ".pvtk"   - legacy parallel vtk format
+		/// - ".vtu"    - xml vtk format for unstructured grid, data is either text or raw appended
+		/// - ".pvtu"   - xml parallel vtk format, ".vtu" pieces are distributed between processors
 		/// - ".gmv"    - format acceptable by general mesh viewer
 		/// - ".msh"    - gmsh generator format
 		/// - ".grdecl" - eclipse format (under construction)
+		/// - ".egrid"  - binary eclipse corner point grid, properties are read from ".init" file with the same name
 		/// - ".grid"   - mesh format by Mohammad Karimi-Fard
 		/// - ".pmf"    - internal parallel portable binary format, saves all features
 		///
@@ -3052,11 +3204,14 @@ namespace INMOST
 		void         LoadPMF(std::string File); 
 		void         LoadVTK(std::string File); 
 		void         LoadVTU(std::string File);
+		void         LoadPVTU(std::string File);
 		void         LoadPVTK(std::string File); 
 		void         LoadMKF(std::string File);
 		/// Acceptable file formats for writing
 		/// - ".vtk"  - legacy vtk format for unstructured grid
 		/// - ".pvtk" - legacy parallel vtk format
+		/// - ".vtu"  - xml vtk format for unstructured grid with raw binary appended data
+		/// - ".pvtu" - xml parallel vtk format, each processor writes it's own ".vtu" file
 		/// - ".gmv"  - format acceptable by general mesh viewer
 		/// - ".pmf"  - internal parallel portable binary format, saves all features
 		///
@@ -3072,8 +3227,78 @@ namespace INMOST
 		void         SavePMF(std::string File);
 		void         SaveVTK(std::string File);
 		void         SavePVTK(std::string File);
+		void         SaveVTU(std::string File);
+		void         SavePVTU(std::string File);
 		void         SaveGMV(std::string File);
 		bool         isParallelFileFormat(std::string File);
+		/// Start saving the mesh into ".pmf" file and return without waiting for the output to complete.
+		///
+		/// The local part of the mesh is serialized into memory, this snapshot does not depend on
+		/// the mesh, so that the mesh may be modified right after the call. In parallel with
+		/// MPI_File support the snapshot is written by non-blocking MPI_File_iwrite_at. In serial the
+		/// snapshot is written by a separate thread when compiled with USE_THREADS, otherwise it is
+		/// written by chunks on each Mesh::TestOutput call and the rest on Mesh::WaitOutput.
+		/// Other formats and parallel output without MPI_File support are written immediately.
+		///
+		/// Snapshots of pending outputs are limited in memory by "PMF_ASYNC_LIMIT" file option,
+		/// when the limit is exceeded the call waits for the oldest outputs to complete.
+		///
+		/// Collective operation.
+		///
+		/// @param File path to the file
+		/// @return identifier of the output for Mesh::TestOutput and Mesh::WaitOutput
+		int          SaveAsync(std::string File);
+		/// Progress the output started by Mesh::SaveAsync.
+		/// @param id identifier of the output
+		/// @return true if all the local data of the output was written
+		bool         TestOutput(int id);
+		/// Wait for the output started by Mesh::SaveAsync to complete and release the snapshot.
+		/// Pending outputs are also completed when the mesh is destroyed.
+		///
+		/// Collective operation, all processors should wait for outputs in the same order.
+		/// Parallel outputs close the file with collective MPI_File_close, so that the mesh with
+		/// pending outputs should be destroyed on all processors at the same point, or the outputs
+		/// should be completed explicitly before. Outputs that are still pending after
+		/// MPI is finalized are reported and dropped.
+		///
+		/// @param id identifier of the output, -1 to wait for all pending outputs
+		void         WaitOutput(int id = -1);
+		/// Start a time series: the mesh with all the tags is saved into ".pmf" file and
+		/// the file with steps is emptied. Only data of selected tags is stored for every step.
+		///
+		/// The series is opened by loading the mesh with Mesh::Load from the ".pmf" file and data of any step
+		/// is loaded with Mesh::LoadSeries. Data of steps is stored in the order of elements,
+		/// so that the topology of the mesh should not change during the series and the series
+		/// should be opened on the same number of processors.
+		///
+		/// Each processor writes steps into it's own file, with the name of ".pmf" file followed
+		/// by ".steps" in serial or by ".<rank>.steps" in parallel.
+		///
+		/// @param File path to the ".pmf" file
+		void         CreateSeries(std::string File);
+		/// Append the data of the tags for a step of the time series started by Mesh::CreateSeries.
+		/// @param File path to the ".pmf" file of the series
+		/// @param tags tags that change from step to step
+		/// @param time time of the step
+		void         AppendSeries(std::string File, const std::vector<Tag> & tags, real time);
+		/// Retrieve times of the steps stored in the time series.
+		/// @param File path to the ".pmf" file of the series
+		/// @return times of the steps, the size of the array is the number of steps
+		std::vector<real> GetSeriesTimes(std::string File);
+		/// Load the data of the tags of the step of the time series, the mesh should be loaded from the ".pmf" file of the series.
+		/// Records of previous steps are skipped without reading.
+		/// @param File path to the ".pmf" file of the series
+		/// @param step number of the step starting from zero
+		/// @return time of the step
+		real         LoadSeries(std::string File, enumerator step);
+	private:
+		struct AsyncOutput;
+		std::vector<AsyncOutput *> async_outputs; //pending outputs started by SaveAsync
+		int          async_outputs_last; //identifier of the next output
+		/// Serialize local part of the mesh in ".pmf" format into the stream.
+		void         WritePMFData(std::ostream & out);
+		/// Size in bytes of the data written by Mesh::WritePMFData, computed without serialization.
+		size_t       PMFDataSize();
 	public:
 		
 		//implemented in geometry.cpp
@@ -3212,6 +3437,35 @@ namespace INMOST
 			bool operator() (const real * a, HandleType b) const;
 		};
 
+		/// Finds nodes by coordinates within tolerance Mesh::GetEpsilon, the same way as
+		/// CentroidComparator::Compare does, but without sorting.
+		///
+		/// Nodes are hashed into buckets of a grid with the step of twice the tolerance,
+		/// so that matching node may only be in one of two neighbouring buckets along each axis.
+		/// The grid starts at the corner of the bounding box of the nodes and the step is enlarged
+		/// when the box would contain too many buckets along an axis for the tolerance.
+		/// Construction takes linear time and search takes constant expected time.
+		/// Use it to merge nodes of the loaded file with nodes already present in the mesh.
+		class NodeMatcher
+		{
+			Mesh * m;
+			real inv; //inverse of the bucket size
+			real lo[3], hi[3]; //bounding box of the nodes
+			integer dims;
+			enumerator mask; //number of slots minus one
+			std::vector<enumerator> start; //position of the first node of each slot in order and coords
+			std::vector<enumerator> order; //positions of nodes in the input array sorted by slots
+			std::vector<real> coords; //coordinates of nodes sorted by slots
+		public:
+			NodeMatcher(Mesh * m) : m(m), inv(1), dims(0), mask(0) {}
+			/// Prepare search among given nodes.
+			NodeMatcher(Mesh * m, const std::vector<HandleType> & nodes) : m(m), inv(1), dims(0), mask(0) {Build(nodes);}
+			/// Prepare search among given nodes, previous nodes are forgotten.
+			void Build(const std::vector<HandleType> & nodes);
+			/// Returns position of matching node in the array passed to Build or -1 if there is no such node.
+			int Find(const real * xyz) const;
+		};
+
 		class GlobalIDComparator
 		{
 			Mesh * m;
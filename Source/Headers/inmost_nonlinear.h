@@ -2,31 +2,152 @@
 #define INMOST_NONLINEAR_INCLUDED
 
 #include "inmost_common.h"
+#include "inmost_solver.h"
+#include "inmost_variable.h"
 
 
-#if defined(USE_NONLINEAR)
+#if defined(USE_NONLINEAR) && defined(USE_AUTODIFF) && defined(USE_SOLVER)
 namespace INMOST
 {
 
-  typedef INMOST_DATA_BULK_TYPE RequestedAction;
+	typedef INMOST_DATA_BULK_TYPE RequestedAction;
 
-  static const RequestedAction COMPUTE_FUNCTION = 0x01;
-  static const RequestedAction COMPUTE_JACOBIAN = 0x02;
-  static const RequestedAction COMPUTE_HESSIAN  = 0x04;
-  static const RequestedAction FINISHED         = 0x08;
+	static const RequestedAction COMPUTE_FUNCTION = 0x01;
+	static const RequestedAction COMPUTE_JACOBIAN = 0x02;
+	static const RequestedAction COMPUTE_HESSIAN  = 0x04;
+	static const RequestedAction FINISHED         = 0x08;
 
+	/// Interface of the model for the NonlinearSolver.
+	/// The model keeps the state of unknowns, usually in tags registered with Automatizator,
+	/// the solver only requests to assemble the residual and to change the state.
+	class NonlinearProblem
+	{
+	public:
+		/// Assemble the residual and the jacobian for the current state of unknowns.
+		/// The residual is cleared by the solver before the call.
+		/// @param R Residual to be filled.
+		/// @param action Combination of COMPUTE_FUNCTION and COMPUTE_JACOBIAN.
+		virtual void Assemble(Residual & R, RequestedAction action) = 0;
+		/// Change the state of unknowns: x = x + alpha*dx.
+		/// During line search the function is called again with the difference of step lengths.
+		/// For unknowns registered with Automatizator use Automatizator::UpdateSolution.
+		/// @param dx Vector with the interval of the local partition.
+		/// @param alpha Multiplier for the update.
+		/// @return False if the new state is not admissible, then the step will be reduced.
+		virtual bool Update(const Sparse::Vector & dx, INMOST_DATA_REAL_TYPE alpha) = 0;
+		virtual ~NonlinearProblem() {}
+	};
 
-  class NonlinearSolver
-  {
-  public:
-    RequestedAction GetAction() const;
-    INMOST_DATA_REAL_TYPE GetResidual() const;
-    INMOST_DATA_ENUM_TYPE GetIterations() const;
-    std::string GetReason() const;
-
-  };
+	/// Inexact Newton method with backtracking line search.
+	///
+	/// On each iteration the linear system J dx = R is solved with the relative tolerance
+	/// selected by the second choice of Eisenstat and Walker, so that the linear system is not
+	/// oversolved far from the solution. The preconditioner of the linear solver is
+	/// kept for the next iterations while the nonlinear residual drops fast and the linear
+	/// solver converges in few iterations, see "preconditioner_lag". The preconditioner
+	/// is kept only if Residual::FreezePattern was called.
+	/// The residual assembled at the accepted point of the line search is reused on the next iteration.
+	class NonlinearSolver
+	{
+	public:
+		/// Statistics of a single nonlinear iteration.
+		struct IterationInfo
+		{
+			INMOST_DATA_REAL_TYPE residual;          ///< Norm of the residual before the iteration.
+			INMOST_DATA_REAL_TYPE forcing;           ///< Relative tolerance requested from the linear solver.
+			INMOST_DATA_REAL_TYPE step;              ///< Step length accepted by line search.
+			INMOST_DATA_ENUM_TYPE linear_iterations; ///< Iterations of the linear solver, including repeated solve.
+			INMOST_DATA_ENUM_TYPE line_search;       ///< Number of reductions of the step.
+			bool                  reused;            ///< The preconditioner from previous iteration was used.
+			double                assembly_time;     ///< Time spent in NonlinearProblem::Assemble, including line search.
+			double                setup_time;        ///< Time spent in Solver::SetMatrix.
+			double                solve_time;        ///< Time spent in Solver::Solve.
+			double                update_time;       ///< Time spent in NonlinearProblem::Update.
+		};
+	private:
+		Solver * S; ///< Linear solver.
+		RequestedAction action; ///< Last action requested from the problem.
+		INMOST_DATA_REAL_TYPE residual; ///< Current norm of the residual.
+		std::string reason; ///< Reason of convergence or failure.
+		std::vector<IterationInfo> history; ///< Statistics for each iteration of the last solution.
+		INMOST_DATA_ENUM_TYPE maximum_iterations; ///< Maximum number of nonlinear iterations.
+		INMOST_DATA_REAL_TYPE absolute_tolerance; ///< Stop when residual norm is below.
+		INMOST_DATA_REAL_TYPE relative_tolerance; ///< Stop when residual norm reduced by the factor.
+		INMOST_DATA_REAL_TYPE divergence_tolerance; ///< Fail when residual norm is above.
+		INMOST_DATA_ENUM_TYPE line_search; ///< Maximum number of step reductions, zero turns line search off.
+		INMOST_DATA_REAL_TYPE sufficient_decrease; ///< Parameter of sufficient decrease condition.
+		INMOST_DATA_ENUM_TYPE adaptive_forcing; ///< Use Eisenstat-Walker forcing terms.
+		INMOST_DATA_REAL_TYPE forcing_initial; ///< Initial or constant forcing term.
+		INMOST_DATA_REAL_TYPE forcing_maximum; ///< Upper bound for forcing term.
+		INMOST_DATA_REAL_TYPE forcing_gamma; ///< Multiplier of Eisenstat-Walker forcing term.
+		INMOST_DATA_REAL_TYPE forcing_alpha; ///< Power of Eisenstat-Walker forcing term.
+		INMOST_DATA_ENUM_TYPE preconditioner_lag; ///< Maximum number of iterations with the same preconditioner.
+		INMOST_DATA_REAL_TYPE lag_reduction; ///< Required reduction of the residual to keep preconditioner.
+		INMOST_DATA_REAL_TYPE lag_iterations; ///< Allowed growth of linear iterations to keep preconditioner.
+		INMOST_DATA_ENUM_TYPE verbosity; ///< Print iterations.
+		/// Clear residual, call NonlinearProblem::Assemble and compute the norm.
+		INMOST_DATA_REAL_TYPE Assemble(NonlinearProblem & P, Residual & R, IterationInfo & info);
+		/// Call NonlinearProblem::Update and account time.
+		bool Update(NonlinearProblem & P, const Sparse::Vector & dx, INMOST_DATA_REAL_TYPE alpha, IterationInfo & info);
+	public:
+		/// Create nonlinear solver.
+		/// @param S Linear solver, it's parameters should be set by the user,
+		/// except for "relative_tolerance" that is changed on each iteration.
+		NonlinearSolver(Solver & S);
+		NonlinearSolver(const NonlinearSolver & other);
+		NonlinearSolver & operator =(NonlinearSolver const & other);
+		~NonlinearSolver();
+		/// Set the parameter of the integer type.
+		///
+		/// Parameters:
+		/// - "maximum_iterations"   - maximum number of nonlinear iterations, 50 by default
+		/// - "line_search"          - maximum number of step reductions in backtracking line search,
+		///                            zero turns line search off, 8 by default
+		/// - "adaptive_forcing"     - select relative tolerance for linear solver by Eisenstat-Walker rule,
+		///                            otherwise "forcing_initial" is always used, 1 by default
+		/// - "preconditioner_lag"   - maximum number of consequent iterations that use the same preconditioner,
+		///                            zero rebuilds the preconditioner on every iteration, 3 by default,
+		///                            has effect only with Residual::FreezePattern
+		/// - "verbosity"            - print statistics of each iteration, 0 by default
+		void SetParameterEnum(std::string name, INMOST_DATA_ENUM_TYPE value);
+		/// Set the parameter of the real type.
+		///
+		/// Parameters:
+		/// - "absolute_tolerance"   - stop if ||R|| < absolute_tolerance, 1.0e-9 by default
+		/// - "relative_tolerance"   - stop if ||R|| < relative_tolerance*||R0||, 1.0e-8 by default
+		/// - "divergence_tolerance" - fail if ||R|| > divergence_tolerance, 1.0e+20 by default
+		/// - "sufficient_decrease"  - step length s is accepted if
+		///                            ||R(x+s*dx)|| <= (1 - sufficient_decrease*s*(1-forcing))*||R(x)||, 1.0e-4 by default
+		/// - "forcing_initial"      - relative tolerance for the first linear solve, 0.5 by default
+		/// - "forcing_maximum"      - upper bound for relative tolerance, 0.9 by default
+		/// - "forcing_gamma"        - forcing = gamma*(||R(k)||/||R(k-1)||)^alpha, 0.9 by default
+		/// - "forcing_alpha"        - see "forcing_gamma", 2 by default
+		/// - "lag_reduction"        - the preconditioner is kept if ||R(k)|| < lag_reduction*||R(k-1)||, 0.5 by default
+		/// - "lag_iterations"       - the preconditioner is kept while linear iterations do not exceed
+		///                            lag_iterations times the iterations with the fresh preconditioner, 2 by default
+		void SetParameterReal(std::string name, INMOST_DATA_REAL_TYPE value);
+		/// Solve the nonlinear problem starting from the current state of unknowns.
+		/// @param P The problem.
+		/// @param R Residual with the interval of the local partition, see Automatizator::GetFirstIndex.
+		/// If Residual::FreezePattern was called, the structure of the matrix is reused by the linear solver,
+		/// otherwise the matrix is set up anew and the preconditioner is rebuilt on every iteration.
+		/// @return True if converged.
+		bool Solve(NonlinearProblem & P, Residual & R);
+		/// Last action requested from the problem, FINISHED after NonlinearSolver::Solve.
+		RequestedAction GetAction() const {return action;}
+		/// Norm of the residual at the end of the last solution.
+		INMOST_DATA_REAL_TYPE GetResidual() const {return residual;}
+		/// Number of iterations performed by the last solution.
+		INMOST_DATA_ENUM_TYPE GetIterations() const {return static_cast<INMOST_DATA_ENUM_TYPE>(history.size());}
+		/// Reason of convergence or failure of the last solution.
+		std::string GetReason() const {return reason;}
+		/// Statistics of the iterations of the last solution.
+		const std::vector<IterationInfo> & GetHistory() const {return history;}
+		/// Statistics of the iteration of the last solution.
+		const IterationInfo & GetIteration(INMOST_DATA_ENUM_TYPE k) const {return history[k];}
+	};
 
 };
 #endif
 
-#endif //INMOST_NONLINEAR_INCLUDED
\ No newline at end of file
+#endif //INMOST_NONLINEAR_INCLUDED
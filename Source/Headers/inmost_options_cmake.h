@@ -2,6 +2,7 @@
 #define INMOST_OPTIONS_CMAKE_INCLUDED
 
 #cmakedefine USE_OMP
+#cmakedefine USE_THREADS //write asynchronous output in a separate thread
 
 #cmakedefine USE_MESH
 
@@ -9,6 +10,7 @@
 #cmakedefine USE_AUTODIFF_EXPRESSION_TEMPLATES
 #cmakedefine USE_AUTODIFF_OPENCL
 #cmakedefine USE_AUTODIFF_ASMJIT
+#define SPARSE_ROW_STACKED @SPARSE_ROW_STACKED@ //entries kept inside of Sparse::Row
 
 #cmakedefine USE_PARTITIONER
 #cmakedefine USE_PARTITIONER_ZOLTAN
@@ -31,6 +33,7 @@
 #cmakedefine USE_MPI_P2P //use (probably) more effective point to point algorithms
 #cmakedefine USE_MPI_FILE //use functionality for parallel files
 #cmakedefine USE_MPI2 //use mpi-2 extensions
+#cmakedefine USE_MPI_SHMEM //use mpi-3 shared memory windows within a node
 
 
 #endif //INMOST_OPTIONS_CMAKE_INCLUDED
@@ -78,6 +78,8 @@ namespace INMOST
 			storage_type global_overlap; ///< Stores pairs: [begin,end) of overlapping intervals of rows
 			std::vector<INMOST_DATA_ENUM_TYPE> vector_exchange_recv; ///< Store packed indices to recieve data. Format: # of processors {proc #, # indices, indices}
 			std::vector<INMOST_DATA_ENUM_TYPE> vector_exchange_send; ///< Store packed indices to send data. Format: # of processors {proc #, # indices, indices}
+			std::vector<INMOST_DATA_ENUM_TYPE> matrix_exchange_recv; ///< Store packed positions of overlapping rows received on all layers. Format: {proc #, # rows, rows}
+			std::vector<INMOST_DATA_ENUM_TYPE> matrix_exchange_send; ///< Store packed positions of local rows sent on all layers. Format: {proc #, # rows, rows}
 			std::vector<INMOST_DATA_REAL_TYPE> send_storage; ///< Storage used to send data of the vector.
 			std::vector<INMOST_DATA_REAL_TYPE> recv_storage; ///< Storage used to receive data of the vector.
 			std::vector<INMOST_MPI_Request> send_requests; ///< Sturctures used to wait complition of send operations.
@@ -114,6 +116,14 @@ namespace INMOST
 			/// @param m Matrix to be expanded.
 			/// @param overlap Overlap size, viz. the number of overlap layers.
 			void PrepareMatrix(Sparse::Matrix &m, INMOST_DATA_ENUM_TYPE overlap);
+			/// Update values of the Matrix prepared by PrepareMatrix from a matrix with the same sparsity pattern.
+			/// Values of the overlapping rows are refreshed from other processors, 
+			/// no other parallel structures are recomputed.
+			/// Should be called on all processors.
+			/// @param m Matrix that was expanded with PrepareMatrix.
+			/// @param A Matrix with new values.
+			/// @return False if the pattern of A differs on any processor, m is not changed then.
+			bool UpdateMatrix(Sparse::Matrix &m, const Sparse::Matrix &A);
 			/// Restore initial nonparallel state of the Matrix with no overlap.
 			/// @param m Matrix to be restored.
 			void RestoreMatrix(Sparse::Matrix &m);
@@ -249,7 +259,19 @@ namespace INMOST
 		///
 		/// Any changes to preconditioner parameters should happen before that point.
 		/// If you increase gmres_substep after this point, inner methods most likely will fail
+		///
+		/// For INNER_* packages with ModifiedPattern set to false the values are copied into
+		/// the stored matrix and the parallel overlap structures are reused, see Residual::FreezePattern.
+		/// If the pattern in fact differs, the matrix is set up from scratch.
 		void SetMatrix(Sparse::Matrix &A, bool ModifiedPattern = true, bool OldPreconditioner = false);
+		/// Set the matrix-free operator to be used in the iterative method in place of the matrix.
+		/// The matrix provided to Solver::SetMatrix is still required and is used only to construct
+		/// the preconditioner, so it may be a cheap approximation, for example the jacobian
+		/// from a previous nonlinear iteration. The operator should outlive its use in the solver.
+		/// Currently works for INNER_* packages only.
+		/// @param op Operator, for example JacobianOperator, or NULL to return to the matrix.
+		/// @see Sparse::AbstractOperator
+		void SetOperator(Sparse::AbstractOperator *op);
 		/// Solver the linear system: A*x = b.
 		/// Prior to this call you should call SetMatrix
 		///
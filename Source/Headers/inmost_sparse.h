@@ -176,8 +176,11 @@ namespace INMOST
 				return ret;
 			}
 		private:
-			//typedef dynarray<entry,16> Entries; //replace later with more memory-efficient chunk_array, with first chunk in stack
-			typedef array<entry> Entries; ///< Container type for 
+#if SPARSE_ROW_STACKED > 0
+			typedef small_array<entry,SPARSE_ROW_STACKED> Entries; ///< Container type for entries, short rows are kept without allocation.
+#else
+			typedef array<entry> Entries; ///< Container type for entries.
+#endif
 		public:
 			typedef Entries::iterator iterator; ///< Iterator over pairs of index and value.
 			typedef Entries::const_iterator const_iterator; ///< Iterator over constant pairs of index and value.
@@ -283,7 +286,11 @@ namespace INMOST
 #endif
 			/// An optimized assignment of the row, when the content of the source row may not be preserved.
 			/// @param source Source raw where to get the contents.
-			void                    MoveRow(Row & source) {data = source.data;} //here move constructor and std::move may be used in future
+#if SPARSE_ROW_STACKED > 0
+			void                    MoveRow(Row & source) {source.data.move(data);}
+#else
+			void                    MoveRow(Row & source) {data.swap(source.data);}
+#endif
 			/// Set the vector entries by zeroes.
 			void                    Zero() {for(iterator it = Begin(); it != End(); ++it) it->second = 0;}
 			/// Push specified element into sparse row.
@@ -309,12 +316,22 @@ namespace INMOST
 			/// @param right The right row.
 			/// @param output Record result in this vector.
 			static void             MergeSortedRows(INMOST_DATA_REAL_TYPE alpha, const Row & left, INMOST_DATA_REAL_TYPE beta, const Row & right, Row & output);
+			/// Add another row into the current one in place. Performs operation this=this+alpha*other.
+			/// Positions of the entries are found by binary search, so that a row with a fixed
+			/// pattern is updated without reallocation. Missing indices are added and the row is sorted again.
+			/// The current row should be sorted, the other row may be unsorted.
+			/// @param alpha Coefficient to multiply the other row.
+			/// @param other The row to be added.
+			void                    AddToPattern(INMOST_DATA_REAL_TYPE alpha, const Row & other);
 		};
 		
 #endif //defined(USE_SOLVER) || defined(USE_AUTODIFF)
 		
 #if defined(USE_SOLVER) || defined(USE_AUTODIFF)
 		/// Class to store the compressed symmetric matrix of a hessian row.
+		/// Only the upper triangle is stored: the index pair always satisfies first <= second,
+		/// see HessianRow::make_index. The value of an off-diagonal entry (i,j) accumulates
+		/// both symmetric halves, i.e. it holds d2f/dxidxj + d2f/dxjdxi.
 		class HessianRow
 		{
 		public:
@@ -402,8 +419,11 @@ namespace INMOST
 			reverse_iterator        rEnd() { return data.rend(); }
 			const_reverse_iterator  rBegin() const { return data.rbegin(); }
 			const_reverse_iterator  rEnd() const { return data.rend(); }
-			/// Return the scalar product of the current sparse row by a dense Vector.
-			void                    RowVec(INMOST_DATA_REAL_TYPE alpha, const Row & rU, INMOST_DATA_REAL_TYPE beta, Row & rJ) const; // returns A(row) * x
+			/// Product of the symmetric matrix by a sparse row of the form: rJ = alpha*H*rU + beta*rJ.
+			/// Each stored entry is visited once and contributes to both symmetric positions.
+			/// @param rU Input sparse row.
+			/// @param rJ Input/output sparse row, sorted on output.
+			void                    RowVec(INMOST_DATA_REAL_TYPE alpha, const Row & rU, INMOST_DATA_REAL_TYPE beta, Row & rJ) const;
 			void                    MoveRow(HessianRow & new_pos) {data = new_pos.data;} //here move constructor and std::move may be used in future
 			/// Set the vector entries by zeroes.
 			void                    Zero() {for(iterator it = Begin(); it != End(); ++it) it->second = 0;}
@@ -427,6 +447,45 @@ namespace INMOST
 			static void             MergeJacobianHessian(INMOST_DATA_REAL_TYPE a, const Row & JL, const Row & JR, INMOST_DATA_REAL_TYPE b, const HessianRow & H, HessianRow & output);
 		};
 		
+		/// This class may be used to sum multiple hessian rows with coefficients.
+		/// Unlike pairwise HessianRow::MergeSortedRows, that copies the accumulated
+		/// result for each added row, each added row is stored as a sorted run and
+		/// the runs are merged in log2(number of runs) passes in HessianRowMerger::RetrieveRow.
+		/// Row index space of a hessian is quadratic, therefore the dense linked list
+		/// of RowMerger is not used here.
+		class HessianRowMerger
+		{
+			std::vector<HessianRow::entry> Entries; ///< Gathered entries, sorted within each run.
+			std::vector<size_t> Runs; ///< Starting positions of sorted runs in Entries.
+			std::vector<HessianRow::entry> Merged; ///< Temporary storage for merge passes.
+			std::vector<size_t> MergedRuns; ///< Temporary storage for merge passes.
+		public:
+			/// Default constructor.
+			HessianRowMerger() {}
+			/// Copy constructor.
+			HessianRowMerger(const HessianRowMerger & other) : Entries(other.Entries), Runs(other.Runs) {}
+			/// Assignment operator.
+			HessianRowMerger & operator =(HessianRowMerger const & other) {Entries = other.Entries; Runs = other.Runs; return *this;}
+			/// Destructor.
+			~HessianRowMerger() {}
+			/// Clear gathered entries, memory is retained for the next row.
+			void Clear() {Entries.clear(); Runs.clear();}
+			/// Check that nothing was gathered.
+			bool Empty() const {return Entries.empty();}
+			/// Add single entry.
+			/// @param ind Index of the entry, should be formed by HessianRow::make_index.
+			/// @param val Value of the entry.
+			void Push(HessianRow::index ind, INMOST_DATA_REAL_TYPE val);
+			/// Add a hessian row with a coefficient.
+			/// @param coef Coefficient to multiply row values.
+			/// @param r A row to be added.
+			void AddRow(INMOST_DATA_REAL_TYPE coef, const HessianRow & r);
+			/// Sort and compress gathered entries and store them into a row.
+			/// Gathered entries are compressed in place, further entries may still be added.
+			/// @param r Output row, previous contents is replaced.
+			void RetrieveRow(HessianRow & r);
+		};
+		
 #endif //defined(USE_SOLVER) || defined(USE_AUTODIFF)
 		
 #if defined(USE_SOLVER)
@@ -524,6 +583,25 @@ namespace INMOST
 			std::string          GetName() const {return name;}
 		};
 		
+		/// Abstract linear operator that provides the action of a matrix on a vector
+		/// without storage of the matrix. It is used in iterative methods of the linear
+		/// solver in place of the matrix-vector product with the matrix, while the
+		/// preconditioner is constructed from the matrix, see Solver::SetOperator.
+		class AbstractOperator
+		{
+		public:
+			/// Operator-vector product of the form: y = alpha*A*x + beta * y.
+			/// Only locally owned rows of y should be computed, the rest is updated by the solver.
+			/// Vectors may have extended range of values via OrderInfo class, only the owned part of x is up to date.
+			/// The function is called by all the threads of the enclosing OpenMP parallel region.
+			/// @param alpha Multiplier for the product.
+			/// @param x Input vector.
+			/// @param beta Multiplier for the output vector.
+			/// @param y Input/output vector.
+			virtual void MatVec(INMOST_DATA_REAL_TYPE alpha, Vector & x, INMOST_DATA_REAL_TYPE beta, Vector & y) = 0;
+			virtual ~AbstractOperator() {}
+		};
+		
 #endif //defined(USE_SOLVER)
 		
 #if defined(USE_SOLVER)
@@ -740,6 +818,14 @@ namespace INMOST
 			/// use AddRow with this row in advance.
 			/// @param r A row to be filled.
 			void RetriveRow(Row & r);
+			/// Add entries from linked list into the row keeping its pattern. Performs operation r=coef*r+list.
+			/// Entries of the row are updated in place, indices that are missing in the row are added
+			/// and the row is sorted again.
+			/// \warning
+			/// The row should be sorted.
+			/// @param coef Coefficient to multiply the row values.
+			/// @param r A row to be updated.
+			void AddToRow(INMOST_DATA_REAL_TYPE coef, Row & r);
 			//INMOST_DATA_REAL_TYPE ScalarProd(RowMerger & other);
 			/// Get current number of nonzeros from linked list.
 			INMOST_DATA_ENUM_TYPE Size() {return Nonzeros;}
@@ -766,11 +852,124 @@ namespace INMOST
 				RetriveRow(c);
 				Clear();
 			}
+			/// Get the first index of owned index interval.
+			INMOST_DATA_ENUM_TYPE GetFirstIndex() const {return IntervalBeg;}
+			/// Get the last index of owned index interval.
+			INMOST_DATA_ENUM_TYPE GetLastIndex() const {return IntervalEnd;}
+			/// Get global indices that are to the left of owned index interval.
+			const std::vector<INMOST_DATA_ENUM_TYPE> & GetNonlocalPre() const {return NonlocalPre;}
+			/// Get global indices that are to the right of owned index interval.
+			const std::vector<INMOST_DATA_ENUM_TYPE> & GetNonlocalPost() const {return NonlocalPost;}
 			///Retrive iterator for the first element.
 			iterator Begin() {return iterator(&LinkedList);}
 			///Retrive iterator for the position beyond the last element.
 			iterator End() {iterator ret(&LinkedList); ret.pos = EOL; return ret;}
 		};
+		
+		/// This class stores a direction vector for evaluation of directional derivatives.
+		/// Values are kept for the owned interval of indices and for additional non-local
+		/// indices that are provided in the same way as for RowMerger.
+		/// @see RowTangent
+		class Direction
+		{
+			INMOST_MPI_Comm comm; ///< Communicator for exchange of non-local values.
+			INMOST_DATA_ENUM_TYPE IntervalBeg; ///< Begin of global interval of owned index interval
+			INMOST_DATA_ENUM_TYPE IntervalEnd;  ///< End of global interval of owned index interval
+			std::vector< INMOST_DATA_REAL_TYPE > Values; ///< Values before, within and after owned index interval.
+			std::vector< INMOST_DATA_ENUM_TYPE > NonlocalPre; ///< List of global indices, that are to the left of owned index interval
+			std::vector< INMOST_DATA_ENUM_TYPE > NonlocalPost; ///< List of global indices, that are to the right of owned index interval
+			std::vector< INMOST_DATA_ENUM_TYPE > exchange_recv; ///< Processors and number of non-local values to be received, format {proc, n}.
+			std::vector< INMOST_DATA_ENUM_TYPE > exchange_send; ///< Processors and owned indices to be sent, format {proc, n, indices}.
+			/// Find position of non-local index.
+			INMOST_DATA_ENUM_TYPE MapNonlocal(INMOST_DATA_ENUM_TYPE pos) const;
+		public:
+			/// Default constructor without size specified.
+			Direction(INMOST_MPI_Comm _comm = INMOST_MPI_COMM_WORLD);
+			/// Constructor with size and non-local indices specified.
+			/// \warning
+			/// Collective operation in parallel, see Direction::Resize.
+			/// @param interval_begin First owned index.
+			/// @param interval_end Last owned index.
+			/// @param Pre Sorted non-local indices before the first owned index.
+			/// @param Post Sorted non-local indices after the last owned index.
+			/// @param _comm Communicator for exchange of non-local values.
+			Direction(INMOST_DATA_ENUM_TYPE interval_begin, INMOST_DATA_ENUM_TYPE interval_end, const std::vector<INMOST_DATA_ENUM_TYPE> & Pre = std::vector<INMOST_DATA_ENUM_TYPE>(), const std::vector<INMOST_DATA_ENUM_TYPE> & Post = std::vector<INMOST_DATA_ENUM_TYPE>(), INMOST_MPI_Comm _comm = INMOST_MPI_COMM_WORLD);
+			/// Resize for the new interval with non-local indices, all values are set to zero.
+			/// In parallel the owners of non-local indices are found and the pattern of
+			/// exchanges is established, therefore it should be called on all processors.
+			/// @param interval_begin First owned index.
+			/// @param interval_end Last owned index.
+			/// @param Pre Sorted non-local indices before the first owned index.
+			/// @param Post Sorted non-local indices after the last owned index.
+			void Resize(INMOST_DATA_ENUM_TYPE interval_begin, INMOST_DATA_ENUM_TYPE interval_end, const std::vector<INMOST_DATA_ENUM_TYPE> & Pre = std::vector<INMOST_DATA_ENUM_TYPE>(), const std::vector<INMOST_DATA_ENUM_TYPE> & Post = std::vector<INMOST_DATA_ENUM_TYPE>());
+			/// Resize for the interval and non-local indices of the row merger.
+			/// @param m Row merger with non-local indices, see Automatizator::GetMerger.
+			void Resize(const RowMerger & m) {Resize(m.GetFirstIndex(),m.GetLastIndex(),m.GetNonlocalPre(),m.GetNonlocalPost());}
+			/// Retrive reference to the value of the direction at owned index.
+			/// Call Direction::Update after all owned values are set.
+			/// @param pos Global index within owned interval.
+			INMOST_DATA_REAL_TYPE & operator [](INMOST_DATA_ENUM_TYPE pos) {assert(pos >= IntervalBeg && pos < IntervalEnd); return Values[NonlocalPre.size()+pos-IntervalBeg];}
+			/// Retrive the value of the direction at owned or non-local index.
+			/// @param pos Global index.
+			INMOST_DATA_REAL_TYPE operator [](INMOST_DATA_ENUM_TYPE pos) const
+			{
+				if( pos >= IntervalBeg && pos < IntervalEnd ) return Values[NonlocalPre.size()+pos-IntervalBeg];
+				return Values[MapNonlocal(pos)];
+			}
+			/// Receive the values at non-local indices from their owners.
+			/// Collective operation in parallel.
+			void Update();
+#if defined(USE_SOLVER)
+			/// Copy the owned part of the vector and receive the values at non-local indices.
+			/// The vector may have extended range of values via OrderInfo class, only the owned part is used.
+			/// Collective operation in parallel.
+			/// @param v Vector with the values of direction.
+			void SetValues(const Vector & v);
+#endif //USE_SOLVER
+			/// Get the first owned index.
+			INMOST_DATA_ENUM_TYPE GetFirstIndex() const {return IntervalBeg;}
+			/// Get the last owned index.
+			INMOST_DATA_ENUM_TYPE GetLastIndex() const {return IntervalEnd;}
+		};
+		
+		/// This class accumulates the derivative of an expression along a direction.
+		/// It is used by automatic differentiation expressions in place of the row,
+		/// so that each partial derivative is immediately multiplied by the value
+		/// of the direction, and the full row of derivatives is never formed.
+		/// This gives a product of jacobian and a vector row by row.
+		/// @see Direction
+		class RowTangent
+		{
+		public:
+			/// Entry that multiplies the added partial derivative by the value of direction.
+			class entry
+			{
+				RowTangent & t;
+				INMOST_DATA_ENUM_TYPE pos;
+			public:
+				entry(RowTangent & _t, INMOST_DATA_ENUM_TYPE _pos) : t(_t), pos(_pos) {}
+				entry & operator +=(INMOST_DATA_REAL_TYPE v) {t.Value += v*(*t.dir)[pos]; return *this;}
+				entry & operator -=(INMOST_DATA_REAL_TYPE v) {t.Value -= v*(*t.dir)[pos]; return *this;}
+			};
+		private:
+			const Direction * dir; ///< Direction of differentiation.
+			INMOST_DATA_REAL_TYPE Value; ///< Accumulated derivative.
+		public:
+			/// Constructor with direction specified.
+			/// @param d Direction of differentiation.
+			RowTangent(const Direction & d) : dir(&d), Value(0.0) {}
+			/// Add contribution of the partial derivative at position.
+			/// @param pos Global index.
+			entry operator [](INMOST_DATA_ENUM_TYPE pos) {return entry(*this,pos);}
+			/// Add the derivative along the same direction, computed elsewhere.
+			void Add(INMOST_DATA_REAL_TYPE v) {Value += v;}
+			/// Retrive accumulated derivative.
+			INMOST_DATA_REAL_TYPE GetValue() const {return Value;}
+			/// Zero out accumulated derivative.
+			void Clear() {Value = 0.0;}
+			/// Retrive the direction.
+			const Direction & GetDirection() const {return *dir;}
+		};
 #endif //defined(USE_SOLVER) || defined(USE_AUTODIFF)
 	} //namespace Sparse
 } //namespace INMOST
@@ -0,0 +1,79 @@
+#ifndef INMOST_TRACE_H_INCLUDED
+#define INMOST_TRACE_H_INCLUDED
+
+#include "inmost_common.h"
+
+namespace INMOST
+{
+	/// Runtime tracing of parallel mesh operations, mesh input/output and solvers.
+	///
+	/// Tracing is disabled by default and costs a single branch per traced function.
+	/// When enabled, every traced function records an event with its duration,
+	/// time spent in MPI calls, bytes sent and received and number of processed elements.
+	/// Events are stored in a ring buffer of fixed capacity, so that only the most recent
+	/// events are kept; accumulated statistics per function are kept for the whole run.
+	///
+	/// Tracing may be enabled without recompilation by setting environment variable
+	/// INMOST_TRACE to the prefix of output files before Mesh::Initialize, then
+	/// Mesh::Finalize writes prefix_<rank>.json in Chrome trace format (open it in
+	/// chrome://tracing or https://ui.perfetto.dev) and the merged summary prefix_summary.txt.
+	///
+	/// Tracing is not thread-safe, traced functions should be called from a single thread.
+	class Trace
+	{
+	public:
+		/// Start recording events.
+		/// @param capacity number of events kept in the ring buffer, 0 to keep only statistics
+		static void Enable          (size_t capacity = 65536);
+		/// Stop recording events, recorded events are kept.
+		static void Disable         ();
+		/// Check whether events are recorded.
+		static bool Enabled         () {return enabled;}
+		/// Remove all recorded events and statistics.
+		static void Clear           ();
+		/// Start event for function or region, name should be a string literal.
+		static void Begin           (const char * name);
+		/// Finish the most recently started event.
+		static void End             ();
+		/// Add time spent in MPI to the current event.
+		static void MPITime         (double seconds);
+		/// Add number of bytes sent and received to the current event.
+		static void Bytes           (size_t sent, size_t received);
+		/// Add number of processed elements to the current event.
+		static void Elements        (size_t count);
+		/// Write events kept in the ring buffer in Chrome trace JSON format.
+		/// @param file name of the output file
+		/// @param rank processor number used as process id in the trace
+		static void WriteChromeTrace(std::string file, int rank = 0);
+		/// Write statistics per function merged over all processors of the communicator.
+		/// Functions are ordered by the maximal over processors time spent in MPI calls.
+		///
+		/// Collective operation.
+		///
+		/// @param file name of the output file written by the first processor
+		/// @param comm communicator to merge statistics
+		static void WriteSummary    (std::string file, INMOST_MPI_Comm comm = INMOST_MPI_COMM_WORLD);
+	private:
+		static bool enabled;
+	};
+
+	/// Records an event for lifetime of the object when Trace is enabled.
+	class TraceScope
+	{
+		bool active;
+	public:
+		TraceScope(const char * name) : active(Trace::Enabled()) {if( active ) Trace::Begin(name);}
+		~TraceScope() {if( active ) Trace::End();}
+	};
+
+	/// Accounts time for lifetime of the object as spent in MPI when Trace is enabled.
+	class TraceMPI
+	{
+		double start;
+	public:
+		TraceMPI() : start(Trace::Enabled() ? Timer() : -1.0) {}
+		~TraceMPI() {if( start >= 0.0 ) Trace::MPITime(Timer() - start);}
+	};
+}
+
+#endif //INMOST_TRACE_H_INCLUDED
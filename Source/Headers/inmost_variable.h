@@ -109,6 +109,7 @@ namespace INMOST
 		unary_pool_expression & operator = (unary_pool_expression const & other) {pool = other.pool; return * this;}
 		__INLINE INMOST_DATA_REAL_TYPE GetValue() const { return pool.get_op().GetValue(); }
 		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowMerger & r) const {pool.get_op().GetJacobian(mult,r);}
+		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowTangent & r) const {pool.get_op().GetJacobian(mult,r);}
 		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::Row & r) const {pool.get_op().GetJacobian(mult,r);}
 		__INLINE void GetHessian(INMOST_DATA_REAL_TYPE multJ, Sparse::Row & J, INMOST_DATA_REAL_TYPE multH, Sparse::HessianRow & H) const {pool.get_op().GetHessian(multJ,J,multH,H);}
 	};
@@ -123,6 +124,7 @@ namespace INMOST
 		unary_const_pool_expression & operator = (unary_const_pool_expression const & other) {pool = other.pool; return * this;}
 		__INLINE INMOST_DATA_REAL_TYPE GetValue() const { return pool.get_op().GetValue(); }
 		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowMerger & r) const {pool.get_op().GetJacobian(mult,r);}
+		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowTangent & r) const {pool.get_op().GetJacobian(mult,r);}
 		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::Row & r) const {pool.get_op().GetJacobian(mult,r);}
 		__INLINE void GetHessian(INMOST_DATA_REAL_TYPE multJ, Sparse::Row & J, INMOST_DATA_REAL_TYPE multH, Sparse::HessianRow & H) const {pool.get_op().GetHessian(multJ,J,multH,H);}
 	};
@@ -137,6 +139,7 @@ namespace INMOST
 		binary_pool_expression & operator = (binary_pool_expression const & other) {pool = other.pool; return * this;}
 		__INLINE INMOST_DATA_REAL_TYPE GetValue() const { return pool.get_op().GetValue(); }
 		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowMerger & r) const {pool.get_op().GetJacobian(mult,r);}
+		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowTangent & r) const {pool.get_op().GetJacobian(mult,r);}
 		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::Row & r) const {pool.get_op().GetJacobian(mult,r);}
 		__INLINE void GetHessian(INMOST_DATA_REAL_TYPE multJ, Sparse::Row & J, INMOST_DATA_REAL_TYPE multH, Sparse::HessianRow & H) const {pool.get_op().GetHessian(multJ,J,multH,H);}
 	};
@@ -151,6 +154,7 @@ namespace INMOST
 		ternary_pool_expression & operator = (ternary_pool_expression const & other) {pool = other.pool; return * this;}
 		__INLINE INMOST_DATA_REAL_TYPE GetValue() const { return pool.get_op().GetValue(); }
 		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowMerger & r) const {pool.get_op().GetJacobian(mult,r);}
+		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::RowTangent & r) const {pool.get_op().GetJacobian(mult,r);}
 		__INLINE void GetJacobian(INMOST_DATA_REAL_TYPE mult, Sparse::Row & r) const {pool.get_op().GetJacobian(mult,r);}
 		__INLINE void GetHessian(INMOST_DATA_REAL_TYPE multJ, Sparse::Row & J, INMOST_DATA_REAL_TYPE multH, Sparse::HessianRow & H) const {pool.get_op().GetHessian(multJ,J,multH,H);}
 	};
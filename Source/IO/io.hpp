@@ -28,7 +28,16 @@
 #include <ostream>
 #include <istream>
 #include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
 #include <stdint.h>
+#if !defined(_WIN32)
+#include <sys/types.h>
+#endif
 
 #define ct_assert(e) extern char (*ct_assert(void)) [sizeof(char[1 - 2*!(e)])]
 
@@ -602,6 +611,293 @@ namespace INMOST
 			return source;
 		}
 	};
+
+	/// Parse integer from text in [p,e), leading spaces are skipped as in scanf.
+	/// Returns position right after the number or NULL if there is no number.
+	inline const char * io_parse_integer(const char * p, const char * e, long long & value)
+	{
+		while( p < e && isspace(static_cast<unsigned char>(*p)) ) ++p;
+		bool neg = false;
+		if( p < e && (*p == '-' || *p == '+') ) neg = (*p++ == '-');
+		const char * s = p;
+		unsigned long long v = 0;
+		while( p < e && *p >= '0' && *p <= '9' ) v = v*10 + static_cast<unsigned long long>(*p++ - '0');
+		if( p == s ) return NULL;
+		value = neg ? -static_cast<long long>(v) : static_cast<long long>(v);
+		return p;
+	}
+
+	/// Parse floating point number from text in [p,e), leading spaces are skipped as in scanf.
+	/// Numbers with at most 15 significant digits and decimal exponent within [-22,22] are
+	/// converted exactly by a single multiplication or division, that covers numbers written
+	/// with printf formats. Other numbers, including nan and inf, are passed to strtod.
+	/// Only the fallback depends on the decimal point of the current C locale, files should
+	/// be read in the "C" locale to get the same result for all numbers.
+	/// Returns position right after the number or NULL if there is no number.
+	inline const char * io_parse_real(const char * p, const char * e, double & value)
+	{
+		static const double pow10[23] = 
+		{
+			1.0e+0, 1.0e+1, 1.0e+2, 1.0e+3, 1.0e+4, 1.0e+5, 1.0e+6, 1.0e+7,
+			1.0e+8, 1.0e+9, 1.0e+10,1.0e+11,1.0e+12,1.0e+13,1.0e+14,1.0e+15,
+			1.0e+16,1.0e+17,1.0e+18,1.0e+19,1.0e+20,1.0e+21,1.0e+22
+		};
+		while( p < e && isspace(static_cast<unsigned char>(*p)) ) ++p;
+		const char * s = p;
+		bool neg = false, any = false, exact = true;
+		if( p < e && (*p == '-' || *p == '+') ) neg = (*p++ == '-');
+		unsigned long long mant = 0;
+		int digits = 0, exp10 = 0;
+		while( p < e && *p >= '0' && *p <= '9' )
+		{
+			if( digits < 19 ) 
+			{
+				mant = mant*10 + static_cast<unsigned long long>(*p - '0');
+				if( mant ) digits++;
+			}
+			else 
+			{
+				exp10++;
+				exact = false;
+			}
+			any = true;
+			++p;
+		}
+		if( p < e && *p == '.' )
+		{
+			++p;
+			while( p < e && *p >= '0' && *p <= '9' )
+			{
+				if( digits < 19 )
+				{
+					mant = mant*10 + static_cast<unsigned long long>(*p - '0');
+					if( mant ) digits++;
+					exp10--;
+				}
+				else exact = false;
+				any = true;
+				++p;
+			}
+		}
+		if( any && p < e && (*p == 'e' || *p == 'E') )
+		{
+			long long ev;
+			const char * q = p+1;
+			//exponent should follow immediately
+			if( q < e && !isspace(static_cast<unsigned char>(*q)) && (q = io_parse_integer(q,e,ev)) != NULL )
+			{
+				if( ev > 100000 ) ev = 100000;
+				if( ev < -100000 ) ev = -100000;
+				exp10 += static_cast<int>(ev);
+				p = q;
+			}
+		}
+		if( any && exact && digits <= 15 && exp10 >= -22 && exp10 <= 22 )
+		{
+			double v = static_cast<double>(mant);
+			if( exp10 < 0 ) v /= pow10[-exp10];
+			else v *= pow10[exp10];
+			value = neg ? -v : v;
+			return p;
+		}
+		//rare case, let the standard library deal with it
+		if( !any ) while( p < e && !isspace(static_cast<unsigned char>(*p)) && *p != '\0' ) ++p;
+		if( p == s ) return NULL;
+		std::string token(s,p);
+		char * end;
+		value = strtod(token.c_str(),&end);
+		if( end == token.c_str() ) return NULL;
+		return s + (end - token.c_str());
+	}
+
+	/// Replacement for sscanf(p,"%d%n",&value,&nchars), returns true if number was read.
+	template<typename T>
+	inline bool io_scan_integer(const char * p, T & value, int & nchars)
+	{
+		long long v;
+		const char * q = io_parse_integer(p,p+strlen(p),v);
+		if( q == NULL ) return false;
+		value = static_cast<T>(v);
+		nchars = static_cast<int>(q - p);
+		return true;
+	}
+
+	/// Replacement for sscanf(p,"%lf%n",&value,&nchars), returns true if number was read.
+	template<typename T>
+	inline bool io_scan_real(const char * p, T & value, int & nchars)
+	{
+		double v;
+		const char * q = io_parse_real(p,p+strlen(p),v);
+		if( q == NULL ) return false;
+		value = static_cast<T>(v);
+		nchars = static_cast<int>(q - p);
+		return true;
+	}
+
+	/// Replacement for atoi, returns zero if there is no number.
+	inline int io_atoi(const char * str)
+	{
+		long long v = 0;
+		io_parse_integer(str,str+strlen(str),v);
+		return static_cast<int>(v);
+	}
+
+	/// Replacement for atof, returns zero if there is no number.
+	inline double io_atof(const char * str)
+	{
+		double v = 0;
+		if( io_parse_real(str,str+strlen(str),v) == NULL ) v = 0;
+		return v;
+	}
+
+	/// Replacement for fseek from the beginning of the file with 64-bit offset,
+	/// fseek takes long that is 32-bit on windows. Returns zero on success.
+	inline int io_fseek(FILE * f, long long offset)
+	{
+#if defined(_WIN32)
+		return _fseeki64(f,offset,SEEK_SET);
+#else
+		if( static_cast<long long>(static_cast<off_t>(offset)) != offset ) return -1;
+		return fseeko(f,static_cast<off_t>(offset),SEEK_SET);
+#endif
+	}
+
+	/// Reads text files by large blocks and parses words and numbers without the overhead of
+	/// scanf family and streams. The same interface is provided for a text that is already in memory.
+	/// Binary data may be read in between with io_tokenizer::read, as with fread.
+	class io_tokenizer
+	{
+		FILE * f;
+		std::vector<char> block;
+		const char * pos, * end;
+		bool more; //there may be more data in the file
+		/// Longest token that should be in the block before it is parsed.
+		enum {max_token = 256};
+		/// Make sure that at least need bytes are in the block unless the file ends.
+		/// Returns true if there is any data in the block.
+		bool fill(size_t need)
+		{
+			if( static_cast<size_t>(end - pos) >= need || !more ) return pos < end;
+			size_t left = static_cast<size_t>(end - pos);
+			if( left ) memmove(&block[0],pos,left);
+			if( block.size() < need ) block.resize(need);
+			size_t got = fread(&block[left],1,block.size()-left,f);
+			if( got < block.size() - left ) more = false;
+			pos = &block[0];
+			end = pos + left + got;
+			return pos < end;
+		}
+		io_tokenizer(const io_tokenizer & other);
+		io_tokenizer & operator =(const io_tokenizer & other);
+	public:
+		/// Read the text from file by blocks of given size, the file is not closed.
+		io_tokenizer(FILE * f, size_t block_size = 1048576) 
+			: f(f), block(std::max(block_size,static_cast<size_t>(max_token))), pos(&block[0]), end(&block[0]), more(true) {}
+		/// Read the text from memory, the text should be kept while tokenizer is in use.
+		io_tokenizer(const std::string & text) 
+			: f(NULL), pos(text.c_str()), end(text.c_str()+text.size()), more(false) {}
+		/// Underlying file.
+		FILE * file() const {return f;}
+		/// No more data.
+		bool eof() {return !fill(1);}
+		/// Skip spaces and new lines. Returns false if nothing left.
+		bool skip_space()
+		{
+			do
+			{
+				while( pos < end && isspace(static_cast<unsigned char>(*pos)) ) ++pos;
+				if( pos < end ) return true;
+			} while( fill(1) );
+			return false;
+		}
+		/// Read line as fgets does, the line includes new line character.
+		/// Returns false if nothing left.
+		bool getline(char * str, int size)
+		{
+			int k = 0;
+			while( k < size - 1 && fill(1) )
+			{
+				size_t n = std::min(static_cast<size_t>(end - pos),static_cast<size_t>(size - 1 - k));
+				const char * nl = static_cast<const char *>(memchr(pos,'\n',n));
+				if( nl ) n = static_cast<size_t>(nl - pos) + 1;
+				memcpy(str+k,pos,n);
+				pos += n;
+				k += static_cast<int>(n);
+				if( nl ) break;
+			}
+			str[k] = '\0';
+			return k > 0;
+		}
+		/// Read word separated by spaces as "%s" in scanf, word is truncated to the size.
+		/// Returns false if nothing left.
+		bool read_word(char * str, int size)
+		{
+			if( !skip_space() ) return false;
+			int k = 0;
+			do
+			{
+				while( pos < end && !isspace(static_cast<unsigned char>(*pos)) ) 
+				{
+					if( k < size - 1 ) str[k++] = *pos;
+					++pos;
+				}
+			} while( pos == end && fill(1) );
+			str[k] = '\0';
+			return true;
+		}
+		/// Read integer number. Returns false if there is no number.
+		template<typename T>
+		bool read_integer(T & value)
+		{
+			if( !skip_space() ) return false;
+			fill(max_token);
+			long long v;
+			const char * q = io_parse_integer(pos,end,v);
+			//number may continue in the file
+			while( q == end && more )
+			{
+				fill(2*static_cast<size_t>(end - pos));
+				q = io_parse_integer(pos,end,v);
+			}
+			if( q == NULL ) return false;
+			value = static_cast<T>(v);
+			pos = q;
+			return true;
+		}
+		/// Read floating point number. Returns false if there is no number.
+		template<typename T>
+		bool read_real(T & value)
+		{
+			if( !skip_space() ) return false;
+			fill(max_token);
+			double v;
+			const char * q = io_parse_real(pos,end,v);
+			//number may continue in the file
+			while( q == end && more )
+			{
+				fill(2*static_cast<size_t>(end - pos));
+				q = io_parse_real(pos,end,v);
+			}
+			if( q == NULL ) return false;
+			value = static_cast<T>(v);
+			pos = q;
+			return true;
+		}
+		/// Read binary data as fread does, returns number of elements read.
+		size_t read(void * ptr, size_t size, size_t count)
+		{
+			size_t total = size*count, k = std::min(total,static_cast<size_t>(end - pos));
+			memcpy(ptr,pos,k);
+			pos += k;
+			if( k < total && more ) 
+			{
+				size_t got = fread(static_cast<char *>(ptr)+k,1,total-k,f);
+				if( got < total - k ) more = false;
+				k += got;
+			}
+			return size ? k / size : 0;
+		}
+	};
 	
 }
 #endif //_IO_H
@@ -4,6 +4,7 @@
 #endif
 
 #include "inmost.h"
+#include "io.hpp"
 #include "../Mesh/incident_matrix.hpp"
 #include <string>
 #include <ctime>
@@ -543,7 +544,7 @@ namespace INMOST
 						k++;
 						q++;
 					}
-					int count = atoi(input+k);
+					int count = io_atoi(input+k);
 					for (int l = 0; l < count; ++l)
 					{
 						output[q++] = '*';
@@ -606,6 +607,333 @@ namespace INMOST
 		else return file.substr(0, found);
 	}
 
+	/// Keyword of binary Eclipse file (EGRID, INIT), data follows in records of at most 1000 numbers.
+	struct ecl_keyword
+	{
+		std::string name; ///< Name of the keyword, trailing spaces are removed.
+		std::string type; ///< Type of data: INTE, REAL, DOUB, LOGI, CHAR, MESS or C0nn.
+		long long count; ///< Number of items.
+		long long offset; ///< Position of the first data record.
+		int size; ///< Size of item in bytes.
+		int block; ///< Number of items in full data record.
+	};
+
+	/// Number encoded in big-endian order.
+	static unsigned long long ecl_big_endian(const char * p, int bytes)
+	{
+		unsigned long long ret = 0;
+		for (int k = 0; k < bytes; ++k)
+			ret = (ret << 8) | static_cast<unsigned char>(p[k]);
+		return ret;
+	}
+
+	/// Unformatted binary Eclipse file with big-endian Fortran records. Headers of all keywords are scanned
+	/// on opening, data of a keyword is split into contiguous slices of items, each processor reads and
+	/// converts only its slice, through MPI-IO if it is available, and the slices are gathered on all processors.
+	class ecl_binary_file
+	{
+		FILE * f;
+#if defined(USE_MPI) && defined(USE_MPI_FILE)
+		MPI_File fh;
+#endif
+		INMOST_MPI_Comm comm;
+		int rank, size;
+		std::vector<ecl_keyword> keywords;
+		size_t read_at(long long offset, char * data, size_t bytes)
+		{
+#if defined(USE_MPI) && defined(USE_MPI_FILE)
+			if (fh != MPI_FILE_NULL)
+			{
+				size_t got = 0;
+				while (got < bytes)
+				{
+					TraceMPI trace_mpi;
+					MPI_Status stat;
+					int chunk = static_cast<int>(std::min<size_t>(bytes - got, 1073741824)), count = 0;
+					int ierr = MPI_File_read_at(fh, static_cast<MPI_Offset>(offset + got), data + got, chunk, MPI_CHAR, &stat);
+					if (ierr != MPI_SUCCESS) MPI_Abort(comm, __LINE__);
+					MPI_Get_count(&stat, MPI_CHAR, &count);
+					got += count;
+					if (count < chunk) break;
+				}
+				return got;
+			}
+#endif
+			if (io_fseek(f, offset)) return 0;
+			return fread(data, 1, bytes, f);
+		}
+		/// Read items of keyword from first to last and convert them with given function.
+		template<typename T, typename Convert>
+		void read_slice(const ecl_keyword & kw, long long first, long long last, T * out, Convert conv)
+		{
+			if (first >= last) return;
+			long long rec = static_cast<long long>(kw.block)*kw.size + 8;
+			long long beg = kw.offset + (first / kw.block)*rec + 4 + (first % kw.block)*kw.size;
+			long long end = kw.offset + ((last - 1) / kw.block)*rec + 4 + ((last - 1) % kw.block + 1)*kw.size;
+			std::vector<char> data(static_cast<size_t>(end - beg));
+			if (read_at(beg, &data[0], data.size()) != data.size())
+			{
+				std::cout << __FILE__ << ":" << __LINE__ << " cannot read data of " << kw.name << std::endl;
+				throw BadFile;
+			}
+			for (long long k = first; k < last; ++k)
+				out[k - first] = conv(&data[static_cast<size_t>(kw.offset + (k / kw.block)*rec + 4 + (k % kw.block)*kw.size - beg)], kw);
+		}
+		static Storage::real to_real(const char * p, const ecl_keyword & kw)
+		{
+			if (kw.type == "DOUB")
+			{
+				unsigned long long v = ecl_big_endian(p, 8);
+				double d;
+				memcpy(&d, &v, 8);
+				return d;
+			}
+			else if (kw.type == "REAL")
+			{
+				uint32_t v = static_cast<uint32_t>(ecl_big_endian(p, 4));
+				float d;
+				memcpy(&d, &v, 4);
+				return d;
+			}
+			return static_cast<Storage::real>(static_cast<int32_t>(ecl_big_endian(p, 4)));
+		}
+		static Storage::integer to_integer(const char * p, const ecl_keyword & kw)
+		{
+			if (kw.type == "INTE" || kw.type == "LOGI")
+				return static_cast<int32_t>(ecl_big_endian(p, 4));
+			return static_cast<Storage::integer>(to_real(p, kw));
+		}
+		/// Read all data of numeric keyword on all processors.
+		template<typename T, typename Convert>
+		void read_all(const ecl_keyword & kw, std::vector<T> & out, Convert conv, INMOST_MPI_Type type)
+		{
+			if (kw.size == 0 || kw.type[0] == 'C')
+			{
+				std::cout << __FILE__ << ":" << __LINE__ << " keyword " << kw.name << " is not numeric" << std::endl;
+				throw BadFile;
+			}
+			out.resize(static_cast<size_t>(kw.count));
+			long long first = kw.count*rank / size, last = kw.count*(rank + 1) / size;
+			std::vector<T> slice(static_cast<size_t>(last - first));
+			read_slice(kw, first, last, slice.empty() ? NULL : &slice[0], conv);
+#if defined(USE_MPI)
+			if (size > 1)
+			{
+				TraceMPI trace_mpi;
+				//counts and displacements of MPI_Allgatherv are int, the slices are gathered by parts that fit into int
+				const long long part = 1073741824;
+				std::vector<int> counts(size), displs(size);
+				for (long long beg = 0; beg < kw.count; beg += part)
+				{
+					long long end = std::min(beg + part, kw.count), pos = 0;
+					for (int q = 0; q < size; ++q)
+					{
+						long long qfirst = std::max(kw.count*q / size, beg), qlast = std::min(kw.count*(q + 1) / size, end);
+						counts[q] = static_cast<int>(std::max(qlast - qfirst, 0LL));
+						displs[q] = static_cast<int>(pos);
+						pos += counts[q];
+					}
+					long long own = std::max(first, beg);
+					MPI_Allgatherv(counts[rank] ? &slice[own - first] : NULL, counts[rank], type, &out[beg], &counts[0], &displs[0], type, comm);
+				}
+				return;
+			}
+#else //USE_MPI
+			(void)type;
+#endif //USE_MPI
+			out.swap(slice);
+		}
+		/// Read headers of all keywords, data positions are computed from the record layout.
+		void scan(std::string File)
+		{
+			char header[24], marker[4];
+			long long pos = 0;
+			while (read_at(pos, header, 24) == 24)
+			{
+				ecl_keyword kw;
+				if (ecl_big_endian(header, 4) != 16 || ecl_big_endian(header + 20, 4) != 16)
+				{
+					std::cout << __FILE__ << ":" << __LINE__ << " bad keyword header at position " << pos << " in " << File << std::endl;
+					throw BadFile;
+				}
+				kw.name = std::string(header + 4, 8);
+				kw.name.erase(kw.name.find_last_not_of(' ') + 1);
+				kw.count = static_cast<int32_t>(ecl_big_endian(header + 12, 4));
+				kw.type = std::string(header + 16, 4);
+				if (kw.count < 0)
+				{
+					std::cout << __FILE__ << ":" << __LINE__ << " negative number of items " << kw.count << " of keyword " << kw.name << " in " << File << std::endl;
+					throw BadFile;
+				}
+				kw.block = 1000;
+				if (kw.type == "INTE" || kw.type == "REAL" || kw.type == "LOGI") kw.size = 4;
+				else if (kw.type == "DOUB") kw.size = 8;
+				else if (kw.type == "MESS") kw.size = 0;
+				else if (kw.type == "CHAR") kw.size = 8, kw.block = 105;
+				else if (kw.type[0] == 'C') kw.size = io_atoi(kw.type.c_str() + 1), kw.block = 105;
+				else
+				{
+					std::cout << __FILE__ << ":" << __LINE__ << " unknown data type " << kw.type << " of keyword " << kw.name << " in " << File << std::endl;
+					throw BadFile;
+				}
+				kw.offset = pos + 24;
+				long long nrec = (kw.count + kw.block - 1) / kw.block;
+				if (nrec && kw.size && (read_at(kw.offset, marker, 4) != 4 || static_cast<long long>(ecl_big_endian(marker, 4)) != std::min<long long>(kw.count, kw.block)*kw.size))
+				{
+					std::cout << __FILE__ << ":" << __LINE__ << " bad data record of keyword " << kw.name << " in " << File << std::endl;
+					throw BadFile;
+				}
+				pos = kw.offset + (kw.size ? kw.count*kw.size + 8 * nrec : 0);
+				keywords.push_back(kw);
+			}
+		}
+		void close()
+		{
+			if (f != NULL) fclose(f);
+			f = NULL;
+#if defined(USE_MPI) && defined(USE_MPI_FILE)
+			if (fh != MPI_FILE_NULL) MPI_File_close(&fh);
+#endif
+		}
+		ecl_binary_file(const ecl_binary_file & other);
+		ecl_binary_file & operator =(const ecl_binary_file & other);
+	public:
+		ecl_binary_file(std::string File, Mesh * m) : f(NULL), comm(m->GetCommunicator()), rank(m->GetProcessorRank()), size(m->GetProcessorsNumber())
+		{
+#if defined(USE_MPI) && defined(USE_MPI_FILE)
+			fh = MPI_FILE_NULL;
+			if (size > 1)
+			{
+				int ierr = MPI_File_open(comm, const_cast<char *>(File.c_str()), MPI_MODE_RDONLY, MPI_INFO_NULL, &fh);
+				if (ierr != MPI_SUCCESS)
+				{
+					std::cout << __FILE__ << ":" << __LINE__ << " cannot open file " << File << std::endl;
+					throw BadFileName;
+				}
+			}
+			else
+#endif
+			{
+				f = fopen(File.c_str(), "rb");
+				if (f == NULL)
+				{
+					std::cout << __FILE__ << ":" << __LINE__ << " cannot open file " << File << std::endl;
+					throw BadFileName;
+				}
+			}
+			try
+			{
+				scan(File);
+			}
+			catch (...)
+			{
+				close();
+				throw;
+			}
+		}
+		~ecl_binary_file() { close(); }
+		/// Keywords of the file in the order of appearance.
+		const std::vector<ecl_keyword> & Keywords() const { return keywords; }
+		/// Read all data of numeric keyword on all processors.
+		void Read(const ecl_keyword & kw, std::vector<Storage::real> & out) { read_all(kw, out, to_real, INMOST_MPI_DATA_REAL_TYPE); }
+		void Read(const ecl_keyword & kw, std::vector<Storage::integer> & out) { read_all(kw, out, to_integer, INMOST_MPI_DATA_INTEGER_TYPE); }
+	};
+
+	/// Put values given either for all blocks or only for active blocks into array over all blocks,
+	/// every stride-th value starting from shift is written.
+	template<typename T>
+	static bool ecl_expand(const std::vector<T> & in, const std::vector<Storage::integer> & actnum, size_t total, std::vector<T> & out, int stride, int shift)
+	{
+		if (out.empty()) out.resize(total*stride, T(0));
+		if (in.size() == total)
+		{
+			for (size_t k = 0; k < total; ++k) out[k*stride + shift] = in[k];
+			return true;
+		}
+		size_t q = 0;
+		for (size_t k = 0; k < actnum.size() && q < in.size(); ++k)
+			if (actnum[k]) out[k*stride + shift] = in[q++];
+		return q == in.size() && !actnum.empty();
+	}
+
+	/// Read corner point grid from binary EGRID file and properties of blocks from INIT file with the same name
+	/// if it exists. Arrays are filled the same way as from keywords of GRDECL file.
+	static void ecl_load_egrid(Mesh * m, std::string File, int verbosity, Storage::integer dims[3], std::vector<Storage::real> & xyz, std::vector<Storage::real> & zcorn,
+		std::vector<Storage::integer> & actnum, std::vector<Storage::real> & perm, char & have_perm, std::vector<Storage::real> & poro, std::vector<Storage::real> & ntg,
+		std::vector<Storage::real> & thconr, std::vector<Storage::integer> & satnum, std::vector<Storage::integer> & pvtnum, std::vector<Storage::integer> & eqlnum,
+		std::vector<Storage::integer> & rocknum)
+	{
+		bool have_dimens = false;
+		{
+			ecl_binary_file egrid(File, m);
+			const std::vector<ecl_keyword> & kws = egrid.Keywords();
+			for (size_t k = 0; k < kws.size() && kws[k].name != "ENDGRID"; ++k)
+			{
+				if (kws[k].name == "GRIDHEAD")
+				{
+					std::vector<Storage::integer> head;
+					egrid.Read(kws[k], head);
+					if (head.size() < 4 || head[0] != 1)
+					{
+						std::cout << __FILE__ << ":" << __LINE__ << " only corner point grids are supported in " << File << std::endl;
+						throw BadFile;
+					}
+					dims[0] = head[1];
+					dims[1] = head[2];
+					dims[2] = head[3];
+					have_dimens = true;
+				}
+				else if (kws[k].name == "COORD") egrid.Read(kws[k], xyz);
+				else if (kws[k].name == "ZCORN") egrid.Read(kws[k], zcorn);
+				else if (kws[k].name == "ACTNUM") egrid.Read(kws[k], actnum);
+			}
+		}
+		if (!have_dimens || xyz.size() != static_cast<size_t>(6 * (dims[0] + 1)*(dims[1] + 1)) || zcorn.size() != static_cast<size_t>(8 * dims[0] * dims[1] * dims[2]) ||
+			!(actnum.empty() || actnum.size() == static_cast<size_t>(dims[0] * dims[1] * dims[2])))
+		{
+			std::cout << __FILE__ << ":" << __LINE__ << " GRIDHEAD, COORD or ZCORN is missing or has wrong size in " << File << std::endl;
+			throw BadFile;
+		}
+		size_t dot = File.find_last_of('.');
+		std::string init = File.substr(0, dot) + (File.substr(dot + 1) == "EGRID" ? ".INIT" : ".init");
+		FILE * f = fopen(init.c_str(), "rb");
+		if (f == NULL) return;
+		fclose(f);
+		ecl_binary_file props(init, m);
+		const std::vector<ecl_keyword> & kws = props.Keywords();
+		size_t total = static_cast<size_t>(dims[0] * dims[1] * dims[2]);
+		std::vector<Storage::real> rvals;
+		std::vector<Storage::integer> ivals;
+		for (size_t k = 0; k < kws.size(); ++k)
+		{
+			const std::string & name = kws[k].name;
+			bool ok = true;
+			if (name == "PERMX" || name == "PERMY" || name == "PERMZ")
+			{
+				props.Read(kws[k], rvals);
+				ok = ecl_expand(rvals, actnum, total, perm, 3, name[4] - 'X');
+				have_perm |= (name[4] == 'X' ? HAVE_PERM_X : (name[4] == 'Y' ? HAVE_PERM_Y : HAVE_PERM_Z));
+			}
+			else if (name == "PORO" || name == "NTG" || name == "THCONR")
+			{
+				props.Read(kws[k], rvals);
+				ok = ecl_expand(rvals, actnum, total, name == "PORO" ? poro : (name == "NTG" ? ntg : thconr), 1, 0);
+			}
+			else if (name == "SATNUM" || name == "PVTNUM" || name == "EQLNUM" || name == "ROCKNUM")
+			{
+				props.Read(kws[k], ivals);
+				ok = ecl_expand(ivals, actnum, total, name == "SATNUM" ? satnum : (name == "PVTNUM" ? pvtnum : (name == "EQLNUM" ? eqlnum : rocknum)), 1, 0);
+			}
+			if (!ok)
+			{
+				std::cout << __FILE__ << ":" << __LINE__ << " number of values " << kws[k].count << " of " << name << " in " << init << " matches neither number of blocks nor number of active blocks" << std::endl;
+				throw BadFile;
+			}
+		}
+		if (verbosity > 0 && m->GetProcessorRank() == 0)
+			std::cout << "Read properties from " << init << std::endl;
+	}
+
 	static ElementArray<Edge> OrderEdges(const ElementArray<Edge> & input, MarkerType mrk)
 	{
 		Mesh * m = const_cast<Mesh *>(input.GetMeshLink());
@@ -1238,7 +1566,7 @@ namespace INMOST
 			}
 			if (file_options[k].first == "VERBOSITY")
 			{
-				verbosity = atoi(file_options[k].second.c_str());
+				verbosity = io_atoi(file_options[k].second.c_str());
 				if (verbosity < 0 || verbosity > 2)
 				{
 					printf("%s:%d Unknown verbosity option: %s\n", __FILE__, __LINE__, file_options[k].second.c_str());
@@ -1247,16 +1575,18 @@ namespace INMOST
 			}
 		}
 		std::vector<HandleType> old_nodes(NumberOfNodes());
+		NodeMatcher matcher(this);
 		{
 			unsigned qq = 0;
 			for (Mesh::iteratorNode it = BeginNode(); it != EndNode(); ++it)
 				old_nodes[qq++] = *it;
 		}
 		if (!old_nodes.empty())
-			std::sort(old_nodes.begin(), old_nodes.end(), CentroidComparator(this));
+			matcher.Build(old_nodes);
 
-		FILE * f = fopen(File.c_str(), "r");
-		if (f == NULL)
+		bool egrid = ToUpper(File).find(".EGRID") != std::string::npos;
+		FILE * f = egrid ? NULL : fopen(File.c_str(), "r");
+		if (f == NULL && !egrid)
 		{
 			std::cout << __FILE__ << ":" << __LINE__ << " cannot open file " << File << std::endl;
 			throw BadFileName;
@@ -1267,7 +1597,8 @@ namespace INMOST
 			tt = Timer();
 			std::cout << "Started loading " << File << std::endl;
 		}
-		std::vector< std::pair< std::pair<FILE *, std::string>, int> > fs(1, std::make_pair(std::make_pair(f, File), 0));
+		std::vector< std::pair< std::pair<io_tokenizer *, std::string>, int> > fs;
+		if (!egrid) fs.push_back(std::make_pair(std::make_pair(new io_tokenizer(f), File), 0));
 		char readline[2048], readlines[2048], *p, *pend, rec[2048], pupper[2048];
 		int text_end, text_start, state = ECL_NONE, state_from = ECL_NONE, state_incl = ECL_NONE, nchars;
 		int waitlines = 0;
@@ -1304,9 +1635,15 @@ namespace INMOST
 		//compdat_wells compdat; 
 		//welspecs_wells welspecs;
 		wells_data wells_sched;
+		if (egrid) //binary grid, there are no keywords to parse
+		{
+			ecl_load_egrid(this, File, verbosity, dims, xyz, zcorn, actnum, perm, have_perm, poro, ntg, thconr, satnum, pvtnum, eqlnum, rocknum);
+			have_dimens = 1;
+			gtype = ECL_GTYPE_ZCORN;
+		}
 		while (!fs.empty())
 		{
-			while (fgets(readline, 2048, fs.back().first.first) != NULL)
+			while (fs.back().first.first->getline(readline, 2048))
 			{
 				fs.back().second++; //line number
 				{
@@ -1688,7 +2025,7 @@ namespace INMOST
 							std::cout << __FILE__ << ":" << __LINE__ << " cannot open file " << filename << " included from " << fs.back().first.second << " line " << fs.back().second << std::endl;
 							throw BadFileName;
 						}
-						fs.push_back(std::make_pair(std::make_pair(f, GetFolder(fs.back().first.second) + "/" + std::string(rec + shift_one)), 0));
+						fs.push_back(std::make_pair(std::make_pair(new io_tokenizer(f), GetFolder(fs.back().first.second) + "/" + std::string(rec + shift_one)), 0));
 						if (*(pend - 1) == '/') state_incl = ECL_NONE; else state_incl = ECL_SKIP_SECTION;
 						state = ECL_NONE;
 					}
@@ -1724,7 +2061,7 @@ namespace INMOST
 				case ECL_THCONR:
 					while (downread > 0 && p < pend)
 					{
-						if (1 == sscanf(p, "%s%n", rec, &nchars))
+						if (ReadName(p, pend, rec, &nchars))
 						{
 							p += nchars;
 							while (isspace(*p) && p < pend) ++p;
@@ -1737,10 +2074,10 @@ namespace INMOST
 								rec[q] = '\0';
 								break;
 							}
-							if (begval > 0) count = atoi(rec);
+							if (begval > 0) count = io_atoi(rec);
 							if (argtype == ECL_VAR_REAL)
 							{
-								Storage::real val = atof(rec + begval);
+								Storage::real val = io_atof(rec + begval);
 								while (count && downread)
 								{
 									read_arrayf[numrecs*(totread - (downread--)) + (state - offset)] = val;
@@ -1749,7 +2086,7 @@ namespace INMOST
 							}
 							else if (argtype == ECL_VAR_INT)
 							{
-								Storage::integer val = atoi(rec + begval);
+								Storage::integer val = io_atoi(rec + begval);
 								while (count && downread)
 								{
 									read_arrayi[numrecs*(totread - (downread--)) + (state - offset)] = val;
@@ -1808,13 +2145,13 @@ namespace INMOST
 							{
 								if (rec[k] == '*')
 								{
-									count = atoi(rec);
-									val = atof(rec+k+1);
+									count = io_atoi(rec);
+									val = io_atof(rec+k+1);
 									have_star = true;
 									break;
 								}
 							}
-							if(!have_star) val = atof(rec);
+							if(!have_star) val = io_atof(rec);
 							for(int k = 0; k < count; ++k)
 								tsteps.push_back(val);
 							p += nchars;
@@ -1825,7 +2162,7 @@ namespace INMOST
 					if (ReadName(p, pend, rec, &nchars) && rec[0] != '/')
 					{
 						memset(&date_cur, 0, sizeof(struct tm));
-						date_cur.tm_mday = atoi(rec);
+						date_cur.tm_mday = io_atoi(rec);
 						if( !read_start )
 							state_from = ECL_DATES;
 						state = ECL_DATES_MON;
@@ -1966,7 +2303,7 @@ namespace INMOST
 				case ECL_MULTIPLY_MUL:
 					if (1 == sscanf(p, "%s%n", rec, &nchars))
 					{
-						mult_cur.mult = atof(rec);
+						mult_cur.mult = io_atof(rec);
 						state = ECL_MULTIPLY_BLK;
 						downread = 0;
 						totread = 6;
@@ -2010,7 +2347,7 @@ namespace INMOST
 					//if (1 == sscanf(p, "%d%n", editnnc_cur.bijk+downread, &nchars))
 					if (1 == sscanf(p, "%s%n", rec, &nchars) && rec[0] != '/')
 					{
-						editnnc_cur.bijk[0] = atoi(rec);
+						editnnc_cur.bijk[0] = io_atoi(rec);
 						downread = 1;
 						totread = 6;
 						state = ECL_EDITNNC_BLK;
@@ -2054,7 +2391,7 @@ namespace INMOST
 				case ECL_EDITNNC_MUL:
 					if (1 == sscanf(p, "%s%n", rec, &nchars))
 					{
-						editnnc_cur.mult = atof(rec);
+						editnnc_cur.mult = io_atof(rec);
 						editnnc.push_back(editnnc_cur);
 						state_from = state = ECL_EDITNNC;
 						p += nchars;
@@ -2165,7 +2502,7 @@ namespace INMOST
 						if (ReadName(p,pend,rec,&nchars) && rec[0] != '/')
 						{
 							if( rec[0] != '*' )
-								wconprodinje_cur.second.urats.rats[downread] = atof(rec);
+								wconprodinje_cur.second.urats.rats[downread] = io_atof(rec);
 							downread++;
 							if (downread == totread)
 								state = ECL_WCONPRODINJE_BHP;
@@ -2190,7 +2527,7 @@ namespace INMOST
 					if (ReadName(p, pend, rec, &nchars) && rec[0] != '/')
 					{
 						if (rec[0] != '*')
-							wconprodinje_cur.second.bhp = atof(rec);
+							wconprodinje_cur.second.bhp = io_atof(rec);
 						wells_sched[wconprodinje_cur.first].wpi[(int)tsteps.size()] = wconprodinje_cur.second;
 						state_from = state = ECL_WCONPRODINJE;
 						p += nchars;
@@ -2272,7 +2609,7 @@ namespace INMOST
 					if (ReadName(p, pend, rec, &nchars) && rec[0] != '/')
 					{
 						if( rec[0] != '*' )
-							welspecs_cur.second.depth = atof(rec);
+							welspecs_cur.second.depth = io_atof(rec);
 						if (wellspec)
 						{
 							wells_sched[welspecs_cur.first].wspec = welspecs_cur.second;
@@ -2391,7 +2728,7 @@ namespace INMOST
 					if (1 == sscanf(p, "%s%n", rec, &nchars))
 					{
 						if( rec[0] != '*' )
-							compdat_cur.second.satnum = atoi(rec);
+							compdat_cur.second.satnum = io_atoi(rec);
 						state = ECL_COMPDAT_TRANS;
 						p += nchars;
 						while (isspace(*p) && p < pend) ++p;
@@ -2406,7 +2743,7 @@ namespace INMOST
 					if (1 == sscanf(p, "%s%n", rec, &nchars))
 					{
 						if (rec[0] != '*')
-							compdat_cur.second.WI = atof(rec);
+							compdat_cur.second.WI = io_atof(rec);
 						state = ECL_COMPDAT_BORE;
 						p += nchars;
 						while (isspace(*p) && p < pend) ++p;
@@ -2429,7 +2766,7 @@ namespace INMOST
 					if (1 == sscanf(p, "%s%n", rec, &nchars))
 					{
 						if (rec[0] != '*')
-							compdat_cur.second.rw = atof(rec);
+							compdat_cur.second.rw = io_atof(rec);
 						state = ECL_COMPDAT_PERM;
 						p += nchars;
 						while (isspace(*p) && p < pend) ++p;
@@ -2452,7 +2789,7 @@ namespace INMOST
 					if (1 == sscanf(p, "%s%n", rec, &nchars))
 					{
 						if( rec[0] != '*' )
-							compdat_cur.second.perm = atof(rec);
+							compdat_cur.second.perm = io_atof(rec);
 						state = ECL_COMPDAT_SKIN;
 						p += nchars;
 						while (isspace(*p) && p < pend) ++p;
@@ -2475,7 +2812,7 @@ namespace INMOST
 					if (1 == sscanf(p, "%s%n", rec, &nchars))
 					{
 						if (rec[0] != '*')
-							compdat_cur.second.skin = atof(rec);
+							compdat_cur.second.skin = io_atof(rec);
 						state = ECL_COMPDAT_DFAC;
 						p += nchars;
 						while (isspace(*p) && p < pend) ++p;
@@ -2498,7 +2835,7 @@ namespace INMOST
 					if (1 == sscanf(p, "%s%n", rec, &nchars))
 					{
 						if (rec[0] != '*')
-							compdat_cur.second.dfac = atof(rec);
+							compdat_cur.second.dfac = io_atof(rec);
 						state = ECL_COMPDAT_DIR;
 						p += nchars;
 						while (isspace(*p) && p < pend) ++p;
@@ -2554,7 +2891,7 @@ namespace INMOST
 					if (1 == sscanf(p, "%s%n", rec, &nchars))
 					{
 						if (rec[0] != '*')
-							compdat_cur.second.r0 = atof(rec);
+							compdat_cur.second.r0 = io_atof(rec);
 						//compdat[compdat_cur.first].push_back(compdat_cur.second);
 						wells_sched[compdat_cur.first].compdat[(int)tsteps.size()].push_back(compdat_cur.second);
 						state = ECL_COMPDAT;
@@ -2651,7 +2988,7 @@ namespace INMOST
 				case ECL_MULTFLT_MUL:
 					if (1 == sscanf(p, "%s%n", rec, &nchars))
 					{
-						multflt_cur.mult = atof(rec);
+						multflt_cur.mult = io_atof(rec);
 						multflt.push_back(multflt_cur);
 						p += nchars;
 						while (isspace(*p) && p < pend) ++p;
@@ -2666,7 +3003,8 @@ namespace INMOST
 				}
 			}
 		ecl_exit_loop:
-			fclose(fs.back().first.first);
+			fclose(fs.back().first.first->file());
+			delete fs.back().first.first;
 			fs.pop_back();
 			if( !fs.empty() ) state = state_incl;
 		}
@@ -2794,17 +3132,7 @@ namespace INMOST
 							node_xyz[0] = x;
 							node_xyz[1] = y;
 							node_xyz[2] = z;
-							int find = -1;
-							if (!old_nodes.empty())
-							{
-								std::vector<HandleType>::iterator it = std::lower_bound(old_nodes.begin(), old_nodes.end(), node_xyz, CentroidComparator(this));
-								if (it != old_nodes.end())
-								{
-									Storage::real_array c = RealArrayDF(*it, CoordsTag());
-									if (CentroidComparator(this).Compare(node_xyz, c.data()) == 0)
-										find = static_cast<int>(it - old_nodes.begin());
-								}
-							}
+							int find = matcher.Find(node_xyz);
 							if (find == -1)
 								newnodes[numnode++] = CreateNode(node_xyz)->GetHandle();
 							else newnodes[numnode++] = old_nodes[find];
@@ -3089,17 +3417,7 @@ namespace INMOST
 							node_xyz[1] = ymin + mean_alpha * (ymax - ymin);
 							node_xyz[2] = mean_depth;
 							//search node among priviously existed nodes, create if not found
-							int find = -1;
-							if (!old_nodes.empty())
-							{
-								std::vector<HandleType>::iterator it = std::lower_bound(old_nodes.begin(), old_nodes.end(), node_xyz, CentroidComparator(this));
-								if (it != old_nodes.end())
-								{
-									Storage::real_array c = RealArrayDF(*it, CoordsTag());
-									if (CentroidComparator(this).Compare(node_xyz, c.data()) == 0)
-										find = static_cast<int>(it - old_nodes.begin());
-								}
-							}
+							int find = matcher.Find(node_xyz);
 							Node current = (find == -1 ? CreateNode(node_xyz) : Node(this, old_nodes[find]));
 							//write down pillar node information (debug)
 							//integer_array pn = current->IntegerArray(pillar_num);
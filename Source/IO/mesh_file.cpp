@@ -28,10 +28,10 @@
 #define ENTER_FUNC() long double all_time = Timer(); WriteTab(out_time) << "<FUNCTION name=\"" << __FUNCTION__ << "\" id=\"func" << func_id++ << "\">\n"; Enter();
 #define EXIT_FUNC() WriteTab(out_time) << "<TIME>" << Timer() - all_time << "</TIME>\n"; Exit(); WriteTab(out_time) << "</FUNCTION>\n";
 #else
-#define REPORT_MPI(x) x
+#define REPORT_MPI(x) {TraceMPI trace_mpi; x;}
 #define REPORT_STR(x) 
 #define REPORT_VAL(str,x)
-#define ENTER_FUNC()
+#define ENTER_FUNC() TraceScope trace_scope(__FUNCTION__);
 #define EXIT_FUNC() 
 #endif
 
@@ -102,6 +102,8 @@ namespace INMOST
 		*/
 		if(LFile.find(".grdecl") != std::string::npos) // this is eclipse grid
 		  LoadECL(File);
+		else if(LFile.find(".egrid") != std::string::npos) // this is binary eclipse grid
+		  LoadECL(File);
 		else if(LFile.find(".pvtk") != std::string::npos) //this is legacy parallel vtk
 		  LoadPVTK(File);
 		else if(LFile.find(".vtk") != std::string::npos) //this is legacy vtk
@@ -112,6 +114,8 @@ namespace INMOST
 		  LoadMSH(File);
 		else if (LFile.find(".xml") != std::string::npos) //new mesh format 
 			LoadXML(File);
+		else if (LFile.find(".pvtu") != std::string::npos) //this is parallel xml vtk
+			LoadPVTU(File);
 		else if (LFile.find(".vtu") != std::string::npos)
 			LoadVTU(File);
 		else if(LFile.find(".pmf") != std::string::npos) //this is inner parallel/platform mesh format
@@ -131,6 +135,10 @@ namespace INMOST
 		  SavePVTK(File);
     else if(LFile.find(".xml") != std::string::npos)
       SaveXML(File);
+		else if(LFile.find(".pvtu") != std::string::npos) //this is parallel xml vtk
+		  SavePVTU(File);
+		else if(LFile.find(".vtu") != std::string::npos) //this is xml vtk
+		  SaveVTU(File);
 		else if(LFile.find(".vtk") != std::string::npos) //this is legacy vtk
 		  SaveVTK(File);
 		else if( LFile.find(".gmv") != std::string::npos) //this is gmv file
@@ -147,13 +155,15 @@ namespace INMOST
 		LFile.resize(File.size());
 		std::transform(File.begin(),File.end(),LFile.begin(),::tolower);
 		if(LFile.find(".grdecl") != std::string::npos) return true;
-		if(LFile.find(".msh") != std::string::npos) return false;
+		if(LFile.find(".egrid") != std::string::npos) return true;
+		if(LFile.find(".msh") != std::string::npos) return GetFileOption("GMSH_PARTITION") == "TRUE";
 		if(LFile.find(".grid") != std::string::npos) return false;
 		else if(LFile.find(".vtk") != std::string::npos) return false;
 		else if(LFile.find(".gmv") != std::string::npos) return false;
 		else if(LFile.find(".pvtk") != std::string::npos) return true;
 		else if(LFile.find(".pmf") != std::string::npos) return true;
 		else if(LFile.find(".xml") != std::string::npos) return true;
+		else if (LFile.find(".pvtu") != std::string::npos) return true;
 		else if (LFile.find(".vtu") != std::string::npos) return false;
 		throw NotImplemented;
 	}
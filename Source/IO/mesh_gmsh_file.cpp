@@ -3,6 +3,7 @@
 #endif
 
 #include "inmost.h"
+#include "io.hpp"
 //gmsh states
 
 #if defined(USE_MESH)
@@ -31,11 +32,784 @@
 
 namespace INMOST
 {
+	/// Number of nodes of gmsh element types from 1 to 19.
+	static const int gmsh_type_nodes[19] =
+	{
+		2,3,4,4,8,6,5,3,6,9,10,
+		27,18,14,1,8,20,15,13
+	};
+
+	/// Number of corner nodes of gmsh element types from 1 to 19, the rest are nodes of higher order elements.
+	static const int gmsh_type_corners[19] =
+	{
+		2,3,4,4,8,6,5,2,3,4,4,
+		8,6,5,1,4,8,6,5
+	};
+
+	/// Create element of gmsh type from the list of its nodes, existing element is returned if it is already in the mesh.
+	static HandleType gmsh_create_element(Mesh * m, int elemtype, ElementArray<Node> & c_nodes)
+	{
+		typedef Storage::integer integer;
+		switch(elemtype)
+		{
+		case 1: return m->CreateEdge(c_nodes).first->GetHandle(); //edge
+		case 2: return m->CreateFace(c_nodes).first->GetHandle(); //triangle
+		case 3: return m->CreateFace(c_nodes).first->GetHandle(); //quad
+		case 4: //tetra
+			{
+				const integer nodesnum[12] = {0,2,1,0,1,3,1,2,3,0,3,2};
+				const integer sizes[4] = {3,3,3,3};
+				return m->CreateCell(c_nodes,nodesnum,sizes,4).first->GetHandle();
+			}
+		case 5: //hex
+			{
+				//const integer nodesnum[24] = {0,4,7,3,1,2,6,5,0,1,5,4,3,7,6,2,0,3,2,1,4,5,6,7};
+				const integer nodesnum[24] = {0,3,2,1,4,5,6,7,0,4,7,3,1,2,6,5,0,1,5,4,2,3,7,6};
+				const integer sizes[6] = {4,4,4,4,4,4};
+				return m->CreateCell(c_nodes,nodesnum,sizes,6).first->GetHandle();
+			}
+		case 6: //prism
+			{
+				//const integer nodesnum[18] = {0,2,5,3,1,4,5,2,0,3,4,1,3,5,4,0,1,2};
+				const integer nodesnum[18] = {0,3,5,2,1,2,5,4,0,1,4,3,3,4,5,0,2,1};
+				const integer sizes[5] = {4,4,4,3,3};
+				return m->CreateCell(c_nodes,nodesnum,sizes,5).first->GetHandle();
+			}
+		case 7: //pyramid
+			{
+				const integer nodesnum[16] = {0,4,3,0,1,4,1,2,4,3,4,2,0,3,2,1};
+				const integer sizes[5] = {3,3,3,3,4};
+				return m->CreateCell(c_nodes,nodesnum,sizes,5).first->GetHandle();
+			}
+		case 8: //second order edge
+			{
+				//treat as just an edge
+				return m->CreateEdge(ElementArray<Node>(m,c_nodes.data(),c_nodes.data()+2)).first->GetHandle();
+			}
+		case 9: //second order tri with nodes on edges
+			{
+				return m->CreateFace(ElementArray<Node>(m,c_nodes.data(),c_nodes.data()+3)).first->GetHandle();
+			}
+		case 10: //second order quad with nodes on edges and in center
+			{
+				return m->CreateFace(ElementArray<Node>(m,c_nodes.data(),c_nodes.data()+4)).first->GetHandle();
+			}
+		case 11: // second order tet with nodes on edges
+			{
+				const integer nodesnum[12] = {0,2,1,0,1,3,1,2,3,0,3,2};
+				const integer sizes[4] = {3,3,3,3};
+				return m->CreateCell(c_nodes,nodesnum,sizes,4).first->GetHandle();
+			}
+		case 12: // second order hex with nodes in centers of edges and faces and in center of volume
+			{
+				const integer nodesnum[24] = {0,4,7,3,1,2,6,5,0,1,5,4,3,7,6,2,0,3,2,1,4,5,6,7};
+				const integer sizes[6] = {4,4,4,4,4,4};
+				return m->CreateCell(c_nodes,nodesnum,sizes,6).first->GetHandle();
+			}
+		case 13: // second order prism  with nodes in centers of edges and quad faces
+			{
+				const integer nodesnum[18] = {0,3,5,2,1,2,5,4,0,1,4,3,3,4,5,0,2,1};
+				const integer sizes[5] = {4,4,4,3,3};
+				return m->CreateCell(c_nodes,nodesnum,sizes,5).first->GetHandle();
+			}
+		case 14: // second order pyramid with nodes in centers of edges and quad faces
+			{
+				const integer nodesnum[16] = {0,4,3,0,1,4,1,2,4,3,4,2,0,3,2,1};
+				const integer sizes[5] = {3,3,3,3,4};
+				return m->CreateCell(c_nodes,nodesnum,sizes,5).first->GetHandle();
+			}
+		case 15: // vertex
+			{
+				return c_nodes.at(0);
+			}
+		case 16: // second order quad with nodes on edges
+			{
+				return m->CreateFace(ElementArray<Node>(m,c_nodes.data(),c_nodes.data()+4)).first->GetHandle();
+			}
+		case 17: // second order hex with nodes on edges
+			{
+				const integer nodesnum[24] = {0,4,7,3,1,2,6,5,0,1,5,4,3,7,6,2,0,3,2,1,4,5,6,7};
+				const integer sizes[6] = {4,4,4,4,4,4};
+				return m->CreateCell(c_nodes,nodesnum,sizes,6).first->GetHandle();
+			}
+		case 18: // second order prism with nodes on edges
+			{
+				const integer nodesnum[18] = {0,3,5,2,1,2,5,4,0,1,4,3,3,4,5,0,2,1};
+				const integer sizes[5] = {4,4,4,3,3};
+				return m->CreateCell(c_nodes,nodesnum,sizes,5).first->GetHandle();
+			}
+		case 19: // second order pyramid with nodes on edges
+			{
+				const integer nodesnum[16] = {0,4,3,0,1,4,1,2,4,3,4,2,0,3,2,1};
+				const integer sizes[5] = {3,3,3,3,4};
+				return m->CreateCell(c_nodes,nodesnum,sizes,5).first->GetHandle();
+			}
+		}
+		return InvalidHandle();
+	}
+
+	/// Find existing element of gmsh type by its corner nodes, returns InvalidHandle() if there is no such element.
+	static HandleType gmsh_find_element(int elemtype, ElementArray<Node> & c_nodes)
+	{
+		int corners = gmsh_type_corners[elemtype-1];
+		if( corners == 1 ) return c_nodes.at(0);
+		ElementArray<Element> adj = c_nodes[0].getAdjElements(corners == 2 ? EDGE : FACE);
+		for(ElementArray<Element>::size_type k = 0; k < adj.size(); ++k)
+		{
+			ElementArray<Node> e_nodes = adj[k].getNodes();
+			bool match = static_cast<int>(e_nodes.size()) == corners;
+			for(int q = 1; q < corners && match; ++q)
+				match = std::find(e_nodes.data(),e_nodes.data()+e_nodes.size(),c_nodes.at(q)) != e_nodes.data()+e_nodes.size();
+			if( match ) return adj[k].GetHandle();
+		}
+		return InvalidHandle();
+	}
+
+	/// Reads numbers from sections of MSH 4.1 files. In binary files int is 4 bytes, double is 8 bytes
+	/// and size_t has the data-size from the header of the file.
+	class gmsh4_input
+	{
+	public:
+		/// Read line of text as fgets does. Returns false if nothing left.
+		virtual bool getline(char * str, int size) = 0;
+		virtual void read_ints(int * v, size_t n) = 0;
+		virtual void read_sizes(long long * v, size_t n) = 0;
+		virtual void read_reals(Storage::real * v, size_t n) = 0;
+		/// Position in binary file, -1 for text files.
+		virtual long long tell() const {return -1;}
+		/// Move to the position in binary file.
+		virtual void seek(long long pos) {(void)pos; throw NotImplemented;}
+		virtual ~gmsh4_input() {}
+	};
+
+	/// Text sections are parsed sequentially.
+	class gmsh4_text_input : public gmsh4_input
+	{
+		io_tokenizer in;
+	public:
+		gmsh4_text_input(FILE * f) : in(f) {}
+		bool getline(char * str, int size) {return in.getline(str,size);}
+		void read_ints(int * v, size_t n) {for(size_t k = 0; k < n; ++k) if( !in.read_integer(v[k]) ) throw BadFile;}
+		void read_sizes(long long * v, size_t n) {for(size_t k = 0; k < n; ++k) if( !in.read_integer(v[k]) ) throw BadFile;}
+		void read_reals(Storage::real * v, size_t n) {for(size_t k = 0; k < n; ++k) if( !in.read_real(v[k]) ) throw BadFile;}
+	};
+
+	/// Binary sections are read by blocks at given position either from file or through MPI-IO,
+	/// so that data of any block of nodes or elements can be read without reading the rest of the file.
+	class gmsh4_binary_input : public gmsh4_input
+	{
+		FILE * f;
+#if defined(USE_MPI) && defined(USE_MPI_FILE)
+		MPI_File fh;
+		MPI_Comm comm;
+#endif
+		std::vector<char> block;
+		long long block_start, pos;
+		size_t block_len;
+		int size_bytes;
+		bool swap;
+		size_t read_file(long long offset, char * data, size_t size)
+		{
+#if defined(USE_MPI) && defined(USE_MPI_FILE)
+			if( fh != MPI_FILE_NULL )
+			{
+				size_t got = 0;
+				while( got < size )
+				{
+					TraceMPI trace_mpi;
+					MPI_Status stat;
+					int chunk = static_cast<int>(std::min<size_t>(size-got,1073741824)), count = 0;
+					int ierr = MPI_File_read_at(fh,static_cast<MPI_Offset>(offset+got),data+got,chunk,MPI_CHAR,&stat);
+					if( ierr != MPI_SUCCESS ) MPI_Abort(comm,__LINE__);
+					MPI_Get_count(&stat,MPI_CHAR,&count);
+					got += count;
+					if( count < chunk ) break;
+				}
+				return got;
+			}
+#endif
+			if( io_fseek(f,offset) ) return 0;
+			return fread(data,1,size,f);
+		}
+		/// Read single character, returns false at the end of file.
+		bool get(char & c)
+		{
+			if( pos < block_start || pos >= block_start + static_cast<long long>(block_len) )
+			{
+				block_start = pos;
+				block_len = read_file(pos,&block[0],block.size());
+				if( block_len == 0 ) return false;
+			}
+			c = block[pos++ - block_start];
+			return true;
+		}
+		void read(char * data, size_t size)
+		{
+			while( size )
+			{
+				if( pos < block_start || pos >= block_start + static_cast<long long>(block_len) )
+				{
+					if( size >= block.size() )
+					{
+						if( read_file(pos,data,size) != size ) throw BadFile;
+						pos += size;
+						return;
+					}
+					block_start = pos;
+					block_len = read_file(pos,&block[0],block.size());
+					if( block_len == 0 ) throw BadFile;
+				}
+				size_t k = std::min(size,static_cast<size_t>(block_start + block_len - pos));
+				memcpy(data,&block[pos - block_start],k);
+				data += k;
+				size -= k;
+				pos += k;
+			}
+		}
+		/// Read numbers of given size in bytes into data, byte order is flipped if file was written on other platform.
+		void read_numbers(char * data, size_t n, size_t bytes)
+		{
+			if( n == 0 ) return;
+			read(data,n*bytes);
+			if( swap )
+			{
+				for(size_t k = 0; k < n; ++k)
+					std::reverse(data+k*bytes,data+(k+1)*bytes);
+			}
+		}
+	public:
+		gmsh4_binary_input(FILE * f, int size_bytes)
+			: f(f), block(65536), block_start(0), pos(0), block_len(0), size_bytes(size_bytes), swap(false)
+		{
+#if defined(USE_MPI) && defined(USE_MPI_FILE)
+			fh = MPI_FILE_NULL;
+			comm = MPI_COMM_SELF;
+#endif
+		}
+#if defined(USE_MPI) && defined(USE_MPI_FILE)
+		gmsh4_binary_input(MPI_File fh, MPI_Comm comm, int size_bytes)
+			: f(NULL), fh(fh), comm(comm), block(65536), block_start(0), pos(0), block_len(0), size_bytes(size_bytes), swap(false) {}
+#endif
+		/// Check the integer one written after the header to detect the byte order of the file.
+		void read_byte_order()
+		{
+			int one;
+			read_numbers(reinterpret_cast<char *>(&one),1,sizeof(int));
+			if( one != 1 )
+			{
+				std::reverse(reinterpret_cast<char *>(&one),reinterpret_cast<char *>(&one)+sizeof(int));
+				if( one != 1 ) throw BadFile;
+				swap = true;
+			}
+		}
+		bool getline(char * str, int size)
+		{
+			int k = 0;
+			char c;
+			while( k < size - 1 && get(c) )
+			{
+				str[k++] = c;
+				if( c == '\n' ) break;
+			}
+			str[k] = '\0';
+			return k > 0;
+		}
+		void read_ints(int * v, size_t n) {read_numbers(reinterpret_cast<char *>(v),n,sizeof(int));}
+		void read_sizes(long long * v, size_t n)
+		{
+			if( size_bytes == 8 ) read_numbers(reinterpret_cast<char *>(v),n,8);
+			else if( size_bytes == 4 )
+			{
+				std::vector<uint32_t> tmp(n);
+				if( n ) read_numbers(reinterpret_cast<char *>(&tmp[0]),n,4);
+				for(size_t k = 0; k < n; ++k) v[k] = tmp[k];
+			}
+			else throw BadFile;
+		}
+		void read_reals(Storage::real * v, size_t n)
+		{
+			std::vector<double> tmp(n);
+			if( n ) read_numbers(reinterpret_cast<char *>(&tmp[0]),n,sizeof(double));
+			std::copy(tmp.begin(),tmp.end(),v);
+		}
+		long long tell() const {return pos;}
+		void seek(long long p) {pos = p;}
+	};
+
+	/// Owns the reader and the file it reads, so that both are released when parsing throws.
+	class gmsh4_input_holder
+	{
+		gmsh4_input * in;
+		gmsh4_input_holder(const gmsh4_input_holder & other);
+		gmsh4_input_holder & operator =(gmsh4_input_holder const & other);
+	public:
+		FILE * f;
+#if defined(USE_MPI) && defined(USE_MPI_FILE)
+		MPI_File fh;
+#endif
+		gmsh4_input_holder() : in(NULL), f(NULL)
+		{
+#if defined(USE_MPI) && defined(USE_MPI_FILE)
+			fh = MPI_FILE_NULL;
+#endif
+		}
+		~gmsh4_input_holder() {close();}
+		void reset(gmsh4_input * i) {delete in; in = i;}
+		/// Release the reader and close the file.
+		void close()
+		{
+			reset(NULL);
+			if( f != NULL ) fclose(f);
+			f = NULL;
+#if defined(USE_MPI) && defined(USE_MPI_FILE)
+			if( fh != MPI_FILE_NULL ) MPI_File_close(&fh);
+#endif
+		}
+		gmsh4_input * get() const {return in;}
+		gmsh4_input * operator ->() const {return in;}
+		gmsh4_input & operator *() const {return *in;}
+	};
+
+	/// Block of nodes or elements of an entity in MSH 4.1 file. Blocks of text files are kept in memory,
+	/// blocks of binary files are remembered by position and read when needed.
+	struct gmsh4_block
+	{
+		int dim, entity;
+		int type; ///< Element type for block of elements, number of parametric coordinates for block of nodes.
+		long long count; ///< Number of nodes or elements in the block.
+		long long offset; ///< Position of data in binary file, -1 if data is in memory.
+		std::vector<long long> data; ///< Node tags or element tags followed by tags of their nodes.
+		std::vector<Storage::real> coords; ///< Coordinates of nodes.
+	};
+
+	/// Get records of the block from first to last, each record has given size.
+	static void gmsh4_block_data(gmsh4_input & in, const gmsh4_block & b, int size_bytes, long long rec, long long first, long long last, std::vector<long long> & out)
+	{
+		out.resize(static_cast<size_t>((last-first)*rec));
+		if( out.empty() ) return;
+		if( b.offset == -1 )
+			std::copy(b.data.begin()+first*rec,b.data.begin()+last*rec,out.begin());
+		else
+		{
+			in.seek(b.offset + first*rec*size_bytes);
+			in.read_sizes(&out[0],out.size());
+		}
+	}
+
+	/// Get coordinates of nodes of the block from first to last.
+	static void gmsh4_node_coords(gmsh4_input & in, const gmsh4_block & b, int size_bytes, long long first, long long last, std::vector<Storage::real> & out)
+	{
+		out.resize(static_cast<size_t>((last-first)*3));
+		if( out.empty() ) return;
+		if( b.offset == -1 )
+			std::copy(b.coords.begin()+first*3,b.coords.begin()+last*3,out.begin());
+		else
+		{
+			long long stride = 3 + b.type;
+			std::vector<Storage::real> tmp(static_cast<size_t>((last-first)*stride));
+			in.seek(b.offset + b.count*size_bytes + first*stride*static_cast<long long>(sizeof(double)));
+			in.read_reals(&tmp[0],tmp.size());
+			for(long long k = 0; k < last-first; ++k)
+				std::copy(tmp.begin()+k*stride,tmp.begin()+k*stride+3,out.begin()+k*3);
+		}
+	}
+
+	/// Create nodes with given tags and coordinates, or take matching nodes that were in the mesh.
+	static void gmsh4_create_nodes(Mesh * m, const std::vector<long long> & tags, const std::vector<Storage::real> & xyz, const Mesh::NodeMatcher & matcher, const std::vector<HandleType> & old_nodes, std::vector< std::pair<long long,HandleType> > & nodes)
+	{
+		for(size_t k = 0; k < tags.size(); ++k)
+		{
+			int find = matcher.Find(&xyz[k*3]);
+			if( find == -1 ) nodes.push_back(std::make_pair(tags[k],m->CreateNode(&xyz[k*3])->GetHandle()));
+			else nodes.push_back(std::make_pair(tags[k],old_nodes[find]));
+		}
+	}
+
+#if defined(USE_MPI)
+	/// Processor that collects the node with given tag during partitioned load.
+	static int gmsh4_owner(long long tag, int size)
+	{
+		return static_cast<int>((tag < 0 ? -tag : tag) % size);
+	}
+
+	/// Send vector of data to each processor, received data is concatenated in the order of processors
+	/// and the number of entries from each processor is returned in count.
+	template<typename T>
+	static void gmsh4_alltoall(INMOST_MPI_Comm comm, MPI_Datatype type, const std::vector< std::vector<T> > & send, std::vector<T> & recv, std::vector<int> & count)
+	{
+		TraceMPI trace_mpi;
+		int size = static_cast<int>(send.size());
+		std::vector<int> scount(size), sdispl(size+1,0), rdispl(size+1,0);
+		count.resize(size);
+		for(int p = 0; p < size; ++p)
+		{
+			scount[p] = static_cast<int>(send[p].size());
+			sdispl[p+1] = sdispl[p] + scount[p];
+		}
+		MPI_Alltoall(&scount[0],1,MPI_INT,&count[0],1,MPI_INT,comm);
+		for(int p = 0; p < size; ++p) rdispl[p+1] = rdispl[p] + count[p];
+		std::vector<T> sbuf(sdispl[size]+1);
+		for(int p = 0; p < size; ++p) std::copy(send[p].begin(),send[p].end(),sbuf.begin()+sdispl[p]);
+		recv.resize(rdispl[size]+1);
+		MPI_Alltoallv(&sbuf[0],&scount[0],&sdispl[0],type,&recv[0],&count[0],&rdispl[0],type,comm);
+		recv.pop_back();
+	}
+
+	/// Split reading of nodes and of elements of lower dimensions between processors for partitioned load.
+	/// Each processor reads a contiguous range of node records and sends them to the processor gmsh4_owner
+	/// of their tags, that answers the requests for the nodes needed by the elements of the highest dimension.
+	/// Elements of lower dimensions are read by ranges as well and forwarded through the processor of their
+	/// first node to all processors that requested that node, their records are appended to records.
+	static void gmsh4_distribute(INMOST_MPI_Comm comm, int rank, int size, gmsh4_input & in, int size_bytes,
+								 const std::vector<gmsh4_block> & node_blocks, const std::vector<gmsh4_block> & elem_blocks, int topdim,
+								 const std::vector<long long> & needed, std::vector< std::vector<long long> > & records,
+								 std::vector<long long> & node_tags, std::vector<Storage::real> & node_xyz)
+	{
+		std::vector< std::vector<long long> > send_tags(size);
+		std::vector< std::vector<Storage::real> > send_xyz(size);
+		std::vector<long long> tags, dir_tags, asked;
+		std::vector<Storage::real> xyz, dir_xyz;
+		std::vector<int> count;
+		long long total = 0, first = 0, lo, hi;
+		//nodes of the range of this processor go to the processors of their tags
+		for(size_t q = 0; q < node_blocks.size(); ++q) total += node_blocks[q].count;
+		lo = total*rank/size;
+		hi = total*(rank+1)/size;
+		for(size_t q = 0; q < node_blocks.size(); ++q)
+		{
+			const gmsh4_block & b = node_blocks[q];
+			long long a = std::max(lo-first,0LL), z = std::min(hi-first,b.count);
+			first += b.count;
+			if( a >= z ) continue;
+			gmsh4_block_data(in,b,size_bytes,1,a,z,tags);
+			gmsh4_node_coords(in,b,size_bytes,a,z,xyz);
+			for(long long k = 0; k < z-a; ++k)
+			{
+				int p = gmsh4_owner(tags[k],size);
+				send_tags[p].push_back(tags[k]);
+				send_xyz[p].insert(send_xyz[p].end(),xyz.begin()+k*3,xyz.begin()+(k+1)*3);
+			}
+		}
+		gmsh4_alltoall(comm,MPI_LONG_LONG,send_tags,dir_tags,count);
+		gmsh4_alltoall(comm,INMOST_MPI_DATA_REAL_TYPE,send_xyz,dir_xyz,count);
+		std::vector< std::pair<long long,size_t> > dir(dir_tags.size());
+		for(size_t k = 0; k < dir.size(); ++k) dir[k] = std::make_pair(dir_tags[k],k);
+		std::sort(dir.begin(),dir.end());
+		//answer the requests for the needed nodes and remember who requested them
+		for(int p = 0; p < size; ++p) send_tags[p].clear();
+		for(size_t k = 0; k < needed.size(); ++k) send_tags[gmsh4_owner(needed[k],size)].push_back(needed[k]);
+		gmsh4_alltoall(comm,MPI_LONG_LONG,send_tags,asked,count);
+		std::vector< std::pair<long long,int> > requested;
+		for(int p = 0; p < size; ++p) send_tags[p].clear(), send_xyz[p].clear();
+		for(int p = 0, k = 0; p < size; ++p)
+		{
+			for(int j = 0; j < count[p]; ++j, ++k)
+			{
+				std::vector< std::pair<long long,size_t> >::iterator it = std::lower_bound(dir.begin(),dir.end(),std::make_pair(asked[k],static_cast<size_t>(0)));
+				if( it == dir.end() || it->first != asked[k] ) continue;
+				send_tags[p].push_back(asked[k]);
+				send_xyz[p].insert(send_xyz[p].end(),dir_xyz.begin()+it->second*3,dir_xyz.begin()+(it->second+1)*3);
+				requested.push_back(std::make_pair(asked[k],p));
+			}
+		}
+		std::sort(requested.begin(),requested.end());
+		gmsh4_alltoall(comm,MPI_LONG_LONG,send_tags,node_tags,count);
+		gmsh4_alltoall(comm,INMOST_MPI_DATA_REAL_TYPE,send_xyz,node_xyz,count);
+		//elements of lower dimensions of the range of this processor go through the processors of their first nodes,
+		//each record is preceded by the number of the block
+		total = first = 0;
+		for(size_t q = 0; q < elem_blocks.size(); ++q) if( elem_blocks[q].dim != topdim ) total += elem_blocks[q].count;
+		lo = total*rank/size;
+		hi = total*(rank+1)/size;
+		for(int p = 0; p < size; ++p) send_tags[p].clear();
+		for(size_t q = 0; q < elem_blocks.size(); ++q) if( elem_blocks[q].dim != topdim )
+		{
+			const gmsh4_block & b = elem_blocks[q];
+			long long rec = 1 + gmsh_type_nodes[b.type-1];
+			long long a = std::max(lo-first,0LL), z = std::min(hi-first,b.count);
+			first += b.count;
+			if( a >= z ) continue;
+			gmsh4_block_data(in,b,size_bytes,rec,a,z,tags);
+			for(long long k = 0; k < z-a; ++k)
+			{
+				std::vector<long long> & out = send_tags[gmsh4_owner(tags[k*rec+1],size)];
+				out.push_back(static_cast<long long>(q));
+				out.insert(out.end(),tags.begin()+k*rec,tags.begin()+(k+1)*rec);
+			}
+		}
+		gmsh4_alltoall(comm,MPI_LONG_LONG,send_tags,asked,count);
+		for(int p = 0; p < size; ++p) send_tags[p].clear();
+		for(size_t k = 0; k < asked.size(); k += 2 + gmsh_type_nodes[elem_blocks[asked[k]].type-1])
+		{
+			size_t len = 2 + gmsh_type_nodes[elem_blocks[asked[k]].type-1];
+			std::vector< std::pair<long long,int> >::iterator it = std::lower_bound(requested.begin(),requested.end(),std::make_pair(asked[k+2],0));
+			for(; it != requested.end() && it->first == asked[k+2]; ++it)
+				send_tags[it->second].insert(send_tags[it->second].end(),asked.begin()+k,asked.begin()+k+len);
+		}
+		gmsh4_alltoall(comm,MPI_LONG_LONG,send_tags,tags,count);
+		for(size_t k = 0; k < tags.size(); k += 2 + gmsh_type_nodes[elem_blocks[tags[k]].type-1])
+		{
+			std::vector<long long> & out = records[tags[k]];
+			out.insert(out.end(),tags.begin()+k+1,tags.begin()+k+2+gmsh_type_nodes[elem_blocks[tags[k]].type-1]);
+		}
+	}
+#endif
+
+	/// Load MSH 4.1 file in text or binary format, header of the file was already checked by Mesh::LoadMSH.
+	/// When partition is set, all processors of the communicator read the file together. Elements of the highest
+	/// dimension are split into contiguous ranges of equal size, each processor reads only its range of records.
+	/// Nodes and elements of lower dimensions are read by ranges and exchanged with gmsh4_distribute, elements of
+	/// lower dimensions are only tagged if they are present on the processor. Text files are still parsed
+	/// entirely by each processor, since positions of the blocks are not known without parsing.
+	static void gmsh4_load(Mesh * m, std::string File, bool binary, int size_bytes, int verbosity, bool partition, const Mesh::NodeMatcher & matcher, const std::vector<HandleType> & old_nodes)
+	{
+		int rank = partition ? m->GetProcessorRank() : 0, size = partition ? m->GetProcessorsNumber() : 1;
+		gmsh4_input_holder in;
+#if defined(USE_MPI) && defined(USE_MPI_FILE)
+		if( binary && size > 1 )
+		{
+			int ierr = MPI_File_open(m->GetCommunicator(),const_cast<char *>(File.c_str()),MPI_MODE_RDONLY,MPI_INFO_NULL,&in.fh);
+			if( ierr != MPI_SUCCESS )
+			{
+				std::cout << __FILE__ << ":" << __LINE__ << " cannot open " << File << std::endl;
+				throw BadFileName;
+			}
+			in.reset(new gmsh4_binary_input(in.fh,m->GetCommunicator(),size_bytes));
+		}
+		else
+#endif
+		{
+			in.f = fopen(File.c_str(),binary ? "rb" : "r");
+			if( in.f == NULL )
+			{
+				std::cout << __FILE__ << ":" << __LINE__ << " cannot open " << File << std::endl;
+				throw BadFileName;
+			}
+			if( binary ) in.reset(new gmsh4_binary_input(in.f,size_bytes));
+			else in.reset(new gmsh4_text_input(in.f));
+		}
+		if( binary && size_bytes != 4 && size_bytes != 8 )
+		{
+			std::cout << __FILE__ << ":" << __LINE__ << " unsupported data size " << size_bytes << " in " << File << std::endl;
+			throw BadFile;
+		}
+		char readline[2048];
+		std::vector<gmsh4_block> node_blocks, elem_blocks;
+		std::vector< std::map<int,int> > physical(4); //first physical tag of entities of each dimension
+		while( in->getline(readline,2048) )
+		{
+			char * p = readline, * pend = readline + strlen(readline);
+			while( p < pend && isspace(*p) ) ++p;
+			while( pend > p && isspace(*(pend-1)) ) --pend;
+			*pend = '\0';
+			if( p == pend ) continue;
+			if( !strcmp(p,"$MeshFormat") )
+			{
+				in->getline(readline,2048);
+				if( binary ) static_cast<gmsh4_binary_input *>(in.get())->read_byte_order();
+			}
+			else if( !strcmp(p,"$Entities") )
+			{
+				long long num[4];
+				std::vector<int> tags;
+				in->read_sizes(num,4);
+				for(int d = 0; d < 4; ++d)
+				{
+					for(long long k = 0; k < num[d]; ++k)
+					{
+						int entity;
+						long long ntags;
+						Storage::real bbox[6];
+						in->read_ints(&entity,1);
+						in->read_reals(bbox,d ? 6 : 3);
+						in->read_sizes(&ntags,1);
+						tags.resize(static_cast<size_t>(ntags));
+						if( ntags )
+						{
+							in->read_ints(&tags[0],tags.size());
+							physical[d][entity] = tags[0];
+						}
+						if( d )
+						{
+							in->read_sizes(&ntags,1);
+							tags.resize(static_cast<size_t>(ntags));
+							if( ntags ) in->read_ints(&tags[0],tags.size());
+						}
+					}
+				}
+			}
+			else if( !strcmp(p,"$Nodes") )
+			{
+				long long hdr[4];
+				in->read_sizes(hdr,4);
+				if( verbosity > 0 && rank == 0 ) printf("Reading %lld nodes.\n",hdr[1]);
+				node_blocks.resize(static_cast<size_t>(hdr[0]));
+				for(size_t q = 0; q < node_blocks.size(); ++q)
+				{
+					gmsh4_block & b = node_blocks[q];
+					int ent[3];
+					in->read_ints(ent,3);
+					in->read_sizes(&b.count,1);
+					b.dim = ent[0];
+					b.entity = ent[1];
+					b.type = ent[2] ? ent[0] : 0;
+					b.offset = in->tell();
+					if( binary ) in->seek(b.offset + b.count*(size_bytes + (3 + b.type)*static_cast<long long>(sizeof(double))));
+					else
+					{
+						Storage::real uvw[3];
+						b.data.resize(static_cast<size_t>(b.count));
+						b.coords.resize(static_cast<size_t>(b.count*3));
+						if( b.count ) in->read_sizes(&b.data[0],b.data.size());
+						for(long long k = 0; k < b.count; ++k)
+						{
+							in->read_reals(&b.coords[k*3],3);
+							in->read_reals(uvw,b.type);
+						}
+					}
+				}
+			}
+			else if( !strcmp(p,"$Elements") )
+			{
+				long long hdr[4];
+				in->read_sizes(hdr,4);
+				if( verbosity > 0 && rank == 0 ) printf("Reading %lld elements.\n",hdr[1]);
+				elem_blocks.resize(static_cast<size_t>(hdr[0]));
+				for(size_t q = 0; q < elem_blocks.size(); ++q)
+				{
+					gmsh4_block & b = elem_blocks[q];
+					int ent[3];
+					in->read_ints(ent,3);
+					in->read_sizes(&b.count,1);
+					b.dim = ent[0];
+					b.entity = ent[1];
+					b.type = ent[2];
+					if( b.type < 1 || b.type > 19 )
+					{
+						std::cout << __FILE__ << ":" << __LINE__ << " bad element type " << b.type << " expected in [1,19] range in " << File << std::endl;
+						throw BadFile;
+					}
+					long long rec = 1 + gmsh_type_nodes[b.type-1];
+					b.offset = in->tell();
+					if( binary ) in->seek(b.offset + b.count*rec*size_bytes);
+					else
+					{
+						b.data.resize(static_cast<size_t>(b.count*rec));
+						if( b.count ) in->read_sizes(&b.data[0],b.data.size());
+					}
+				}
+			}
+			else if( !strncmp(p,"$End",4) ) continue;
+			else if( p[0] == '$' )
+			{
+				if( verbosity > 0 && rank == 0 ) std::cout << __FILE__ << ":" << __LINE__ << " skipping unknown keyword " << p+1 << " in " << File << std::endl;
+				std::string skip_keyword = std::string("$End") + (p+1);
+				while( in->getline(readline,2048) && strncmp(readline,skip_keyword.c_str(),skip_keyword.size()) );
+			}
+			else
+			{
+				std::cout << __FILE__ << ":" << __LINE__ << " unexpected line " << p << " in " << File << std::endl;
+				throw BadFile;
+			}
+		}
+		//split elements of the highest dimension between processors
+		int topdim = -1;
+		long long total = 0, first = 0, lo, hi;
+		for(size_t q = 0; q < elem_blocks.size(); ++q) topdim = std::max(topdim,elem_blocks[q].dim);
+		for(size_t q = 0; q < elem_blocks.size(); ++q) if( elem_blocks[q].dim == topdim ) total += elem_blocks[q].count;
+		lo = total*rank/size;
+		hi = total*(rank+1)/size;
+		std::vector< std::vector<long long> > records(elem_blocks.size());
+		std::vector<long long> needed, tags;
+		for(size_t q = 0; q < elem_blocks.size(); ++q)
+		{
+			const gmsh4_block & b = elem_blocks[q];
+			long long rec = 1 + gmsh_type_nodes[b.type-1];
+			if( b.dim == topdim )
+			{
+				long long a = std::max(lo-first,0LL), z = std::min(hi-first,b.count);
+				if( a < z ) gmsh4_block_data(*in,b,size_bytes,rec,a,z,records[q]);
+				first += b.count;
+				if( size > 1 )
+				{
+					for(size_t k = 0; k < records[q].size(); ++k)
+						if( k % rec ) needed.push_back(records[q][k]);
+				}
+			}
+			else if( size == 1 ) gmsh4_block_data(*in,b,size_bytes,rec,0,b.count,records[q]);
+		}
+		std::sort(needed.begin(),needed.end());
+		needed.resize(std::unique(needed.begin(),needed.end())-needed.begin());
+		//create nodes used by elements of this processor, or all nodes in serial
+		std::vector< std::pair<long long,HandleType> > nodes;
+		std::vector<Storage::real> xyz;
+		if( size == 1 )
+		{
+			for(size_t q = 0; q < node_blocks.size(); ++q)
+			{
+				const gmsh4_block & b = node_blocks[q];
+				gmsh4_block_data(*in,b,size_bytes,1,0,b.count,tags);
+				gmsh4_node_coords(*in,b,size_bytes,0,b.count,xyz);
+				gmsh4_create_nodes(m,tags,xyz,matcher,old_nodes,nodes);
+			}
+		}
+#if defined(USE_MPI)
+		else
+		{
+			gmsh4_distribute(m->GetCommunicator(),rank,size,*in,size_bytes,node_blocks,elem_blocks,topdim,needed,records,tags,xyz);
+			gmsh4_create_nodes(m,tags,xyz,matcher,old_nodes,nodes);
+		}
+#endif
+		std::sort(nodes.begin(),nodes.end());
+		in.close();
+		//create elements of the highest dimension first, so that in parallel the rest are only searched among them
+		Tag gmsh_tags = m->CreateTag("GMSH_TAGS",DATA_INTEGER,CELL|FACE|EDGE|NODE,FACE|EDGE|NODE);
+		ElementArray<Node> c_nodes(m);
+		for(int pass = 0; pass < 2; ++pass)
+		{
+			for(size_t q = 0; q < elem_blocks.size(); ++q) if( (elem_blocks[q].dim == topdim) == (pass == 0) )
+			{
+				const gmsh4_block & b = elem_blocks[q];
+				long long rec = 1 + gmsh_type_nodes[b.type-1];
+				std::map<int,int>::const_iterator phys = physical[b.dim].find(b.entity);
+				for(size_t k = 0; k < records[q].size(); k += rec)
+				{
+					bool found = true;
+					c_nodes.clear();
+					for(long long j = 1; j < rec && found; ++j)
+					{
+						std::vector< std::pair<long long,HandleType> >::iterator it = std::lower_bound(nodes.begin(),nodes.end(),std::make_pair(records[q][k+j],InvalidHandle()));
+						found = it != nodes.end() && it->first == records[q][k+j];
+						if( found ) c_nodes.push_back(it->second);
+					}
+					if( !found )
+					{
+						if( size > 1 ) continue;
+						std::cout << __FILE__ << ":" << __LINE__ << " element " << records[q][k] << " refers to missing node in " << File << std::endl;
+						throw BadFile;
+					}
+					HandleType h;
+					if( size > 1 && pass == 1 ) h = gmsh_find_element(b.type,c_nodes);
+					else h = gmsh_create_element(m,b.type,c_nodes);
+					if( h == InvalidHandle() ) continue;
+					Storage::integer_array ptags = m->IntegerArray(h,gmsh_tags);
+					ptags.resize(2);
+					ptags[0] = phys == physical[b.dim].end() ? 0 : phys->second;
+					ptags[1] = b.entity;
+				}
+			}
+		}
+		if( size > 1 ) m->ResolveShared();
+	}
+
   void Mesh::LoadMSH(std::string File)
   {
     int verbosity = 0;
+		bool partition = false;
 		for(INMOST_DATA_ENUM_TYPE k = 0; k < file_options.size(); ++k)
 		{
+			if( file_options[k].first == "GMSH_PARTITION" )
+				partition = file_options[k].second == "TRUE";
 			if( file_options[k].first == "VERBOSITY" )
 			{
 				verbosity = atoi(file_options[k].second.c_str());
@@ -65,17 +839,21 @@ namespace INMOST
 			std::cout << __FILE__ << ":" << __LINE__ << " cannot open " << File << std::endl;
 			throw BadFileName;
 		}
+		io_tokenizer in(f);
 		std::vector<HandleType> old_nodes(NumberOfNodes());
+		NodeMatcher matcher(this);
 		{
 			unsigned qq = 0;
 			for(Mesh::iteratorNode it = BeginNode(); it != EndNode(); ++it)
 				old_nodes[qq++] = *it;
 		}
 		if( !old_nodes.empty() ) 
-			std::sort(old_nodes.begin(),old_nodes.end(),CentroidComparator(this));
+			matcher.Build(old_nodes);
+		//all processors read the file only in MSH 4.1 format, otherwise it is loaded on the first processor
+		partition = partition && GetMeshState() == Mesh::Parallel && GetProcessorsNumber() > 1;
 		int line = 0;
 		unsigned report_pace;
-		while( fgets(readline,2048,f) != NULL )
+		while( in.getline(readline,2048) )
 		{
 			line++;
 			if( readline[strlen(readline)-1] == '\n' ) readline[strlen(readline)-1] = '\0';
@@ -91,6 +869,11 @@ namespace INMOST
 			case GMSH_NONE:
 				if(!strcmp(p,"$NOD"))
 				{
+					if( partition && GetProcessorRank() != 0 )
+					{
+						fclose(f);
+						return;
+					}
 					ver = GMSH_VER1;
 					state = GMSH_NODES_TOT;
 					elemtags.resize(2);
@@ -156,7 +939,7 @@ namespace INMOST
 				}
 				break;
 			case GMSH_NODES_TOT:
-				if( 1 == sscanf(p,"%d%n",&nnodes,&nchars) )
+				if( io_scan_integer(p,nnodes,nchars) )
 				{
 					p += nchars;
 					while(isspace(*p) && p < pend) ++p;
@@ -173,7 +956,7 @@ namespace INMOST
 				if( p >= pend ) break;
 			case GMSH_NODES_NUM:
 read_node_num_link:
-				if( 1 == sscanf(p,"%d%n",&nodenum,&nchars) )
+				if( io_scan_integer(p,nodenum,nchars) )
 				{
 					--nodenum;
 					if( nodenum >= static_cast<int>(newnodes.size()) ) std::cout << __FILE__ << ":" << __LINE__ << " node number is bigger then total number of nodes " << nodenum << " / " << newnodes.size() << " line " << line <<std::endl;
@@ -203,7 +986,7 @@ read_node_num_link:
 				}
 				if( p >= pend ) break;
 			case GMSH_NODES_X:
-				if( 1 == sscanf(p,"%lf%n",xyz,&nchars) )
+				if( io_scan_real(p,xyz[0],nchars) )
 				{
 					p += nchars;
 					while(isspace(*p) && p < pend) ++p;
@@ -216,7 +999,7 @@ read_node_num_link:
 				}
 				if( p >= pend ) break;
 			case GMSH_NODES_Y:
-				if( 1 == sscanf(p,"%lf%n",xyz+1,&nchars) )
+				if( io_scan_real(p,xyz[1],nchars) )
 				{
 					p += nchars;
 					while(isspace(*p) && p < pend) ++p;
@@ -229,21 +1012,11 @@ read_node_num_link:
 				}
 				if( p >= pend ) break;
 			case GMSH_NODES_Z:
-				if( 1 == sscanf(p,"%lf%n",xyz+2,&nchars) )
+				if( io_scan_real(p,xyz[2],nchars) )
 				{
 					p += nchars;
 					while(isspace(*p) && p < pend) ++p;
-					int find = -1;
-					if( !old_nodes.empty() )
-					{
-						std::vector<HandleType>::iterator it = std::lower_bound(old_nodes.begin(),old_nodes.end(),xyz,CentroidComparator(this));
-						if( it != old_nodes.end() ) 
-						{
-							Storage::real_array c = RealArrayDF(*it,CoordsTag());
-							if( CentroidComparator(this).Compare(xyz,c.data()) == 0 )
-								find = static_cast<int>(it - old_nodes.begin());
-						}
-					}
+					int find = matcher.Find(xyz);
 					if( find == -1 ) newnodes[nodenum] = CreateNode(xyz)->GetHandle();
 					else newnodes[nodenum] = old_nodes[find];
 					nnodes--;
@@ -261,7 +1034,7 @@ read_node_num_link:
 				}
 				if( p < pend ) goto read_node_num_link; else break;
 			case GMSH_ELEMENTS_TOT:
-				if( 1 == sscanf(p,"%d%n",&ncells,&nchars) )
+				if( io_scan_integer(p,ncells,nchars) )
 				{
 					p += nchars;
 					while(isspace(*p) && p < pend) ++p;
@@ -278,7 +1051,7 @@ read_node_num_link:
 				if( p >= pend ) break;
 			case GMSH_ELEMENTS_NUM:
 read_elem_num_link:
-				if( 1 == sscanf(p,"%d%n",&elemnum,&nchars) )
+				if( io_scan_integer(p,elemnum,nchars) )
 				{
 					--elemnum;
 					//std::cout << __FILE__ << ":" << __LINE__ << " element number: " << elemnum << " line " << line << std::endl;
@@ -309,13 +1082,8 @@ read_elem_num_link:
 				}
 				if( p >= pend ) break;
 			case GMSH_ELEMENTS_TYPE:
-				if( 1 == sscanf(p,"%d%n",&elemtype,&nchars) )
+				if( io_scan_integer(p,elemtype,nchars) )
 				{
-					const int type_nodes[19] =
-					{
-						2,3,4,4,8,6,5,3,6,9,10,
-						27,18,14,1,8,20,15,13
-					};
 					//std::cout << __FILE__ << ":" << __LINE__ << " element type: " << elemtype << " line " << line << std::endl;
 					if( elemtype < 1 || elemtype > 19 )
 					{
@@ -330,7 +1098,7 @@ read_elem_num_link:
 					else if( ver == GMSH_VER2 )
 						state = GMSH_ELEMENTS_NUMTAGS;
 
-					elemnodes = type_nodes[elemtype-1];
+					elemnodes = gmsh_type_nodes[elemtype-1];
 					nodelist.resize(elemnodes);
 				}
 				else
@@ -342,7 +1110,7 @@ read_elem_num_link:
 			case GMSH_ELEMENTS_REGPHYS:
 				if( state == GMSH_ELEMENTS_REGPHYS )
 				{
-					if( 1 == sscanf(p,"%d%n",&elemtags[0],&nchars) )
+					if( io_scan_integer(p,elemtags[0],nchars) )
 					{
 						//std::cout << __FILE__ << ":" << __LINE__ << " i should not be here " << std::endl;
 						p += nchars;
@@ -359,7 +1127,7 @@ read_elem_num_link:
 			case GMSH_ELEMENTS_REGELEM:
 				if( state == GMSH_ELEMENTS_REGELEM )
 				{
-					if( 1 == sscanf(p,"%d%n",&elemtags[1],&nchars) )
+					if( io_scan_integer(p,elemtags[1],nchars) )
 					{
 						//std::cout << __FILE__ << ":" << __LINE__ << " i should not be here " << std::endl;
 						p += nchars;
@@ -376,7 +1144,7 @@ read_elem_num_link:
 			case GMSH_ELEMENTS_NUMNODES:
 				if( state == GMSH_ELEMENTS_NUMNODES )
 				{
-					if( 1 == sscanf(p,"%d%n",&temp,&nchars) )
+					if( io_scan_integer(p,temp,nchars) )
 					{
 						//std::cout << __FILE__ << ":" << __LINE__ << " i should not be here " << std::endl;
 						if( temp != elemnodes )
@@ -398,7 +1166,7 @@ read_elem_num_link:
 			case GMSH_ELEMENTS_NUMTAGS:
 				if( state == GMSH_ELEMENTS_NUMTAGS )
 				{
-					if( 1 == sscanf(p,"%d%n",&numtags,&nchars) )
+					if( io_scan_integer(p,numtags,nchars) )
 					{
 						//std::cout << __FILE__ << ":" << __LINE__ << " numtags: " << numtags << " line " << line << std::endl;
 						elemtags.resize(numtags);
@@ -418,7 +1186,7 @@ read_elem_num_link:
 				{
 					while( numtags > 0 && p < pend )
 					{
-						if( 1 == sscanf(p,"%d%n",&elemtags[elemtags.size()-numtags],&nchars) )
+						if( io_scan_integer(p,elemtags[elemtags.size()-numtags],nchars) )
 						{
 							//std::cout << __FILE__ << ":" << __LINE__ << " tag[" << elemtags.size()-numtags << "] = " << elemtags[elemtags.size()-numtags] << " line " << line << std::endl;
 							p += nchars;
@@ -436,7 +1204,7 @@ read_elem_num_link:
 			case GMSH_ELEMENTS_NODELIST:
 				while( elemnodes > 0 && p < pend )
 				{
-					if( 1 == sscanf(p,"%d%n",&nodelist[nodelist.size()-elemnodes],&nchars) )
+					if( io_scan_integer(p,nodelist[nodelist.size()-elemnodes],nchars) )
 					{
 						--nodelist[nodelist.size()-elemnodes];
 						if( nodelist[nodelist.size()-elemnodes] < 0 || nodelist[nodelist.size()-elemnodes] >= static_cast<int>(newnodes.size()) )
@@ -457,117 +1225,7 @@ read_elem_num_link:
 								c_nodes.push_back(newnodes[nodelist[k]]);
 
 							//Create new element
-							switch(elemtype)
-							{
-							case 1: newelems[elemnum] = CreateEdge(c_nodes).first->GetHandle(); break; //edge
-							case 2: newelems[elemnum] = CreateFace(c_nodes).first->GetHandle(); break; //triangle
-							case 3: newelems[elemnum] = CreateFace(c_nodes).first->GetHandle(); break; //quad
-							case 4: //tetra
-								{
-									const integer nodesnum[12] = {0,2,1,0,1,3,1,2,3,0,3,2};
-									const integer sizes[4] = {3,3,3,3};
-									newelems[elemnum] = CreateCell(c_nodes,nodesnum,sizes,4).first->GetHandle();
-								}
-								break;
-							case 5: //hex
-								{
-									//const integer nodesnum[24] = {0,4,7,3,1,2,6,5,0,1,5,4,3,7,6,2,0,3,2,1,4,5,6,7};
-									const integer nodesnum[24] = {0,3,2,1,4,5,6,7,0,4,7,3,1,2,6,5,0,1,5,4,2,3,7,6};
-									const integer sizes[6] = {4,4,4,4,4,4};
-									newelems[elemnum] = CreateCell(c_nodes,nodesnum,sizes,6).first->GetHandle();
-								}
-								break;
-							case 6: //prism
-								{
-									//const integer nodesnum[18] = {0,2,5,3,1,4,5,2,0,3,4,1,3,5,4,0,1,2};
-									const integer nodesnum[18] = {0,3,5,2,1,2,5,4,0,1,4,3,3,4,5,0,2,1};
-									const integer sizes[5] = {4,4,4,3,3};
-									newelems[elemnum] = CreateCell(c_nodes,nodesnum,sizes,5).first->GetHandle();
-								}
-								break;
-							case 7: //pyramid
-								{
-									const integer nodesnum[16] = {0,4,3,0,1,4,1,2,4,3,4,2,0,3,2,1};
-									const integer sizes[5] = {3,3,3,3,4};
-									newelems[elemnum] = CreateCell(c_nodes,nodesnum,sizes,5).first->GetHandle();
-								}
-								break;
-							case 8: //second order edge
-								{
-									//treat as just an edge
-									newelems[elemnum] = CreateEdge(ElementArray<Node>(this,c_nodes.data(),c_nodes.data()+2)).first->GetHandle();
-								}
-								break;
-							case 9: //second order tri with nodes on edges
-								{
-									newelems[elemnum] = CreateFace(ElementArray<Node>(this,c_nodes.data(),c_nodes.data()+3)).first->GetHandle();
-								}
-								break;
-							case 10: //second order quad with nodes on edges and in center
-								{
-									newelems[elemnum] = CreateFace(ElementArray<Node>(this,c_nodes.data(),c_nodes.data()+4)).first->GetHandle();
-								}
-								break;
-							case 11: // second order tet with nodes on edges
-								{
-									const integer nodesnum[12] = {0,2,1,0,1,3,1,2,3,0,3,2};
-									const integer sizes[4] = {3,3,3,3};
-									newelems[elemnum] = CreateCell(c_nodes,nodesnum,sizes,4).first->GetHandle();
-								}
-								break;
-							case 12: // second order hex with nodes in centers of edges and faces and in center of volume
-								{
-									const integer nodesnum[24] = {0,4,7,3,1,2,6,5,0,1,5,4,3,7,6,2,0,3,2,1,4,5,6,7};
-									const integer sizes[6] = {4,4,4,4,4,4};
-									newelems[elemnum] = CreateCell(c_nodes,nodesnum,sizes,6).first->GetHandle();
-								}
-								break;
-							case 13: // second order prism  with nodes in centers of edges and quad faces
-								{
-									const integer nodesnum[18] = {0,3,5,2,1,2,5,4,0,1,4,3,3,4,5,0,2,1};
-									const integer sizes[5] = {4,4,4,3,3};
-									newelems[elemnum] = CreateCell(c_nodes,nodesnum,sizes,5).first->GetHandle();
-								}
-								break;
-							case 14: // second order pyramid with nodes in centers of edges and quad faces
-								{
-									const integer nodesnum[16] = {0,4,3,0,1,4,1,2,4,3,4,2,0,3,2,1};
-									const integer sizes[5] = {3,3,3,3,4};
-									newelems[elemnum] = CreateCell(c_nodes,nodesnum,sizes,5).first->GetHandle();
-								}
-								break;
-							case 15: // vertex
-								{
-									newelems[elemnum] = c_nodes.at(0);
-								}
-								break;
-							case 16: // second order quad with nodes on edges
-								{
-									newelems[elemnum] = CreateFace(ElementArray<Node>(this,c_nodes.data(),c_nodes.data()+4)).first->GetHandle();
-								}
-								break;
-							case 17: // second order hex with nodes on edges
-								{
-									const integer nodesnum[24] = {0,4,7,3,1,2,6,5,0,1,5,4,3,7,6,2,0,3,2,1,4,5,6,7};
-									const integer sizes[6] = {4,4,4,4,4,4};
-									newelems[elemnum] = CreateCell(c_nodes,nodesnum,sizes,6).first->GetHandle();
-								}
-								break;
-							case 18: // second order prism with nodes on edges
-								{
-									const integer nodesnum[18] = {0,3,5,2,1,2,5,4,0,1,4,3,3,4,5,0,2,1};
-									const integer sizes[5] = {4,4,4,3,3};
-									newelems[elemnum] = CreateCell(c_nodes,nodesnum,sizes,5).first->GetHandle();
-								}
-								break;
-							case 19: // second order pyramid with nodes on edges
-								{
-									const integer nodesnum[16] = {0,4,3,0,1,4,1,2,4,3,4,2,0,3,2,1};
-									const integer sizes[5] = {3,3,3,3,4};
-									newelems[elemnum] = CreateCell(c_nodes,nodesnum,sizes,5).first->GetHandle();
-								}
-								break;
-							}
+							newelems[elemnum] = gmsh_create_element(this,elemtype,c_nodes);
 
 							Storage::integer_array ptags = IntegerArray(newelems[elemnum],gmsh_tags);
 
@@ -602,14 +1260,25 @@ read_elem_num_link:
 			case GMSH_FORMAT:
 				if( 4 == sscanf(p, "%1d.%1d %d %d\n",&verlow,&verhigh,&ascii,&float_size) )
 				{
+					if( verlow == 4 && verhigh == 1 )
+					{
+						fclose(f);
+						gmsh4_load(this,File,ascii != 0,float_size,verbosity,partition,matcher,old_nodes);
+						return;
+					}
+					if( partition && GetProcessorRank() != 0 )
+					{
+						fclose(f);
+						return;
+					}
 					if( !(verlow == 2 && verhigh == 0) && verbosity > 0)
 					{
-						std::cout << __FILE__ << ":" << __LINE__ << " version of file " << File << " is " << verlow << "." << verhigh << " expected 2.0 ";
+						std::cout << __FILE__ << ":" << __LINE__ << " version of file " << File << " is " << verlow << "." << verhigh << " expected 2.0 or 4.1 ";
 						std::cout << " in " << File << " line " << line << std::endl;
 					}
 					if( ascii != 0 )
 					{
-						std::cout << __FILE__ << ":" << __LINE__ << " file " << File << " is binary, gmsh binary is not currently supported " << " line " << line <<std::endl;
+						std::cout << __FILE__ << ":" << __LINE__ << " file " << File << " is binary, gmsh binary is supported only for version 4.1 " << " line " << line <<std::endl;
 						throw BadFile;
 					}
 				}
@@ -31,13 +31,14 @@ namespace INMOST
 		porosity = CreateTag("PORO",DATA_REAL,CELL|FACE,FACE,1);
 		permiability = CreateTag("PERM",DATA_REAL,CELL|FACE,FACE,9);
 		std::vector<HandleType> old_nodes(NumberOfNodes());
+		NodeMatcher matcher(this);
 		{
 			unsigned qq = 0;
 			for(Mesh::iteratorNode it = BeginNode(); it != EndNode(); ++it)
 				old_nodes[qq++] = *it;
 		}
 		if( !old_nodes.empty() ) 
-			std::sort(old_nodes.begin(),old_nodes.end(),CentroidComparator(this));
+			matcher.Build(old_nodes);
 
 		FILE * f = fopen(File.c_str(),"r");
 		if( f == NULL ) 
@@ -89,17 +90,7 @@ namespace INMOST
 			Storage::real xyz[3];
 			if( 3 == fscanf(f," %lf %lf %lf",xyz,xyz+1,xyz+2) )
 			{
-				int find = -1;
-				if( !old_nodes.empty() )
-				{
-					std::vector<HandleType>::iterator it = std::lower_bound(old_nodes.begin(),old_nodes.end(),xyz,CentroidComparator(this));
-					if( it != old_nodes.end() ) 
-					{
-						Storage::real_array c = RealArrayDF(*it,CoordsTag());
-						if( CentroidComparator(this).Compare(xyz,c.data()) == 0 )
-							find = static_cast<int>(it - old_nodes.begin());
-					}
-				}
+				int find = matcher.Find(xyz);
 				if( find == -1 ) newnodes[i] = CreateNode(xyz)->GetHandle();
 				else newnodes[i] = old_nodes[find];
 			}
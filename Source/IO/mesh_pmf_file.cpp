@@ -4,6 +4,10 @@
 
 #if defined(USE_MESH)
 
+#if defined(USE_THREADS)
+#include <pthread.h>
+#endif
+
 #if defined(USE_PARALLEL_WRITE_TIME)
 #define REPORT_MPI(x) {WriteTab(out_time) << "<MPI><![CDATA[" << #x << "]]></MPI>\n"; x;}
 #define REPORT_STR(x) {WriteTab(out_time) << "<TEXT><![CDATA[" << x << "]]></TEXT>\n";}
@@ -11,10 +15,10 @@
 #define ENTER_FUNC() long double all_time = Timer(); WriteTab(out_time) << "<FUNCTION name=\"" << __FUNCTION__ << "\" id=\"func" << func_id++ << "\">\n"; Enter();
 #define EXIT_FUNC() WriteTab(out_time) << "<TIME>" << Timer() - all_time << "</TIME>\n"; Exit(); WriteTab(out_time) << "</FUNCTION>\n";
 #else
-#define REPORT_MPI(x) x
+#define REPORT_MPI(x) {TraceMPI trace_mpi; x;}
 #define REPORT_STR(x) 
 #define REPORT_VAL(str,x)
-#define ENTER_FUNC()
+#define ENTER_FUNC() TraceScope trace_scope(__FUNCTION__);
 #define EXIT_FUNC() 
 #endif
 
@@ -33,6 +37,8 @@ namespace INMOST
 	const HeaderType EoMHeader  = 0x09;
 	const HeaderType INMOSTFile   = 0x10;
 	const HeaderType MeshDataHeader = 0x11;
+	const HeaderType INMOSTFileOffsets = 0x12; //file that starts with table of offsets
+	const HeaderType MeshDataIndexHeader = 0x13; //data of each tag is preceded by it's size
 
   
 	std::ostream & operator <<(std::ostream & out, HeaderType H)
@@ -47,18 +53,672 @@ namespace INMOST
 		return in;
 	}
 
-  void Mesh::SavePMF(std::string File)
+	/// Default size of the buffer used to stream ".pmf" data, see "PMF_BUFFER_SIZE" file option.
+	const INMOST_DATA_ENUM_TYPE PMFBufferSize = 4194304;
+	/// Default limit on the memory held by pending asynchronous outputs, see "PMF_ASYNC_LIMIT" file option.
+	const size_t PMFAsyncLimit = 1073741824;
+
+	/// Output buffer of fixed size that hands over every filled chunk
+	/// to the destination, the serialized mesh is never staged in memory.
+	class pmf_output_buffer : public std::streambuf
+	{
+		std::vector<char> buffer;
+		size_t written;
+	protected:
+		virtual void write_chunk(const char * data, INMOST_DATA_ENUM_TYPE size) = 0;
+		int_type overflow(int_type c)
+		{
+			flush_chunk();
+			if( !traits_type::eq_int_type(c,traits_type::eof()) )
+			{
+				*pptr() = traits_type::to_char_type(c);
+				pbump(1);
+			}
+			return traits_type::not_eof(c);
+		}
+	public:
+		pmf_output_buffer(INMOST_DATA_ENUM_TYPE size) : buffer(std::max<INMOST_DATA_ENUM_TYPE>(size,1)), written(0) {setp(&buffer[0],&buffer[0]+buffer.size());}
+		virtual ~pmf_output_buffer() {}
+		/// Hand over the data remaining in the buffer.
+		void flush_chunk()
+		{
+			INMOST_DATA_ENUM_TYPE size = static_cast<INMOST_DATA_ENUM_TYPE>(pptr()-pbase());
+			if( size ) write_chunk(pbase(),size);
+			written += size;
+			setp(&buffer[0],&buffer[0]+buffer.size());
+		}
+		/// Total number of bytes put into the buffer.
+		size_t total() const {return written + (pptr()-pbase());}
+		/// Only reports the position for std::ostream::tellp, the output can not be repositioned.
+		pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which)
+		{
+			if( off == 0 && dir == std::ios_base::cur && (which & std::ios_base::out) ) return pos_type(static_cast<off_type>(total()));
+			return pos_type(off_type(-1));
+		}
+	};
+
+	/// Writes chunks into the stream.
+	class pmf_stream_output : public pmf_output_buffer
+	{
+		std::ostream & dest;
+	protected:
+		void write_chunk(const char * data, INMOST_DATA_ENUM_TYPE size) {dest.write(data,size);}
+	public:
+		pmf_stream_output(std::ostream & dest, INMOST_DATA_ENUM_TYPE size) : pmf_output_buffer(size), dest(dest) {}
+	};
+
+	/// Keeps chunks in memory, used to take a snapshot of the mesh for asynchronous output.
+	class pmf_memory_output : public pmf_output_buffer
+	{
+		std::vector< std::vector<char> > & chunks;
+	protected:
+		void write_chunk(const char * data, INMOST_DATA_ENUM_TYPE size) {chunks.push_back(std::vector<char>(data,data+size));}
+	public:
+		pmf_memory_output(std::vector< std::vector<char> > & chunks, INMOST_DATA_ENUM_TYPE size) : pmf_output_buffer(size), chunks(chunks) {}
+	};
+
+	/// Input buffer of fixed size that requests a chunk from the source
+	/// each time the buffer is exhausted until total size of the data is read.
+	/// Reading a chunk of size n always requires ceil(total/n) requests.
+	/// Failed requests throw BadFile, the stream should rethrow it with badbit exception mask.
+	class pmf_input_buffer : public std::streambuf
+	{
+		std::vector<char> buffer;
+		size_t remain;
+	protected:
+		virtual void read_chunk(char * data, INMOST_DATA_ENUM_TYPE size) = 0;
+		/// Drop the chunk without reading, by default the chunk is read.
+		virtual void skip_chunk(INMOST_DATA_ENUM_TYPE size) {read_chunk(&buffer[0],size);}
+		int_type underflow()
+		{
+			if( gptr() < egptr() ) return traits_type::to_int_type(*gptr());
+			if( remain == 0 ) return traits_type::eof();
+			INMOST_DATA_ENUM_TYPE size = static_cast<INMOST_DATA_ENUM_TYPE>(std::min<size_t>(buffer.size(),remain));
+			read_chunk(&buffer[0],size);
+			remain -= size;
+			setg(&buffer[0],&buffer[0],&buffer[0]+size);
+			return traits_type::to_int_type(*gptr());
+		}
+	public:
+		pmf_input_buffer(size_t total, INMOST_DATA_ENUM_TYPE size) : buffer(std::max<INMOST_DATA_ENUM_TYPE>(size,1)), remain(total) {setg(&buffer[0],&buffer[0],&buffer[0]);}
+		virtual ~pmf_input_buffer() {}
+		/// Called after the data was parsed.
+		virtual void finish() {}
+		/// Skip given number of bytes without parsing.
+		/// Chunks that are skipped completely are not read from the source when possible.
+		void skip(size_t size)
+		{
+			size_t avail = static_cast<size_t>(egptr()-gptr());
+			if( size <= avail )
+			{
+				gbump(static_cast<int>(size));
+				return;
+			}
+			size -= avail;
+			setg(&buffer[0],&buffer[0],&buffer[0]);
+			while( size && remain )
+			{
+				INMOST_DATA_ENUM_TYPE chunk = static_cast<INMOST_DATA_ENUM_TYPE>(std::min<size_t>(buffer.size(),remain));
+				remain -= chunk;
+				if( size >= chunk )
+				{
+					skip_chunk(chunk);
+					size -= chunk;
+				}
+				else
+				{
+					read_chunk(&buffer[0],chunk);
+					setg(&buffer[0],&buffer[0]+size,&buffer[0]+chunk);
+					size = 0;
+				}
+			}
+		}
+	};
+
+	/// Owns the input buffer, so that the buffer is released when parsing throws.
+	class pmf_input_holder
+	{
+		pmf_input_buffer * buf;
+		pmf_input_holder(const pmf_input_holder & other);
+		pmf_input_holder & operator =(pmf_input_holder const & other);
+	public:
+		pmf_input_holder() : buf(NULL) {}
+		~pmf_input_holder() {delete buf;}
+		void reset(pmf_input_buffer * b) {delete buf; buf = b;}
+		pmf_input_buffer * get() const {return buf;}
+		pmf_input_buffer * operator ->() const {return buf;}
+	};
+
+	/// Reads chunks from the stream.
+	class pmf_stream_input : public pmf_input_buffer
+	{
+		std::istream & source;
+	protected:
+		void read_chunk(char * data, INMOST_DATA_ENUM_TYPE size) {source.read(data,size);}
+		void skip_chunk(INMOST_DATA_ENUM_TYPE size) {source.seekg(static_cast<std::streamoff>(size),std::ios::cur);}
+	public:
+		pmf_stream_input(std::istream & source, size_t total, INMOST_DATA_ENUM_TYPE size) : pmf_input_buffer(total,size), source(source) {}
+	};
+
+#if defined(USE_MPI)
+	/// Sends chunks to the processor that writes the file.
+	/// The receiver expects exactly limit bytes, the program is aborted before more is sent.
+	class pmf_send_output : public pmf_output_buffer
+	{
+		INMOST_MPI_Comm comm;
+		int dest;
+		MPI_Offset sent, limit;
+	protected:
+		void write_chunk(const char * data, INMOST_DATA_ENUM_TYPE size)
+		{
+			TraceMPI trace_mpi;
+			if( (sent += size) > limit )
+			{
+				std::cout << __FILE__ << ":" << __LINE__ << " mesh data exceeds predicted size " << limit << std::endl;
+				MPI_Abort(comm,__LINE__);
+			}
+			int ierr = MPI_Send(const_cast<char *>(data),static_cast<INMOST_MPI_SIZE>(size),MPI_CHAR,dest,0,comm);
+			if( ierr != MPI_SUCCESS ) MPI_Abort(comm,__LINE__);
+		}
+	public:
+		pmf_send_output(INMOST_MPI_Comm comm, int dest, MPI_Offset limit, INMOST_DATA_ENUM_TYPE size) : pmf_output_buffer(size), comm(comm), dest(dest), sent(0), limit(limit) {}
+	};
+
+	/// Receives chunks from the processor that reads the file.
+	class pmf_recv_input : public pmf_input_buffer
+	{
+		INMOST_MPI_Comm comm;
+		int source;
+	protected:
+		void read_chunk(char * data, INMOST_DATA_ENUM_TYPE size)
+		{
+			TraceMPI trace_mpi;
+			MPI_Status stat;
+			int ierr = MPI_Recv(data,static_cast<INMOST_MPI_SIZE>(size),MPI_CHAR,source,0,comm,&stat);
+			if( ierr != MPI_SUCCESS ) throw BadFile;
+		}
+	public:
+		pmf_recv_input(INMOST_MPI_Comm comm, int source, size_t total, INMOST_DATA_ENUM_TYPE size) : pmf_input_buffer(total,size), comm(comm), source(source) {}
+	};
+#if defined(USE_MPI_FILE)
+	/// Writes chunks at consecutive offsets of the file with collective calls,
+	/// processors with less chunks should match the number of calls with finish.
+	/// Data beyond the end offset belongs to the next processor, the program is aborted before it is written.
+	class pmf_file_output : public pmf_output_buffer
+	{
+		INMOST_MPI_Comm comm;
+		MPI_File fh;
+		MPI_Offset offset, end;
+		INMOST_DATA_ENUM_TYPE chunks;
+	protected:
+		void write_chunk(const char * data, INMOST_DATA_ENUM_TYPE size)
+		{
+			TraceMPI trace_mpi;
+			MPI_Status stat;
+			if( offset + static_cast<MPI_Offset>(size) > end )
+			{
+				std::cout << __FILE__ << ":" << __LINE__ << " mesh data exceeds predicted end " << end << std::endl;
+				MPI_Abort(comm,__LINE__);
+			}
+			int ierr = MPI_File_write_at_all(fh,offset,const_cast<char *>(data),static_cast<INMOST_MPI_SIZE>(size),MPI_CHAR,&stat);
+			if( ierr != MPI_SUCCESS ) MPI_Abort(comm,__LINE__);
+			offset += size;
+			chunks++;
+		}
+	public:
+		pmf_file_output(INMOST_MPI_Comm comm, MPI_File fh, MPI_Offset offset, MPI_Offset end, INMOST_DATA_ENUM_TYPE size) : pmf_output_buffer(size), comm(comm), fh(fh), offset(offset), end(end), chunks(0) {}
+		/// Write the rest of the data and perform empty writes up to the maximal number of chunks over processors.
+		void finish(INMOST_DATA_ENUM_TYPE max_chunks)
+		{
+			flush_chunk();
+			while( chunks < max_chunks )
+			{
+				TraceMPI trace_mpi;
+				MPI_Status stat;
+				int ierr = MPI_File_write_at_all(fh,offset,NULL,0,MPI_CHAR,&stat);
+				if( ierr != MPI_SUCCESS ) MPI_Abort(comm,__LINE__);
+				chunks++;
+			}
+		}
+	};
+
+	/// Reads chunks at consecutive offsets of the file with collective calls,
+	/// after parsing performs empty reads up to the maximal number of chunks over processors.
+	class pmf_file_input : public pmf_input_buffer
+	{
+		MPI_File fh;
+		MPI_Offset offset;
+		INMOST_DATA_ENUM_TYPE chunks, max_chunks;
+	protected:
+		void read_chunk(char * data, INMOST_DATA_ENUM_TYPE size)
+		{
+			TraceMPI trace_mpi;
+			MPI_Status stat;
+			int ierr = MPI_File_read_at_all(fh,offset,data,static_cast<INMOST_MPI_SIZE>(size),MPI_CHAR,&stat);
+			if( ierr != MPI_SUCCESS ) throw BadFile;
+			offset += size;
+			chunks++;
+		}
+		void skip_chunk(INMOST_DATA_ENUM_TYPE size) {offset += size;}
+	public:
+		pmf_file_input(MPI_File fh, MPI_Offset offset, size_t total, INMOST_DATA_ENUM_TYPE size, INMOST_DATA_ENUM_TYPE max_chunks) 
+			: pmf_input_buffer(total,size), fh(fh), offset(offset), chunks(0), max_chunks(max_chunks) {}
+		void finish()
+		{
+			char dummy;
+			while( chunks < max_chunks )
+			{
+				TraceMPI trace_mpi;
+				MPI_Status stat;
+				int ierr = MPI_File_read_at_all(fh,offset,&dummy,0,MPI_CHAR,&stat);
+				if( ierr != MPI_SUCCESS ) throw BadFile;
+				chunks++;
+			}
+		}
+	};
+#endif //USE_MPI_FILE
+#endif //USE_MPI
+
+	/// Size of the buffer for streaming set by "PMF_BUFFER_SIZE" file option.
+	static INMOST_DATA_ENUM_TYPE pmf_buffer_size(const std::vector< std::pair<std::string, std::string> > & file_options)
+	{
+		INMOST_DATA_ENUM_TYPE ret = PMFBufferSize;
+		for(INMOST_DATA_ENUM_TYPE k = 0; k < file_options.size(); ++k)
+		{
+			if( file_options[k].first == "PMF_BUFFER_SIZE" )
+			{
+				int size = atoi(file_options[k].second.c_str());
+				if( size > 0 ) ret = static_cast<INMOST_DATA_ENUM_TYPE>(size);
+				else printf("%s:%d Bad buffer size option: %s\n",__FILE__,__LINE__,file_options[k].second.c_str());
+			}
+		}
+		return ret;
+	}
+
+	/// Names of tags listed in "SET_TAGS_LOAD" file option, separated by commas or spaces.
+	/// Returns false if the option is not set and all the tags should be loaded.
+	static bool pmf_load_tags(const std::vector< std::pair<std::string, std::string> > & file_options, std::set<std::string> & names)
+	{
+		bool ret = false;
+		for(INMOST_DATA_ENUM_TYPE k = 0; k < file_options.size(); ++k)
+		{
+			if( file_options[k].first == "SET_TAGS_LOAD" )
+			{
+				std::string name;
+				std::stringstream list(file_options[k].second);
+				while( std::getline(list,name,',') )
+				{
+					std::stringstream words(name);
+					while( words >> name ) names.insert(name);
+				}
+				ret = true;
+			}
+		}
+		return ret;
+	}
+
+	/// Offsets in the table of ".pmf" file are stored as 8-byte little endian numbers.
+	static void pmf_write_offset(char * out, unsigned long long offset)
+	{
+		for(int q = 0; q < 8; ++q) out[q] = static_cast<char>((offset >> (8*q)) & 0xff);
+	}
+
+	static unsigned long long pmf_read_offset(const char * in)
+	{
+		unsigned long long ret = 0;
+		for(int q = 0; q < 8; ++q) ret |= static_cast<unsigned long long>(static_cast<unsigned char>(in[q])) << (8*q);
+		return ret;
+	}
+
+#if defined(USE_MPI)
+	/// Range [first,last) of data blocks in the file parsed by the processor.
+	/// If there are more blocks then processors, the blocks are accumulated on processors.
+	static void pmf_blocks(INMOST_DATA_ENUM_TYPE datanum, INMOST_DATA_ENUM_TYPE numprocs, INMOST_DATA_ENUM_TYPE rank, INMOST_DATA_ENUM_TYPE & first, INMOST_DATA_ENUM_TYPE & last)
+	{
+		if( datanum <= numprocs )
+		{
+			first = std::min(rank,datanum);
+			last = std::min(rank+1,datanum);
+		}
+		else
+		{
+			INMOST_DATA_ENUM_TYPE chunk = datanum / numprocs;
+			first = rank*chunk;
+			last = (rank == numprocs-1) ? datanum : first + chunk;
+		}
+	}
+#endif //USE_MPI
+
+	/// Read the header of the file from the stream positioned after the first token.
+	/// Fills positions of data blocks in the file, the last position is the end of the data.
+	static void pmf_read_header(std::istream & fin, HeaderType token, io_converter<INMOST_DATA_ENUM_TYPE,INMOST_DATA_REAL_TYPE> & uconv, std::vector<unsigned long long> & offsets)
+	{
+		INMOST_DATA_ENUM_TYPE datanum, datasize, k;
+		if( token != INMOST::INMOSTFile && token != INMOST::INMOSTFileOffsets ) throw BadFile;
+		uconv.read_iByteOrder(fin);
+		uconv.read_iByteSize(fin);
+		uconv.read_iValue(fin,datanum);
+		offsets.resize(datanum+1);
+		if( token == INMOST::INMOSTFileOffsets )
+		{
+			char entry[8];
+			for(k = 0; k <= datanum; k++)
+			{
+				fin.read(entry,8);
+				offsets[k] = pmf_read_offset(entry);
+			}
+		}
+		else
+		{
+			offsets[0] = 3 + static_cast<unsigned long long>(datanum+1)*uconv.get_source_iByteSize();
+			for(k = 0; k < datanum; k++)
+			{
+				uconv.read_iValue(fin,datasize);
+				offsets[k+1] = offsets[k] + datasize;
+			}
+		}
+		if( fin.fail() ) throw BadFile;
+	}
+
+	/// Write the data of the tag on all the elements, elements are referenced by their numbers in set_id.
+	static void pmf_write_tag_data(Mesh * mesh, std::ostream & out, const Tag & tag, const Tag & set_id)
+	{
+		io_converter<INMOST_DATA_ENUM_TYPE   ,INMOST_DATA_REAL_TYPE> uconv;
+		char wetype;
+		for(ElementType etype = NODE; etype <= MESH; etype = etype << 1)
+			if( tag.isDefined(etype) ) 
+			{
+				INMOST_DATA_ENUM_TYPE q = 0;
+				INMOST_DATA_ENUM_TYPE tagsize = tag.GetSize(), recsize = tagsize, lid, k;
+				DataType data_type = tag.GetDataType();
+				bool sparse = tag.isSparse(etype);
+				for(Mesh::iteratorStorage it = mesh->Begin(etype); it != mesh->End(); it++) 
+				{
+					if( !sparse || (sparse && it->HaveData(tag)) )
+					{
+						if( sparse ) uconv.write_iValue(out,q);
+						if( tagsize == ENUMUNDEF )
+						{
+							recsize = it->GetDataSize(tag);
+							uconv.write_iValue(out,recsize);
+						}
+						switch(data_type)
+						{
+						case DATA_REAL:
+							{
+								Storage::real_array arr = it->RealArray(tag);
+								for(k = 0; k < recsize; k++)
+									uconv.write_fValue(out,arr[k]);
+							} break;
+						case DATA_INTEGER:
+							{
+								Storage::integer_array arr = it->IntegerArray(tag);
+								for(k = 0; k < recsize; k++)
+									uconv.write_iValue(out,arr[k]);
+							} break;
+						case DATA_BULK:
+							{
+								out.write(reinterpret_cast<char *>(&it->Bulk(tag)),recsize);
+							} break;
+						case DATA_REFERENCE:
+							{
+								Storage::reference_array arr = it->ReferenceArray(tag);
+								for(k = 0; k < recsize; k++)
+								{
+									if( arr[k].isValid() )
+									{
+										wetype = arr[k].GetElementType();
+										out.put(wetype);
+										lid = mesh->IntegerDF(arr[k]->GetHandle(),set_id);
+										uconv.write_iValue(out,lid);
+									}
+									else out.put(NONE);
+								}
+							} break;
+              case DATA_REMOTE_REFERENCE:
+							{
+								Storage::remote_reference_array arr = it->RemoteReferenceArray(tag);
+								for(k = 0; k < recsize; k++)
+								{
+									if( arr[k].isValid() )
+									{
+                      uconv.write_iValue(out,static_cast<INMOST_DATA_ENUM_TYPE>(arr[k].GetMeshLink()->GetMeshName().size()));
+                      out.write(arr[k].GetMeshLink()->GetMeshName().c_str(),arr[k].GetMeshLink()->GetMeshName().size());
+										wetype = arr[k].GetElementType();
+										out.put(wetype);
+										lid = mesh->IntegerDF(arr[k]->GetHandle(),set_id);
+										uconv.write_iValue(out,lid);
+									}
+									else out.put(NONE);
+								}
+							} break;
+#if defined(USE_AUTODIFF)
+              case DATA_VARIABLE:
+							{
+								Storage::var_array arr = it->VariableArray(tag);
+								for(k = 0; k < recsize; k++)
+								{
+                    const Sparse::Row & r = arr[k].GetRow();
+                    uconv.write_fValue(out,arr[k].GetValue());
+                    uconv.write_iValue(out,arr[k].GetRow().Size());
+                    for(int m = 0; m < (int)r.Size(); ++m)
+                    {
+                      uconv.write_fValue(out,r.GetValue(m));
+                      uconv.write_iValue(out,r.GetIndex(m));
+                    }
+								}
+							} break;
+#endif
+						}
+					}
+					q++;
+				}
+				if( sparse ) uconv.write_iValue(out,q);
+			}
+	}
+
+	/// Size in bytes of the data written by pmf_write_tag_data, computed without serialization.
+	static size_t pmf_tag_data_size(Mesh * mesh, const Tag & tag)
+	{
+		io_converter<INMOST_DATA_ENUM_TYPE   ,INMOST_DATA_REAL_TYPE> uconv;
+		const size_t isize = uconv.get_iByteSize(), fsize = uconv.get_fByteSize();
+		size_t ret = 0, unit = 0;
+		DataType data_type = tag.GetDataType();
+		INMOST_DATA_ENUM_TYPE tagsize = tag.GetSize(), recsize = tagsize, k;
+		switch(data_type)
+		{
+		case DATA_REAL:    unit = fsize; break;
+		case DATA_INTEGER: unit = isize; break;
+		case DATA_BULK:    unit = 1; break;
+		default:           unit = 0; break; //size depends on the content
+		}
+		for(ElementType etype = NODE; etype <= MESH; etype = etype << 1)
+			if( tag.isDefined(etype) ) 
+			{
+				bool sparse = tag.isSparse(etype);
+				if( !sparse && tagsize != ENUMUNDEF && unit )
+				{
+					ret += static_cast<size_t>(mesh->NumberOf(etype))*tagsize*unit;
+					continue;
+				}
+				for(Mesh::iteratorStorage it = mesh->Begin(etype); it != mesh->End(); it++) 
+				{
+					if( sparse && !it->HaveData(tag) ) continue;
+					if( sparse ) ret += isize;
+					if( tagsize == ENUMUNDEF )
+					{
+						recsize = it->GetDataSize(tag);
+						ret += isize;
+					}
+					if( unit ) ret += recsize*unit;
+					else if( data_type == DATA_REFERENCE )
+					{
+						Storage::reference_array arr = it->ReferenceArray(tag);
+						for(k = 0; k < recsize; k++)
+							ret += arr[k].isValid() ? 1 + isize : 1;
+					}
+					else if( data_type == DATA_REMOTE_REFERENCE )
+					{
+						Storage::remote_reference_array arr = it->RemoteReferenceArray(tag);
+						for(k = 0; k < recsize; k++)
+							ret += arr[k].isValid() ? 2*isize + arr[k].GetMeshLink()->GetMeshName().size() + 1 : 1;
+					}
+#if defined(USE_AUTODIFF)
+					else if( data_type == DATA_VARIABLE )
+					{
+						Storage::var_array arr = it->VariableArray(tag);
+						for(k = 0; k < recsize; k++)
+							ret += fsize + isize + arr[k].GetRow().Size()*(fsize + isize);
+					}
+#endif
+				}
+				if( sparse ) ret += isize;
+			}
+		return ret;
+	}
+
+	/// Read the data of the tag written by pmf_write_tag_data, elements are referenced by their positions in elem_links.
+	static void pmf_read_tag_data(Mesh * mesh, std::istream & in, const Tag & tag, ElementType defined, ElementType sparse_mask, HandleType * elem_links[6], const INMOST_DATA_ENUM_TYPE elem_sizes[6],
+	                              io_converter<INMOST_DATA_INTEGER_TYPE,INMOST_DATA_REAL_TYPE> & iconv, io_converter<INMOST_DATA_ENUM_TYPE,INMOST_DATA_REAL_TYPE> & uconv)
+	{
+		for(ElementType etype = NODE; etype <= MESH; etype = etype << 1)
+		{
+			if( etype & defined )
+			{
+				INMOST_DATA_ENUM_TYPE q, cycle_end, etypenum = ElementNum(etype);
+				cycle_end = elem_sizes[etypenum];
+				bool sparse = false;
+              if( etype & sparse_mask ) sparse = true;
+				INMOST_DATA_ENUM_TYPE tagsize = tag.GetSize(), recsize = tagsize, lid;
+				INMOST_DATA_ENUM_TYPE k;
+				DataType data_type = tag.GetDataType();
+				if( sparse ) 
+				{
+					uconv.read_iValue(in,q); 
+					if( in.eof() ) std::cout << __FILE__ << ":" << __LINE__ << " Unexpected end of file! " << tag.GetTagName() << " " << ElementTypeName(etype) << " " << (sparse? "sparse" : "dense") << std::endl;
+				}
+				else q = 0;
+				while(q != cycle_end)
+				{
+					HandleType he = elem_links[etypenum][q];
+					if( tagsize == ENUMUNDEF ) 
+					{
+						uconv.read_iValue(in,recsize); 
+						if( in.eof() ) std::cout << __FILE__ << ":" << __LINE__ << " Unexpected end of file! " << tag.GetTagName() << " " << ElementTypeName(etype) << " " << (sparse? "sparse" : "dense") << std::endl;
+						mesh->SetDataSize(he,tag,recsize);
+					}
+					switch(data_type)
+					{
+					case DATA_REAL:
+						{
+							Storage::real_array arr = mesh->RealArray(he,tag);
+							for(k = 0; k < recsize; k++) 
+							{
+								iconv.read_fValue(in,arr[k]); 
+								if( in.eof() ) std::cout << __FILE__ << ":" << __LINE__ << " Unexpected end of file! " << tag.GetTagName() << " " << ElementTypeName(etype) << " " << (sparse? "sparse" : "dense") << std::endl;
+							}
+						} break;
+					case DATA_INTEGER:   
+						{
+							Storage::integer_array arr = mesh->IntegerArray(he,tag); 
+							for(k = 0; k < recsize; k++) 
+							{
+								iconv.read_iValue(in,arr[k]); 
+								if( in.eof() ) std::cout << __FILE__ << ":" << __LINE__ << " Unexpected end of file! " << tag.GetTagName() << " " << ElementTypeName(etype) << " " << (sparse? "sparse" : "dense") << std::endl;
+							}
+						} break;
+					case DATA_BULK:      
+						{
+							in.read(reinterpret_cast<char *>(&mesh->Bulk(he,tag)),recsize);
+							if( in.eof() ) std::cout << __FILE__ << ":" << __LINE__ << " Unexpected end of file! " << tag.GetTagName() << " " << ElementTypeName(etype) << " " << (sparse? "sparse" : "dense") << std::endl;
+						} break;
+					case DATA_REFERENCE: 
+						{
+							Storage::reference_array arr = mesh->ReferenceArray(he,tag);
+							for(k = 0; k < recsize; k++)
+							{
+								char type;
+								in.get(type);
+								if( in.eof() ) std::cout << __FILE__ << ":" << __LINE__ << " Unexpected end of file! " << tag.GetTagName() << " " << ElementTypeName(etype) << " " << (sparse? "sparse" : "dense") << std::endl;
+								if (type != NONE)
+								{
+									uconv.read_iValue(in, lid);
+									if( in.eof() ) std::cout << __FILE__ << ":" << __LINE__ << " Unexpected end of file! " << tag.GetTagName() << " " << ElementTypeName(etype) << " " << (sparse? "sparse" : "dense") << std::endl;
+									arr.at(k) = elem_links[ElementNum(type)][lid];
+								}
+								else arr.at(k) = InvalidHandle();
+							}
+						} break;
+                case DATA_REMOTE_REFERENCE: 
+						{
+							Storage::remote_reference_array arr = mesh->RemoteReferenceArray(he,tag);
+							for(k = 0; k < recsize; k++)
+							{
+                      INMOST_DATA_ENUM_TYPE size;
+                      std::vector<char> name;
+                      uconv.read_iValue(in,size);
+                      name.resize(size);
+                      if( !name.empty() ) in.read(&name[0],size);
+                      else std::cout << __FILE__ << ":" << __LINE__ << " Mesh of the name was not specified" << std::endl;
+                      arr.at(k).first = Mesh::GetMesh(std::string(name.begin(),name.end()));
+                      if( arr.at(k).first == NULL )
+                        std::cout << __FILE__ << ":" << __LINE__ << " Mesh with the name " << std::string(name.begin(),name.end()) << " do not exist, you should create the mesh with this name first" << std::endl;
+								char type;
+								in.get(type);
+								if( in.eof() ) std::cout << __FILE__ << ":" << __LINE__ << " Unexpected end of file! " << tag.GetTagName() << " " << ElementTypeName(etype) << " " << (sparse? "sparse" : "dense") << std::endl;
+								if (type != NONE)
+								{
+									uconv.read_iValue(in, lid);
+									if( in.eof() ) std::cout << __FILE__ << ":" << __LINE__ << " Unexpected end of file! " << tag.GetTagName() << " " << ElementTypeName(etype) << " " << (sparse? "sparse" : "dense") << std::endl;
+                        arr.at(k).second = ComposeHandle(type,lid);
+								}
+                      else arr.at(k).second = InvalidHandle();
+							}
+						} break;
+#if defined(USE_AUTODIFF)
+                case DATA_VARIABLE:
+                  {
+                    Storage::var_array arr = mesh->VariableArray(he,tag);
+                    Storage::real val;
+                    Storage::integer ival;
+                    for(k = 0; k < recsize; k++)
+                    {
+                      Sparse::Row & r = arr[k].GetRow();
+                      iconv.read_fValue(in,val);
+                      arr[k].SetValue(val);
+                      iconv.read_iValue(in,ival);
+                      r.Resize(ival);
+                      for(int l = 0; l < (int)r.Size(); ++l)
+                      {
+                        iconv.read_fValue(in,val);
+                        iconv.read_iValue(in,ival);
+                        r.GetValue(l) = val;
+                        r.GetIndex(l) = ival;
+                      }
+                    }
+                  } break;
+#endif
+					}
+					if( sparse ) 
+					{
+						uconv.read_iValue(in,q); 
+						if( in.eof() ) std::cout << __FILE__ << ":" << __LINE__ << " Unexpected end of file! " << tag.GetTagName() << " " << ElementTypeName(etype) << " " << (sparse? "sparse" : "dense") << std::endl;
+					}
+					else q++;
+				}
+			}
+		}
+	}
+
+  void Mesh::WritePMFData(std::ostream & out)
   {
 		io_converter<INMOST_DATA_INTEGER_TYPE,INMOST_DATA_REAL_TYPE> iconv;
 		io_converter<INMOST_DATA_ENUM_TYPE   ,INMOST_DATA_REAL_TYPE> uconv;
 		INMOST_DATA_ENUM_TYPE nlow,nhigh, lid;
-		char wetype;
-		//~ if( m_state == Mesh::Serial ) SetCommunicator(INMOST_MPI_COMM_WORLD);
-		std::stringstream out(std::ios::in | std::ios::out | std::ios::binary);
+		char wetype, entry[8];
 			
 		out << INMOST::INMOSTFile;
 		out << INMOST::MeshHeader;
-		ReorderEmpty(NODE | EDGE | FACE | CELL | ESET);
 
 		uconv.write_iByteOrder(out);
 		uconv.write_iByteSize(out);
@@ -258,8 +918,8 @@ namespace INMOST
 			}
 		}
 		
-		out << INMOST::MeshDataHeader;
-		REPORT_STR("MeshDataHeader");
+		out << INMOST::MeshDataIndexHeader;
+		REPORT_STR("MeshDataIndexHeader");
 
 		for(Mesh::iteratorTag jt = BeginTag(); jt != EndTag(); jt++) 
 		{
@@ -274,196 +934,547 @@ namespace INMOST
 			if( *jt == CoordsTag() ) continue;
 			if( *jt == SetNameTag() ) continue;
 			REPORT_VAL("TagName",tagname);
-			for(ElementType etype = NODE; etype <= MESH; etype = etype << 1)
-				if( jt->isDefined(etype) ) 
-				{
-					INMOST_DATA_ENUM_TYPE q = 0;
-					INMOST_DATA_ENUM_TYPE tagsize = jt->GetSize(), recsize = tagsize, lid, k;
-					DataType data_type = jt->GetDataType();
-					bool sparse = jt->isSparse(etype);
-					for(Mesh::iteratorStorage it = Begin(etype); it != End(); it++) 
-					{
-						if( !sparse || (sparse && it->HaveData(*jt)) )
-						{
-							if( sparse ) uconv.write_iValue(out,q);
-							if( tagsize == ENUMUNDEF )
-							{
-								recsize = it->GetDataSize(*jt);
-								uconv.write_iValue(out,recsize);
-							}
-							switch(data_type)
-							{
-							case DATA_REAL:
-								{
-									Storage::real_array arr = it->RealArray(*jt);
-									for(k = 0; k < recsize; k++)
-										uconv.write_fValue(out,arr[k]);
-								} break;
-							case DATA_INTEGER:
-								{
-									Storage::integer_array arr = it->IntegerArray(*jt);
-									for(k = 0; k < recsize; k++)
-										uconv.write_iValue(out,arr[k]);
-								} break;
-							case DATA_BULK:
-								{
-									out.write(reinterpret_cast<char *>(&it->Bulk(*jt)),recsize);
-								} break;
-							case DATA_REFERENCE:
-								{
-									Storage::reference_array arr = it->ReferenceArray(*jt);
-									for(k = 0; k < recsize; k++)
-									{
-										if( arr[k].isValid() )
-										{
-											wetype = arr[k].GetElementType();
-											out.put(wetype);
-											lid = IntegerDF(arr[k]->GetHandle(),set_id);
-											uconv.write_iValue(out,lid);
-										}
-										else out.put(NONE);
-									}
-								} break;
-              case DATA_REMOTE_REFERENCE:
-								{
-									Storage::remote_reference_array arr = it->RemoteReferenceArray(*jt);
-									for(k = 0; k < recsize; k++)
-									{
-										if( arr[k].isValid() )
-										{
-                      uconv.write_iValue(out,static_cast<INMOST_DATA_ENUM_TYPE>(arr[k].GetMeshLink()->GetMeshName().size()));
-                      out.write(arr[k].GetMeshLink()->GetMeshName().c_str(),arr[k].GetMeshLink()->GetMeshName().size());
-											wetype = arr[k].GetElementType();
-											out.put(wetype);
-											lid = IntegerDF(arr[k]->GetHandle(),set_id);
-											uconv.write_iValue(out,lid);
-										}
-										else out.put(NONE);
-									}
-								} break;
-#if defined(USE_AUTODIFF)
-              case DATA_VARIABLE:
-								{
-									Storage::var_array arr = it->VariableArray(*jt);
-									for(k = 0; k < recsize; k++)
-									{
-                    const Sparse::Row & r = arr[k].GetRow();
-                    uconv.write_fValue(out,arr[k].GetValue());
-                    uconv.write_iValue(out,arr[k].GetRow().Size());
-                    for(int m = 0; m < (int)r.Size(); ++m)
-                    {
-                      uconv.write_fValue(out,r.GetValue(m));
-                      uconv.write_iValue(out,r.GetIndex(m));
-                    }
-									}
-								} break;
+			//size of the section allows to skip the tag on load
+			size_t size = pmf_tag_data_size(this,*jt);
+			pmf_write_offset(entry,size);
+			out.write(entry,8);
+			std::streampos start = out.tellp();
+			pmf_write_tag_data(this,out,*jt,set_id);
+			//a wrong size would shift all the following sections for the loader that skips the tag
+			if( start != std::streampos(-1) && static_cast<size_t>(out.tellp() - start) != size )
+			{
+				std::cout << __FILE__ << ":" << __LINE__ << " data of tag " << tagname << " takes " << (out.tellp() - start) << " bytes instead of " << size << std::endl;
+#if defined(USE_MPI)
+				//other processors would wait for the data
+				if( m_state == Mesh::Parallel ) MPI_Abort(GetCommunicator(),__LINE__);
 #endif
-							}
-						}
-						q++;
-					}
-					if( sparse ) uconv.write_iValue(out,q);
-				}
+				DeleteTag(set_id);
+				throw Failure;
+			}
 		}
 		DeleteTag(set_id);
 		
 		out << INMOST::EoMHeader;
+  }
+
+#if defined(USE_MPI)
+	/// Check the size of the local data of the parallel output. The position of the data
+	/// in the file was found from Mesh::PMFDataSize, if the written size differs, the table of offsets
+	/// is wrong and the data of the other processor may be overwritten, therefore the program is aborted.
+	static void pmf_check_size(INMOST_MPI_Comm comm, size_t written, MPI_Offset datasize)
+	{
+		if( static_cast<MPI_Offset>(written) != datasize )
+		{
+			std::cout << __FILE__ << ":" << __LINE__ << " written " << written << " bytes of mesh data instead of predicted " << datasize << std::endl;
+			MPI_Abort(comm,__LINE__);
+		}
+	}
+#endif
+
+	size_t Mesh::PMFDataSize()
+	{
+		io_converter<INMOST_DATA_ENUM_TYPE   ,INMOST_DATA_REAL_TYPE> uconv;
+		const size_t isize = uconv.get_iByteSize(), fsize = uconv.get_fByteSize();
+		//tokens, byte orders and sizes, header and geometric data flags
+		size_t ret = 2 + 6 + 9*isize + sizeof(remember);
+		//tags, skipped tags should match with Mesh::WritePMFData
+		ret += 1 + isize;
+		for(Mesh::iteratorTag it = BeginTag(); it != EndTag(); it++)  
+		{
+			if( *it == MarkersTag() ) continue;
+			if( *it == HighConnTag() ) continue;
+			if( *it == LowConnTag() ) continue;
+			if( *it == CoordsTag() ) continue;
+			if( *it == SetNameTag() ) continue;
+			ret += 2*isize + it->GetTagName().size() + 3;
+		}
+		ret += 1 + isize + static_cast<size_t>(NumberOfNodes())*GetDimensions()*fsize;
+		ret += 1 + isize;
+		for(Mesh::iteratorEdge it = BeginEdge(); it != EndEdge(); it++) 
+			ret += (1 + LowConn(*it).size())*isize;
+		ret += 1 + isize;
+		for(Mesh::iteratorFace it = BeginFace(); it != EndFace(); it++) 
+			ret += (1 + LowConn(*it).size())*isize;
+		ret += 1 + isize;
+		for(Mesh::iteratorCell it = BeginCell(); it != EndCell(); it++) 
+			ret += (2 + LowConn(*it).size() + HighConn(*it).size())*isize;
+		ret += 1 + isize;
+		for(Mesh::iteratorSet it = BeginSet(); it != EndSet(); ++it) 
+		{
+			ret += 3*isize + it->GetName().size();
+			Element::adj_type & lc = LowConn(it->GetHandle());
+			for(Element::adj_type::iterator kt = lc.begin(); kt != lc.end(); ++kt)
+				ret += (*kt != InvalidHandle()) ? 1 + isize : 1;
+			Element::adj_type & hc = HighConn(it->GetHandle());
+			for(Element::adj_type::iterator kt = hc.begin(); kt != hc.begin()+ElementSet::high_conn_reserved-1; ++kt)
+				ret += (*kt != InvalidHandle()) ? 1 + isize : 1;
+			ret += (hc.size() - (ElementSet::high_conn_reserved-1))*isize;
+		}
+		//data of tags, each section is preceded by it's size
+		ret += 1;
+		for(Mesh::iteratorTag jt = BeginTag(); jt != EndTag(); jt++) 
+		{
+			if( *jt == HighConnTag() ) continue;
+			if( *jt == LowConnTag() ) continue;
+			if( *jt == MarkersTag() ) continue;
+			if( *jt == CoordsTag() ) continue;
+			if( *jt == SetNameTag() ) continue;
+			ret += 8 + pmf_tag_data_size(this,*jt);
+		}
+		return ret + 1;
+	}
+
+  void Mesh::SavePMF(std::string File)
+  {
+		io_converter<INMOST_DATA_ENUM_TYPE   ,INMOST_DATA_REAL_TYPE> uconv;
+		INMOST_DATA_ENUM_TYPE buffer_size = pmf_buffer_size(file_options);
+		//~ if( m_state == Mesh::Serial ) SetCommunicator(INMOST_MPI_COMM_WORLD);
+		ReorderEmpty(NODE | EDGE | FACE | CELL | ESET);
 #if defined(USE_MPI)
 		if( m_state == Mesh::Parallel )
 		{
 			REPORT_STR("Parallel write");
 			int ierr;
-			INMOST_DATA_ENUM_TYPE numprocs = GetProcessorsNumber(), datasize = static_cast<INMOST_DATA_ENUM_TYPE>(out.tellp()),k;
-			std::vector<INMOST_DATA_ENUM_TYPE> datasizes(numprocs,0);
+			INMOST_DATA_ENUM_TYPE numprocs = GetProcessorsNumber(), mpirank = GetProcessorRank(), k;
+			//header consists of the token, integer byte order and size, number of blocks and table of offsets
+			MPI_Offset datasize, header_size = 3 + uconv.get_iByteSize() + 8*static_cast<MPI_Offset>(numprocs+1);
+			//the size of the data is known before serialization to find where it goes in the file
+			datasize = static_cast<MPI_Offset>(PMFDataSize());
 			REPORT_VAL("local_write_file_size",datasize);
-			REPORT_MPI(ierr = MPI_Gather(&datasize,1,INMOST_MPI_DATA_ENUM_TYPE,&datasizes[0],1,INMOST_MPI_DATA_ENUM_TYPE,0,GetCommunicator()));
-			if( ierr != MPI_SUCCESS ) MPI_Abort(GetCommunicator(),__LINE__);
 #if defined(USE_MPI_FILE) //We have access to MPI_File
 			if( parallel_file_strategy == 1 )
 			{
 				MPI_File fh;
 				MPI_Status stat;
+				MPI_Info info;
+				MPI_Offset offset = 0;
+				INMOST_DATA_ENUM_TYPE chunks = static_cast<INMOST_DATA_ENUM_TYPE>((datasize + buffer_size - 1) / buffer_size), max_chunks = 0;
+				char entries[16];
+				MPI_Info_create(&info);
+				for(k = 0; k < file_options.size(); ++k)
+				{
+					if( file_options[k].first == "PMF_STRIPING_FACTOR" ) MPI_Info_set(info,const_cast<char *>("striping_factor"),const_cast<char *>(file_options[k].second.c_str()));
+					if( file_options[k].first == "PMF_STRIPING_UNIT" ) MPI_Info_set(info,const_cast<char *>("striping_unit"),const_cast<char *>(file_options[k].second.c_str()));
+				}
+				//remove the old file, so that striping is applied to the new one
 				REPORT_MPI(ierr = MPI_File_open(GetCommunicator(),const_cast<char *>(File.c_str()), MPI_MODE_CREATE | MPI_MODE_DELETE_ON_CLOSE | MPI_MODE_WRONLY, MPI_INFO_NULL, &fh));
 				if( ierr != MPI_SUCCESS ) MPI_Abort(GetCommunicator(),__LINE__);
 				REPORT_MPI(ierr = MPI_File_close(&fh));
 				if( ierr != MPI_SUCCESS ) MPI_Abort(GetCommunicator(),__LINE__);
                 REPORT_MPI(ierr = MPI_Barrier(GetCommunicator()));
 				if( ierr != MPI_SUCCESS ) MPI_Abort(GetCommunicator(),__LINE__);
-				REPORT_MPI(ierr = MPI_File_open(GetCommunicator(),const_cast<char *>(File.c_str()),MPI_MODE_CREATE | MPI_MODE_WRONLY,MPI_INFO_NULL,&fh));
+				REPORT_MPI(ierr = MPI_File_open(GetCommunicator(),const_cast<char *>(File.c_str()),MPI_MODE_CREATE | MPI_MODE_WRONLY,info,&fh));
 				if( ierr != MPI_SUCCESS ) MPI_Abort(GetCommunicator(),__LINE__);
-				if( GetProcessorRank() == 0 )
+				MPI_Info_free(&info);
+				if( mpirank == 0 )
+				{
+					std::stringstream header;
+					header.put(INMOST::INMOSTFileOffsets);
+					uconv.write_iByteOrder(header);
+					uconv.write_iByteSize(header);
+					uconv.write_iValue(header,numprocs);
+					std::string header_data(header.str());
+					REPORT_MPI(ierr = MPI_File_write_at(fh,0,&header_data[0],static_cast<INMOST_MPI_SIZE>(header_data.size()),MPI_CHAR,&stat));
+					if( ierr != MPI_SUCCESS ) MPI_Abort(GetCommunicator(),__LINE__);
+				}
+				//local data goes after the header and the data of previous processors
+				REPORT_MPI(ierr = MPI_Exscan(&datasize,&offset,1,MPI_OFFSET,MPI_SUM,GetCommunicator()));
+				if( ierr != MPI_SUCCESS ) MPI_Abort(GetCommunicator(),__LINE__);
+				if( mpirank == 0 ) offset = 0;
+				offset += header_size;
+				REPORT_VAL("local_write_offset",offset);
+				//every processor writes it's own entry of the table, the last one also writes the end of the data
+				pmf_write_offset(entries,offset);
+				pmf_write_offset(entries+8,offset+datasize);
+				REPORT_MPI(ierr = MPI_File_write_at_all(fh,3 + uconv.get_iByteSize() + 8*static_cast<MPI_Offset>(mpirank),entries,mpirank == numprocs-1 ? 16 : 8,MPI_CHAR,&stat));
+				if( ierr != MPI_SUCCESS ) MPI_Abort(GetCommunicator(),__LINE__);
+				REPORT_MPI(ierr = MPI_Allreduce(&chunks,&max_chunks,1,INMOST_MPI_DATA_ENUM_TYPE,MPI_MAX,GetCommunicator()));
+				if( ierr != MPI_SUCCESS ) MPI_Abort(GetCommunicator(),__LINE__);
+				{
+					pmf_file_output buf(GetCommunicator(),fh,offset,offset+datasize,buffer_size);
+					std::ostream out(&buf);
+					WritePMFData(out);
+					buf.finish(max_chunks);
+					pmf_check_size(GetCommunicator(),buf.total(),datasize);
+				}
+				REPORT_MPI(ierr = MPI_File_close(&fh));
+				if( ierr != MPI_SUCCESS ) MPI_Abort(GetCommunicator(),__LINE__);
+			}
+			else
+#endif
+			{
+				std::vector<MPI_Offset> datasizes(numprocs,0);
+				REPORT_MPI(ierr = MPI_Gather(&datasize,1,MPI_OFFSET,&datasizes[0],1,MPI_OFFSET,0,GetCommunicator()));
+				if( ierr != MPI_SUCCESS ) MPI_Abort(GetCommunicator(),__LINE__);
+				if( mpirank == 0 )
+				{
+					std::fstream fout(File.c_str(),std::ios::out | std::ios::binary);
+					unsigned long long offset = header_size;
+					char entry[8];
+					fout.put(INMOST::INMOSTFileOffsets);
+					uconv.write_iByteOrder(fout);
+					uconv.write_iByteSize(fout);
+					uconv.write_iValue(fout,numprocs);
+					for(k = 0; k <= numprocs; k++)
+					{
+						pmf_write_offset(entry,offset);
+						fout.write(entry,8);
+						if( k < numprocs ) offset += datasizes[k];
+					}
+					{
+						pmf_stream_output buf(fout,buffer_size);
+						std::ostream out(&buf);
+						WritePMFData(out);
+						buf.flush_chunk();
+						pmf_check_size(GetCommunicator(),buf.total(),datasize);
+					}
+					//processors are served one by one, so that only one chunk is held at once
+					std::vector<char> chunk;
+					MPI_Status stat;
+					for(k = 1; k < numprocs; k++)
+					{
+						MPI_Offset received = 0;
+						REPORT_MPI(ierr = MPI_Send(NULL,0,MPI_CHAR,k,0,GetCommunicator()));
+						if( ierr != MPI_SUCCESS ) MPI_Abort(GetCommunicator(),__LINE__);
+						while( received < datasizes[k] )
+						{
+							int count = 0;
+							REPORT_MPI(ierr = MPI_Probe(k,0,GetCommunicator(),&stat));
+							if( ierr != MPI_SUCCESS ) MPI_Abort(GetCommunicator(),__LINE__);
+							MPI_Get_count(&stat,MPI_CHAR,&count);
+							chunk.resize(std::max(count,1));
+							REPORT_MPI(ierr = MPI_Recv(&chunk[0],count,MPI_CHAR,k,0,GetCommunicator(),&stat));
+							if( ierr != MPI_SUCCESS ) MPI_Abort(GetCommunicator(),__LINE__);
+							fout.write(&chunk[0],count);
+							received += count;
+						}
+					}
+					fout.close();
+				}
+				else
+				{
+					MPI_Status stat;
+					char go;
+					//wait until the first processor is ready to write local data
+					REPORT_MPI(ierr = MPI_Recv(&go,0,MPI_CHAR,0,0,GetCommunicator(),&stat));
+					if( ierr != MPI_SUCCESS ) MPI_Abort(GetCommunicator(),__LINE__);
+					//the first processor waits for exactly datasize bytes
+					pmf_send_output buf(GetCommunicator(),0,datasize,buffer_size);
+					std::ostream out(&buf);
+					WritePMFData(out);
+					buf.flush_chunk();
+					pmf_check_size(GetCommunicator(),buf.total(),datasize);
+				}
+			}
+		}
+		else
+#endif
+		{
+			REPORT_STR("Serial write");
+			std::fstream fout(File.c_str(),std::ios::out | std::ios::binary);
+			INMOST_DATA_ENUM_TYPE numprocs = 1;
+			unsigned long long header_size = 3 + uconv.get_iByteSize() + 16, datasize = 0;
+			char entry[8];
+			fout.put(INMOST::INMOSTFileOffsets);
+			uconv.write_iByteOrder(fout);
+			uconv.write_iByteSize(fout);
+			uconv.write_iValue(fout,numprocs);
+			pmf_write_offset(entry,header_size);
+			fout.write(entry,8);
+			fout.write(entry,8); //the end is known after the data is written
+			{
+				pmf_stream_output buf(fout,buffer_size);
+				std::ostream out(&buf);
+				WritePMFData(out);
+				buf.flush_chunk();
+				datasize = buf.total();
+			}
+			assert(datasize == PMFDataSize());
+			REPORT_VAL("write_file_size",datasize);
+			fout.seekp(static_cast<std::streamoff>(header_size - 8));
+			pmf_write_offset(entry,header_size + datasize);
+			fout.write(entry,8);
+			fout.close();
+		}
+	}
+
+
+	/// State of the output started by Mesh::SaveAsync.
+	struct Mesh::AsyncOutput
+	{
+		int id;
+		std::vector< std::vector<char> > chunks; //header and serialized data
+		size_t written; //number of chunks written or posted for writing
+		size_t bytes; //size of the snapshot
+		std::fstream fout;
+#if defined(USE_MPI) && defined(USE_MPI_FILE)
+		bool parallel; //written with parallel file handle
+		MPI_File fh;
+		std::vector<MPI_Request> requests;
+#endif
+#if defined(USE_THREADS)
+		bool threaded; //chunks are written into fout by the thread
+		bool done; //the thread has written all the chunks, guarded by lock
+		pthread_t thread;
+		pthread_mutex_t lock;
+		/// Write all the chunks in the background, each chunk is released once written.
+		static void * writer(void * arg)
+		{
+			AsyncOutput * output = static_cast<AsyncOutput *>(arg);
+			for(size_t k = 0; k < output->chunks.size(); ++k)
+			{
+				output->fout.write(&output->chunks[k][0],output->chunks[k].size());
+				std::vector<char>().swap(output->chunks[k]);
+			}
+			output->fout.flush();
+			pthread_mutex_lock(&output->lock);
+			output->done = true;
+			pthread_mutex_unlock(&output->lock);
+			return NULL;
+		}
+#endif
+		AsyncOutput() : id(-1), written(0), bytes(0)
+		{
+#if defined(USE_MPI) && defined(USE_MPI_FILE)
+			parallel = false;
+#endif
+#if defined(USE_THREADS)
+			threaded = done = false;
+			pthread_mutex_init(&lock,NULL);
+#endif
+		}
+		~AsyncOutput()
+		{
+#if defined(USE_THREADS)
+			pthread_mutex_destroy(&lock);
+#endif
+		}
+	};
+
+	/// Limit on the memory held by snapshots of pending outputs set by "PMF_ASYNC_LIMIT" file option.
+	static size_t pmf_async_limit(const std::vector< std::pair<std::string, std::string> > & file_options)
+	{
+		size_t ret = PMFAsyncLimit;
+		for(INMOST_DATA_ENUM_TYPE k = 0; k < file_options.size(); ++k)
+		{
+			if( file_options[k].first == "PMF_ASYNC_LIMIT" )
+			{
+				double size = atof(file_options[k].second.c_str());
+				if( size >= 0 ) ret = static_cast<size_t>(size);
+				else printf("%s:%d Bad asynchronous output limit option: %s\n",__FILE__,__LINE__,file_options[k].second.c_str());
+			}
+		}
+		return ret;
+	}
+
+	int Mesh::SaveAsync(std::string File)
+	{
+		ENTER_FUNC();
+		REPORT_VAL("File",File);
+		io_converter<INMOST_DATA_ENUM_TYPE   ,INMOST_DATA_REAL_TYPE> uconv;
+		INMOST_DATA_ENUM_TYPE buffer_size = pmf_buffer_size(file_options);
+		AsyncOutput * output = new AsyncOutput;
+		output->id = async_outputs_last++;
+		async_outputs.push_back(output);
+		std::string LFile;
+		LFile.resize(File.size());
+		std::transform(File.begin(),File.end(),LFile.begin(),::tolower);
+#if defined(USE_MPI)
+		bool parallel = (m_state == Mesh::Parallel);
+#if !defined(USE_MPI_FILE)
+		//without parallel access to the file only the first processor is able to write
+		if( parallel ) LFile.clear();
+#endif
+#endif
+		if( LFile.find(".pmf") == std::string::npos )
+		{
+			//other formats are written immediately
+			Save(File);
+			EXIT_FUNC();
+			return output->id;
+		}
+		ReorderEmpty(NODE | EDGE | FACE | CELL | ESET);
+		//the snapshot, the rest of the work does not depend on the mesh
+		{
+			pmf_memory_output buf(output->chunks,buffer_size);
+			std::ostream out(&buf);
+			WritePMFData(out);
+			buf.flush_chunk();
+			output->bytes = buf.total();
+		}
+		REPORT_VAL("local_write_file_size",output->bytes);
+#if defined(USE_MPI) && defined(USE_MPI_FILE)
+		if( parallel )
+		{
+			int ierr;
+			INMOST_DATA_ENUM_TYPE numprocs = GetProcessorsNumber(), mpirank = GetProcessorRank();
+			MPI_Offset datasize = static_cast<MPI_Offset>(output->bytes), offset = 0;
+			MPI_Offset table = 3 + uconv.get_iByteSize(), header_size = table + 8*static_cast<MPI_Offset>(numprocs+1);
+			//remove the old file, so that no data of the old file remains in the end
+			REPORT_MPI(ierr = MPI_File_open(GetCommunicator(),const_cast<char *>(File.c_str()), MPI_MODE_CREATE | MPI_MODE_DELETE_ON_CLOSE | MPI_MODE_WRONLY, MPI_INFO_NULL, &output->fh));
+			if( ierr != MPI_SUCCESS ) MPI_Abort(GetCommunicator(),__LINE__);
+			REPORT_MPI(ierr = MPI_File_close(&output->fh));
+			if( ierr != MPI_SUCCESS ) MPI_Abort(GetCommunicator(),__LINE__);
+			REPORT_MPI(ierr = MPI_Barrier(GetCommunicator()));
+			if( ierr != MPI_SUCCESS ) MPI_Abort(GetCommunicator(),__LINE__);
+			REPORT_MPI(ierr = MPI_File_open(GetCommunicator(),const_cast<char *>(File.c_str()),MPI_MODE_CREATE | MPI_MODE_WRONLY,MPI_INFO_NULL,&output->fh));
+			if( ierr != MPI_SUCCESS ) MPI_Abort(GetCommunicator(),__LINE__);
+			output->parallel = true;
+			REPORT_MPI(ierr = MPI_Exscan(&datasize,&offset,1,MPI_OFFSET,MPI_SUM,GetCommunicator()));
+			if( ierr != MPI_SUCCESS ) MPI_Abort(GetCommunicator(),__LINE__);
+			if( mpirank == 0 ) offset = 0;
+			offset += header_size;
+			//the entry of the table of offsets goes last, the first processor also writes the header
+			std::vector<char> entries(mpirank == numprocs-1 ? 16 : 8);
+			pmf_write_offset(&entries[0],offset);
+			if( mpirank == numprocs-1 ) pmf_write_offset(&entries[8],offset+datasize);
+			if( mpirank == 0 )
+			{
+				std::stringstream header;
+				header.put(INMOST::INMOSTFileOffsets);
+				uconv.write_iByteOrder(header);
+				uconv.write_iByteSize(header);
+				uconv.write_iValue(header,numprocs);
+				std::string header_data(header.str());
+				entries.insert(entries.begin(),header_data.begin(),header_data.end());
+			}
+			output->chunks.push_back(entries);
+			output->requests.resize(output->chunks.size());
+			for(size_t k = 0; k+1 < output->chunks.size(); ++k)
+			{
+				REPORT_MPI(ierr = MPI_File_iwrite_at(output->fh,offset,&output->chunks[k][0],static_cast<INMOST_MPI_SIZE>(output->chunks[k].size()),MPI_CHAR,&output->requests[k]));
+				if( ierr != MPI_SUCCESS ) MPI_Abort(GetCommunicator(),__LINE__);
+				offset += static_cast<MPI_Offset>(output->chunks[k].size());
+			}
+			REPORT_MPI(ierr = MPI_File_iwrite_at(output->fh,mpirank == 0 ? 0 : table + 8*static_cast<MPI_Offset>(mpirank),&output->chunks.back()[0],static_cast<INMOST_MPI_SIZE>(entries.size()),MPI_CHAR,&output->requests.back()));
+			if( ierr != MPI_SUCCESS ) MPI_Abort(GetCommunicator(),__LINE__);
+			output->written = output->chunks.size();
+		}
+		else
+#endif
+		{
+			unsigned long long header_size = 3 + uconv.get_iByteSize() + 16;
+			char entry[8];
+			output->fout.open(File.c_str(),std::ios::out | std::ios::binary);
+			if( output->fout.fail() ) throw BadFileName;
+			output->fout.put(INMOST::INMOSTFileOffsets);
+			uconv.write_iByteOrder(output->fout);
+			uconv.write_iByteSize(output->fout);
+			uconv.write_iValue(output->fout,static_cast<INMOST_DATA_ENUM_TYPE>(1));
+			pmf_write_offset(entry,header_size);
+			output->fout.write(entry,8);
+			pmf_write_offset(entry,header_size+output->bytes);
+			output->fout.write(entry,8);
+#if defined(USE_THREADS)
+			if( pthread_create(&output->thread,NULL,AsyncOutput::writer,output) == 0 )
+			{
+				output->threaded = true;
+				output->written = output->chunks.size();
+			}
+			//otherwise chunks are written on Mesh::TestOutput and Mesh::WaitOutput
+#endif
+		}
+		//back-pressure: wait for older outputs while snapshots hold too much memory
+		{
+			size_t limit = pmf_async_limit(file_options), pending = 0;
+			for(size_t k = 0; k < async_outputs.size(); ++k) pending += async_outputs[k]->bytes;
+			int wait = 0;
+			do
+			{
+				wait = (pending > limit && async_outputs.size() > 1) ? 1 : 0;
+#if defined(USE_MPI)
+				//waiting is collective in parallel
+				if( parallel )
 				{
-					std::stringstream header;
-					header.put(INMOST::INMOSTFile);
-					uconv.write_iByteOrder(header);
-					uconv.write_iByteSize(header);
-					uconv.write_iValue(header,numprocs);
-					for(k = 0; k < numprocs; k++) uconv.write_iValue(header,datasizes[k]);
-
-					std::string header_data(header.str());
-					REPORT_MPI(ierr = MPI_File_write_shared(fh,&header_data[0],static_cast<INMOST_MPI_SIZE>(header_data.size()),MPI_CHAR,&stat));
-					if( ierr != MPI_SUCCESS ) MPI_Abort(GetCommunicator(),__LINE__);
+					int local = wait;
+					REPORT_MPI(MPI_Allreduce(&local,&wait,1,MPI_INT,MPI_MAX,GetCommunicator()));
 				}
+#endif
+				if( wait )
 				{
-					std::string local_data(out.str());
-					REPORT_MPI(ierr = MPI_File_write_ordered(fh,&local_data[0],static_cast<INMOST_MPI_SIZE>(local_data.size()),MPI_CHAR,&stat));
-					if( ierr != MPI_SUCCESS ) MPI_Abort(GetCommunicator(),__LINE__);
+					pending -= async_outputs[0]->bytes;
+					WaitOutput(async_outputs[0]->id);
 				}
+			} while( wait );
+		}
+		EXIT_FUNC();
+		return output->id;
+	}
 
-				REPORT_MPI(ierr = MPI_File_close(&fh));
-				if( ierr != MPI_SUCCESS ) MPI_Abort(GetCommunicator(),__LINE__);
+	bool Mesh::TestOutput(int id)
+	{
+		for(size_t k = 0; k < async_outputs.size(); ++k) if( async_outputs[k]->id == id )
+		{
+			AsyncOutput * output = async_outputs[k];
+#if defined(USE_MPI) && defined(USE_MPI_FILE)
+			if( !output->requests.empty() )
+			{
+				int flag = 0;
+				REPORT_MPI(MPI_Testall(static_cast<int>(output->requests.size()),&output->requests[0],&flag,MPI_STATUSES_IGNORE));
+				if( flag ) output->requests.clear();
+				return flag != 0;
 			}
-			else
 #endif
+#if defined(USE_THREADS)
+			if( output->threaded )
 			{
-				std::vector<INMOST_MPI_SIZE> displs(numprocs),recvcounts(numprocs);
-				std::string file_contents;
-				std::string local_data(out.str());
-				if( GetProcessorRank() == 0 )
-				{
-					recvcounts[0] = static_cast<INMOST_MPI_SIZE>(datasizes[0]);
-					displs[0] = 0;
-					int sizesum = recvcounts[0];
-					for(k = 1; k < numprocs; k++)
-					{
-						recvcounts[k] = static_cast<INMOST_MPI_SIZE>(datasizes[k]);
-						displs[k] = displs[k-1]+recvcounts[k-1];
-						sizesum += recvcounts[k];
-					}
-					file_contents.resize(sizesum);
-				}
-				else file_contents.resize(1); //protect from accessing bad pointer
-				REPORT_MPI(ierr = MPI_Gatherv(&local_data[0],static_cast<INMOST_MPI_SIZE>(local_data.size()),MPI_CHAR,&file_contents[0],&recvcounts[0],&displs[0],MPI_CHAR,0,GetCommunicator()));
-				if( ierr != MPI_SUCCESS ) MPI_Abort(GetCommunicator(),__LINE__);
-				if( GetProcessorRank() == 0 )
+				pthread_mutex_lock(&output->lock);
+				bool done = output->done;
+				pthread_mutex_unlock(&output->lock);
+				return done;
+			}
+#endif
+			//write the next chunk
+			if( output->written < output->chunks.size() )
+			{
+				std::vector<char> & chunk = output->chunks[output->written++];
+				output->fout.write(&chunk[0],chunk.size());
+				std::vector<char>().swap(chunk);
+			}
+			return output->written == output->chunks.size();
+		}
+		return true;
+	}
+
+	void Mesh::WaitOutput(int id)
+	{
+		size_t k = 0;
+		while( k < async_outputs.size() )
+		{
+			AsyncOutput * output = async_outputs[k];
+			if( id != -1 && output->id != id )
+			{
+				++k;
+				continue;
+			}
+#if defined(USE_MPI) && defined(USE_MPI_FILE)
+			if( output->parallel )
+			{
+				int ierr, finalized = 0;
+				MPI_Finalized(&finalized);
+				if( finalized )
+					std::cout << __FILE__ << ":" << __LINE__ << " cannot complete the output " << output->id << " since MPI was already finalized" << std::endl;
+				else
 				{
-					std::fstream fout(File.c_str(),std::ios::out | std::ios::binary);
-					fout.put(INMOST::INMOSTFile);
-					uconv.write_iByteOrder(fout);
-					uconv.write_iByteSize(fout);
-					uconv.write_iValue(fout,numprocs);
-					for(k = 0; k < numprocs; k++) uconv.write_iValue(fout,datasizes[k]);
-					fout.write(&file_contents[0],file_contents.size());
-					fout.close();
+					if( !output->requests.empty() )
+						REPORT_MPI(MPI_Waitall(static_cast<int>(output->requests.size()),&output->requests[0],MPI_STATUSES_IGNORE));
+					REPORT_MPI(ierr = MPI_File_close(&output->fh));
+					if( ierr != MPI_SUCCESS ) MPI_Abort(GetCommunicator(),__LINE__);
 				}
 			}
-		}
-		else
 #endif
-		{
-			REPORT_STR("Serial write");
-			std::fstream fout(File.c_str(),std::ios::out | std::ios::binary);
-			INMOST_DATA_ENUM_TYPE numprocs = 1, datasize = static_cast<INMOST_DATA_ENUM_TYPE>(out.tellp());
-			REPORT_VAL("write_file_size",datasize);
-			fout.put(INMOST::INMOSTFile);
-			uconv.write_iByteOrder(fout);
-			uconv.write_iByteSize(fout);
-			uconv.write_iValue(fout,numprocs);
-			uconv.write_iValue(fout,datasize);
-			fout << out.rdbuf();
-			fout.close();
+#if defined(USE_THREADS)
+			if( output->threaded ) pthread_join(output->thread,NULL);
+#endif
+			while( output->written < output->chunks.size() )
+			{
+				std::vector<char> & chunk = output->chunks[output->written++];
+				output->fout.write(&chunk[0],chunk.size());
+			}
+			if( output->fout.is_open() ) output->fout.close();
+			delete output;
+			async_outputs.erase(async_outputs.begin()+k);
 		}
-			
 	}
 
 
@@ -487,8 +1498,18 @@ namespace INMOST
 		io_converter<INMOST_DATA_ENUM_TYPE   ,INMOST_DATA_REAL_TYPE> uconv;
 		REPORT_STR("start load pmf");
 		dynarray<INMOST_DATA_ENUM_TYPE,128> myprocs;
-		std::stringstream in(std::ios::in | std::ios::out | std::ios::binary);
+		INMOST_DATA_ENUM_TYPE buffer_size = pmf_buffer_size(file_options);
+		std::set<std::string> load_tags;
+		bool select_tags = pmf_load_tags(file_options,load_tags);
+		//tags already present in the mesh are always loaded
+		for(Mesh::iteratorTag it = BeginTag(); it != EndTag(); ++it) load_tags.insert(it->GetTagName());
+		std::fstream fin;
+		pmf_input_holder inbuf;
 		HeaderType token;
+#if defined(USE_MPI) && defined(USE_MPI_FILE)
+		MPI_File fh;
+		bool close_fh = false;
+#endif
 #if defined(USE_MPI)
 		if( m_state == Mesh::Parallel )
 		{
@@ -498,131 +1519,75 @@ namespace INMOST
         REPORT_STR("strategy 1");
 				int ierr;
 				std::vector<char> buffer;
-				MPI_File fh;
+				std::stringstream header;
 				MPI_Status stat;
 				REPORT_MPI(ierr = MPI_File_open(GetCommunicator(),const_cast<char *>(File.c_str()),MPI_MODE_RDONLY,MPI_INFO_NULL,&fh));
 				if( ierr != MPI_SUCCESS ) REPORT_MPI(MPI_Abort(GetCommunicator(),__LINE__));
-				INMOST_DATA_ENUM_TYPE numprocs = GetProcessorsNumber(), recvsize = 0, mpirank = GetProcessorRank();
+				close_fh = true;
+				INMOST_DATA_ENUM_TYPE numprocs = GetProcessorsNumber(), mpirank = GetProcessorRank();
+				INMOST_DATA_ENUM_TYPE datanum, first, last, isize, k, chunks, max_chunks = 0;
+				MPI_Offset offset, recvsize;
         REPORT_VAL("number of processors",numprocs);
         REPORT_VAL("rank of processor", mpirank);
-				std::vector<INMOST_DATA_ENUM_TYPE> recvsizes;
-				if( mpirank == 0 ) //the alternative is to read alltogether
-				{
-					INMOST_DATA_ENUM_TYPE datanum, chunk,pos,k,q;
-					std::stringstream header;
-						
-					buffer.resize(3);
-					//ierr = MPI_File_read_all(fh,&buffer[0],3,MPI_CHAR,&stat);
-					REPORT_MPI(ierr = MPI_File_read_shared(fh,&buffer[0],3,MPI_CHAR,&stat));
-					if( ierr != MPI_SUCCESS ) REPORT_MPI(MPI_Abort(GetCommunicator(),__LINE__));
-
-					if( static_cast<HeaderType>(buffer[0]) != INMOST::INMOSTFile ) throw BadFile;
-
-					header.write(&buffer[1],2);
-					uconv.read_iByteOrder(header);
-					uconv.read_iByteSize(header);
-
-          REPORT_VAL("integer_byte_order",uconv.str_iByteOrder(uconv.get_iByteOrder()));
-          REPORT_VAL("integer_byte_size",(int)uconv.get_iByteSize());
-        
-
-					buffer.resize(uconv.get_source_iByteSize());
-					//ierr = MPI_File_read_all(fh,&buffer[0],buffer.size(),MPI_CHAR,&stat);
-					REPORT_MPI(ierr = MPI_File_read_shared(fh,&buffer[0],static_cast<INMOST_MPI_SIZE>(buffer.size()),MPI_CHAR,&stat));
-					if( ierr != MPI_SUCCESS ) MPI_Abort(GetCommunicator(),__LINE__);
-
-          header.write(&buffer[0],buffer.size());
-					uconv.read_iValue(header,datanum);
+				//every processor reads the header and finds it's data without communication
+				buffer.resize(3);
+				REPORT_MPI(ierr = MPI_File_read_at_all(fh,0,&buffer[0],3,MPI_CHAR,&stat));
+				if( ierr != MPI_SUCCESS ) REPORT_MPI(MPI_Abort(GetCommunicator(),__LINE__));
+				token = static_cast<HeaderType>(buffer[0]);
+				if( token != INMOST::INMOSTFile && token != INMOST::INMOSTFileOffsets ) throw BadFile;
+				header.write(&buffer[1],2);
+				uconv.read_iByteOrder(header);
+				uconv.read_iByteSize(header);
+				isize = uconv.get_source_iByteSize();
+
+        REPORT_VAL("integer_byte_order",uconv.str_iByteOrder(uconv.get_iByteOrder()));
+        REPORT_VAL("integer_byte_size",(int)uconv.get_iByteSize());
+
+				buffer.resize(isize);
+				REPORT_MPI(ierr = MPI_File_read_at_all(fh,3,&buffer[0],static_cast<INMOST_MPI_SIZE>(isize),MPI_CHAR,&stat));
+				if( ierr != MPI_SUCCESS ) REPORT_MPI(MPI_Abort(GetCommunicator(),__LINE__));
+				header.write(&buffer[0],buffer.size());
+				uconv.read_iValue(header,datanum);
 
-          REPORT_VAL("number of data entries",datanum);
+        REPORT_VAL("number of data entries",datanum);
 
-					buffer.resize(datanum*uconv.get_source_iByteSize());
-					std::vector<INMOST_DATA_ENUM_TYPE> datasizes(datanum);
-					//ierr = MPI_File_read_all(fh,&buffer[0],buffer.size(),MPI_CHAR,&stat);
-					REPORT_MPI(ierr = MPI_File_read_shared(fh,&buffer[0],static_cast<INMOST_MPI_SIZE>(buffer.size()),MPI_CHAR,&stat));
+				pmf_blocks(datanum,numprocs,mpirank,first,last);
+				if( token == INMOST::INMOSTFileOffsets )
+				{
+					//read only entries of the table for local blocks
+					buffer.resize(8*(last-first+1));
+					REPORT_MPI(ierr = MPI_File_read_at_all(fh,3+isize+8*static_cast<MPI_Offset>(first),&buffer[0],static_cast<INMOST_MPI_SIZE>(buffer.size()),MPI_CHAR,&stat));
 					if( ierr != MPI_SUCCESS ) REPORT_MPI(MPI_Abort(GetCommunicator(),__LINE__));
-
-          INMOST_DATA_ENUM_TYPE datasum = 0;
-					header.write(&buffer[0],buffer.size());
-					for(k = 0; k < datanum; k++) 
-          {
-            uconv.read_iValue(header,datasizes[k]);
-            REPORT_VAL("size of data entry " << k,datasizes[k]);
-            datasum += datasizes[k];
-          }
-          REPORT_VAL("total size",datasum);
-
-					// use this commented code when all processors read the file alltogether through MPI_File_read_all
-					//{
-					//	MPI_Offset off;
-					//	ierr = MPI_File_get_position(fh,&off);
-					//	if( ierr != MPI_SUCCESS ) MPI_Abort(GetCommunicator(),__LINE__);
-					//	ierr = MPI_File_seek_shared( fh, off, MPI_SEEK_SET );
-					//	if( ierr != MPI_SUCCESS ) MPI_Abort(GetCommunicator(),__LINE__);
-					//}
-					//if( datanum <= numprocs )
-					//{
-					//	if( mpirank < datanum )
-					//		recvsize = datasizes[mpirank];
-					//}
-					//else
-					//{
-					//	chunk = static_cast<INMOST_DATA_ENUM_TYPE>(floor(static_cast<double>(datanum)/static_cast<double>(numprocs)));
-					//	if( mpirank < numprocs - 1)
-					//	{
-					//		for(k = chunk*(mpirank); k < chunk*(mpirank+1); k++)
-					//			recvsize += datasizes[k];
-					//	}
-					//	else
-					//	{
-					//		for(k = chunk*(mpirank); k < datanum; k++)
-					//			recvsize += datasizes[k];
-					//	}
-					//}
-
-					recvsizes.resize(numprocs,0);
-					if( datanum <= recvsizes.size() )
-					{
-            REPORT_STR("number of processors is greater or equal then number of data entries");
-						for(k = 0; k < datanum; k++)
-							recvsizes[k] = datasizes[k];
-					}
-					else
+					offset = static_cast<MPI_Offset>(pmf_read_offset(&buffer[0]));
+					recvsize = static_cast<MPI_Offset>(pmf_read_offset(&buffer[8*(last-first)])) - offset;
+				}
+				else
+				{
+					//sizes of all the blocks are required to find the local offset
+					INMOST_DATA_ENUM_TYPE datasize;
+					buffer.resize(std::max<size_t>(datanum*isize,1));
+					REPORT_MPI(ierr = MPI_File_read_at_all(fh,3+isize,&buffer[0],static_cast<INMOST_MPI_SIZE>(datanum*isize),MPI_CHAR,&stat));
+					if( ierr != MPI_SUCCESS ) REPORT_MPI(MPI_Abort(GetCommunicator(),__LINE__));
+					header.write(&buffer[0],datanum*isize);
+					offset = 3 + static_cast<MPI_Offset>(datanum+1)*isize;
+					recvsize = 0;
+					for(k = 0; k < last; k++)
 					{
-            REPORT_STR("number of processors is less then number of data entries - accumulating data");
-						chunk = static_cast<INMOST_DATA_ENUM_TYPE>(floor(static_cast<double>(datanum)/static_cast<double>(recvsizes.size())));
-            REPORT_VAL("chunk size" ,chunk);
-						pos = 0;
-						for(k = 0; k < recvsizes.size()-1; k++)
-            {
-							for(q = 0; q < chunk; q++)
-								recvsizes[k] += datasizes[pos++];
-
-              REPORT_VAL("recv on " << k, recvsizes[k]);
-            }
-						for(k = pos; k < datanum; k++)
-							recvsizes[recvsizes.size()-1] += datasizes[k];
-            REPORT_VAL("recv on " << recvsizes.size()-1, recvsizes[recvsizes.size()-1]);
+						uconv.read_iValue(header,datasize);
+						REPORT_VAL("size of data entry " << k,datasize);
+						if( k < first ) offset += datasize;
+						else recvsize += datasize;
 					}
 				}
-				else recvsizes.resize(1,0); //protect from dereferencing null
-
-				REPORT_MPI(ierr = MPI_Scatter(&recvsizes[0],1,INMOST_MPI_DATA_ENUM_TYPE,&recvsize,1,INMOST_MPI_DATA_ENUM_TYPE,0,GetCommunicator()));
-				if( ierr != MPI_SUCCESS ) REPORT_MPI(MPI_Abort(GetCommunicator(),__LINE__));
 
         REPORT_VAL("read on current processor",recvsize);
+        REPORT_VAL("read offset on current processor",offset);
 
-				buffer.resize(std::max(1u,recvsize)); //protect from dereferencing null
-
-
-				{
-					REPORT_MPI(ierr = MPI_File_read_ordered(fh,&buffer[0],static_cast<INMOST_MPI_SIZE>(recvsize),MPI_CHAR,&stat));
-					if( ierr != MPI_SUCCESS ) REPORT_MPI(MPI_Abort(GetCommunicator(),__LINE__));
-					in.write(&buffer[0],recvsize);
-				}
-
-				REPORT_MPI(ierr = MPI_File_close(&fh));
+				//all processors should perform the same number of collective reads
+				chunks = static_cast<INMOST_DATA_ENUM_TYPE>((recvsize + buffer_size - 1) / buffer_size);
+				REPORT_MPI(ierr = MPI_Allreduce(&chunks,&max_chunks,1,INMOST_MPI_DATA_ENUM_TYPE,MPI_MAX,GetCommunicator()));
 				if( ierr != MPI_SUCCESS ) REPORT_MPI(MPI_Abort(GetCommunicator(),__LINE__));
+				inbuf.reset(new pmf_file_input(fh,offset,static_cast<size_t>(recvsize),buffer_size,max_chunks));
 			}
 			else
 #endif
@@ -630,159 +1595,101 @@ namespace INMOST
 
         REPORT_STR("strategy 0");
 				int ierr;
-				std::vector<char> buffer, local_buffer;
-				INMOST_DATA_ENUM_TYPE recvsize;
-					
-				INMOST_DATA_ENUM_TYPE numprocs = GetProcessorsNumber(),mpirank = GetProcessorRank();
-				std::vector<INMOST_DATA_ENUM_TYPE> recvsizes(numprocs,0);
-				std::vector<INMOST_MPI_SIZE> sendcnts(numprocs), displs(numprocs);
+				MPI_Offset recvsize;
+				INMOST_DATA_ENUM_TYPE numprocs = GetProcessorsNumber(),mpirank = GetProcessorRank(), k;
+				std::vector<MPI_Offset> recvsizes(numprocs,0), positions(numprocs,0);
         REPORT_VAL("number of processors",numprocs);
         REPORT_VAL("rank of processor", mpirank);
 				if( mpirank == 0 ) //zero reads everything
 				{
-					std::fstream fin(File.c_str(),std::ios::in | std::ios::binary);
+					std::vector<unsigned long long> offsets;
+					INMOST_DATA_ENUM_TYPE datanum, first, last;
+					fin.open(File.c_str(),std::ios::in | std::ios::binary);
 					fin.get(token);
-					if( token != INMOST::INMOSTFile ) throw BadFile;
-					uconv.read_iByteOrder(fin);
-					uconv.read_iByteSize(fin);
-
-          REPORT_VAL("file position",fin.tellg());
+					pmf_read_header(fin,token,uconv,offsets);
+					datanum = static_cast<INMOST_DATA_ENUM_TYPE>(offsets.size()-1);
 
           REPORT_VAL("integer_byte_order",uconv.str_iByteOrder(uconv.get_iByteOrder()));
           REPORT_VAL("integer_byte_size",(int)uconv.get_iByteSize());
-        
-
-					INMOST_DATA_ENUM_TYPE datanum,k,q,datasum = 0,chunk,pos;
-					uconv.read_iValue(fin,datanum);
-
           REPORT_VAL("number of data entries",datanum);
-          REPORT_VAL("file position",fin.tellg());
-
-					std::vector<INMOST_DATA_ENUM_TYPE> datasizes(datanum);
-					for(k = 0; k < datanum; k++) 
-					{
-						uconv.read_iValue(fin,datasizes[k]);
-            REPORT_VAL("size of data entry " << k,datasizes[k]);
-						datasum += datasizes[k];
-					}
-
-          REPORT_VAL("file position",fin.tellg());
-
-					{
-						buffer.resize(datasum);
-						fin.read(&buffer[0],buffer.size());
-              
-					}
-          REPORT_VAL("file position",fin.tellg());
-          REPORT_VAL("total size",datasum);
-					fin.close();
-
-
-					if( datanum <= recvsizes.size() )
-					{
-            REPORT_STR("number of processors is greater or equal then number of data entries");
-						for(k = 0; k < datanum; k++)
-							recvsizes[k] = datasizes[k];
-					}
-					else
-					{
-            REPORT_STR("number of processors is less then number of data entries - accumulating data");
-						chunk = static_cast<INMOST_DATA_ENUM_TYPE>(floor(static_cast<double>(datanum)/static_cast<double>(recvsizes.size())));
-            REPORT_VAL("chunk size" ,chunk);
-						pos = 0;
-						for(k = 0; k < recvsizes.size()-1; k++)
-            {
-							for(q = 0; q < chunk; q++)
-								recvsizes[k] += datasizes[pos++];
-              REPORT_VAL("recv on " << k, recvsizes[k]);
-            }
-						for(k = pos; k < datanum; k++)
-							recvsizes[recvsizes.size()-1] += datasizes[k];
-            REPORT_VAL("recv on " << recvsizes.size()-1, recvsizes[recvsizes.size()-1]);
-					}
+          REPORT_VAL("total size",offsets[datanum]-offsets[0]);
 
-					displs[0] = 0;
-					sendcnts[0] = static_cast<INMOST_MPI_SIZE>(recvsizes[0]);
-          REPORT_VAL("disp on "<<0,displs[0]);
-          REPORT_VAL("send on "<<0,sendcnts[0]);
-					for(k = 1; k < numprocs; k++)
+					for(k = 0; k < numprocs; k++)
 					{
-						sendcnts[k] = static_cast<INMOST_MPI_SIZE>(recvsizes[k]);
-						displs[k] = sendcnts[k-1]+displs[k-1];
-            REPORT_VAL("disp on "<<k,displs[k]);
-            REPORT_VAL("send on "<<k,sendcnts[k]);
+						pmf_blocks(datanum,numprocs,k,first,last);
+						positions[k] = static_cast<MPI_Offset>(offsets[first]);
+						recvsizes[k] = static_cast<MPI_Offset>(offsets[last] - offsets[first]);
+            REPORT_VAL("recv on " << k, recvsizes[k]);
 					}
 				}
-				else 
-				{
-					//protect from dereferencing null
-					buffer.resize(1);
-				}
-				REPORT_MPI(ierr = MPI_Scatter(&recvsizes[0],1,INMOST_MPI_DATA_ENUM_TYPE,&recvsize,1,INMOST_MPI_DATA_ENUM_TYPE,0,GetCommunicator()));
+				REPORT_MPI(ierr = MPI_Scatter(&recvsizes[0],1,MPI_OFFSET,&recvsize,1,MPI_OFFSET,0,GetCommunicator()));
+				if( ierr != MPI_SUCCESS ) REPORT_MPI(MPI_Abort(GetCommunicator(),__LINE__));
+				//chunks are sent with the size of the buffer on the first processor
+				REPORT_MPI(ierr = MPI_Bcast(&buffer_size,1,INMOST_MPI_DATA_ENUM_TYPE,0,GetCommunicator()));
 				if( ierr != MPI_SUCCESS ) REPORT_MPI(MPI_Abort(GetCommunicator(),__LINE__));
-				local_buffer.resize(std::max(1u,recvsize));
 
         REPORT_VAL("read on current processor",recvsize);
 
-
-				REPORT_MPI(ierr = MPI_Scatterv(&buffer[0],&sendcnts[0],&displs[0],MPI_CHAR,&local_buffer[0],recvsize,MPI_CHAR,0,GetCommunicator()));
-				if( ierr != MPI_SUCCESS ) REPORT_MPI(MPI_Abort(GetCommunicator(),__LINE__));
-				in.write(&local_buffer[0],local_buffer.size());
-        REPORT_VAL("output position",in.tellg());
+				if( mpirank == 0 )
+				{
+					//serve other processors chunk by chunk in turn, so that they parse the data 
+					//while the next processor is served and only one chunk is held at once
+					std::vector<char> buffer(buffer_size);
+					INMOST_DATA_ENUM_TYPE size;
+					bool serve = true;
+					while( serve )
+					{
+						serve = false;
+						for(k = 1; k < numprocs; k++) if( recvsizes[k] )
+						{
+							size = static_cast<INMOST_DATA_ENUM_TYPE>(std::min<MPI_Offset>(recvsizes[k],buffer_size));
+							fin.seekg(static_cast<std::streamoff>(positions[k]));
+							fin.read(&buffer[0],size);
+							REPORT_MPI(ierr = MPI_Send(&buffer[0],static_cast<INMOST_MPI_SIZE>(size),MPI_CHAR,k,0,GetCommunicator()));
+							if( ierr != MPI_SUCCESS ) REPORT_MPI(MPI_Abort(GetCommunicator(),__LINE__));
+							positions[k] += size;
+							recvsizes[k] -= size;
+							serve = true;
+						}
+					}
+					fin.seekg(static_cast<std::streamoff>(positions[0]));
+					inbuf.reset(new pmf_stream_input(fin,static_cast<size_t>(recvsize),buffer_size));
+				}
+				else inbuf.reset(new pmf_recv_input(GetCommunicator(),0,static_cast<size_t>(recvsize),buffer_size));
 			}
 
 		}
 		else
 #endif
 		{
-			std::fstream fin(File.c_str(),std::ios::in | std::ios::binary);
+			std::vector<unsigned long long> offsets;
+			fin.open(File.c_str(),std::ios::in | std::ios::binary);
 			fin.get(token);
-			if( token != INMOST::INMOSTFile ) throw BadFile;
-			uconv.read_iByteOrder(fin);
-			uconv.read_iByteSize(fin);
-
-      REPORT_VAL("file position",fin.tellg());
+			pmf_read_header(fin,token,uconv,offsets);
 
       REPORT_VAL("integer_byte_order",uconv.str_iByteOrder(uconv.get_iByteOrder()));
       REPORT_VAL("integer_byte_size",(int)uconv.get_iByteSize());
-        
-			INMOST_DATA_ENUM_TYPE datanum,k,datasum = 0;
-			uconv.read_iValue(fin,datanum);
-
-      REPORT_VAL("file position",fin.tellg());
-
-      REPORT_VAL("number of data entries",datanum);
+      REPORT_VAL("number of data entries",offsets.size()-1);
+      REPORT_VAL("total size",offsets.back()-offsets[0]);
 
-			std::vector<INMOST_DATA_ENUM_TYPE> datasizes(datanum);
-			for(k = 0; k < datanum; k++) 
-			{
-				uconv.read_iValue(fin,datasizes[k]);
-        REPORT_VAL("size of data entry " << k,datasizes[k]);
-				datasum += datasizes[k];
-			}
-
-      REPORT_VAL("file position",fin.tellg());
-
-      REPORT_VAL("total size",datasum);
-			{
-				std::vector<char> buffer;
-				buffer.resize(datasum);
-				fin.read(&buffer[0],buffer.size());
-				in.write(&buffer[0],buffer.size());
-        REPORT_VAL("output position",in.tellg());
-			}
-
-      REPORT_VAL("file position",fin.tellg());
-
-			fin.close();
+			fin.seekg(static_cast<std::streamoff>(offsets[0]));
+			inbuf.reset(new pmf_stream_input(fin,static_cast<size_t>(offsets.back()-offsets[0]),buffer_size));
 		}
-			
+		//the data is parsed directly from the file by chunks, errors of reading are rethrown
+		std::istream in(inbuf.get());
+		in.exceptions(std::ios::badbit);
+
 		//std::fstream in(File.c_str(),std::ios::in | std::ios::binary);
 			
 		std::vector<Tag> tags;
     std::vector<ElementType> tags_defined;
     std::vector<ElementType> tags_sparse;
+		std::vector<std::string> tags_name;
+		std::vector<DataType> tags_type;
+		std::vector<INMOST_DATA_ENUM_TYPE> tags_length;
+		std::vector<Tag> tags_dropped; //not selected tags read from files without sizes of sections
 		std::vector<HandleType> old_nodes;
+		NodeMatcher matcher(this);
 		std::vector<HandleType> new_nodes;
 		std::vector<HandleType> new_edges;
 		std::vector<HandleType> new_faces;
@@ -811,6 +1718,9 @@ namespace INMOST
 					tags.clear();
           tags_sparse.clear();
           tags_defined.clear();
+					tags_name.clear();
+					tags_type.clear();
+					tags_length.clear();
 					old_nodes.clear();
 					old_nodes.resize(NumberOfNodes());
 					{
@@ -818,8 +1728,7 @@ namespace INMOST
 						for(Mesh::iteratorNode it = BeginNode(); it != EndNode(); ++it)
 							old_nodes[qq++] = *it;
 					}
-					if( !old_nodes.empty() ) 
-						std::sort(old_nodes.begin(),old_nodes.end(),CentroidComparator(this));
+					matcher.Build(old_nodes);
 					if( old_nodes.empty() )
 					{
 						tmp = GetTopologyCheck(DUPLICATE_CELL | DUPLICATE_FACE | DUPLICATE_EDGE); //we expect not to have duplicates
@@ -898,6 +1807,9 @@ namespace INMOST
 				tags.resize(header[6]);
         tags_sparse.resize(header[6]);
         tags_defined.resize(header[6]);
+				tags_name.resize(header[6]);
+				tags_type.resize(header[6]);
+				tags_length.resize(header[6]);
 				//~ if( static_cast<Mesh::MeshState>(header[7]) == Mesh::Parallel && m_state != Mesh::Parallel)
 					//~ SetCommunicator(INMOST_MPI_COMM_WORLD);
 				myprocs.push_back(header[8]);
@@ -930,11 +1842,15 @@ namespace INMOST
           //}
 					uconv.read_iValue(in,datalength);
           REPORT_VAL("length",datalength);
-					tags[i] = CreateTag(std::string(name),static_cast<DataType>(datatype),
-						                  static_cast<ElementType>(definedmask),
-						                  static_cast<ElementType>(sparsemask),datalength);
           tags_defined[i] = static_cast<ElementType>(definedmask);
           tags_sparse[i] = static_cast<ElementType>(sparsemask);
+					tags_name[i] = std::string(name);
+					tags_type[i] = static_cast<DataType>(datatype);
+					tags_length[i] = datalength;
+					//tags that are not selected are not created
+					if( !select_tags || load_tags.count(tags_name[i]) || tags_name[i].compare(0,10,"PROTECTED_") == 0 )
+						tags[i] = CreateTag(tags_name[i],tags_type[i],tags_defined[i],tags_sparse[i],datalength);
+					else tags[i] = Tag();
 
           REPORT_VAL("output position, tag " << i,in.tellg());
 				}
@@ -949,17 +1865,7 @@ namespace INMOST
 				for(i = 0; i < size; i++) 
 				{
 					for(unsigned int k = 0; k < current_dim; k++) iconv.read_fValue(in,coords[k]);
-					int find = -1;
-					if( !old_nodes.empty() ) 
-					{
-						std::vector<HandleType>::iterator it = std::lower_bound(old_nodes.begin(),old_nodes.end(),coords,CentroidComparator(this));
-						if( it != old_nodes.end() ) 
-						{
-							Storage::real_array c = RealArrayDF(*it,CoordsTag());
-							if( CentroidComparator(this).Compare(coords,c.data()) == 0 )
-								find = static_cast<int>(it - old_nodes.begin());
-						}
-					}
+					int find = matcher.Find(coords);
 					if( find == -1 ) new_nodes[i] = CreateNode(coords)->GetHandle();
 					else  new_nodes[i] = old_nodes[find];
 				}
@@ -1130,9 +2036,10 @@ namespace INMOST
 
         REPORT_VAL("output position, sets",in.tellg());
 			}
-			else if (token == INMOST::MeshDataHeader)
+			else if (token == INMOST::MeshDataHeader || token == INMOST::MeshDataIndexHeader)
 			{
 				REPORT_STR("MeshDataHeader");
+				bool indexed = (token == INMOST::MeshDataIndexHeader);
 				HandleType m_storage = GetHandle();
 				INMOST_DATA_ENUM_TYPE elem_sizes[6] =
 				{
@@ -1154,143 +2061,26 @@ namespace INMOST
 				};
 				for(INMOST_DATA_ENUM_TYPE j = 0; j < tags.size(); j++) 
 				{
-					REPORT_VAL("TagName",tags[j].GetTagName());
-					if( verbosity > 0 ) std::cout << "Reading " << tags[j].GetTagName() << std::endl;
-					Tag * jt = &tags[j];
-					for(ElementType etype = NODE; etype <= MESH; etype = etype << 1)
+					REPORT_VAL("TagName",tags_name[j]);
+					if( indexed )
 					{
-						if( etype & tags_defined[j] )
+						char entry[8];
+						in.read(entry,8);
+						if( !tags[j].isValid() )
 						{
-              REPORT_VAL("defined on",ElementTypeName(etype));
-							INMOST_DATA_ENUM_TYPE q, cycle_end, etypenum = ElementNum(etype);
-							cycle_end = elem_sizes[etypenum];
-              REPORT_VAL("cycle end",cycle_end);
-							bool sparse = false;
-              if( etype & tags_sparse[j] ) sparse = true;
-							INMOST_DATA_ENUM_TYPE tagsize = jt->GetSize(), recsize = tagsize, lid;
-							INMOST_DATA_ENUM_TYPE k;
-							DataType data_type = jt->GetDataType();
-							if( sparse ) 
-							{
-                REPORT_VAL("sparse on",ElementTypeName(etype));
-								uconv.read_iValue(in,q); 
-								if( in.eof() ) std::cout << __FILE__ << ":" << __LINE__ << " Unexpected end of file! " << tags[j].GetTagName() << " " << ElementTypeName(etype) << " " << (sparse? "sparse" : "dense") << std::endl;
-							}
-							else q = 0;
-
-              REPORT_VAL("data type",DataTypeName(data_type));
-              REPORT_VAL("tag size",tagsize);
-
-							while(q != cycle_end)
-							{
-								HandleType he = elem_links[etypenum][q];
-								if( tagsize == ENUMUNDEF ) 
-								{
-									uconv.read_iValue(in,recsize); 
-									if( in.eof() ) std::cout << __FILE__ << ":" << __LINE__ << " Unexpected end of file! " << tags[j].GetTagName() << " " << ElementTypeName(etype) << " " << (sparse? "sparse" : "dense") << std::endl;
-									SetDataSize(he,*jt,recsize);
-								}
-								switch(data_type)
-								{
-								case DATA_REAL:
-									{
-										Storage::real_array arr = RealArray(he,*jt);
-										for(k = 0; k < recsize; k++) 
-										{
-											iconv.read_fValue(in,arr[k]); 
-											if( in.eof() ) std::cout << __FILE__ << ":" << __LINE__ << " Unexpected end of file! " << tags[j].GetTagName() << " " << ElementTypeName(etype) << " " << (sparse? "sparse" : "dense") << std::endl;
-										}
-									} break;
-								case DATA_INTEGER:   
-									{
-										Storage::integer_array arr = IntegerArray(he,*jt); 
-										for(k = 0; k < recsize; k++) 
-										{
-											iconv.read_iValue(in,arr[k]); 
-											if( in.eof() ) std::cout << __FILE__ << ":" << __LINE__ << " Unexpected end of file! " << tags[j].GetTagName() << " " << ElementTypeName(etype) << " " << (sparse? "sparse" : "dense") << std::endl;
-										}
-									} break;
-								case DATA_BULK:      
-									{
-										in.read(reinterpret_cast<char *>(&Bulk(he,*jt)),recsize);
-										if( in.eof() ) std::cout << __FILE__ << ":" << __LINE__ << " Unexpected end of file! " << tags[j].GetTagName() << " " << ElementTypeName(etype) << " " << (sparse? "sparse" : "dense") << std::endl;
-									} break;
-								case DATA_REFERENCE: 
-									{
-										Storage::reference_array arr = ReferenceArray(he,*jt);
-										for(k = 0; k < recsize; k++)
-										{
-											char type;
-											in.get(type);
-											if( in.eof() ) std::cout << __FILE__ << ":" << __LINE__ << " Unexpected end of file! " << tags[j].GetTagName() << " " << ElementTypeName(etype) << " " << (sparse? "sparse" : "dense") << std::endl;
-											if (type != NONE)
-											{
-												uconv.read_iValue(in, lid);
-												if( in.eof() ) std::cout << __FILE__ << ":" << __LINE__ << " Unexpected end of file! " << tags[j].GetTagName() << " " << ElementTypeName(etype) << " " << (sparse? "sparse" : "dense") << std::endl;
-												arr.at(k) = elem_links[ElementNum(type)][lid];
-											}
-											else arr.at(k) = InvalidHandle();
-										}
-									} break;
-                case DATA_REMOTE_REFERENCE: 
-									{
-										Storage::remote_reference_array arr = RemoteReferenceArray(he,*jt);
-										for(k = 0; k < recsize; k++)
-										{
-                      INMOST_DATA_ENUM_TYPE size;
-                      std::vector<char> name;
-                      uconv.read_iValue(in,size);
-                      name.resize(size);
-                      if( !name.empty() ) in.read(&name[0],size);
-                      else std::cout << __FILE__ << ":" << __LINE__ << " Mesh of the name was not specified" << std::endl;
-                      arr.at(k).first = GetMesh(std::string(name.begin(),name.end()));
-                      if( arr.at(k).first == NULL )
-                        std::cout << __FILE__ << ":" << __LINE__ << " Mesh with the name " << std::string(name.begin(),name.end()) << " do not exist, you should create the mesh with this name first" << std::endl;
-											char type;
-											in.get(type);
-											if( in.eof() ) std::cout << __FILE__ << ":" << __LINE__ << " Unexpected end of file! " << tags[j].GetTagName() << " " << ElementTypeName(etype) << " " << (sparse? "sparse" : "dense") << std::endl;
-											if (type != NONE)
-											{
-												uconv.read_iValue(in, lid);
-												if( in.eof() ) std::cout << __FILE__ << ":" << __LINE__ << " Unexpected end of file! " << tags[j].GetTagName() << " " << ElementTypeName(etype) << " " << (sparse? "sparse" : "dense") << std::endl;
-                        arr.at(k).second = ComposeHandle(type,lid);
-											}
-                      else arr.at(k).second = InvalidHandle();
-										}
-									} break;
-#if defined(USE_AUTODIFF)
-                case DATA_VARIABLE:
-                  {
-                    Storage::var_array arr = VariableArray(he,*jt);
-                    Storage::real val;
-                    Storage::integer ival;
-                    for(k = 0; k < recsize; k++)
-                    {
-                      Sparse::Row & r = arr[k].GetRow();
-                      iconv.read_fValue(in,val);
-                      arr[k].SetValue(val);
-                      iconv.read_iValue(in,ival);
-                      r.Resize(ival);
-                      for(int l = 0; l < (int)r.Size(); ++l)
-                      {
-                        iconv.read_fValue(in,val);
-                        iconv.read_iValue(in,ival);
-                        r.GetValue(l) = val;
-                        r.GetIndex(l) = ival;
-                      }
-                    }
-                  } break;
-#endif
-								}
-								if( sparse ) 
-								{
-									uconv.read_iValue(in,q); 
-									if( in.eof() ) std::cout << __FILE__ << ":" << __LINE__ << " Unexpected end of file! " << tags[j].GetTagName() << " " << ElementTypeName(etype) << " " << (sparse? "sparse" : "dense") << std::endl;
-								}
-								else q++;
-							}
+							REPORT_VAL("skip section",pmf_read_offset(entry));
+							inbuf->skip(static_cast<size_t>(pmf_read_offset(entry)));
+							continue;
 						}
 					}
+					else if( !tags[j].isValid() )
+					{
+						//without the size of the section the data has to be parsed
+						tags[j] = CreateTag(tags_name[j],tags_type[j],tags_defined[j],tags_sparse[j],tags_length[j]);
+						tags_dropped.push_back(tags[j]);
+					}
+					if( verbosity > 0 ) std::cout << "Reading " << tags[j].GetTagName() << std::endl;
+					pmf_read_tag_data(this,in,tags[j],tags_defined[j],tags_sparse[j],elem_links,elem_sizes,iconv,uconv);
 
           REPORT_VAL("output position, tag data " << j,in.tellg());
 				}
@@ -1305,6 +2095,16 @@ namespace INMOST
 				throw BadFile;
 			}
 		}
+		inbuf->finish();
+		if( fin.is_open() ) fin.close();
+#if defined(USE_MPI) && defined(USE_MPI_FILE)
+		if( close_fh )
+		{
+			int ierr;
+			REPORT_MPI(ierr = MPI_File_close(&fh));
+			if( ierr != MPI_SUCCESS ) REPORT_MPI(MPI_Abort(GetCommunicator(),__LINE__));
+		}
+#endif
 			
 			
 			
@@ -1403,6 +2203,9 @@ namespace INMOST
 #endif
 		}
 		EndModification();
+		
+		for(size_t k = 0; k < tags_dropped.size(); ++k)
+			if( tags_dropped[k].isValid() && HaveTag(tags_dropped[k].GetTagName()) ) DeleteTag(tags_dropped[k]);
 			
 		//~ PrepareGeometricData(table);
 		RestoreGeometricTags();
@@ -1442,6 +2245,192 @@ namespace INMOST
 		}
 #endif
 	}
+
+	/// Each processor appends the steps of the series into it's own file.
+	static std::string pmf_series_steps(const std::string & File, int rank, int size)
+	{
+		if( size == 1 ) return File + ".steps";
+		std::stringstream name;
+		name << File << "." << rank << ".steps";
+		return name.str();
+	}
+
+	void Mesh::CreateSeries(std::string File)
+	{
+		Save(File);
+		std::fstream fout(pmf_series_steps(File,GetProcessorRank(),GetProcessorsNumber()).c_str(),std::ios::out | std::ios::binary | std::ios::trunc);
+		if( fout.fail() ) throw BadFileName;
+		fout.close();
+	}
+
+	void Mesh::AppendSeries(std::string File, const std::vector<Tag> & tags, real time)
+	{
+		io_converter<INMOST_DATA_INTEGER_TYPE,INMOST_DATA_REAL_TYPE> iconv;
+		io_converter<INMOST_DATA_ENUM_TYPE   ,INMOST_DATA_REAL_TYPE> uconv;
+		std::fstream fout(pmf_series_steps(File,GetProcessorRank(),GetProcessorsNumber()).c_str(),std::ios::in | std::ios::out | std::ios::binary | std::ios::ate);
+		if( fout.fail() ) throw BadFileName;
+		unsigned long long start = static_cast<unsigned long long>(fout.tellp()), size = 0;
+		char entry[8];
+		//the size of the record is known after it is written
+		pmf_write_offset(entry,0);
+		fout.write(entry,8);
+		Tag set_id = CreateTag("TEMPORARY_ELEMENT_ID_PMF_WRITER",DATA_INTEGER,ESET|CELL|FACE|EDGE|NODE,NONE,1);
+		for(ElementType etype = NODE; etype <= ESET; etype = NextElementType(etype))
+		{
+			Storage::integer cur_num = 0;
+			for(Mesh::iteratorStorage it = Begin(etype); it != End(); ++it) it->IntegerDF(set_id) = cur_num++;
+		}
+		{
+			pmf_stream_output buf(fout,pmf_buffer_size(file_options));
+			std::ostream out(&buf);
+			uconv.write_iByteOrder(out);
+			uconv.write_iByteSize(out);
+			iconv.write_iByteOrder(out);
+			iconv.write_iByteSize(out);
+			iconv.write_fByteOrder(out);
+			iconv.write_fByteSize(out);
+			iconv.write_fValue(out,time);
+			INMOST_DATA_ENUM_TYPE header[6] =
+			{
+				static_cast<INMOST_DATA_ENUM_TYPE>(NumberOfNodes()),
+				static_cast<INMOST_DATA_ENUM_TYPE>(NumberOfEdges()),
+				static_cast<INMOST_DATA_ENUM_TYPE>(NumberOfFaces()),
+				static_cast<INMOST_DATA_ENUM_TYPE>(NumberOfCells()),
+				static_cast<INMOST_DATA_ENUM_TYPE>(NumberOfSets()),
+				static_cast<INMOST_DATA_ENUM_TYPE>(tags.size())
+			};
+			for(int k = 0; k < 6; k++) uconv.write_iValue(out,header[k]);
+			for(size_t k = 0; k < tags.size(); ++k)
+			{
+				std::string name = tags[k].GetTagName();
+				ElementType sparsemask = NONE, definedmask = NONE;
+				for(ElementType etype = NODE; etype <= MESH; etype = etype << 1)
+				{
+					if( tags[k].isSparse (etype) ) sparsemask  |= etype;
+					if( tags[k].isDefined(etype) ) definedmask |= etype;
+				}
+				uconv.write_iValue(out,static_cast<INMOST_DATA_ENUM_TYPE>(name.size()));
+				out.write(name.c_str(),name.size());
+				out.put(static_cast<INMOST_DATA_BULK_TYPE>(tags[k].GetDataType()));
+				out.put(sparsemask);
+				out.put(definedmask);
+				uconv.write_iValue(out,tags[k].GetSize());
+			}
+			for(size_t k = 0; k < tags.size(); ++k)
+				pmf_write_tag_data(this,out,tags[k],set_id);
+			buf.flush_chunk();
+			size = buf.total();
+		}
+		DeleteTag(set_id);
+		fout.seekp(static_cast<std::streamoff>(start));
+		pmf_write_offset(entry,size);
+		fout.write(entry,8);
+		fout.close();
+	}
+
+	/// Read the common part of the record of the step up to the number of tags.
+	static Storage::real pmf_series_header(std::istream & in, io_converter<INMOST_DATA_INTEGER_TYPE,INMOST_DATA_REAL_TYPE> & iconv, io_converter<INMOST_DATA_ENUM_TYPE,INMOST_DATA_REAL_TYPE> & uconv)
+	{
+		Storage::real time = 0;
+		uconv.read_iByteOrder(in);
+		uconv.read_iByteSize(in);
+		iconv.read_iByteOrder(in);
+		iconv.read_iByteSize(in);
+		iconv.read_fByteOrder(in);
+		iconv.read_fByteSize(in);
+		iconv.read_fValue(in,time);
+		if( in.fail() ) throw BadFile;
+		return time;
+	}
+
+	std::vector<Storage::real> Mesh::GetSeriesTimes(std::string File)
+	{
+		io_converter<INMOST_DATA_INTEGER_TYPE,INMOST_DATA_REAL_TYPE> iconv;
+		io_converter<INMOST_DATA_ENUM_TYPE   ,INMOST_DATA_REAL_TYPE> uconv;
+		std::vector<real> ret;
+		std::fstream fin(pmf_series_steps(File,GetProcessorRank(),GetProcessorsNumber()).c_str(),std::ios::in | std::ios::binary);
+		if( fin.fail() ) throw BadFileName;
+		char entry[8];
+		while( fin.read(entry,8) )
+		{
+			unsigned long long size = pmf_read_offset(entry);
+			std::streamoff next = static_cast<std::streamoff>(fin.tellg()) + static_cast<std::streamoff>(size);
+			ret.push_back(pmf_series_header(fin,iconv,uconv));
+			fin.seekg(next);
+		}
+		fin.close();
+		return ret;
+	}
+
+	Storage::real Mesh::LoadSeries(std::string File, enumerator step)
+	{
+		io_converter<INMOST_DATA_INTEGER_TYPE,INMOST_DATA_REAL_TYPE> iconv;
+		io_converter<INMOST_DATA_ENUM_TYPE   ,INMOST_DATA_REAL_TYPE> uconv;
+		std::fstream fin(pmf_series_steps(File,GetProcessorRank(),GetProcessorsNumber()).c_str(),std::ios::in | std::ios::binary);
+		if( fin.fail() ) throw BadFileName;
+		char entry[8];
+		//jump over the records of previous steps
+		for(enumerator k = 0; k < step; ++k)
+		{
+			if( !fin.read(entry,8) ) throw BadFile;
+			fin.seekg(static_cast<std::streamoff>(pmf_read_offset(entry)),std::ios::cur);
+		}
+		if( !fin.read(entry,8) ) throw BadFile;
+		size_t size = static_cast<size_t>(pmf_read_offset(entry));
+		pmf_stream_input buf(fin,size,pmf_buffer_size(file_options));
+		std::istream in(&buf);
+		real time = pmf_series_header(in,iconv,uconv);
+		INMOST_DATA_ENUM_TYPE header[6];
+		for(int k = 0; k < 6; k++) uconv.read_iValue(in,header[k]);
+		//the data is stored in the order of elements of the mesh loaded from the series
+		if( header[0] != static_cast<INMOST_DATA_ENUM_TYPE>(NumberOfNodes()) ||
+			header[1] != static_cast<INMOST_DATA_ENUM_TYPE>(NumberOfEdges()) ||
+			header[2] != static_cast<INMOST_DATA_ENUM_TYPE>(NumberOfFaces()) ||
+			header[3] != static_cast<INMOST_DATA_ENUM_TYPE>(NumberOfCells()) ||
+			header[4] != static_cast<INMOST_DATA_ENUM_TYPE>(NumberOfSets()) ) throw BadFile;
+		std::vector<HandleType> elements[5];
+		for(ElementType etype = NODE; etype <= ESET; etype = NextElementType(etype))
+		{
+			elements[ElementNum(etype)].reserve(header[ElementNum(etype)]);
+			for(Mesh::iteratorStorage it = Begin(etype); it != End(); ++it) elements[ElementNum(etype)].push_back(it->GetHandle());
+		}
+		HandleType m_storage = GetHandle();
+		HandleType * elem_links[6];
+		for(int k = 0; k < 5; k++) elem_links[k] = elements[k].empty() ? NULL : &elements[k][0];
+		elem_links[5] = &m_storage;
+		INMOST_DATA_ENUM_TYPE elem_sizes[6] = {header[0],header[1],header[2],header[3],header[4],1};
+		std::vector<Tag> tags(header[5]);
+		std::vector<ElementType> tags_defined(header[5]), tags_sparse(header[5]);
+		for(INMOST_DATA_ENUM_TYPE k = 0; k < header[5]; ++k)
+		{
+			INMOST_DATA_ENUM_TYPE namesize, datalength;
+			char datatype, sparsemask, definedmask;
+			uconv.read_iValue(in,namesize);
+			std::vector<char> name(namesize+1,'\0');
+			in.read(&name[0],namesize);
+			in.get(datatype);
+			in.get(sparsemask);
+			in.get(definedmask);
+			uconv.read_iValue(in,datalength);
+			if( in.fail() ) throw BadFile;
+			tags[k] = CreateTag(std::string(&name[0]),static_cast<DataType>(datatype),
+			                    static_cast<ElementType>(definedmask),
+			                    static_cast<ElementType>(sparsemask),datalength);
+			tags_defined[k] = static_cast<ElementType>(definedmask);
+			tags_sparse[k] = static_cast<ElementType>(sparsemask);
+			//sparse data of the previous step should not remain
+			for(ElementType etype = NODE; etype <= MESH; etype = NextElementType(etype)) if( tags_sparse[k] & etype )
+			{
+				for(INMOST_DATA_ENUM_TYPE q = 0; q < elem_sizes[ElementNum(etype)]; ++q)
+					DelSparseData(elem_links[ElementNum(etype)][q],tags[k]);
+			}
+		}
+		for(INMOST_DATA_ENUM_TYPE k = 0; k < header[5]; ++k)
+			pmf_read_tag_data(this,in,tags[k],tags_defined[k],tags_sparse[k],elem_links,elem_sizes,iconv,uconv);
+		if( in.fail() ) throw BadFile;
+		fin.close();
+		return time;
+	}
 }
 
 #endif
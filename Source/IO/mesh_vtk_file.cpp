@@ -4,6 +4,7 @@
 
 
 #include "inmost.h"
+#include "io.hpp"
 #include <cfloat>
 
 #if defined(USE_MESH)
@@ -32,11 +33,23 @@ static int __isnan__(double x) { return x != x; }
 static int __isinf__(double x) { return fabs(x) > DBL_MAX; }
 static int __isbad(double x) { return __isnan__(x) || __isinf__(x); }
 
+/// Binary legacy vtk files are big endian, read one value and convert it to the native order.
 template<typename T>
-void ReadCoords(FILE * f,INMOST_DATA_REAL_TYPE c[3])
+static bool VtkReadBinary(INMOST::io_tokenizer & in, T & val)
+{
+	unsigned char bytes[sizeof(T)];
+	if( in.read(bytes,sizeof(T),1) != 1 ) return false;
+	int one = 1;
+	if( *reinterpret_cast<char *>(&one) ) std::reverse(bytes,bytes+sizeof(T));
+	memcpy(&val,bytes,sizeof(T));
+	return true;
+}
+
+template<typename T>
+void ReadCoords(INMOST::io_tokenizer & in,INMOST_DATA_REAL_TYPE c[3])
 {
 	T temp[3];
-	if( fread(temp,sizeof(T),3,f) == 3 )
+	if( VtkReadBinary(in,temp[0]) && VtkReadBinary(in,temp[1]) && VtkReadBinary(in,temp[2]) )
 	{
 		c[0] = temp[0];
 		c[1] = temp[1];
@@ -49,6 +62,36 @@ void ReadCoords(FILE * f,INMOST_DATA_REAL_TYPE c[3])
 	}
 }
 
+template<typename B, typename T>
+static bool VtkReadBinaryAs(INMOST::io_tokenizer & in, T & val)
+{
+	B temp;
+	if( !VtkReadBinary(in,temp) ) return false;
+	val = static_cast<T>(temp);
+	return true;
+}
+
+/// Read one value of data attribute with the type given in lower case by the file.
+template<typename T>
+static bool VtkReadValue(INMOST::io_tokenizer & in, bool binary, const char * type, T & val)
+{
+	if( !binary )
+	{
+		if( !strcmp(type,"float") || !strcmp(type,"double") ) return in.read_real(val);
+		return in.read_integer(val);
+	}
+	if( !strcmp(type,"double") ) return VtkReadBinaryAs<double>(in,val);
+	if( !strcmp(type,"float") ) return VtkReadBinaryAs<float>(in,val);
+	if( !strcmp(type,"int") ) return VtkReadBinaryAs<int>(in,val);
+	if( !strcmp(type,"unsigned_int") ) return VtkReadBinaryAs<unsigned int>(in,val);
+	if( !strcmp(type,"short") ) return VtkReadBinaryAs<short>(in,val);
+	if( !strcmp(type,"unsigned_short") ) return VtkReadBinaryAs<unsigned short>(in,val);
+	if( !strcmp(type,"long") ) return VtkReadBinaryAs<long>(in,val);
+	if( !strcmp(type,"unsigned_long") ) return VtkReadBinaryAs<unsigned long>(in,val);
+	if( !strcmp(type,"char") ) return VtkReadBinaryAs<char>(in,val);
+	return VtkReadBinaryAs<unsigned char>(in,val); //bit and unsigned_char
+}
+
 namespace INMOST
 {
 
@@ -101,6 +144,40 @@ namespace INMOST
 		assert(false);
 		return ENUMUNDEF;
 	}
+
+	/// Binary legacy vtk files are big endian, 4-byte integers and 8-byte doubles.
+	template<typename T>
+	static void VtkWriteBinary(FILE * f, T val)
+	{
+		unsigned char bytes[sizeof(T)];
+		memcpy(bytes,&val,sizeof(T));
+		int one = 1;
+		if( *reinterpret_cast<char *>(&one) ) std::reverse(bytes,bytes+sizeof(T));
+		fwrite(bytes,1,sizeof(T),f);
+	}
+
+	static void VtkWriteReal(FILE * f, double val, bool binary)
+	{
+		if( binary ) VtkWriteBinary<double>(f,val);
+		else fprintf(f,"%14e ",val);
+	}
+
+	static void VtkWriteInteger(FILE * f, int val, bool binary)
+	{
+		if( binary ) VtkWriteBinary<int>(f,val);
+		else fprintf(f,"%d ",val);
+	}
+
+	static void VtkWriteType(FILE * f, int val, bool binary)
+	{
+		if( binary ) VtkWriteBinary<int>(f,val);
+		else fprintf(f,"%d\n",val);
+	}
+
+	static void VtkWriteLine(FILE * f, bool binary)
+	{
+		if( !binary ) fprintf(f,"\n");
+	}
 	
 
   void Mesh::SaveVTK(std::string File)
@@ -111,12 +188,13 @@ namespace INMOST
 			printf("VTK file supports 3 dimensions max\n");
 			return;
 		}
-		FILE * f = fopen(File.c_str(),"w");
+		bool binary = (GetFileOption("VTK_BINARY") == "1");
+		FILE * f = fopen(File.c_str(),binary ? "wb" : "w");
 		if( !f ) throw BadFileName;
 		fprintf(f,"# vtk DataFile Version 3.0\n");
 		if (this->GetFileOption("VTK_OUTPUT_FACES") == "1") fprintf(f, "VTK_OUTPUT_FACES file is written by INMOST\n");
 		else fprintf(f,"file is written by INMOST\n");
-		fprintf(f,"ASCII\n");
+		fprintf(f,binary ? "BINARY\n" : "ASCII\n");
 		fprintf(f,"DATASET UNSTRUCTURED_GRID\n");
 
 		bool output_faces = false;
@@ -142,6 +220,12 @@ namespace INMOST
 		for(Mesh::iteratorNode it = BeginNode(); it != EndNode(); it++)
 		{
 			Storage::real_array coords = it->RealArray(CoordsTag());
+			if( binary )
+			{
+				for(integer i = 0; i < 3; i++)
+					VtkWriteBinary<double>(f,i < dim ? static_cast<double>(coords[i]) : 0.0);
+				continue;
+			}
 			for(integer i = 0; i < dim; i++) 
 			{
 				double temp = coords[i];
@@ -151,6 +235,7 @@ namespace INMOST
 				fprintf(f,"0 ");
 			fprintf(f,"\n");
 		}
+		if( binary ) fprintf(f,"\n");
 		{
 			dynarray<int,64> values;
 			for(Mesh::iteratorCell it = BeginCell(); it != EndCell(); it++)
@@ -289,8 +374,8 @@ safe_output:
 
 			for(dynarray<Storage::integer,64>::size_type i = 0; i < values.size(); i++)
 			{
-				fprintf(f,"%d ",values[i]);
-				if( (i+1) % 20 == 0) fprintf(f,"\n");
+				VtkWriteInteger(f,values[i],binary);
+				if( (i+1) % 20 == 0) VtkWriteLine(f,binary);
 			}
 			fprintf(f,"\n");
 		}
@@ -304,20 +389,21 @@ safe_output:
 		{
 			INMOST_DATA_ENUM_TYPE nnodes = VtkElementNodes(it->GetGeometricType());
 			if( nnodes == ENUMUNDEF || nnodes == it->nbAdjElements(NODE) ) //nodes match - output correct type
-				fprintf(f,"%d\n",VtkElementType(it->GetGeometricType()));
+				VtkWriteType(f,VtkElementType(it->GetGeometricType()),binary);
 			else //number of nodes mismatch with expected - some topology checks must be off
-				fprintf(f,"%d\n",VtkElementType(Element::MultiPolygon));
+				VtkWriteType(f,VtkElementType(Element::MultiPolygon),binary);
 		}
 		if (output_faces){
 			for (Mesh::iteratorFace it = BeginFace(); it != EndFace(); it++)
 			{
 				INMOST_DATA_ENUM_TYPE nnodes = VtkElementNodes(it->GetGeometricType());
 				if (nnodes == ENUMUNDEF || nnodes == it->nbAdjElements(NODE)) //nodes match - output correct type
-					fprintf(f, "%d\n", VtkElementType(it->GetGeometricType()));
+					VtkWriteType(f,VtkElementType(it->GetGeometricType()),binary);
 				else //number of nodes mismatch with expected - some topology checks must be off
-					fprintf(f, "%d\n", VtkElementType(Element::MultiPolygon));
+					VtkWriteType(f,VtkElementType(Element::MultiPolygon),binary);
 			}
 		}
+		if( binary ) fprintf(f,"\n");
 		DeleteTag(set_id);
 		{
 			std::vector<std::string> tag_names;
@@ -379,11 +465,11 @@ safe_output:
 												  for (unsigned int m = 0; m < comps; m++)
 												  {
 													  double val = static_cast<double>(arr[m]);
-													  fprintf(f, "%14e ", __isbad(val) ? -0.9999E30 : val);
+													  VtkWriteReal(f, __isbad(val) ? -0.9999E30 : val, binary);
 												  }
 											  }
-											  else for (unsigned int m = 0; m < comps; m++) fprintf(f, "%14e ", -0.9999E30);
-											  fprintf(f, "\n");
+											  else for (unsigned int m = 0; m < comps; m++) VtkWriteReal(f, -0.9999E30, binary);
+											  VtkWriteLine(f, binary);
 							}
 								break;
 							case DATA_INTEGER:
@@ -391,10 +477,10 @@ safe_output:
 												 if (tags[i].isDefined(CELL))
 												 {
 													 Storage::integer_array arr = it->IntegerArray(tags[i]);
-													 for (unsigned int m = 0; m < comps; m++) fprintf(f, "%d ", arr[m]);
+													 for (unsigned int m = 0; m < comps; m++) VtkWriteInteger(f, arr[m], binary);
 												 }
-												 else for (unsigned int m = 0; m < comps; m++) fprintf(f, "%d ",INT_MIN);
-												 fprintf(f, "\n");
+												 else for (unsigned int m = 0; m < comps; m++) VtkWriteInteger(f, INT_MIN, binary);
+												 VtkWriteLine(f, binary);
 							}
 								break;
 #if defined(USE_AUTODIFF)
@@ -406,11 +492,11 @@ safe_output:
 													  for (unsigned int m = 0; m < comps; m++)
 													  {
 														  double val = static_cast<double>(arr[m].GetValue());
-														  fprintf(f, "%14e ", __isbad(val) ? -0.9999E30 : val);
+														  VtkWriteReal(f, __isbad(val) ? -0.9999E30 : val, binary);
 													  }
 												  }
-												  else for (unsigned int m = 0; m < comps; m++) fprintf(f, "%14e ", -0.9999E30);
-												  fprintf(f, "\n");
+												  else for (unsigned int m = 0; m < comps; m++) VtkWriteReal(f, -0.9999E30, binary);
+												  VtkWriteLine(f, binary);
 							}
 								break;
 #endif
@@ -430,10 +516,10 @@ safe_output:
 												  if (tags[i].isDefined(FACE))
 												  {
 													  Storage::real_array arr = it->RealArray(tags[i]);
-													  for (unsigned int m = 0; m < comps; m++) fprintf(f, "%14e ", arr[m]);
+													  for (unsigned int m = 0; m < comps; m++) VtkWriteReal(f, arr[m], binary);
 												  }
-												  else for (unsigned int m = 0; m < comps; m++) fprintf(f, "%14e ", -0.9999E30);
-												  fprintf(f, "\n");
+												  else for (unsigned int m = 0; m < comps; m++) VtkWriteReal(f, -0.9999E30, binary);
+												  VtkWriteLine(f, binary);
 								}
 									break;
 								case DATA_INTEGER:
@@ -441,10 +527,10 @@ safe_output:
 													 if (tags[i].isDefined(FACE))
 													 {
 														 Storage::integer_array arr = it->IntegerArray(tags[i]);
-														 for (unsigned int m = 0; m < comps; m++) fprintf(f, "%d ", arr[m]);
+														 for (unsigned int m = 0; m < comps; m++) VtkWriteInteger(f, arr[m], binary);
 													 }
-													 else for (unsigned int m = 0; m < comps; m++) fprintf(f, "%d ",INT_MIN);
-													 fprintf(f, "\n");
+													 else for (unsigned int m = 0; m < comps; m++) VtkWriteInteger(f, INT_MIN, binary);
+													 VtkWriteLine(f, binary);
 								}
 									break;
 #if defined(USE_AUTODIFF)
@@ -456,11 +542,11 @@ safe_output:
 														  for (unsigned int m = 0; m < comps; m++)
 														  {
 															  double val = static_cast<double>(arr[m].GetValue());
-															  fprintf(f, "%14e ", __isbad(val) ? -0.9999E30 : val);
+															  VtkWriteReal(f, __isbad(val) ? -0.9999E30 : val, binary);
 														  }
 													  }
-													  else for (unsigned int m = 0; m < comps; m++) fprintf(f, "%14e ", -0.9999E30);
-													  fprintf(f, "\n");
+													  else for (unsigned int m = 0; m < comps; m++) VtkWriteReal(f, -0.9999E30, binary);
+													  VtkWriteLine(f, binary);
 								}
 									break;
 #endif
@@ -468,6 +554,7 @@ safe_output:
 								}
 							}
 						}
+						if( binary ) fprintf(f,"\n");
 					}
 				}
 			}
@@ -521,16 +608,16 @@ safe_output:
 									for(unsigned int m = 0; m < comps; m++) 
 									{
 										double val = static_cast<double>(arr[m]);
-										fprintf(f,"%14e ",(__isbad(val) ? -0.9999E30 : val));
+										VtkWriteReal(f, __isbad(val) ? -0.9999E30 : val, binary);
 									}
-									fprintf(f,"\n");
+									VtkWriteLine(f,binary);
 								}
 								break;
 								case DATA_INTEGER:
 								{
 									Storage::integer_array arr = it->IntegerArray(tags[i]);
-									for(unsigned int m = 0; m < comps; m++) fprintf(f,"%d ",arr[m]);
-									fprintf(f,"\n");
+									for(unsigned int m = 0; m < comps; m++) VtkWriteInteger(f, arr[m], binary);
+									VtkWriteLine(f,binary);
 								}
 								break;
 #if defined(USE_AUTODIFF)
@@ -540,15 +627,16 @@ safe_output:
 									for(unsigned int m = 0; m < comps; m++) 
 									{
 										double val = static_cast<double>(arr[m].GetValue());
-										fprintf(f,"%14e ",(__isbad(val) ? -0.9999E30 : val));
+										VtkWriteReal(f, __isbad(val) ? -0.9999E30 : val, binary);
 									}
-									fprintf(f,"\n");
+									VtkWriteLine(f,binary);
 								}
 								break;
 #endif
 								default: continue;
 							}
 						}
+						if( binary ) fprintf(f,"\n");
 					}
 				}
 			}
@@ -597,6 +685,7 @@ safe_output:
 
 
 		std::vector<HandleType> old_nodes(NumberOfNodes());
+		NodeMatcher matcher(this);
 		{
 			unsigned qq = 0;
 			for(Mesh::iteratorNode it = BeginNode(); it != EndNode(); ++it)
@@ -604,7 +693,7 @@ safe_output:
 		}
 		if( !old_nodes.empty() ) 
 		{
-			std::sort(old_nodes.begin(),old_nodes.end(),CentroidComparator(this));
+			matcher.Build(old_nodes);
 			//for(std::vector<HandleType>::iterator it = old_nodes.begin(); it != old_nodes.end(); ++it)
 			//{
 			//	Storage::real_array c = RealArrayDF(*it,CoordsTag());
@@ -613,12 +702,13 @@ safe_output:
 		}
 
 			
-		FILE * f = fopen(File.c_str(),"r");
+		FILE * f = fopen(File.c_str(),"rb");
 		if( !f ) 
 		{
 			std::cout << __FILE__ << ":" << __LINE__ << " cannot open " << File << std::endl;
 			throw BadFileName;
 		}
+		io_tokenizer in(f);
 		std::vector<Tag> datatags;
 		std::vector<HandleType> newnodes;
 		std::vector<HandleType> newcells;
@@ -632,7 +722,7 @@ safe_output:
 		while( state != R_QUIT )
 		{
 				
-			if( fgets(readline,2048,f) == NULL )
+			if( !in.getline(readline,2048) )
 			{
 				state = R_QUIT;
 				continue;
@@ -715,7 +805,7 @@ safe_output:
 							std::cout << "expected one of: bit, unsigned_char, char, unsigned_short, short, unsigned_int, int, unsigned_long, long, float, double" << std::endl;
 							throw BadFile;
 						}
-						if( fgets(readline,2048,f) == NULL ) 
+						if( !in.getline(readline,2048) ) 
 						{
 							std::cout << __FILE__ << ":" << __LINE__ << " expected LOOKUP_TABLE in " << File << std::endl;
 							throw BadFile; //LOOK_UP TABLE
@@ -732,18 +822,18 @@ safe_output:
 									if( newcells[it] != InvalidHandle() )
 									{
 										Storage::integer_array attrdata = IntegerArray(newcells[it],attr);
-										for(int jt = 0; jt < nentries; jt++) {int temp; filled = fscanf(f," %d",&temp); if(filled != 1 ) throw BadFile; attrdata[jt] = temp;}
+										for(int jt = 0; jt < nentries; jt++) {int temp; if( !VtkReadValue(in,binary,attrtype,temp) ) throw BadFile; attrdata[jt] = temp;}
 									}
-									else for(int jt = 0; jt < nentries; jt++) {int temp; filled = fscanf(f," %d",&temp); if(filled != 1 ) throw BadFile;}
+									else for(int jt = 0; jt < nentries; jt++) {int temp; if( !VtkReadValue(in,binary,attrtype,temp) ) throw BadFile;}
 								}
 								if( t == DATA_REAL )
 								{
 									if( newcells[it] != InvalidHandle() )
 									{
 										Storage::real_array attrdata = RealArray(newcells[it],attr);
-										for(int jt = 0; jt < nentries; jt++) {double temp; filled = fscanf(f," %lf",&temp); if(filled != 1 ) throw BadFile; attrdata[jt] = temp;}
+										for(int jt = 0; jt < nentries; jt++) {double temp; if( !VtkReadValue(in,binary,attrtype,temp) ) throw BadFile; attrdata[jt] = temp;}
 									}
-									else for(int jt = 0; jt < nentries; jt++) {double temp; filled = fscanf(f," %lf",&temp); if(filled != 1 ) throw BadFile; }
+									else for(int jt = 0; jt < nentries; jt++) {double temp; if( !VtkReadValue(in,binary,attrtype,temp) ) throw BadFile; }
 								}
 								if( verbosity > 1 && it%report_pace == 0)
 								{
@@ -751,7 +841,7 @@ safe_output:
 									fflush(stdout);
 								}
 							}
-							filled = fscanf(f,"\n");
+							in.skip_space();
 							datatags.push_back(attr);
 						}
 						if( read_into == 1 )
@@ -763,12 +853,12 @@ safe_output:
 								if( t == DATA_INTEGER )
 								{
 									Storage::integer_array attrdata = IntegerArray(newnodes[it],attr);
-									for(int jt = 0; jt < nentries; jt++) {int temp; filled = fscanf(f," %d",&temp); if(filled != 1 ) throw BadFile; attrdata[jt] = temp;}
+									for(int jt = 0; jt < nentries; jt++) {int temp; if( !VtkReadValue(in,binary,attrtype,temp) ) throw BadFile; attrdata[jt] = temp;}
 								}
 								if( t == DATA_REAL )
 								{
 									Storage::real_array attrdata = RealArray(newnodes[it],attr);
-									for(int jt = 0; jt < nentries; jt++) {double temp; filled = fscanf(f," %lf",&temp); if(filled != 1 ) throw BadFile; attrdata[jt] = temp;}
+									for(int jt = 0; jt < nentries; jt++) {double temp; if( !VtkReadValue(in,binary,attrtype,temp) ) throw BadFile; attrdata[jt] = temp;}
 								}
 								if( verbosity > 1 && it%report_pace == 0)
 								{
@@ -776,7 +866,7 @@ safe_output:
 									fflush(stdout);
 								}
 							}
-							filled = fscanf(f,"\n");
+							in.skip_space();
 						}
 						break;
 					}
@@ -794,16 +884,16 @@ safe_output:
 								if( newcells[it] != InvalidHandle() )
 								{
 									Storage::real_array attrdata = RealArray(newcells[it],attr);
-									for(int jt = 0; jt < nentries; jt++) {double temp; filled = fscanf(f," %lf",&temp); if(filled != 1 ) throw BadFile; attrdata[jt] = temp;}
+									for(int jt = 0; jt < nentries; jt++) {double temp; if( !in.read_real(temp) ) throw BadFile; attrdata[jt] = temp;}
 								}
-								else for(int jt = 0; jt < nentries; jt++) {double temp; filled = fscanf(f," %lf",&temp); if(filled != 1 ) throw BadFile;}
+								else for(int jt = 0; jt < nentries; jt++) {double temp; if( !in.read_real(temp) ) throw BadFile;}
 								if( verbosity > 1 && it%100 == 0)
 								{
 									printf("data %3.1f%%\r",(it*report_pace)/(1.0*newcells.size()));
 									fflush(stdout);
 								}
 							}
-							filled = fscanf(f,"\n");
+							in.skip_space();
 							datatags.push_back(attr);
 						}
 						if( read_into == 1 )
@@ -813,14 +903,14 @@ safe_output:
 							for(unsigned int it = 0; it < newnodes.size(); it++)
 							{
 								Storage::real_array attrdata = RealArray(newnodes[it],attr);
-								for(int jt = 0; jt < nentries; jt++) {double temp; filled = fscanf(f," %lf",&temp); if(filled != 1 ) throw BadFile; attrdata[jt] = temp;}
+								for(int jt = 0; jt < nentries; jt++) {double temp; if( !in.read_real(temp) ) throw BadFile; attrdata[jt] = temp;}
 								if( verbosity > 1 && it%report_pace == 0)
 								{
 									printf("data %3.1f%%\r",(it*100.0)/(1.0*newnodes.size()));
 									fflush(stdout);
 								}
 							}
-							filled = fscanf(f,"\n");
+							in.skip_space();
 						}
 						break;
 					}
@@ -831,9 +921,10 @@ safe_output:
 						if( filled != 1 ) throw BadFile;
 						for(int i = 0; i < nentries; i++)
 						{
-							filled = fscanf(f," %*f %*f %*f %*f");
+							double rgba;
+							for(int q = 0; q < 4; q++) if( !in.read_real(rgba) ) throw BadFile;
 						}
-						filled = fscanf(f,"\n");
+						in.skip_space();
 						break;
 					}
 					else if( !strcmp(dataname,"NORMALS") || !strcmp(dataname,"VECTORS") || !strcmp(dataname,"TENSORS"))
@@ -855,7 +946,7 @@ safe_output:
 							t = DATA_REAL;
 						else
 							throw BadFile;
-						if( fgets(readline,2048,f) == NULL ) throw BadFile; //LOOK_UP TABLE
+						if( !in.getline(readline,2048) ) throw BadFile; //LOOK_UP TABLE
 						if( read_into == 2 )
 						{
 							Tag attr = CreateTag(attrname,t,read_into_cell,read_into_cell & ~CELL,nentries);
@@ -867,18 +958,18 @@ safe_output:
 									if( newcells[it] != InvalidHandle() )
 									{
 										Storage::integer_array attrdata = IntegerArray(newcells[it],attr);
-										for(int jt = 0; jt < nentries; jt++) {int temp; filled = fscanf(f," %d",&temp); if(filled != 1 ) throw BadFile; attrdata[jt] = temp;}
+										for(int jt = 0; jt < nentries; jt++) {int temp; if( !in.read_integer(temp) ) throw BadFile; attrdata[jt] = temp;}
 									}
-									else for(int jt = 0; jt < nentries; jt++) {int temp; filled = fscanf(f," %d",&temp); if(filled != 1 ) throw BadFile;}
+									else for(int jt = 0; jt < nentries; jt++) {int temp; if( !in.read_integer(temp) ) throw BadFile;}
 								}
 								if( t == DATA_REAL )
 								{
 									if( newcells[it] != InvalidHandle() )
 									{
 										Storage::real_array attrdata = RealArray(newcells[it],attr);
-										for(int jt = 0; jt < nentries; jt++) {double temp; filled = fscanf(f," %lf",&temp); if(filled != 1 ) throw BadFile; attrdata[jt] = temp;}
+										for(int jt = 0; jt < nentries; jt++) {double temp; if( !in.read_real(temp) ) throw BadFile; attrdata[jt] = temp;}
 									}
-									else for(int jt = 0; jt < nentries; jt++) {double temp; filled = fscanf(f," %lf",&temp); if(filled != 1 ) throw BadFile;}
+									else for(int jt = 0; jt < nentries; jt++) {double temp; if( !in.read_real(temp) ) throw BadFile;}
 								}
 								if( verbosity > 1 && it%report_pace == 0)
 								{
@@ -886,7 +977,7 @@ safe_output:
 									fflush(stdout);
 								}
 							}
-							filled = fscanf(f,"\n");
+							in.skip_space();
 							datatags.push_back(attr);
 						}
 						if( read_into == 1 )
@@ -898,12 +989,12 @@ safe_output:
 								if( t == DATA_INTEGER )
 								{
 									Storage::integer_array attrdata = IntegerArray(newnodes[it],attr);
-									for(int jt = 0; jt < nentries; jt++) {int temp; filled = fscanf(f," %d",&temp); if(filled != 1 ) throw BadFile; attrdata[jt] = temp;}
+									for(int jt = 0; jt < nentries; jt++) {int temp; if( !in.read_integer(temp) ) throw BadFile; attrdata[jt] = temp;}
 								}
 								if( t == DATA_REAL )
 								{
 									Storage::real_array attrdata = RealArray(newnodes[it],attr);
-									for(int jt = 0; jt < nentries; jt++) {double temp; filled = fscanf(f," %lf",&temp); if(filled != 1 ) throw BadFile; attrdata[jt] = temp;}
+									for(int jt = 0; jt < nentries; jt++) {double temp; if( !in.read_real(temp) ) throw BadFile; attrdata[jt] = temp;}
 								}
 								if( verbosity > 1 && it%report_pace == 0)
 								{
@@ -911,7 +1002,7 @@ safe_output:
 									fflush(stdout);
 								}
 							}
-							filled = fscanf(f,"\n");
+							in.skip_space();
 						}
 						break;
 					}
@@ -932,7 +1023,7 @@ safe_output:
 							t = DATA_REAL;
 						else
 							throw BadFile;
-						if( fgets(readline,2048,f) == NULL ) throw BadFile; //LOOK_UP TABLE
+						if( !in.getline(readline,2048) ) throw BadFile; //LOOK_UP TABLE
 						if( read_into == 2 )
 						{
 							Tag attr = CreateTag(attrname,t,read_into_cell,read_into_cell & ~CELL,nentries);
@@ -944,16 +1035,16 @@ safe_output:
 									if( newcells[it] != InvalidHandle() )
 									{
 										Storage::integer_array attrdata = IntegerArray(newcells[it],attr);
-										for(int jt = 0; jt < nentries; jt++) {int temp; filled = fscanf(f," %d",&temp); if(filled != 1 ) throw BadFile; attrdata[jt] = temp;}
-									} else for(int jt = 0; jt < nentries; jt++) {int temp; filled = fscanf(f," %d",&temp); if(filled != 1 ) throw BadFile;}
+										for(int jt = 0; jt < nentries; jt++) {int temp; if( !in.read_integer(temp) ) throw BadFile; attrdata[jt] = temp;}
+									} else for(int jt = 0; jt < nentries; jt++) {int temp; if( !in.read_integer(temp) ) throw BadFile;}
 								}
 								if( t == DATA_REAL )
 								{
 									if( newcells[it] != InvalidHandle() )
 									{
 										Storage::real_array attrdata = RealArray(newcells[it],attr);
-										for(int jt = 0; jt < nentries; jt++) {double temp; filled = fscanf(f," %lf",&temp); if(filled != 1 ) throw BadFile; attrdata[jt] = temp;}
-									} else for(int jt = 0; jt < nentries; jt++) {double temp; filled = fscanf(f," %lf",&temp); if(filled != 1 ) throw BadFile;}
+										for(int jt = 0; jt < nentries; jt++) {double temp; if( !in.read_real(temp) ) throw BadFile; attrdata[jt] = temp;}
+									} else for(int jt = 0; jt < nentries; jt++) {double temp; if( !in.read_real(temp) ) throw BadFile;}
 								}
 								if( verbosity > 1 && it%report_pace == 0)
 								{
@@ -961,7 +1052,7 @@ safe_output:
 									fflush(stdout);
 								}
 							}
-							filled = fscanf(f,"\n");
+							in.skip_space();
 							datatags.push_back(attr);
 						}
 						if( read_into == 1 )
@@ -973,12 +1064,12 @@ safe_output:
 								if( t == DATA_INTEGER )
 								{
 									Storage::integer_array attrdata = IntegerArray(newnodes[it],attr);
-									for(int jt = 0; jt < nentries; jt++) {int temp; filled = fscanf(f," %d",&temp); if(filled != 1 ) throw BadFile; attrdata[jt] = temp;}
+									for(int jt = 0; jt < nentries; jt++) {int temp; if( !in.read_integer(temp) ) throw BadFile; attrdata[jt] = temp;}
 								}
 								if( t == DATA_REAL )
 								{
 									Storage::real_array attrdata = RealArray(newnodes[it],attr);
-									for(int jt = 0; jt < nentries; jt++) {double temp; filled = fscanf(f," %lf",&temp); if(filled != 1 ) throw BadFile; attrdata[jt] = temp;}
+									for(int jt = 0; jt < nentries; jt++) {double temp; if( !in.read_real(temp) ) throw BadFile; attrdata[jt] = temp;}
 								}
 								if( verbosity > 1 && it%report_pace == 0)
 								{
@@ -986,7 +1077,7 @@ safe_output:
 									fflush(stdout);
 								}
 							}
-							filled = fscanf(f,"\n");
+							in.skip_space();
 						}
 						break;
 					}
@@ -1001,8 +1092,9 @@ safe_output:
 							char attrtype[1024];
 							unsigned int nentries, ntuples;
 							DataType t = DATA_BULK;
-							filled = fscanf(f," %s %u %u %s\n",attrname,&nentries,&ntuples,attrtype);
-							if( filled != 4 ) throw BadFile;
+							if( !in.read_word(attrname,1024) || !in.read_integer(nentries) || 
+								!in.read_integer(ntuples) || !in.read_word(attrtype,1024) ) throw BadFile;
+							in.skip_space();
 							for(unsigned int i = 0; i < strlen(attrtype); i++) attrtype[i] = tolower(attrtype[i]);
 							if( !strcmp(attrtype,"bit") || !strcmp(attrtype,"unsigned_char") || !strcmp(attrtype,"char") ||
 								  !strcmp(attrtype,"unsigned_short") || !strcmp(attrtype,"short") || !strcmp(attrtype,"unsigned_int") ||
@@ -1024,16 +1116,16 @@ safe_output:
 										if( newcells[it] != InvalidHandle() )
 										{
 											Storage::integer_array attrdata = IntegerArray(newcells[it],attr);
-											for(unsigned int jt = 0; jt < nentries; jt++) {int temp; filled = fscanf(f," %d",&temp); if(filled != 1 ) throw BadFile; attrdata[jt] = temp;}
-										} else for(unsigned int jt = 0; jt < nentries; jt++) {int temp; filled = fscanf(f," %d",&temp); if(filled != 1 ) throw BadFile;}
+											for(unsigned int jt = 0; jt < nentries; jt++) {int temp; if( !in.read_integer(temp) ) throw BadFile; attrdata[jt] = temp;}
+										} else for(unsigned int jt = 0; jt < nentries; jt++) {int temp; if( !in.read_integer(temp) ) throw BadFile;}
 									}
 									if( t == DATA_REAL )
 									{
 										if( newcells[it] != InvalidHandle() )
 										{
 											Storage::real_array attrdata = RealArray(newcells[it],attr);
-											for(unsigned int jt = 0; jt < nentries; jt++) {double temp; filled = fscanf(f," %lf",&temp); if(filled != 1 ) throw BadFile; attrdata[jt] = temp;}
-										} else for(unsigned int jt = 0; jt < nentries; jt++) {double temp; filled = fscanf(f," %lf",&temp); if(filled != 1 ) throw BadFile;}
+											for(unsigned int jt = 0; jt < nentries; jt++) {double temp; if( !in.read_real(temp) ) throw BadFile; attrdata[jt] = temp;}
+										} else for(unsigned int jt = 0; jt < nentries; jt++) {double temp; if( !in.read_real(temp) ) throw BadFile;}
 									}
 									if( verbosity > 1 && it%report_pace == 0)
 									{
@@ -1041,7 +1133,7 @@ safe_output:
 										fflush(stdout);
 									}
 								}
-								filled = fscanf(f,"\n");
+								in.skip_space();
 								datatags.push_back(attr);
 							}
 							if( read_into == 1 )
@@ -1054,12 +1146,12 @@ safe_output:
 									if( t == DATA_INTEGER )
 									{
 										Storage::integer_array attrdata = IntegerArray(newnodes[it],attr);
-										for(unsigned int jt = 0; jt < nentries; jt++) {int temp; filled = fscanf(f," %d",&temp); if(filled != 1 ) throw BadFile; attrdata[jt] = temp;}
+										for(unsigned int jt = 0; jt < nentries; jt++) {int temp; if( !in.read_integer(temp) ) throw BadFile; attrdata[jt] = temp;}
 									}
 									if( t == DATA_REAL )
 									{
 										Storage::real_array attrdata = RealArray(newnodes[it],attr);
-										for(unsigned int jt = 0; jt < nentries; jt++) {double temp; filled = fscanf(f," %lf",&temp); if(filled != 1 ) throw BadFile; attrdata[jt] = temp;}
+										for(unsigned int jt = 0; jt < nentries; jt++) {double temp; if( !in.read_real(temp) ) throw BadFile; attrdata[jt] = temp;}
 									}
 									if( verbosity > 1 && it%report_pace == 0)
 									{
@@ -1067,7 +1159,7 @@ safe_output:
 										fflush(stdout);
 									}
 								}
-								filled = fscanf(f,"\n");
+								in.skip_space();
 							}
 						}
 						break;
@@ -1141,7 +1233,7 @@ safe_output:
 						
 						while( nfields_done < nfields )
 						{
-							if( fgets(readline,2048,f) == NULL )
+							if( !in.getline(readline,2048) )
 							{
 								state = R_QUIT;
 								continue;
@@ -1165,12 +1257,12 @@ safe_output:
 							if( t == DATA_REAL )
 							{
 								for(int q = 0; q < ncomps*ntuples; ++q)
-									filled = fscanf(f,"%lf ", &RealArray(GetHandle(),field_data)[q]);
+									in.read_real(RealArray(GetHandle(),field_data)[q]);
 							}
 							else
 							{
 								for(int q = 0; q < ncomps*ntuples; ++q)
-									filled = fscanf(f,"%d ", &IntegerArray(GetHandle(),field_data)[q]);
+									in.read_integer(IntegerArray(GetHandle(),field_data)[q]);
 							}
 
 							
@@ -1178,7 +1270,7 @@ safe_output:
 						}
 						do
 						{
-							if( fgets(readline,2048,f) == NULL )
+							if( !in.getline(readline,2048) )
 							{
 								state = R_QUIT;
 								continue;
@@ -1201,28 +1293,18 @@ safe_output:
 						i = 0;
 						while(i != npoints)
 						{
-							if( !strcmp(datatype,"double") ) ReadCoords<double>(f,coords);
-							else if( !strcmp(datatype,"float") ) ReadCoords<float>(f,coords);
-							else if( !strcmp(datatype,"unsigned char") ) ReadCoords<unsigned char>(f,coords);
-							else if( !strcmp(datatype,"char") ) ReadCoords<char>(f,coords);
-							else if( !strcmp(datatype,"unsigned short") ) ReadCoords<unsigned short>(f,coords);
-							else if( !strcmp(datatype,"short") ) ReadCoords<short>(f,coords);
-							else if( !strcmp(datatype,"unsigned int") ) ReadCoords<unsigned int>(f,coords);
-							else if( !strcmp(datatype,"int") ) ReadCoords<int>(f,coords);
-							else if( !strcmp(datatype,"unsigned long") ) ReadCoords<unsigned long>(f,coords);
-							else if( !strcmp(datatype,"long") ) ReadCoords<long>(f,coords);
+							if( !strcmp(datatype,"double") ) ReadCoords<double>(in,coords);
+							else if( !strcmp(datatype,"float") ) ReadCoords<float>(in,coords);
+							else if( !strcmp(datatype,"unsigned char") ) ReadCoords<unsigned char>(in,coords);
+							else if( !strcmp(datatype,"char") ) ReadCoords<char>(in,coords);
+							else if( !strcmp(datatype,"unsigned short") ) ReadCoords<unsigned short>(in,coords);
+							else if( !strcmp(datatype,"short") ) ReadCoords<short>(in,coords);
+							else if( !strcmp(datatype,"unsigned int") ) ReadCoords<unsigned int>(in,coords);
+							else if( !strcmp(datatype,"int") ) ReadCoords<int>(in,coords);
+							else if( !strcmp(datatype,"unsigned long") ) ReadCoords<unsigned long>(in,coords);
+							else if( !strcmp(datatype,"long") ) ReadCoords<long>(in,coords);
 							else throw BadFile;
-							int find = -1;
-							if( !old_nodes.empty() )
-							{
-								std::vector<HandleType>::iterator it = std::lower_bound(old_nodes.begin(),old_nodes.end(),coords,CentroidComparator(this));
-								if( it != old_nodes.end() ) 
-								{
-									Storage::real_array c = RealArrayDF(*it,CoordsTag());
-									if( CentroidComparator(this).Compare(c.data(),coords) == 0 )
-										find = static_cast<int>(it - old_nodes.begin());
-								}
-							}
+							int find = matcher.Find(coords);
 							if( find == -1 ) 
 							{
 								newnodes[i] = CreateNode(coords)->GetHandle();
@@ -1238,34 +1320,15 @@ safe_output:
 							}
 							i++;
 						}
+						in.skip_space();
 					}
 					else
 					{
 						i = 0;
 						while(i != npoints)
 						{
-							double c[3];
-							filled = fscanf(f," %lg %lg %lg",&c[0],&c[1],&c[2]);
-							coords[0] = c[0];
-							coords[1] = c[1];
-							coords[2] = c[2];
-							if( filled != 3 ) throw BadFile;
-							int find = -1;
-							if( !old_nodes.empty() )
-							{
-								//REPORT_VAL("look up",coords[0] << " " << coords[1] << " " << coords[2]);
-								std::vector<HandleType>::iterator it = std::lower_bound(old_nodes.begin(),old_nodes.end(),coords,CentroidComparator(this));
-								if( it != old_nodes.end() ) 
-								{
-									Storage::real_array c = RealArrayDF(*it,CoordsTag());
-									//REPORT_VAL("found",c[0] << " " << c[1] << " " << c[2]);
-									if( CentroidComparator(this).Compare(c.data(),coords) == 0 )
-									{
-										find = static_cast<int>(it - old_nodes.begin());
-										//REPORT_VAL("match",find << " " << old_nodes[find]);
-									}
-								}
-							}
+							if( !in.read_real(coords[0]) || !in.read_real(coords[1]) || !in.read_real(coords[2]) ) throw BadFile;
+							int find = matcher.Find(coords);
 							if( find == -1 )
 							{
 								newnodes[i] = CreateNode(coords)->GetHandle();
@@ -1280,9 +1343,9 @@ safe_output:
 							}
 							i++;
 						}
-						filled = fscanf(f,"\n");
+						in.skip_space();
 					}
-					if( fgets(readline,2048,f) == NULL ) throw BadFile;
+					if( !in.getline(readline,2048) ) throw BadFile;
 					filled = sscanf(readline,"%*s %d %d\n",&ncells,&nints);
 					//printf("number of cells: %d\nnumber of ints: %d\n",ncells,nints);
 					if( filled != 2 ) throw BadFile;
@@ -1290,34 +1353,40 @@ safe_output:
 					ct.resize(ncells);
 						
 					if( binary )
-						filled = static_cast<int>(fread(&cp[0],sizeof(int),nints,f));
+					{
+						for(i = 0; i < nints; i++) 
+							if( !VtkReadBinary(in,cp[i]) ) throw BadFile;
+						in.skip_space();
+					}
 					else
 					{
 						i = 0;
 						while(i != nints)
 						{
-							filled = fscanf(f," %d",&cp[i]);
-							if( filled != 1 ) throw BadFile;
+							if( !in.read_integer(cp[i]) ) throw BadFile;
 							i++;
 						}
-						filled = fscanf(f,"\n");
+						in.skip_space();
 					}
-					if( fgets(readline,2048,f) == NULL ) throw BadFile;
+					if( !in.getline(readline,2048) ) throw BadFile;
 					filled = sscanf(readline,"%*s %d\n",&ncells2);
 					if( filled != 1 ) throw BadFile;
 					if( ncells2 != ncells ) throw BadFile;
 					if( binary )
-						filled = static_cast<int>(fread(&ct[0],sizeof(int),nints,f));
+					{
+						for(i = 0; i < ncells; i++) 
+							if( !VtkReadBinary(in,ct[i]) ) throw BadFile;
+						in.skip_space();
+					}
 					else
 					{
 						i = 0;
 						while(i != ncells)
 						{
-							filled = fscanf(f," %d",&ct[i]);
-							if( filled != 1 ) throw BadFile;
+							if( !in.read_integer(ct[i]) ) throw BadFile;
 							i++;
 						}
-						filled = fscanf(f,"\n");
+						in.skip_space();
 					}
 
 					if( grid_is_2d == 2 && ncells )
@@ -4,6 +4,7 @@
 
 
 #include "inmost.h"
+#include "io.hpp"
 #include <cfloat>
 
 #if defined(USE_MESH)
@@ -17,7 +18,137 @@ static int __isbad(double x) { return __isnan__(x) || __isinf__(x); }
 
 namespace INMOST
 {
+	static const char * VtuByteOrder()
+	{
+		int one = 1;
+		return *reinterpret_cast<char *>(&one) ? "LittleEndian" : "BigEndian";
+	}
 
+	/// Replace characters that may not appear in the value of xml attribute by entities.
+	static std::string VtuEscape(const std::string & name)
+	{
+		std::string ret;
+		for(std::string::size_type k = 0; k < name.size(); ++k)
+		{
+			switch(name[k])
+			{
+			case '&': ret += "&amp;"; break;
+			case '<': ret += "&lt;"; break;
+			case '>': ret += "&gt;"; break;
+			case '"': ret += "&quot;"; break;
+			case '\'': ret += "&apos;"; break;
+			default: ret += name[k];
+			}
+		}
+		return ret;
+	}
+
+	/// Replace entities written by VtuEscape back by characters, xml reader keeps them as is.
+	static std::string VtuUnescape(const std::string & name)
+	{
+		const char * entities[5] = {"&amp;","&lt;","&gt;","&quot;","&apos;"};
+		const char chars[5] = {'&','<','>','"','\''};
+		std::string ret;
+		for(std::string::size_type k = 0; k < name.size(); ++k)
+		{
+			int q = 0;
+			if( name[k] == '&' ) while( q < 5 && name.compare(k,strlen(entities[q]),entities[q]) != 0 ) q++;
+			if( name[k] == '&' && q < 5 )
+			{
+				ret += chars[q];
+				k += strlen(entities[q])-1;
+			}
+			else ret += name[k];
+		}
+		return ret;
+	}
+
+	/// Values of a DataArray that are either written as text inside of the tag
+	/// or stored as a raw block in the appended data with the size of the block in front.
+	class vtu_data_array
+	{
+		io_tokenizer * text;
+		const char * pos, * end;
+		std::string type;
+		bool swap;
+		template<typename T>
+		bool get(T & val)
+		{
+			if( end - pos < static_cast<std::ptrdiff_t>(sizeof(T)) ) return false;
+			unsigned char bytes[sizeof(T)];
+			memcpy(bytes,pos,sizeof(T));
+			if( swap ) std::reverse(bytes,bytes+sizeof(T));
+			memcpy(&val,bytes,sizeof(T));
+			pos += sizeof(T);
+			return true;
+		}
+		template<typename B, typename T>
+		bool get_as(T & val)
+		{
+			B temp;
+			if( !get(temp) ) return false;
+			val = static_cast<T>(temp);
+			return true;
+		}
+		template<typename T>
+		bool get_value(T & val)
+		{
+			if( type == "Float64" ) return get_as<double>(val);
+			if( type == "Float32" ) return get_as<float>(val);
+			if( type == "Int64" ) return get_as<long long>(val);
+			if( type == "UInt64" ) return get_as<unsigned long long>(val);
+			if( type == "Int32" ) return get_as<int>(val);
+			if( type == "UInt32" ) return get_as<unsigned int>(val);
+			if( type == "Int16" ) return get_as<short>(val);
+			if( type == "UInt16" ) return get_as<unsigned short>(val);
+			if( type == "Int8" ) return get_as<signed char>(val);
+			if( type == "UInt8" ) return get_as<unsigned char>(val);
+			std::cout << __FILE__ << ":" << __LINE__ << " unsupported data type " << type << std::endl;
+			throw BadFile;
+		}
+		vtu_data_array(const vtu_data_array & other);
+		vtu_data_array & operator =(const vtu_data_array & other);
+	public:
+		/// Appended data starts after the underscore, header64 is set for UInt64 header_type
+		/// and swap is set when byte_order of the file differs from the native one.
+		vtu_data_array(const XMLReader::XMLTree * da, const char * appended, size_t appended_size, bool header64, bool swap)
+			: text(NULL), pos(NULL), end(NULL), type(da->GetAttrib("type")), swap(swap)
+		{
+			int fa = da->FindAttrib("format");
+			if( fa != da->NumAttrib() && da->GetAttrib(fa).value == "appended" )
+			{
+				unsigned long long offset = strtoull(da->GetAttrib("offset").c_str(),NULL,10), nbytes = 0;
+				if( appended == NULL || offset >= appended_size )
+				{
+					std::cout << __FILE__ << ":" << __LINE__ << " offset " << offset << " of DataArray is out of the appended data" << std::endl;
+					throw BadFile;
+				}
+				pos = appended + offset;
+				end = appended + appended_size;
+				if( header64 ) get(nbytes);
+				else
+				{
+					unsigned int nbytes32 = 0;
+					get(nbytes32);
+					nbytes = nbytes32;
+				}
+				if( nbytes > static_cast<unsigned long long>(end - pos) )
+				{
+					std::cout << __FILE__ << ":" << __LINE__ << " block of " << nbytes << " bytes at offset " << offset << " is out of the appended data" << std::endl;
+					throw BadFile;
+				}
+				end = pos + nbytes;
+			}
+			else text = new io_tokenizer(da->GetContents());
+		}
+		~vtu_data_array() {if( text ) delete text;}
+		/// Read integer number. Returns false if there is no number.
+		template<typename T>
+		bool read_integer(T & value) {return text ? text->read_integer(value) : get_value(value);}
+		/// Read floating point number. Returns false if there is no number.
+		template<typename T>
+		bool read_real(T & value) {return text ? text->read_real(value) : get_value(value);}
+	};
 	
 	void Mesh::LoadVTU(std::string File)
 	{
@@ -60,6 +191,7 @@ namespace INMOST
 
 
 		std::vector<HandleType> old_nodes(NumberOfNodes());
+		NodeMatcher matcher(this);
 		{
 			unsigned qq = 0;
 			for (Mesh::iteratorNode it = BeginNode(); it != EndNode(); ++it)
@@ -70,7 +202,7 @@ namespace INMOST
 		
 		if (!old_nodes.empty())
 		{
-			std::sort(old_nodes.begin(), old_nodes.end(), CentroidComparator(this));
+			matcher.Build(old_nodes);
 			//for(std::vector<HandleType>::iterator it = old_nodes.begin(); it != old_nodes.end(); ++it)
 			//{
 			//	Storage::real_array c = RealArrayDF(*it,CoordsTag());
@@ -84,7 +216,36 @@ namespace INMOST
 		std::vector<HandleType> newcells;
 		
 
-		std::fstream f(File.c_str(), std::ios::in);
+		//raw appended data is not xml, it is cut off before the xml is parsed
+		std::string xml;
+		{
+			std::ifstream fin(File.c_str(), std::ios::in | std::ios::binary);
+			if( fin.fail() ) throw BadFileName;
+			std::ostringstream contents;
+			contents << fin.rdbuf();
+			contents.str().swap(xml);
+		}
+		const char * appended = NULL;
+		size_t appended_size = 0;
+		std::string::size_type apos = xml.find("<AppendedData");
+		if( apos != std::string::npos )
+		{
+			std::string::size_type astart = xml.find('>',apos);
+			if( astart != std::string::npos ) astart = xml.find('_',astart);
+			if( astart == std::string::npos )
+			{
+				std::cout << "Start of appended data is not found in " << File << std::endl;
+				throw BadFile;
+			}
+			if( xml.substr(apos,astart-apos).find("\"raw\"") == std::string::npos )
+			{
+				std::cout << "Only raw encoding of appended data is supported in " << File << std::endl;
+				throw BadFile;
+			}
+			appended = xml.c_str() + astart + 1;
+			appended_size = xml.size() - astart - 1;
+		}
+		std::istringstream f(apos != std::string::npos ? xml.substr(0,apos) + "</VTKFile>\n" : xml);
 		XMLReader r(File, f);
 		XMLReader::XMLTree t = r.ReadXML();
 
@@ -96,6 +257,8 @@ namespace INMOST
 				std::cout << "Compression is specified in " << File << " but not supported" << std::endl;
 				throw BadFile;
 			}
+			bool header64 = (t.FindAttrib("header_type") != t.NumAttrib() && t.GetAttrib("header_type") == "UInt64");
+			bool swap = (t.FindAttrib("byte_order") != t.NumAttrib() && t.GetAttrib("byte_order") != VtuByteOrder());
 			const XMLReader::XMLTree * da, * pd;
 			const XMLReader::XMLTree * v = t.GetChild("UnstructuredGrid")->GetChild("Piece");
 			int nnodes, ncells, ncoords;
@@ -105,24 +268,14 @@ namespace INMOST
 			{
 				da = v->GetChild("Points")->GetChild("DataArray");
 				ncoords = atoi(da->GetAttrib("NumberOfComponents").c_str());
-				std::stringstream readcoords(da->GetContents());
+				vtu_data_array readcoords(da, appended, appended_size, header64, swap);
 				Storage::real xyz[3] = { 0.0, 0.0, 0.0 };
 				newnodes.reserve(nnodes);
 				for (int q = 0; q < nnodes; ++q)
 				{
 					for (int l = 0; l < ncoords; ++l)
-						readcoords >> xyz[l];
-					int find = -1;
-					if (!old_nodes.empty())
-					{
-						std::vector<HandleType>::iterator it = std::lower_bound(old_nodes.begin(), old_nodes.end(), xyz, CentroidComparator(this));
-						if (it != old_nodes.end())
-						{
-							Storage::real_array c = RealArrayDF(*it, CoordsTag());
-							if (CentroidComparator(this).Compare(c.data(), xyz) == 0)
-								find = static_cast<int>(it - old_nodes.begin());
-						}
-					}
+						readcoords.read_real(xyz[l]);
+					int find = matcher.Find(xyz);
 					if (find == -1)
 					{
 						newnodes.push_back(CreateNode(xyz)->GetHandle());
@@ -136,26 +289,26 @@ namespace INMOST
 			da = v->GetChild("Cells")->GetChildWithAttrib("Name", "faces");
 			if( da )
 			{
-				std::stringstream faces(v->GetChild("Cells")->GetChildWithAttrib("Name", "faces")->GetContents());
-				std::stringstream faceoffsets(v->GetChild("Cells")->GetChildWithAttrib("Name", "faceoffsets")->GetContents());
+				vtu_data_array faces(v->GetChild("Cells")->GetChildWithAttrib("Name", "faces"), appended, appended_size, header64, swap);
+				vtu_data_array faceoffsets(v->GetChild("Cells")->GetChildWithAttrib("Name", "faceoffsets"), appended, appended_size, header64, swap);
 				int cconn, coffset = 0, totread = 0, nread, nfaces, nfacenodes;
 				ElementArray<Node> hnodes(this);
 				ElementArray<Face> hfaces(this);
-				while (!faceoffsets.eof())
+				while (faceoffsets.read_integer(coffset))
 				{
-					faceoffsets >> coffset;
+					if (coffset < 0) continue; //not a polyhedron
 					nread = coffset - totread;
-					faces >> nfaces;
+					faces.read_integer(nfaces);
 					hfaces.resize(nfaces);
 					totread++;
 					for (int q = 0; q < nfaces; ++q)
 					{
-						faces >> nfacenodes;
+						faces.read_integer(nfacenodes);
 						hnodes.resize(nfacenodes);
 						totread++;
 						for (int l = 0; l < nfacenodes; ++l)
 						{
-							faces >> cconn;
+							faces.read_integer(cconn);
 							hnodes.at(l) = newnodes[cconn];
 							RemMarker(newnodes[cconn], unused_marker);
 							totread++;
@@ -168,12 +321,12 @@ namespace INMOST
 			//check grid type
 			if( grid_is_2d == 2 && ncells) //detect grid type
 			{
-				std::stringstream type(v->GetChild("Cells")->GetChildWithAttrib("Name", "types")->GetContents());
+				vtu_data_array type(v->GetChild("Cells")->GetChildWithAttrib("Name", "types"), appended, appended_size, header64, swap);
 				int ctype;
 				bool have_2d = false;
 				for (int q = 0; q < ncells && grid_is_2d == 2; ++q)
 				{
-					type >> ctype;
+					type.read_integer(ctype);
 					if( ctype > 9 ) grid_is_2d = 0;
 				}
 				if( grid_is_2d == 2 ) grid_is_2d = 1;
@@ -198,22 +351,22 @@ namespace INMOST
 			bool have_nodes = false;
 			//read all the cells
 			{
-				std::stringstream conn(v->GetChild("Cells")->GetChildWithAttrib("Name", "connectivity")->GetContents());
-				std::stringstream type(v->GetChild("Cells")->GetChildWithAttrib("Name", "types")->GetContents());
-				std::stringstream offset(v->GetChild("Cells")->GetChildWithAttrib("Name", "offsets")->GetContents());
+				vtu_data_array conn(v->GetChild("Cells")->GetChildWithAttrib("Name", "connectivity"), appended, appended_size, header64, swap);
+				vtu_data_array type(v->GetChild("Cells")->GetChildWithAttrib("Name", "types"), appended, appended_size, header64, swap);
+				vtu_data_array offset(v->GetChild("Cells")->GetChildWithAttrib("Name", "offsets"), appended, appended_size, header64, swap);
 				int ctype, coffset = 0, totread = 0, nread, cconn, npolyh = 0;
 				ElementArray<Face> hfaces(this);
 				ElementArray<Node> hnodes(this);
 				newcells.resize(ncells);
 				for (int q = 0; q < ncells; ++q)
 				{
-					type >> ctype;
-					offset >> coffset;
+					type.read_integer(ctype);
+					offset.read_integer(coffset);
 					nread = coffset - totread;
 					hnodes.resize(nread);
 					for (int l = 0; l < nread; ++l)
 					{
-						conn >> cconn;
+						conn.read_integer(cconn);
 						hnodes.at(l) = newnodes[cconn];
 						RemMarker(newnodes[cconn], unused_marker);
 						totread++;
@@ -477,12 +630,25 @@ namespace INMOST
 								int ncomps = 1;
 								int nca = pd->FindAttrib("NumberOfComponents");
 								if (nca != pd->NumAttrib()) ncomps = atoi(pd->GetAttrib(nca).value.c_str());
-								TagRealArray t = CreateTag(pd->GetAttrib("Name"), DATA_REAL, dtype[j], dsparse[j], ncomps);
-								std::stringstream inp(pd->GetContents());
-								for (int l = 0; l < dsize[j]; ++l)
+								vtu_data_array inp(pd, appended, appended_size, header64, swap);
+								std::string atype = pd->GetAttrib("type");
+								if (atype.find("Int") == 0 || atype.find("UInt") == 0)
 								{
-									for (INMOST_DATA_ENUM_TYPE q = 0; q < t.GetSize(); ++q)
-										inp >> t[darray[j][l]][q];
+									TagIntegerArray t = CreateTag(VtuUnescape(pd->GetAttrib("Name")), DATA_INTEGER, dtype[j], dsparse[j], ncomps);
+									for (int l = 0; l < dsize[j]; ++l)
+									{
+										for (INMOST_DATA_ENUM_TYPE q = 0; q < t.GetSize(); ++q)
+											inp.read_integer(t[darray[j][l]][q]);
+									}
+								}
+								else
+								{
+									TagRealArray t = CreateTag(VtuUnescape(pd->GetAttrib("Name")), DATA_REAL, dtype[j], dsparse[j], ncomps);
+									for (int l = 0; l < dsize[j]; ++l)
+									{
+										for (INMOST_DATA_ENUM_TYPE q = 0; q < t.GetSize(); ++q)
+											inp.read_real(t[darray[j][l]][q]);
+									}
 								}
 							}
 							else std::cout << __FILE__ << ":" << __LINE__ << "I don't know yet what is " << pd->GetName() << " in point data" << std::endl;
@@ -498,7 +664,371 @@ namespace INMOST
 		}
 
 		ReleaseMarker(unused_marker,FACE|NODE);
-		f.close();
+	}
+
+	void Mesh::LoadPVTU(std::string File)
+	{
+		std::string path = "";
+		std::vector<std::string> files;
+		std::string::size_type l = File.find_last_of("/\\");
+		if( l != std::string::npos )
+			path = File.substr(0,l+1);
+		{
+			std::fstream f(File.c_str(), std::ios::in);
+			if( f.fail() ) throw BadFileName;
+			XMLReader r(File, f);
+			XMLReader::XMLTree t = r.ReadXML();
+			const XMLReader::XMLTree * v = t.GetChild("PUnstructuredGrid");
+			if( t.GetName() != "VTKFile" || v == NULL )
+			{
+				std::cout << __FILE__ << ":" << __LINE__ << " parallel unstructured grid is not found in " << File << std::endl;
+				throw BadFile;
+			}
+			for(int k = 0; k < v->NumChildren(); ++k)
+				if( v->GetChild(k).GetName() == "Piece" )
+					files.push_back(v->GetChild(k).GetAttrib("Source"));
+		}
+		for(int i = GetProcessorRank(); i < static_cast<int>(files.size()); i+= GetProcessorsNumber()) 
+			LoadVTU(path + files[i]);
+		ResolveShared();
+	}
+
+	int VtkElementType(ElementType t);
+	INMOST_DATA_ENUM_TYPE VtkElementNodes(ElementType t);
+
+	/// Tags with data of fixed size that can be written into vtu file.
+	static void VtuTags(Mesh * m, ElementType etype, std::vector<Tag> & tags)
+	{
+		std::vector<std::string> tag_names;
+		m->ListTagNames(tag_names);
+		for(unsigned int i = 0; i < tag_names.size(); i++)
+		{
+			Tag t = m->GetTag(tag_names[i]);
+			if( t.isDefined(etype) && 
+				!t.isSparse(etype) && 
+				t.GetSize() != ENUMUNDEF &&
+				(t.GetDataType() == DATA_REAL || 
+#if defined(USE_AUTODIFF)
+				 t.GetDataType() == DATA_VARIABLE ||
+#endif
+				 t.GetDataType() == DATA_INTEGER) &&
+				t != m->CoordsTag() && 
+				t != m->SharedTag() && 
+				t != m->SendtoTag() && 
+				t != m->ProcessorsTag())
+				tags.push_back(t);
+		}
+	}
+
+	static const char * VtuTagType(Tag t)
+	{
+		if( t.GetDataType() == DATA_INTEGER ) return sizeof(Storage::integer) == 8 ? "Int64" : "Int32";
+		return "Float64";
+	}
+
+	static unsigned long long VtuTagBytes(Tag t)
+	{
+		if( t.GetDataType() == DATA_INTEGER ) return sizeof(Storage::integer);
+		return sizeof(double);
+	}
+
+	/// Cells that are not standard vtk elements or have unexpected number of nodes are written as polyhedra.
+	static bool VtuPolyhedron(const Cell & c)
+	{
+		Element::GeometricType gt = c.GetGeometricType();
+		if( gt == Element::Polyhedron || gt == Element::MultiPolygon ) return true;
+		INMOST_DATA_ENUM_TYPE nnodes = VtkElementNodes(gt);
+		return nnodes != ENUMUNDEF && nnodes != c.nbAdjElements(NODE);
+	}
+
+	/// One array of the appended data with the size of the block in front,
+	/// gathered in memory to be written into the file by a single call.
+	class VtuBlock
+	{
+		std::vector<char> data;
+	public:
+		VtuBlock(unsigned long long bytes)
+		{
+			data.reserve(sizeof(unsigned long long) + bytes);
+			Put<unsigned long long>(bytes);
+		}
+		template<typename T>
+		void Put(T val)
+		{
+			const char * p = reinterpret_cast<const char *>(&val);
+			data.insert(data.end(),p,p+sizeof(T));
+		}
+		void Write(FILE * f) const
+		{
+			fwrite(&data[0],1,data.size(),f);
+		}
+	};
+
+	/// Write data of the tag on elements as a raw block with the size in front.
+	static void VtuWriteTag(FILE * f, Mesh * m, ElementType etype, Tag t)
+	{
+		unsigned int comps = t.GetSize();
+		VtuBlock block(m->NumberOf(etype)*comps*VtuTagBytes(t));
+		for(Mesh::iteratorElement it = m->BeginElement(etype); it != m->EndElement(); ++it)
+		{
+			switch(t.GetDataType())
+			{
+			case DATA_REAL:
+				{
+					Storage::real_array arr = it->RealArray(t);
+					for(unsigned int q = 0; q < comps; q++)
+					{
+						double val = static_cast<double>(arr[q]);
+						block.Put<double>(__isbad(val) ? -0.9999E30 : val);
+					}
+				}
+				break;
+			case DATA_INTEGER:
+				{
+					Storage::integer_array arr = it->IntegerArray(t);
+					for(unsigned int q = 0; q < comps; q++) block.Put<Storage::integer>(arr[q]);
+				}
+				break;
+#if defined(USE_AUTODIFF)
+			case DATA_VARIABLE:
+				{
+					Storage::var_array arr = it->VariableArray(t);
+					for(unsigned int q = 0; q < comps; q++)
+					{
+						double val = static_cast<double>(arr[q].GetValue());
+						block.Put<double>(__isbad(val) ? -0.9999E30 : val);
+					}
+				}
+				break;
+#endif
+			default: break;
+			}
+		}
+		block.Write(f);
+	}
+
+	void Mesh::SaveVTU(std::string File)
+	{
+		integer dim = GetDimensions();
+		if( dim > 3 )
+		{
+			printf("VTK file supports 3 dimensions max\n");
+			return;
+		}
+		std::vector<Tag> node_tags, cell_tags;
+		VtuTags(this,NODE,node_tags);
+		VtuTags(this,CELL,cell_tags);
+		//mark ghost cells so that the viewer skips them in parallel
+		bool ghost_type = (GetMeshState() == Mesh::Parallel);
+		unsigned long long nnodes = NumberOfNodes(), ncells = NumberOfCells(), nconn = 0, nfaces = 0, offset = 0;
+		Tag set_id = CreateTag("TEMPORARY_ELEMENT_ID",DATA_INTEGER,NODE,NONE,1);
+		{
+			Storage::integer cur_num = 0;
+			for(Mesh::iteratorNode it = BeginNode(); it != EndNode(); ++it) it->IntegerDF(set_id) = cur_num++;
+		}
+		//sizes of connectivity arrays are needed to know offsets of the blocks in advance
+		for(Mesh::iteratorCell it = BeginCell(); it != EndCell(); ++it)
+		{
+			nconn += it->nbAdjElements(NODE);
+			if( VtuPolyhedron(it->self()) )
+			{
+				ElementArray<Face> faces = it->getFaces();
+				nfaces += 1 + faces.size();
+				for(ElementArray<Face>::iterator jt = faces.begin(); jt != faces.end(); ++jt)
+					nfaces += jt->nbAdjElements(NODE);
+			}
+		}
+		FILE * f = fopen(File.c_str(),"wb");
+		if( !f ) 
+		{
+			DeleteTag(set_id);
+			throw BadFileName;
+		}
+		fprintf(f,"<?xml version=\"1.0\"?>\n");
+		fprintf(f,"<VTKFile type=\"UnstructuredGrid\" version=\"1.0\" byte_order=\"%s\" header_type=\"UInt64\">\n",VtuByteOrder());
+		fprintf(f,"\t<UnstructuredGrid>\n");
+		fprintf(f,"\t\t<Piece NumberOfPoints=\"%llu\" NumberOfCells=\"%llu\">\n",nnodes,ncells);
+		if( !node_tags.empty() )
+		{
+			fprintf(f,"\t\t\t<PointData>\n");
+			for(unsigned int i = 0; i < node_tags.size(); i++)
+			{
+				fprintf(f,"\t\t\t\t<DataArray type=\"%s\" Name=\"%s\" NumberOfComponents=\"%u\" format=\"appended\" offset=\"%llu\"/>\n",
+					VtuTagType(node_tags[i]),VtuEscape(node_tags[i].GetTagName()).c_str(),node_tags[i].GetSize(),offset);
+				offset += 8 + nnodes*node_tags[i].GetSize()*VtuTagBytes(node_tags[i]);
+			}
+			fprintf(f,"\t\t\t</PointData>\n");
+		}
+		if( !cell_tags.empty() || ghost_type )
+		{
+			fprintf(f,"\t\t\t<CellData>\n");
+			for(unsigned int i = 0; i < cell_tags.size(); i++)
+			{
+				fprintf(f,"\t\t\t\t<DataArray type=\"%s\" Name=\"%s\" NumberOfComponents=\"%u\" format=\"appended\" offset=\"%llu\"/>\n",
+					VtuTagType(cell_tags[i]),VtuEscape(cell_tags[i].GetTagName()).c_str(),cell_tags[i].GetSize(),offset);
+				offset += 8 + ncells*cell_tags[i].GetSize()*VtuTagBytes(cell_tags[i]);
+			}
+			if( ghost_type )
+			{
+				fprintf(f,"\t\t\t\t<DataArray type=\"UInt8\" Name=\"vtkGhostType\" format=\"appended\" offset=\"%llu\"/>\n",offset);
+				offset += 8 + ncells;
+			}
+			fprintf(f,"\t\t\t</CellData>\n");
+		}
+		fprintf(f,"\t\t\t<Points>\n");
+		fprintf(f,"\t\t\t\t<DataArray type=\"Float64\" NumberOfComponents=\"3\" format=\"appended\" offset=\"%llu\"/>\n",offset);
+		offset += 8 + nnodes*3*sizeof(double);
+		fprintf(f,"\t\t\t</Points>\n");
+		fprintf(f,"\t\t\t<Cells>\n");
+		fprintf(f,"\t\t\t\t<DataArray type=\"Int64\" Name=\"connectivity\" format=\"appended\" offset=\"%llu\"/>\n",offset);
+		offset += 8 + nconn*8;
+		fprintf(f,"\t\t\t\t<DataArray type=\"Int64\" Name=\"offsets\" format=\"appended\" offset=\"%llu\"/>\n",offset);
+		offset += 8 + ncells*8;
+		fprintf(f,"\t\t\t\t<DataArray type=\"UInt8\" Name=\"types\" format=\"appended\" offset=\"%llu\"/>\n",offset);
+		offset += 8 + ncells;
+		if( nfaces )
+		{
+			fprintf(f,"\t\t\t\t<DataArray type=\"Int64\" Name=\"faces\" format=\"appended\" offset=\"%llu\"/>\n",offset);
+			offset += 8 + nfaces*8;
+			fprintf(f,"\t\t\t\t<DataArray type=\"Int64\" Name=\"faceoffsets\" format=\"appended\" offset=\"%llu\"/>\n",offset);
+			offset += 8 + ncells*8;
+		}
+		fprintf(f,"\t\t\t</Cells>\n");
+		fprintf(f,"\t\t</Piece>\n");
+		fprintf(f,"\t</UnstructuredGrid>\n");
+		fprintf(f,"\t<AppendedData encoding=\"raw\">\n_");
+		for(unsigned int i = 0; i < node_tags.size(); i++) VtuWriteTag(f,this,NODE,node_tags[i]);
+		for(unsigned int i = 0; i < cell_tags.size(); i++) VtuWriteTag(f,this,CELL,cell_tags[i]);
+		if( ghost_type )
+		{
+			VtuBlock block(ncells);
+			for(Mesh::iteratorCell it = BeginCell(); it != EndCell(); ++it)
+				block.Put<unsigned char>(it->GetStatus() == Element::Ghost ? 1 : 0);
+			block.Write(f);
+		}
+		{
+			VtuBlock block(nnodes*3*sizeof(double));
+			for(Mesh::iteratorNode it = BeginNode(); it != EndNode(); ++it)
+			{
+				Storage::real_array coords = it->Coords();
+				for(integer i = 0; i < 3; i++) block.Put<double>(i < dim ? static_cast<double>(coords[i]) : 0.0);
+			}
+			block.Write(f);
+		}
+		{
+			VtuBlock block(nconn*8);
+			for(Mesh::iteratorCell it = BeginCell(); it != EndCell(); ++it)
+			{
+				ElementArray<Node> nodes = it->getNodes();
+				for(ElementArray<Node>::iterator jt = nodes.begin(); jt != nodes.end(); ++jt)
+					block.Put<long long>(jt->IntegerDF(set_id));
+			}
+			block.Write(f);
+		}
+		{
+			VtuBlock block(ncells*8);
+			long long pos = 0;
+			for(Mesh::iteratorCell it = BeginCell(); it != EndCell(); ++it)
+			{
+				pos += it->nbAdjElements(NODE);
+				block.Put<long long>(pos);
+			}
+			block.Write(f);
+		}
+		{
+			VtuBlock block(ncells);
+			for(Mesh::iteratorCell it = BeginCell(); it != EndCell(); ++it)
+			{
+				if( VtuPolyhedron(it->self()) )
+					block.Put<unsigned char>(static_cast<unsigned char>(VtkElementType(Element::MultiPolygon)));
+				else
+					block.Put<unsigned char>(static_cast<unsigned char>(VtkElementType(it->GetGeometricType())));
+			}
+			block.Write(f);
+		}
+		if( nfaces )
+		{
+			VtuBlock faces_block(nfaces*8), offsets_block(ncells*8);
+			long long pos = 0;
+			for(Mesh::iteratorCell it = BeginCell(); it != EndCell(); ++it)
+			{
+				if( VtuPolyhedron(it->self()) )
+				{
+					ElementArray<Face> faces = it->getFaces();
+					faces_block.Put<long long>(faces.size());
+					pos += 1 + faces.size();
+					for(ElementArray<Face>::iterator jt = faces.begin(); jt != faces.end(); ++jt)
+					{
+						ElementArray<Node> nodes = jt->getNodes();
+						faces_block.Put<long long>(nodes.size());
+						pos += nodes.size();
+						if( jt->FaceOrientedOutside(it->self()) )
+							for(ElementArray<Node>::iterator kt = nodes.begin(); kt != nodes.end(); ++kt)
+								faces_block.Put<long long>(kt->IntegerDF(set_id));
+						else
+							for(ElementArray<Node>::reverse_iterator kt = nodes.rbegin(); kt != nodes.rend(); ++kt)
+								faces_block.Put<long long>(kt->IntegerDF(set_id));
+					}
+					offsets_block.Put<long long>(pos);
+				}
+				else offsets_block.Put<long long>(-1);
+			}
+			faces_block.Write(f);
+			offsets_block.Write(f);
+		}
+		fprintf(f,"\n\t</AppendedData>\n");
+		fprintf(f,"</VTKFile>\n");
+		fclose(f);
+		DeleteTag(set_id);
+	}
+
+	void Mesh::SavePVTU(std::string File)
+	{
+		std::string name = File, lname = File;
+		std::transform(File.begin(),File.end(),lname.begin(),::tolower);
+		std::string::size_type pos = lname.rfind(".pvtu");
+		if( pos != std::string::npos ) name.erase(pos);
+		std::string::size_type l = name.find_last_of("/\\");
+		std::string fname = name.substr(l+1,name.length());
+		if( GetProcessorRank() == 0 )
+		{
+			std::vector<Tag> node_tags, cell_tags;
+			VtuTags(this,NODE,node_tags);
+			VtuTags(this,CELL,cell_tags);
+			FILE * f = fopen(File.c_str(),"w");
+			if( !f ) throw BadFileName;
+			fprintf(f,"<?xml version=\"1.0\"?>\n");
+			fprintf(f,"<VTKFile type=\"PUnstructuredGrid\" version=\"1.0\" byte_order=\"%s\" header_type=\"UInt64\">\n",VtuByteOrder());
+			fprintf(f,"\t<PUnstructuredGrid GhostLevel=\"%d\">\n",GetMeshState() == Mesh::Parallel ? 1 : 0);
+			if( !node_tags.empty() )
+			{
+				fprintf(f,"\t\t<PPointData>\n");
+				for(unsigned int i = 0; i < node_tags.size(); i++)
+					fprintf(f,"\t\t\t<PDataArray type=\"%s\" Name=\"%s\" NumberOfComponents=\"%u\"/>\n",VtuTagType(node_tags[i]),VtuEscape(node_tags[i].GetTagName()).c_str(),node_tags[i].GetSize());
+				fprintf(f,"\t\t</PPointData>\n");
+			}
+			if( !cell_tags.empty() || GetMeshState() == Mesh::Parallel )
+			{
+				fprintf(f,"\t\t<PCellData>\n");
+				for(unsigned int i = 0; i < cell_tags.size(); i++)
+					fprintf(f,"\t\t\t<PDataArray type=\"%s\" Name=\"%s\" NumberOfComponents=\"%u\"/>\n",VtuTagType(cell_tags[i]),VtuEscape(cell_tags[i].GetTagName()).c_str(),cell_tags[i].GetSize());
+				if( GetMeshState() == Mesh::Parallel )
+					fprintf(f,"\t\t\t<PDataArray type=\"UInt8\" Name=\"vtkGhostType\"/>\n");
+				fprintf(f,"\t\t</PCellData>\n");
+			}
+			fprintf(f,"\t\t<PPoints>\n");
+			fprintf(f,"\t\t\t<PDataArray type=\"Float64\" NumberOfComponents=\"3\"/>\n");
+			fprintf(f,"\t\t</PPoints>\n");
+			for(int i = 0; i < GetProcessorsNumber(); i++)
+				fprintf(f,"\t\t<Piece Source=\"%s_%d.vtu\"/>\n",fname.c_str(),i);
+			fprintf(f,"\t</PUnstructuredGrid>\n");
+			fprintf(f,"</VTKFile>\n");
+			fclose(f);
+		}
+		std::stringstream ss;
+		ss << GetProcessorRank();
+		name.append("_"+ss.str()+".vtu");
+		SaveVTU(name);
 	}
 }
 
@@ -16,6 +16,113 @@ namespace INMOST
 		return 0;
 	}
 
+	//maximal number of buckets along an axis, positions within buckets stay accurate in double precision
+	static const Storage::real node_matcher_buckets = 1.0e+9;
+
+	static long long node_matcher_key(Storage::real t)
+	{
+		return static_cast<long long>(floor(t));
+	}
+
+	static INMOST_DATA_ENUM_TYPE node_matcher_slot(const long long key[3], INMOST_DATA_ENUM_TYPE mask)
+	{
+		unsigned long long h = static_cast<unsigned long long>(key[0])*0x9E3779B97F4A7C15ULL;
+		h ^= static_cast<unsigned long long>(key[1])*0xC2B2AE3D27D4EB4FULL;
+		h ^= static_cast<unsigned long long>(key[2])*0x165667B19E3779F9ULL;
+		h ^= h >> 29;
+		h *= 0xBF58476D1CE4E5B9ULL;
+		h ^= h >> 32;
+		return static_cast<INMOST_DATA_ENUM_TYPE>(h) & mask;
+	}
+
+	void Mesh::NodeMatcher::Build(const std::vector<HandleType> & nodes)
+	{
+		real e = m->GetEpsilon();
+		dims = m->GetDimensions();
+		enumerator n = static_cast<enumerator>(nodes.size()), slots = 1;
+		while( slots < 2*n ) slots <<= 1;
+		mask = slots-1;
+		std::vector<enumerator> slot(n);
+		Tag coords_tag = m->CoordsTag();
+		//keys are counted from the corner of the bounding box, so that they do not
+		//overflow for large coordinates with small tolerance
+		real extent = 0;
+		for(integer i = 0; i < 3; ++i)
+		{
+			lo[i] = 1.0e+300;
+			hi[i] = -1.0e+300;
+		}
+		for(enumerator k = 0; k < n; ++k)
+		{
+			Storage::real_array c = m->RealArrayDF(nodes[k],coords_tag);
+			for(integer i = 0; i < dims; ++i)
+			{
+				lo[i] = std::min(lo[i],c[i]);
+				hi[i] = std::max(hi[i],c[i]);
+			}
+		}
+		for(integer i = 0; i < dims; ++i) extent = std::max(extent,hi[i]-lo[i]);
+		real step = std::max(2*e,extent/node_matcher_buckets);
+		inv = step > 0 ? 1.0/step : 1.0;
+#if defined(USE_OMP)
+#pragma omp parallel for
+#endif
+		for(integer k = 0; k < static_cast<integer>(n); ++k)
+		{
+			long long key[3] = {0,0,0};
+			Storage::real_array c = m->RealArrayDF(nodes[k],coords_tag);
+			for(integer i = 0; i < dims; ++i) key[i] = node_matcher_key((c[i]-lo[i])*inv);
+			slot[k] = node_matcher_slot(key,mask);
+		}
+		//counting sort of nodes by slots
+		start.assign(slots+1,0);
+		for(enumerator k = 0; k < n; ++k) start[slot[k]+1]++;
+		for(enumerator k = 0; k < slots; ++k) start[k+1] += start[k];
+		order.resize(n);
+		coords.resize(static_cast<size_t>(n)*dims);
+		std::vector<enumerator> pos(start.begin(),start.end()-1);
+		for(enumerator k = 0; k < n; ++k) order[pos[slot[k]]++] = k;
+#if defined(USE_OMP)
+#pragma omp parallel for
+#endif
+		for(integer k = 0; k < static_cast<integer>(n); ++k)
+		{
+			Storage::real_array c = m->RealArrayDF(nodes[order[k]],coords_tag);
+			for(integer i = 0; i < dims; ++i) coords[k*dims+i] = c[i];
+		}
+	}
+
+	int Mesh::NodeMatcher::Find(const real * xyz) const
+	{
+		if( order.empty() ) return -1;
+		real e = m->GetEpsilon();
+		long long kl[3] = {0,0,0}, kh[3] = {0,0,0}, key[3];
+		for(integer i = 0; i < dims; ++i)
+		{
+			//no node within tolerance, also keeps keys in range
+			if( xyz[i] < lo[i]-e || xyz[i] > hi[i]+e ) return -1;
+			//matching node is within tolerance from the point, allow for rounding
+			real t = (xyz[i]-lo[i])*inv, slack = e*inv + 1.0e-12*(1.0+fabs(t));
+			kl[i] = node_matcher_key(t-slack);
+			kh[i] = node_matcher_key(t+slack);
+		}
+		int ret = -1;
+		for(key[0] = kl[0]; key[0] <= kh[0]; ++key[0])
+			for(key[1] = kl[1]; key[1] <= kh[1]; ++key[1])
+				for(key[2] = kl[2]; key[2] <= kh[2]; ++key[2])
+				{
+					enumerator s = node_matcher_slot(key,mask);
+					for(enumerator k = start[s]; k < start[s+1]; ++k)
+					{
+						const real * c = &coords[k*dims];
+						integer i = 0;
+						while( i < dims && fabs(c[i]-xyz[i]) <= e ) ++i;
+						//prefer the first node in the input array, as sorted search would
+						if( i == dims && (ret == -1 || static_cast<int>(order[k]) < ret) ) ret = static_cast<int>(order[k]);
+					}
+				}
+		return ret;
+	}
 	bool Mesh::CentroidComparator::operator () (HandleType a, HandleType b) const
 	{
 		if( a == InvalidHandle() || b == InvalidHandle() ) return a > b;
@@ -179,6 +179,18 @@ namespace INMOST
 			comm = INMOST_MPI_COMM_WORLD;
 		}
 #endif
+#if defined(USE_MPI_SHMEM)
+		node_comm = MPI_COMM_NULL;
+		node_window = MPI_WIN_NULL;
+		node_space = NULL;
+		node_space_size = 0;
+#endif
+		shared_memory_exchange = false;
+		message_compression = false;
+		compression_threshold = 65536;
+		numbering_order = NumberingDefault;
+		ghost_layers_valid = false;
+		async_outputs_last = 0;
 
 #if defined(USE_PARALLEL_WRITE_TIME)
 		num_exchanges = 0;
@@ -402,6 +414,18 @@ namespace INMOST
 		epsilon = other.epsilon;
 		//have_global_id = other.have_global_id;
 		// copy communicator
+#if defined(USE_MPI_SHMEM)
+		node_comm = MPI_COMM_NULL;
+		node_window = MPI_WIN_NULL;
+		node_space = NULL;
+		node_space_size = 0;
+#endif
+		shared_memory_exchange = other.shared_memory_exchange;
+		message_compression = other.message_compression;
+		compression_threshold = other.compression_threshold;
+		numbering_order = other.numbering_order;
+		ghost_layers_valid = false;
+		async_outputs_last = 0;
 		if( m_state == Mesh::Parallel ) SetCommunicator(other.comm); else comm = INMOST_MPI_COMM_WORLD;
 		// reestablish geometric tags and table
 		memcpy(remember,other.remember,sizeof(remember));
@@ -434,7 +458,19 @@ namespace INMOST
 			MPI_Win_free(&window);
 		}
 #endif
+#if defined(USE_MPI_SHMEM)
+		if( m_state == Mesh::Parallel )
+		{
+			FreeNodeSpace();
+			if( node_comm != MPI_COMM_NULL ) MPI_Comm_free(&node_comm);
+		}
+#endif
 #endif
+		shared_memory_exchange = other.shared_memory_exchange;
+		message_compression = other.message_compression;
+		compression_threshold = other.compression_threshold;
+		numbering_order = other.numbering_order;
+		ghost_layers_valid = false;
 		//clear all data fields
 		for(ElementType etype = NODE; etype <= MESH; etype = NextElementType(etype))
 		{
@@ -589,6 +625,9 @@ namespace INMOST
 	
 	Mesh::~Mesh()
 	{
+		//complete pending outputs before the communicator may be released,
+		//collective for parallel outputs, see Mesh::WaitOutput
+		WaitOutput();
 		//clear all data fields
 		for(ElementType etype = NODE; etype <= MESH; etype = NextElementType(etype))
 		{
@@ -651,6 +690,18 @@ namespace INMOST
 			//~ MPI_Comm_free(&comm);
 		}
 #endif //USE_MPI_P2P
+#if defined(USE_MPI_SHMEM)
+		if( m_state == Mesh::Parallel )
+		{
+			int test = 0;
+			MPI_Finalized(&test);
+			if( !test )
+			{
+				FreeNodeSpace();
+				if( node_comm != MPI_COMM_NULL ) MPI_Comm_free(&node_comm);
+			}
+		}
+#endif //USE_MPI_SHMEM
 #endif //USE_MPI
 #if defined(USE_PARALLEL_WRITE_TIME)
 		FinalizeFile();
@@ -1876,6 +1927,7 @@ namespace INMOST
 	
 	void Mesh::ReorderEmpty(ElementType etype)
 	{
+		if( etype & CELL ) ghost_layers_valid = false;
 		for(int etypenum = 0; etypenum < ElementNum(MESH); etypenum++) if( ElementTypeFromDim(etypenum) & etype )
 		{
 			integer cend = static_cast<integer>(back_links[etypenum].size())-1;
@@ -23,10 +23,10 @@ static INMOST_DATA_BIG_ENUM_TYPE pmid = 0;
 #define EXIT_FUNC() {WriteTab(out_time) << "<TIME>" << Timer() - all_time << "</TIME>" << std::endl; Exit(); WriteTab(out_time) << "</FUNCTION>" << std::endl;}
 #define EXIT_FUNC_DIE() {WriteTab(out_time) << "<TIME>" << -1 << "</TIME>" << std::endl; Exit(); WriteTab(out_time) << "</FUNCTION>" << std::endl;}
 #else
-#define REPORT_MPI(x) x
+#define REPORT_MPI(x) {TraceMPI trace_mpi; x;}
 #define REPORT_STR(x) {}
 #define REPORT_VAL(str,x) {}
-#define ENTER_FUNC() {}
+#define ENTER_FUNC() TraceScope trace_scope(__FUNCTION__);
 #define EXIT_FUNC() {}
 #define EXIT_FUNC_DIE()  {}
 #endif
@@ -288,88 +288,112 @@ namespace INMOST
 		EXIT_FUNC();
 		return ret;
 	}
-	Storage::integer Mesh::EnumerateSet(const ElementSet & set, const Tag & num_tag, Storage::integer start, bool define_sparse)
+	static unsigned long long morton_key(const Storage::real * x, const Storage::real * bmin, const Storage::real * bmax)
+	{
+		unsigned long long key = 0;
+		unsigned q[3];
+		for(int k = 0; k < 3; ++k)
+		{
+			Storage::real len = bmax[k] - bmin[k];
+			Storage::real t = len > 0 ? (x[k] - bmin[k])/len : 0.0;
+			q[k] = static_cast<unsigned>(std::min(std::max(t,0.0),1.0)*((1u << 21) - 1));
+		}
+		for(int b = 20; b >= 0; --b)
+			for(int k = 0; k < 3; ++k)
+				key = (key << 1) | ((q[k] >> b) & 1);
+		return key;
+	}
+	
+	void Mesh::OrderForNumbering(element_set & elements, bool owned_first)
+	{
+		if( numbering_order == NumberingDefault && owned_first )
+		{
+			element_set ordered;
+			ordered.reserve(elements.size());
+			for(element_set::iterator it = elements.begin(); it != elements.end(); ++it)
+				if( GetStatus(*it) == Element::Owned ) ordered.push_back(*it);
+			for(element_set::iterator it = elements.begin(); it != elements.end(); ++it)
+				if( GetStatus(*it) != Element::Owned ) ordered.push_back(*it);
+			elements.swap(ordered);
+		}
+		else if( numbering_order == NumberingSpaceFillingCurve )
+			OrderAlongCurve(elements);
+	}
+	
+	void Mesh::OrderAlongCurve(element_set & elements)
+	{
+		if( elements.empty() ) return;
+		std::vector<Storage::real> cnt(elements.size()*3,0.0);
+		Storage::real bmin[3], bmax[3];
+		for(int k = 0; k < 3; ++k)
+		{
+			bmin[k] = 1.0e+20;
+			bmax[k] = -1.0e+20;
+		}
+		for(size_t q = 0; q < elements.size(); ++q)
+		{
+			Element(this,elements[q]).Centroid(&cnt[q*3]);
+			for(int k = 0; k < 3; ++k)
+			{
+				bmin[k] = std::min(bmin[k],cnt[q*3+k]);
+				bmax[k] = std::max(bmax[k],cnt[q*3+k]);
+			}
+		}
+		std::vector< std::pair<unsigned long long, HandleType> > keys(elements.size());
+		for(size_t q = 0; q < elements.size(); ++q)
+			keys[q] = std::make_pair(morton_key(&cnt[q*3],bmin,bmax),elements[q]);
+		std::sort(keys.begin(),keys.end());
+		for(size_t q = 0; q < elements.size(); ++q)
+			elements[q] = keys[q].second;
+	}
+	
+	Storage::integer Mesh::EnumerateInner(const element_set & elements, const Tag & num_tag, Storage::integer start, ElementType mask)
 	{
 		ENTER_FUNC();
 		Storage::integer shift = 0, ret = 0;
-		ElementType mask = CELL | FACE | EDGE | NODE;
 #if defined(USE_MPI)
-		Storage::integer number = 0;
-		for(ElementSet::iterator it = set.Begin(); it != set.End(); it++)
-			if( it->GetStatus() != Element::Ghost && (define_sparse || it->HaveData(num_tag)) )
-				number++;
-		REPORT_MPI(MPI_Scan(&number,&shift,1,INMOST_MPI_DATA_INTEGER_TYPE,MPI_SUM,comm));
-		shift -= number;
+		Storage::integer number = static_cast<Storage::integer>(elements.size());
+		REPORT_MPI(MPI_Exscan(&number,&shift,1,INMOST_MPI_DATA_INTEGER_TYPE,MPI_SUM,comm));
+		if( GetProcessorRank() == 0 ) shift = 0; //result of MPI_Exscan is undefined on first processor
 #endif//USE_MPI
 		shift += start;
-		for(ElementSet::iterator it = set.Begin(); it != set.End(); it++)
-			if( it->GetStatus() == Element::Owned && (define_sparse || it->HaveData(num_tag)) )
-				it->Integer(num_tag) = shift++;
-		for(ElementSet::iterator it = set.Begin(); it != set.End(); it++)
-			if( it->GetStatus() == Element::Shared && (define_sparse || it->HaveData(num_tag)) )
-				it->Integer(num_tag) = shift++;
+		for(element_set::const_iterator it = elements.begin(); it != elements.end(); ++it)
+			Integer(*it,num_tag) = shift++;
 		ExchangeData(num_tag,mask,0);
 		ret = shift;
 #if defined(USE_MPI)
 		REPORT_MPI(MPI_Bcast(&ret,1,INMOST_MPI_DATA_INTEGER_TYPE,GetProcessorsNumber()-1,comm));
-		//MPI_Allreduce(&shift,&ret,1,INMOST_DATA_INTEGER_TYPE,MPI_MAX,comm);
 #endif//USE_MPI
 		EXIT_FUNC();
 		return ret;
 	}
+	
+	Storage::integer Mesh::EnumerateSet(const ElementSet & set, const Tag & num_tag, Storage::integer start, bool define_sparse)
+	{
+		element_set elements;
+		for(ElementSet::iterator it = set.Begin(); it != set.End(); it++)
+			if( it->GetStatus() != Element::Ghost && (define_sparse || it->HaveData(num_tag)) )
+				elements.push_back(*it);
+		OrderForNumbering(elements,true);
+		return EnumerateInner(elements,num_tag,start,CELL | FACE | EDGE | NODE);
+	}
 	Storage::integer Mesh::Enumerate(const HandleType * set, enumerator n, const Tag & num_tag, Storage::integer start, bool define_sparse)
 	{
-		ENTER_FUNC();
-		Storage::integer shift = 0, ret = 0;
-		ElementType mask = CELL | FACE | EDGE | NODE;
-#if defined(USE_MPI)
-		Storage::integer number = 0;
+		element_set elements;
 		for(const HandleType * it = set; it != set+n; ++it)
-			if( GetStatus(*it) != Element::Ghost && (define_sparse || HaveData(*it,num_tag))) number++;
-		REPORT_MPI(MPI_Scan(&number,&shift,1,INMOST_MPI_DATA_INTEGER_TYPE,MPI_SUM,comm));
-		shift -= number;
-#endif//USE_MPI
-		shift += start;
-		for(const HandleType * it = set; it != set+n; ++it)
-			if( GetStatus(*it) == Element::Owned && (define_sparse || HaveData(*it,num_tag))) Integer(*it,num_tag) = shift++;
-		for(const HandleType * it = set; it != set+n; ++it)
-			if( GetStatus(*it) == Element::Shared && (define_sparse || HaveData(*it,num_tag))) Integer(*it,num_tag) = shift++;
-		ExchangeData(num_tag,mask,0);
-		ret = shift;
-#if defined(USE_MPI)
-		REPORT_MPI(MPI_Bcast(&ret,1,INMOST_MPI_DATA_INTEGER_TYPE,GetProcessorsNumber()-1,comm));
-		//MPI_Allreduce(&shift,&ret,1,INMOST_DATA_INTEGER_TYPE,MPI_MAX,comm);
-#endif//USE_MPI
-		EXIT_FUNC();
-		return ret;
+			if( GetStatus(*it) != Element::Ghost && (define_sparse || HaveData(*it,num_tag))) 
+				elements.push_back(*it);
+		OrderForNumbering(elements,true);
+		return EnumerateInner(elements,num_tag,start,CELL | FACE | EDGE | NODE);
 	}
 	Storage::integer Mesh::Enumerate(ElementType mask, Tag num_tag, Storage::integer start, bool define_sparse)
 	{
-		ENTER_FUNC();
-		Storage::integer shift = 0, ret = 0;
-#if defined(USE_MPI)
-		Storage::integer number = 0;
+		element_set elements;
 		for(Mesh::iteratorElement it = BeginElement(mask); it != EndElement(); it++)
 			if( it->GetStatus() != Element::Ghost && (define_sparse || it->HaveData(num_tag)) )
-				number++;
-		REPORT_MPI(MPI_Scan(&number,&shift,1,INMOST_MPI_DATA_INTEGER_TYPE,MPI_SUM,comm));
-		shift -= number;
-#endif//USE_MPI
-		shift += start;
-		for(Mesh::iteratorElement it = BeginElement(mask); it != EndElement(); it++)
-			if( it->GetStatus() == Element::Owned && (define_sparse || it->HaveData(num_tag)) )
-				it->Integer(num_tag) = shift++;
-		for(Mesh::iteratorElement it = BeginElement(mask); it != EndElement(); it++)
-			if( it->GetStatus() == Element::Shared && (define_sparse || it->HaveData(num_tag)) )
-				it->Integer(num_tag) = shift++;
-		ExchangeData(num_tag,mask,0);
-		ret = shift;
-#if defined(USE_MPI)
-		REPORT_MPI(MPI_Bcast(&ret,1,INMOST_MPI_DATA_INTEGER_TYPE,GetProcessorsNumber()-1,comm));
-		//MPI_Allreduce(&shift,&ret,1,INMOST_DATA_INTEGER_TYPE,MPI_MAX,comm);
-#endif//USE_MPI
-		EXIT_FUNC();
-		return ret;
+				elements.push_back(*it);
+		OrderForNumbering(elements,true);
+		return EnumerateInner(elements,num_tag,start,mask);
 	}
 	
 	Storage::real Mesh::Integrate(Storage::real input)
@@ -607,6 +631,19 @@ namespace INMOST
 #endif //USE_MPI
 	}	
 	
+	int Mesh::GetNodeProcessorsNumber() const
+	{
+#if defined(USE_MPI_SHMEM)
+		if( node_comm != MPI_COMM_NULL )
+		{
+			int size;
+			MPI_Comm_size(node_comm,&size);
+			return size;
+		}
+#endif //USE_MPI_SHMEM
+		return 1;
+	}
+
 	void Mesh::Initialize(int * argc, char *** argv)
 	{
 #if defined(USE_MPI)
@@ -620,9 +657,23 @@ namespace INMOST
 #if defined(USE_PARALLEL_WRITE_TIME)
 		atexit(Mesh::AtExit);
 #endif
+		if( getenv("INMOST_TRACE") != NULL ) Trace::Enable();
 	}
 	void Mesh::Finalize()
 	{
+		if( getenv("INMOST_TRACE") != NULL )
+		{
+			int rank = 0;
+#if defined(USE_MPI)
+			int test = 0;
+			MPI_Finalized(&test);
+			if( !test ) MPI_Comm_rank(INMOST_MPI_COMM_WORLD,&rank);
+#endif //USE_MPI
+			std::stringstream name;
+			name << getenv("INMOST_TRACE") << "_" << rank << ".json";
+			Trace::WriteChromeTrace(name.str(),rank);
+			Trace::WriteSummary(std::string(getenv("INMOST_TRACE")) + "_summary.txt");
+		}
 #if defined(USE_MPI)
 		int test = 0;
 		MPI_Finalized(&test);
@@ -689,6 +740,29 @@ namespace INMOST
 		}
 		REPORT_MPI(MPI_Win_create(shared_space,sizeof(unsigned)*GetProcessorsNumber()*2,sizeof(unsigned),MPI_INFO_NULL,comm,&window));
 #endif //USE_MPI_P2P
+#if defined(USE_MPI_SHMEM)
+		{
+			//group processors that can share memory and remember their positions within the node
+			int mpisize = GetProcessorsNumber(), nodesize;
+			REPORT_MPI(MPI_Comm_split_type(comm,MPI_COMM_TYPE_SHARED,GetProcessorRank(),MPI_INFO_NULL,&node_comm));
+			MPI_Comm_size(node_comm,&nodesize);
+			MPI_Group world_group, node_group;
+			MPI_Comm_group(comm,&world_group);
+			MPI_Comm_group(node_comm,&node_group);
+			std::vector<int> world_ranks(mpisize);
+			for(int k = 0; k < mpisize; ++k) world_ranks[k] = k;
+			node_ranks.resize(mpisize);
+			REPORT_MPI(MPI_Group_translate_ranks(world_group,mpisize,&world_ranks[0],node_group,&node_ranks[0]));
+			for(int k = 0; k < mpisize; ++k) if( node_ranks[k] == MPI_UNDEFINED ) node_ranks[k] = -1;
+			MPI_Group_free(&world_group);
+			MPI_Group_free(&node_group);
+			node_bases.resize(nodesize,NULL);
+			node_window = MPI_WIN_NULL;
+			node_space = NULL;
+			node_space_size = 0;
+			REPORT_VAL("processors on node",nodesize);
+		}
+#endif //USE_MPI_SHMEM
 #else //USE_MPI
 		(void) _comm;
 #endif //USE_MPI
@@ -729,6 +803,190 @@ namespace INMOST
 	
 	
 	
+#if defined(USE_MPI)
+	//Compression of message buffers.
+	//First byte of the message tells whether the message is compressed,
+	//compressed message continues with the size of the original message and
+	//the sequence of blocks, every block starts with the byte of the encoding.
+	//The byte is reserved by the packing routine before the data, so that
+	//uncompressed message is sent as is.
+	const size_t compress_block_size = 1024;
+	enum CompressBlockMode {CompressRaw = 0, CompressDelta32 = 1, CompressXor64 = 2};
+	
+	static void compress_put_varint(Mesh::buffer_type & out, unsigned v)
+	{
+		while( v >= 0x80 )
+		{
+			out.push_back(static_cast<INMOST_DATA_BULK_TYPE>(v | 0x80));
+			v >>= 7;
+		}
+		out.push_back(static_cast<INMOST_DATA_BULK_TYPE>(v));
+	}
+	
+	//consecutive 32-bit words are replaced by zigzag-encoded differences written as varints
+	static void compress_delta32(const INMOST_DATA_BULK_TYPE * in, size_t n, Mesh::buffer_type & out)
+	{
+		size_t words = n/4;
+		unsigned prev = 0, x, d;
+		for(size_t k = 0; k < words; ++k)
+		{
+			memcpy(&x,in+k*4,4);
+			d = x - prev;
+			prev = x;
+			compress_put_varint(out,(d << 1) ^ (0u - (d >> 31)));
+		}
+		out.insert(out.end(),in+words*4,in+n);
+	}
+	
+	static const INMOST_DATA_BULK_TYPE * decompress_delta32(const INMOST_DATA_BULK_TYPE * in, const INMOST_DATA_BULK_TYPE * end, size_t n, INMOST_DATA_BULK_TYPE * out)
+	{
+		size_t words = n/4;
+		unsigned prev = 0, z, d;
+		for(size_t k = 0; k < words; ++k)
+		{
+			z = 0;
+			for(int shift = 0; ; shift += 7)
+			{
+				if( in == end ) throw Impossible;
+				z |= static_cast<unsigned>(*in & 0x7f) << shift;
+				if( !(*in++ & 0x80) ) break;
+			}
+			d = (z >> 1) ^ (0u - (z & 1));
+			prev += d;
+			memcpy(out+k*4,&prev,4);
+		}
+		if( static_cast<size_t>(end-in) < n-words*4 ) throw Impossible;
+		memcpy(out+words*4,in,n-words*4);
+		return in + (n-words*4);
+	}
+	
+	//64-bit word is xored with the previous word, then leading zero bytes are dropped,
+	//numbers of dropped bytes for a pair of words are stored in a single byte
+	static void compress_xor64(const INMOST_DATA_BULK_TYPE * in, size_t n, Mesh::buffer_type & out)
+	{
+		size_t words = n/8;
+		unsigned long long prev = 0, x, r;
+		size_t header = 0;
+		for(size_t k = 0; k < words; ++k)
+		{
+			memcpy(&x,in+k*8,8);
+			r = x ^ prev;
+			prev = x;
+			unsigned nbytes = 0;
+			while( nbytes < 8 && (r >> (8*nbytes)) != 0 ) nbytes++;
+			if( k % 2 == 0 )
+			{
+				header = out.size();
+				out.push_back(static_cast<INMOST_DATA_BULK_TYPE>(nbytes));
+			}
+			else out[header] |= static_cast<INMOST_DATA_BULK_TYPE>(nbytes << 4);
+			for(unsigned q = 0; q < nbytes; ++q)
+				out.push_back(static_cast<INMOST_DATA_BULK_TYPE>(r >> (8*q)));
+		}
+		out.insert(out.end(),in+words*8,in+n);
+	}
+	
+	static const INMOST_DATA_BULK_TYPE * decompress_xor64(const INMOST_DATA_BULK_TYPE * in, const INMOST_DATA_BULK_TYPE * end, size_t n, INMOST_DATA_BULK_TYPE * out)
+	{
+		size_t words = n/8;
+		unsigned long long prev = 0, r;
+		unsigned header = 0;
+		for(size_t k = 0; k < words; ++k)
+		{
+			if( k % 2 == 0 )
+			{
+				if( in == end ) throw Impossible;
+				header = *in++;
+			}
+			unsigned nbytes = (k % 2 == 0) ? (header & 0x0f) : (header >> 4);
+			if( nbytes > 8 || static_cast<size_t>(end-in) < nbytes ) throw Impossible;
+			r = 0;
+			for(unsigned q = 0; q < nbytes; ++q)
+				r |= static_cast<unsigned long long>(*in++) << (8*q);
+			prev ^= r;
+			memcpy(out+k*8,&prev,8);
+		}
+		if( static_cast<size_t>(end-in) < n-words*8 ) throw Impossible;
+		memcpy(out+words*8,in,n-words*8);
+		return in + (n-words*8);
+	}
+	
+	//buffer[0] is the reserved zero byte, data follows it
+	static void compress_buffer(Mesh::buffer_type & buffer, size_t threshold)
+	{
+		Mesh::buffer_type out, delta, xor64;
+		size_t size = buffer.size()-1;
+		if( size >= threshold && size > 0 )
+		{
+			const INMOST_DATA_BULK_TYPE * data = &buffer[1];
+			out.reserve(size/2);
+			out.push_back(1);
+			for(int q = 0; q < 8; ++q) out.push_back(static_cast<INMOST_DATA_BULK_TYPE>(static_cast<unsigned long long>(size) >> (8*q)));
+			for(size_t pos = 0; pos < size && out.size() < size; pos += compress_block_size)
+			{
+				size_t n = std::min(compress_block_size,size-pos);
+				delta.clear();
+				xor64.clear();
+				compress_delta32(data+pos,n,delta);
+				compress_xor64(data+pos,n,xor64);
+				if( delta.size() < n && delta.size() <= xor64.size() )
+				{
+					out.push_back(CompressDelta32);
+					out.insert(out.end(),delta.begin(),delta.end());
+				}
+				else if( xor64.size() < n )
+				{
+					out.push_back(CompressXor64);
+					out.insert(out.end(),xor64.begin(),xor64.end());
+				}
+				else
+				{
+					out.push_back(CompressRaw);
+					out.insert(out.end(),data+pos,data+pos+n);
+				}
+			}
+			if( out.size() < size ) buffer.swap(out);
+		}
+	}
+	
+	//returns position of the data in the buffer
+	static int decompress_buffer(Mesh::buffer_type & buffer)
+	{
+		if( buffer.empty() ) return 0;
+		if( buffer[0] == 0 ) return 1;
+		if( buffer.size() < 9 ) throw Impossible;
+		unsigned long long size = 0;
+		for(int q = 0; q < 8; ++q) size |= static_cast<unsigned long long>(buffer[1+q]) << (8*q);
+		Mesh::buffer_type out(static_cast<size_t>(size));
+		const INMOST_DATA_BULK_TYPE * in = &buffer[0] + 9, * end = &buffer[0] + buffer.size();
+		for(size_t pos = 0; pos < out.size(); pos += compress_block_size)
+		{
+			size_t n = std::min(compress_block_size,out.size()-pos);
+			if( in == end ) throw Impossible;
+			INMOST_DATA_BULK_TYPE mode = *in++;
+			if( mode == CompressDelta32 ) in = decompress_delta32(in,end,n,&out[pos]);
+			else if( mode == CompressXor64 ) in = decompress_xor64(in,end,n,&out[pos]);
+			else if( mode == CompressRaw )
+			{
+				if( static_cast<size_t>(end-in) < n ) throw Impossible;
+				memcpy(&out[pos],in,n);
+				in += n;
+			}
+			else throw Impossible;
+		}
+		buffer.swap(out);
+		return 0;
+	}
+#endif //USE_MPI
+	
+	void remove_invalid_elements(Mesh * m, Mesh::element_set & set)
+	{
+		Mesh::element_set::size_type k = 0;
+		for(Mesh::element_set::size_type i = 0; i < set.size(); ++i)
+			if( m->isValidElement(set[i]) ) set[k++] = set[i];
+		set.resize(k);
+	}
+	
 	void determine_my_procs_low(Mesh * m, HandleType h, dynarray<Storage::integer,64> & result, dynarray<Storage::integer,64> & intersection)
 	{
 		Element::adj_type const & subelements = m->LowConn(h);
@@ -1720,7 +1978,7 @@ namespace INMOST
 				}
 				element_set result(ref.size());
 				element_set::iterator end;
-				if( HaveGlobalID(CELL) )
+				if( HaveGlobalID(mask) )
 					end = std::set_difference(ref.begin(),ref.end(),it->second.begin(),it->second.end(),result.begin(),GlobalIDComparator(this));
 				else
 					end = std::set_difference(ref.begin(),ref.end(),it->second.begin(),it->second.end(),result.begin(),CentroidComparator(this));
@@ -1740,7 +1998,7 @@ namespace INMOST
 				}
 				element_set result(ref.size());
 				element_set::iterator end;
-				if( HaveGlobalID(CELL) )
+				if( HaveGlobalID(mask) )
 					end = std::set_difference(ref.begin(),ref.end(),it->second.begin(),it->second.end(),result.begin(),GlobalIDComparator(this));
 				else
 					end = std::set_difference(ref.begin(),ref.end(),it->second.begin(),it->second.end(),result.begin(),CentroidComparator(this));
@@ -1756,6 +2014,9 @@ namespace INMOST
 		ComputeSharedProcs();
 		Integer(GetHandle(),tag_layers) = 0;
 		Integer(GetHandle(),tag_bridge) = NONE;
+		ghost_layers_sent.clear();
+		ghost_layers_recv.clear();
+		ghost_layers_valid = false;
 #endif //USE_MPI
 		EXIT_FUNC();
 	}
@@ -1839,7 +2100,7 @@ namespace INMOST
 				}
 				element_set result(ref.size());
 				element_set::iterator end;
-				if( HaveGlobalID(CELL) )
+				if( HaveGlobalID(mask) )
 					end = std::set_difference(ref.begin(),ref.end(),it->second.begin(),it->second.end(),result.begin(),GlobalIDComparator(this));
 				else
 					end = std::set_difference(ref.begin(),ref.end(),it->second.begin(),it->second.end(),result.begin(),CentroidComparator(this));
@@ -1859,7 +2120,7 @@ namespace INMOST
 				}
 				element_set result(ref.size());
 				element_set::iterator end;
-				if( HaveGlobalID(CELL) )
+				if( HaveGlobalID(mask) )
 					end = std::set_difference(ref.begin(),ref.end(),it->second.begin(),it->second.end(),result.begin(),GlobalIDComparator(this));
 				else
 					end = std::set_difference(ref.begin(),ref.end(),it->second.begin(),it->second.end(),result.begin(),CentroidComparator(this));
@@ -1885,47 +2146,44 @@ namespace INMOST
 	{
 		tag_global_id = CreateTag("GLOBAL_ID",DATA_INTEGER, mask, NONE,1);
 		ENTER_FUNC();
-
-#if defined(USE_MPI)
-		if( m_state == Parallel )
+		element_set elements[4];
+		INMOST_DATA_BIG_ENUM_TYPE shift[4] = {0,0,0,0};
+		for(ElementType currenttype = NODE; currenttype <= CELL; currenttype = NextElementType(currenttype) )
 		{
-			INMOST_DATA_BIG_ENUM_TYPE number,shift[4], shift_recv[4], local_shift;
-			//int mpirank = GetProcessorRank(),mpisize = GetProcessorsNumber();
-			int num;
-			//std::vector<INMOST_DATA_BIG_ENUM_TYPE> shifts(mpisize*4);
-			memset(shift,0,sizeof(INMOST_DATA_BIG_ENUM_TYPE));
-			for(ElementType currenttype = NODE; currenttype <= CELL; currenttype = NextElementType(currenttype) )
+			if( mask & currenttype )
 			{
-				if( mask & currenttype )
+				int num = ElementNum(currenttype);
+				elements[num].reserve(NumberOf(currenttype));
+				for(Mesh::iteratorElement it = BeginElement(currenttype); it != EndElement(); it++)
 				{
-					num = ElementNum(currenttype);
-					number = 0;
-					for(Mesh::iteratorElement it = BeginElement(currenttype); it != EndElement(); it++)
-					{
-						if( it->GetStatus() != Element::Ghost )
-							number++;
-					}
-					shift[num] = number;
-				}
-			}
-			{
-				int ierr;
-				REPORT_MPI(ierr = MPI_Scan(shift,shift_recv,4,INMOST_MPI_DATA_BIG_ENUM_TYPE,MPI_SUM,GetCommunicator()));
-				if( ierr != MPI_SUCCESS ) MPI_Abort(GetCommunicator(),__LINE__);
-			}
-			for(ElementType currenttype = NODE; currenttype <= CELL; currenttype = NextElementType(currenttype) )
-			{
-				if( mask & currenttype )
-				{
-					num = ElementNum(currenttype);
-					local_shift = shift_recv[num] - shift[num];
-					for(Mesh::iteratorElement it = BeginElement(currenttype); it != EndElement(); it++)
-					{
-						if( it->GetStatus() != Element::Ghost )
-							it->Integer(tag_global_id) = local_shift++;
-					}
+					if( it->GetStatus() != Element::Ghost )
+						elements[num].push_back(*it);
 				}
+				OrderForNumbering(elements[num],false);
 			}
+		}
+#if defined(USE_MPI)
+		if( m_state == Parallel )
+		{
+			//shifts for all types at once
+			INMOST_DATA_BIG_ENUM_TYPE number[4];
+			for(int num = 0; num < 4; ++num) number[num] = static_cast<INMOST_DATA_BIG_ENUM_TYPE>(elements[num].size());
+			int ierr;
+			REPORT_MPI(ierr = MPI_Exscan(number,shift,4,INMOST_MPI_DATA_BIG_ENUM_TYPE,MPI_SUM,GetCommunicator()));
+			if( ierr != MPI_SUCCESS ) MPI_Abort(GetCommunicator(),__LINE__);
+			if( GetProcessorRank() == 0 ) memset(shift,0,sizeof(shift)); //result of MPI_Exscan is undefined on first processor
+		}
+#endif //USE_MPI
+		for(int num = 0; num < 4; ++num)
+		{
+			INMOST_DATA_BIG_ENUM_TYPE local_shift = shift[num];
+			for(element_set::iterator it = elements[num].begin(); it != elements[num].end(); ++it)
+				Integer(*it,tag_global_id) = local_shift++;
+		}
+#if defined(USE_MPI)
+		if( m_state == Parallel )
+		{
+			//ghost elements of all types at once
 			if( tag_global_id.isValid() )
 			{
 				Tag exchange = tag_global_id;
@@ -1936,19 +2194,6 @@ namespace INMOST
 			}
 			SortParallelStorage(mask);
 		}
-		else
-		{
-#endif //USE_MPI
-			INMOST_DATA_BIG_ENUM_TYPE number;
-			for(ElementType currenttype = NODE; currenttype <= CELL; currenttype = NextElementType(currenttype) )
-				if( mask & currenttype )
-				{
-					number = 0;
-					for(Mesh::iteratorElement it = BeginElement(currenttype); it != EndElement(); it++)
-						it->Integer(tag_global_id) = number++;
-				}
-#if defined(USE_MPI)
-		}
 #endif //USE_MPI
 		EXIT_FUNC();
 	}
@@ -2858,6 +3103,7 @@ namespace INMOST
 		REPORT_VAL("prealloc face edges",prealloc[2]);
 		REPORT_VAL("prealloc cell faces",prealloc[3]);
 		MarkerType pack_tags_mrk = CreateMarker();
+		if( message_compression ) buffer.push_back(0); //reserve the byte telling that the message is not compressed
 		//pack nodes coords
 		{
 			integer dim = GetDimensions();
@@ -3194,6 +3440,13 @@ namespace INMOST
 		for(integer i = ElementNum(NODE); i <= ElementNum(CELL); i++) 
 			if( !selems[i].empty() ) RemMarkerArray(&selems[i][0],static_cast<enumerator>(selems[i].size()),pack_tags_mrk);
 		ReleaseMarker(pack_tags_mrk);
+		if( message_compression )
+		{
+			REPORT_VAL("compressed from",buffer.size()-1);
+			compress_buffer(buffer,compression_threshold);
+			REPORT_VAL("compressed to",buffer.size());
+		}
+		Trace::Elements(all.size());
 #else
 		(void) all;
 		(void) buffer;
@@ -3224,6 +3477,7 @@ namespace INMOST
 		std::vector<HandleType> old_nodes(NumberOfNodes());
 		all.clear();
 		double time = Timer();
+		if( message_compression ) position = decompress_buffer(buffer);
 		//TODO 49
 		int k = 0;
 		for(Mesh::iteratorNode it = BeginNode(); it != EndNode(); it++)
@@ -3685,6 +3939,7 @@ namespace INMOST
 		time = Timer() - time;
 		REPORT_STR("unpack tag data");
 		REPORT_VAL("time", time);	
+		Trace::Elements(all.size());
 #else
 		(void) all;
 		(void) buffer;
@@ -3717,6 +3972,17 @@ namespace INMOST
 		recv_reqs.resize(recv_bufs.size());
 		send_reqs.resize(send_bufs.size());
 		REPORT_VAL("strategy",parallel_strategy);
+		if( Trace::Enabled() )
+		{
+			size_t sent = 0, received = 0;
+			for(i = 0; i < send_bufs.size(); i++) sent += send_bufs[i].second.size();
+			for(i = 0; i < recv_bufs.size(); i++) received += recv_bufs[i].second.size();
+			Trace::Bytes(sent,received);
+		}
+#if defined(USE_MPI_SHMEM)
+		if( shared_memory_exchange && parallel_strategy != 0 )
+			ExchangeBuffersNode(send_bufs,recv_bufs,send_reqs,recv_reqs);
+#endif //USE_MPI_SHMEM
 		if( parallel_strategy == 0 )
 		{
 			for(i = 0; i < send_bufs.size(); i++)
@@ -3740,14 +4006,14 @@ namespace INMOST
 		{
 			INMOST_DATA_BULK_TYPE stub;
 			REPORT_VAL("recv bufs size",recv_bufs.size());
-			for(i = 0; i < recv_bufs.size(); i++)// if( !recv_bufs[i].second.empty() )
+			for(i = 0; i < recv_bufs.size(); i++) if( !OnSameNode(recv_bufs[i].first) )// if( !recv_bufs[i].second.empty() )
 			{
 				mpi_tag = ((parallel_mesh_unique_id+1)*mpisize*mpisize + (mpirank+mpisize+rand_num))%max_tag;
 				//mpi_tag = parallel_mesh_unique_id*mpisize*mpisize+recv_bufs[i].first*mpisize+mpirank;
 				REPORT_MPI(MPI_Irecv(recv_bufs[i].second.empty()?&stub:&recv_bufs[i].second[0],static_cast<INMOST_MPI_SIZE>(recv_bufs[i].second.size()),MPI_PACKED,recv_bufs[i].first,mpi_tag,comm,&recv_reqs[i]));
 			}
 			REPORT_VAL("send bufs size",send_bufs.size());
-			for(i = 0; i < send_bufs.size(); i++) //if( !send_bufs[i].second.empty() )
+			for(i = 0; i < send_bufs.size(); i++) if( !OnSameNode(send_bufs[i].first) ) //if( !send_bufs[i].second.empty() )
 			{
 				mpi_tag = ((parallel_mesh_unique_id+1)*mpisize*mpisize + (send_bufs[i].first+mpisize+rand_num))%max_tag;
 				//mpi_tag = parallel_mesh_unique_id*mpisize*mpisize+mpirank*mpisize+send_bufs[i].first;
@@ -3758,14 +4024,14 @@ namespace INMOST
 		{
 			INMOST_DATA_BULK_TYPE stub;
 			REPORT_VAL("recv bufs size",recv_bufs.size());
-			for(i = 0; i < recv_bufs.size(); i++) //if( !recv_bufs[i].second.empty() )
+			for(i = 0; i < recv_bufs.size(); i++) if( !OnSameNode(recv_bufs[i].first) ) //if( !recv_bufs[i].second.empty() )
 			{
 				mpi_tag = ((parallel_mesh_unique_id+1)*mpisize*mpisize + (mpirank+mpisize+rand_num))%max_tag;
 				REPORT_MPI(MPI_Irecv(recv_bufs[i].second.empty()? &stub : &recv_bufs[i].second[0],static_cast<INMOST_MPI_SIZE>(recv_bufs[i].second.size()),MPI_PACKED,recv_bufs[i].first,mpi_tag,comm,&recv_reqs[i]));
 			}
 			REPORT_MPI(MPI_Barrier(comm));
 			REPORT_VAL("send bufs size",send_bufs.size());
-			for(i = 0; i < send_bufs.size(); i++)// if( !send_bufs[i].second.empty() )
+			for(i = 0; i < send_bufs.size(); i++) if( !OnSameNode(send_bufs[i].first) )// if( !send_bufs[i].second.empty() )
 			{
 				mpi_tag = ((parallel_mesh_unique_id+1)*mpisize*mpisize + (send_bufs[i].first+mpisize+rand_num))%max_tag;
 				REPORT_MPI(MPI_Irsend(send_bufs[i].second.empty()? &stub : &send_bufs[i].second[0],static_cast<INMOST_MPI_SIZE>(send_bufs[i].second.size()),MPI_PACKED,send_bufs[i].first,mpi_tag,comm,&send_reqs[i]));	
@@ -3780,6 +4046,143 @@ namespace INMOST
 		EXIT_FUNC();
 	}
 	
+	bool Mesh::OnSameNode(int proc) const
+	{
+#if defined(USE_MPI_SHMEM)
+		return shared_memory_exchange && parallel_strategy != 0 && node_comm != MPI_COMM_NULL && node_ranks[proc] != -1;
+#else //USE_MPI_SHMEM
+		(void) proc;
+		return false;
+#endif //USE_MPI_SHMEM
+	}
+
+#if defined(USE_MPI_SHMEM)
+	//generalized request that is already complete, used to report buffers
+	//received through shared memory to Mesh::FinishRequests
+	static int node_request_query(void * extra_state, MPI_Status * status)
+	{
+		(void) extra_state;
+		MPI_Status_set_elements(status,MPI_BYTE,0);
+		MPI_Status_set_cancelled(status,0);
+		status->MPI_SOURCE = MPI_UNDEFINED;
+		status->MPI_TAG = MPI_UNDEFINED;
+		return MPI_SUCCESS;
+	}
+	static int node_request_free(void * extra_state) {(void) extra_state; return MPI_SUCCESS;}
+	static int node_request_cancel(void * extra_state, int complete) {(void) extra_state; (void) complete; return MPI_SUCCESS;}
+#endif //USE_MPI_SHMEM
+
+	void Mesh::FreeNodeSpace()
+	{
+#if defined(USE_MPI_SHMEM)
+		if( node_window != MPI_WIN_NULL )
+		{
+			MPI_Win_unlock_all(node_window);
+			MPI_Win_free(&node_window);
+		}
+		node_window = MPI_WIN_NULL;
+		node_space = NULL;
+		node_space_size = 0;
+		std::fill(node_bases.begin(),node_bases.end(),static_cast<INMOST_DATA_BULK_TYPE *>(NULL));
+#endif //USE_MPI_SHMEM
+	}
+
+	void Mesh::AllocateNodeSpace(INMOST_DATA_ENUM_TYPE size)
+	{
+		ENTER_FUNC();
+#if defined(USE_MPI_SHMEM)
+		//collective over node_comm, all processors of the node provide the same size
+		FreeNodeSpace();
+		MPI_Aint seg_size;
+		int disp_unit;
+		void * base;
+		REPORT_MPI(MPI_Win_allocate_shared(size,1,MPI_INFO_NULL,node_comm,&node_space,&node_window));
+		REPORT_MPI(MPI_Win_lock_all(MPI_MODE_NOCHECK,node_window));
+		for(int k = 0; k < static_cast<int>(node_bases.size()); ++k)
+		{
+			REPORT_MPI(MPI_Win_shared_query(node_window,k,&seg_size,&disp_unit,&base));
+			node_bases[k] = static_cast<INMOST_DATA_BULK_TYPE *>(base);
+		}
+		node_space_size = size;
+		REPORT_VAL("node space size",size);
+#else //USE_MPI_SHMEM
+		(void) size;
+#endif //USE_MPI_SHMEM
+		EXIT_FUNC();
+	}
+
+	void Mesh::ExchangeBuffersNode(exch_buffer_type & send_bufs, exch_buffer_type & recv_bufs,
+								   std::vector<INMOST_MPI_Request> & send_reqs, std::vector<INMOST_MPI_Request> & recv_reqs)
+	{
+		ENTER_FUNC();
+#if defined(USE_MPI_SHMEM)
+		//Segment of each processor starts with a table of (offset, size+1) per processor of the node,
+		//zero size means there is no message, then the data for all the processors follows.
+		typedef INMOST_DATA_ENUM_TYPE node_header;
+		int nodesize = static_cast<int>(node_bases.size());
+		int noderank = node_ranks[GetProcessorRank()];
+		if( nodesize > 1 )
+		{
+			INMOST_DATA_ENUM_TYPE header_size = static_cast<INMOST_DATA_ENUM_TYPE>(sizeof(node_header)*2*nodesize);
+			INMOST_DATA_ENUM_TYPE need = header_size, need_max = 0;
+			bool have_messages = false;
+			unsigned i;
+			for(i = 0; i < send_bufs.size(); i++) if( OnSameNode(send_bufs[i].first) )
+			{
+				need += static_cast<INMOST_DATA_ENUM_TYPE>(send_bufs[i].second.size());
+				have_messages = true;
+			}
+			if( !have_messages ) need = 0;
+			REPORT_MPI(MPI_Allreduce(&need,&need_max,1,INMOST_MPI_DATA_ENUM_TYPE,MPI_MAX,node_comm));
+			REPORT_VAL("node space required",need_max);
+			if( need_max == 0 ) 
+			{
+				//nobody on the node has anything to transfer
+				EXIT_FUNC();
+				return;
+			}
+			if( need_max > node_space_size ) AllocateNodeSpace(need_max+need_max/2);
+			//write out messages into own segment
+			node_header * header = reinterpret_cast<node_header *>(node_space);
+			memset(header,0,header_size);
+			INMOST_DATA_ENUM_TYPE offset = header_size;
+			for(i = 0; i < send_bufs.size(); i++) if( OnSameNode(send_bufs[i].first) )
+			{
+				int dest = node_ranks[send_bufs[i].first];
+				INMOST_DATA_ENUM_TYPE size = static_cast<INMOST_DATA_ENUM_TYPE>(send_bufs[i].second.size());
+				header[dest*2+0] = offset;
+				header[dest*2+1] = size+1;
+				if( size ) memcpy(node_space+offset,&send_bufs[i].second[0],size);
+				offset += size;
+				send_reqs[i] = MPI_REQUEST_NULL;
+			}
+			REPORT_MPI(MPI_Win_sync(node_window));
+			REPORT_MPI(MPI_Barrier(node_comm));
+			REPORT_MPI(MPI_Win_sync(node_window));
+			//copy messages from the segments of senders directly into receive buffers
+			for(i = 0; i < recv_bufs.size(); i++) if( OnSameNode(recv_bufs[i].first) )
+			{
+				const node_header * src_header = reinterpret_cast<const node_header *>(node_bases[node_ranks[recv_bufs[i].first]]);
+				INMOST_DATA_ENUM_TYPE size = src_header[noderank*2+1];
+				if( size ) size--;
+				else REPORT_STR("no message from processor " << recv_bufs[i].first << " on the node");
+				recv_bufs[i].second.resize(size);
+				if( size ) memcpy(&recv_bufs[i].second[0],node_bases[node_ranks[recv_bufs[i].first]]+src_header[noderank*2+0],size);
+				REPORT_MPI(MPI_Grequest_start(node_request_query,node_request_free,node_request_cancel,NULL,&recv_reqs[i]));
+				REPORT_MPI(MPI_Grequest_complete(recv_reqs[i]));
+			}
+			//segments may be overwritten by the next exchange only after everybody have read them
+			REPORT_MPI(MPI_Barrier(node_comm));
+		}
+#else //USE_MPI_SHMEM
+		(void) send_bufs;
+		(void) recv_bufs;
+		(void) send_reqs;
+		(void) recv_reqs;
+#endif //USE_MPI_SHMEM
+		EXIT_FUNC();
+	}
+
 	void Mesh::PrepareReceiveInner(Prepare todo, exch_buffer_type & send_bufs, exch_buffer_type & recv_bufs)
 	{
 		if( parallel_strategy == 0 && todo == UnknownSize ) return; //in this case we know all we need
@@ -3838,6 +4241,8 @@ namespace INMOST
 				REPORT_VAL("recv buffers size",recv_bufs.size());
 				for(i = 0; i < recv_bufs.size(); i++)
 				{
+					//sizes of messages within the node are known from the shared segment
+					if( OnSameNode(recv_bufs[i].first) ) {reqs[i] = MPI_REQUEST_NULL; continue;}
 					mpi_tag = ((parallel_mesh_unique_id+1)*mpisize*mpisize + (mpirank+mpisize+rand_num))%max_tag;
 					//mpi_tag = parallel_mesh_unique_id*mpisize*mpisize+recv_bufs[i].first*mpisize+mpirank;
 					REPORT_MPI(MPI_Irecv(&send_recv_size[i],1,MPI_INT,recv_bufs[i].first,mpi_tag,comm,&reqs[i]));
@@ -3845,6 +4250,7 @@ namespace INMOST
 				REPORT_VAL("send buffers size",send_bufs.size());
 				for(i = 0; i < send_bufs.size(); i++)
 				{
+					if( OnSameNode(send_bufs[i].first) ) {reqs[i+recv_bufs.size()] = MPI_REQUEST_NULL; continue;}
 					mpi_tag = ((parallel_mesh_unique_id+1)*mpisize*mpisize + (send_bufs[i].first+mpisize+rand_num))%max_tag;
 					//mpi_tag = parallel_mesh_unique_id*mpisize*mpisize+mpirank*mpisize+send_bufs[i].first;
 					REPORT_MPI(MPI_Isend(&send_recv_size[i+recv_bufs.size()],1,MPI_INT,send_bufs[i].first,mpi_tag,comm,&reqs[i+recv_bufs.size()]));	
@@ -3853,7 +4259,7 @@ namespace INMOST
 				{
 					REPORT_MPI(MPI_Waitall(static_cast<INMOST_MPI_SIZE>(recv_bufs.size()),&reqs[0],MPI_STATUSES_IGNORE));
 				}
-				for(i = 0; i < recv_bufs.size(); i++) recv_bufs[i].second.resize(send_recv_size[i]);
+				for(i = 0; i < recv_bufs.size(); i++) if( !OnSameNode(recv_bufs[i].first) ) recv_bufs[i].second.resize(send_recv_size[i]);
 				if( !send_bufs.empty() )
 				{
 					REPORT_MPI(MPI_Waitall(static_cast<INMOST_MPI_SIZE>(send_bufs.size()),&reqs[recv_bufs.size()],MPI_STATUSES_IGNORE));
@@ -4392,6 +4798,9 @@ namespace INMOST
 		proc_elements old_layers;
 		proc_elements current_layers;
 		element_set all_visited;
+		ghost_layers_sent.clear();
+		ghost_layers_recv.clear();
+		ghost_layers_valid = false;
 		{
 			
 			proc_elements shared_skin = ComputeSharedSkinSet(bridge);
@@ -4436,6 +4845,8 @@ namespace INMOST
 			ExchangeMarked();
 			old_layers.swap(current_layers);
 			current_layers.clear();
+			for(Storage::integer_array::iterator p = procs.begin(); p != procs.end(); p++)
+				ghost_layers_sent[*p].push_back(old_layers[*p]);
 			if( k > 0 ) 
 			{
 				time = Timer();
@@ -4512,8 +4923,12 @@ namespace INMOST
 			REPORT_STR("Select ghost elements to remove");
 			REPORT_VAL("time",time);
 			RemoveGhostElements(del_ghost);
+			for(std::map<int, std::vector<element_set> >::iterator it = ghost_layers_sent.begin(); it != ghost_layers_sent.end(); ++it)
+				for(std::vector<element_set>::iterator jt = it->second.begin(); jt != it->second.end(); ++jt)
+					remove_invalid_elements(this,*jt);
 		}
 		DeleteTag(layers_marker);
+		ghost_layers_valid = true;
 		//throw NotImplemented;
 #else
 		(void) layers;
@@ -4525,6 +4940,219 @@ namespace INMOST
 	
 	
 	
+	void Mesh::ComputeGhostLayersRecv(Storage::integer layers, ElementType bridge)
+	{
+		ENTER_FUNC();
+#if defined(USE_MPI)
+		double time = Timer();
+		element_set ghost;
+#if defined(USE_PARALLEL_STORAGE)
+		for(parallel_storage::iterator it = ghost_elements.begin(); it != ghost_elements.end(); ++it)
+			ghost.insert(ghost.end(),it->second[ElementNum(CELL)].begin(),it->second[ElementNum(CELL)].end());
+#else //USE_PARALLEL_STORAGE
+		for(iteratorCell it = BeginCell(); it != EndCell(); ++it)
+			if( it->GetStatus() == Element::Ghost ) ghost.push_back(*it);
+#endif //USE_PARALLEL_STORAGE
+		ghost_layers_recv.clear();
+		if( layers > 0 ) ghost_layers_recv.resize(layers);
+		MarkerType busy = CreateMarker();
+		//first layer is adjacent to local cells
+		for(element_set::iterator it = ghost.begin(); it != ghost.end(); ++it)
+		{
+			bool first = false;
+			ElementArray<Element> adj_bridge = Element(this,*it)->getAdjElements(bridge);
+			for(ElementArray<Element>::iterator jt = adj_bridge.begin(); jt != adj_bridge.end() && !first; ++jt)
+			{
+				ElementArray<Element> adj = jt->getAdjElements(CELL);
+				for(ElementArray<Element>::iterator kt = adj.begin(); kt != adj.end() && !first; ++kt)
+					if( kt->GetStatus() != Element::Ghost ) first = true;
+			}
+			if( first )
+			{
+				SetMarker(*it,busy);
+				ghost_layers_recv[0].push_back(*it);
+			}
+		}
+		//next layers are adjacent to previous layers
+		for(Storage::integer k = 1; k < layers; ++k)
+		{
+			element_set & ref_old = ghost_layers_recv[k-1];
+			element_set & ref_cur = ghost_layers_recv[k];
+			for(element_set::iterator it = ref_old.begin(); it != ref_old.end(); ++it)
+			{
+				ElementArray<Element> adj_bridge = Element(this,*it)->getAdjElements(bridge);
+				for(ElementArray<Element>::iterator jt = adj_bridge.begin(); jt != adj_bridge.end(); ++jt)
+				{
+					ElementArray<Element> adj = jt->getAdjElements(CELL);
+					for(ElementArray<Element>::iterator kt = adj.begin(); kt != adj.end(); ++kt)
+						if( !kt->GetMarker(busy) && kt->GetStatus() == Element::Ghost )
+						{
+							kt->SetMarker(busy);
+							ref_cur.push_back(*kt);
+						}
+				}
+			}
+		}
+		for(std::vector<element_set>::iterator it = ghost_layers_recv.begin(); it != ghost_layers_recv.end(); ++it)
+			if( !it->empty() ) RemMarkerArray(&(*it)[0],static_cast<enumerator>(it->size()),busy);
+		ReleaseMarker(busy);
+		time = Timer() - time;
+		REPORT_STR("Compute layers of ghost cells");
+		REPORT_VAL("time",time);
+#else //USE_MPI
+		(void) layers;
+		(void) bridge;
+#endif //USE_MPI
+		EXIT_FUNC();
+	}
+	
+	void Mesh::AddGhostLayer(ElementType bridge)
+	{
+		if( m_state == Serial ) return;
+		ENTER_FUNC();
+#if defined(USE_MPI)
+		Storage::integer layers = Integer(GetHandle(),tag_layers);
+		ElementType cur_bridge = Integer(GetHandle(),tag_bridge);
+		if( layers == 0 )
+		{
+			if( bridge == NONE ) throw BadParameter;
+			ExchangeGhost(1,bridge);
+		}
+		else if( (bridge != NONE && bridge != cur_bridge) || Integrate(ghost_layers_valid ? 0 : 1) > 0 )
+		{
+			REPORT_STR("Layers were altered, fall back to ExchangeGhost");
+			ExchangeGhost(layers+1,bridge != NONE ? bridge : cur_bridge);
+		}
+		else
+		{
+			bridge = cur_bridge;
+			if( ghost_layers_recv.size() != static_cast<size_t>(layers) ) ComputeGhostLayersRecv(layers,bridge);
+			double time = Timer();
+			Storage::integer_array procs_arr = IntegerArrayDV(GetHandle(),tag_processors);
+			std::vector<Storage::integer> procs(procs_arr.begin(),procs_arr.end());
+			element_set all_visited;
+			for(std::vector<Storage::integer>::iterator p = procs.begin(); p != procs.end(); ++p)
+			{
+				std::vector<element_set> & sent = ghost_layers_sent[*p];
+				if( sent.size() != static_cast<size_t>(layers) ) continue; //processor is not connected through layers
+				element_set & ref_old = sent[layers-1];
+				element_set ref_cur;
+				MarkerType busy = CreateMarker();
+				all_visited.clear();
+				//cells of two outer layers are already on remote processor
+				for(element_set::iterator it = ref_old.begin(); it != ref_old.end(); ++it) SetMarker(*it,busy);
+				if( layers > 1 ) for(element_set::iterator it = sent[layers-2].begin(); it != sent[layers-2].end(); ++it) SetMarker(*it,busy);
+				for(element_set::iterator it = ref_old.begin(); it != ref_old.end(); ++it)
+				{
+					ElementArray<Element> adj_bridge = Element(this,*it)->getAdjElements(bridge);
+					for(ElementArray<Element>::iterator jt = adj_bridge.begin(); jt != adj_bridge.end(); ++jt)
+						if( !jt->GetMarker(busy) )
+						{
+							ElementArray<Element> adj = jt->getAdjElements(CELL);
+							for(ElementArray<Element>::iterator kt = adj.begin(); kt != adj.end(); ++kt)
+								if( !kt->GetMarker(busy) )
+								{
+									if( jt->IntegerDF(tag_owner) != *p )
+									{
+										ref_cur.push_back(*kt);
+										Storage::integer_array adj_procs = kt->IntegerArrayDV(tag_processors);
+										if( !std::binary_search(adj_procs.begin(),adj_procs.end(),*p) )
+											kt->IntegerArray(tag_sendto).push_back(*p);
+									}
+									kt->SetMarker(busy);
+									all_visited.push_back(*kt);
+								}
+							jt->SetMarker(busy);
+							all_visited.push_back(*jt);
+						}
+				}
+				for(element_set::iterator it = ref_old.begin(); it != ref_old.end(); ++it) RemMarker(*it,busy);
+				if( layers > 1 ) for(element_set::iterator it = sent[layers-2].begin(); it != sent[layers-2].end(); ++it) RemMarker(*it,busy);
+				if( !all_visited.empty() ) RemMarkerArray(&all_visited[0],static_cast<enumerator>(all_visited.size()),busy);
+				ReleaseMarker(busy);
+				sent.push_back(element_set());
+				sent.back().swap(ref_cur);
+			}
+			time = Timer() - time;
+			REPORT_STR("Mark layer");
+			REPORT_VAL("layer",layers+1);
+			REPORT_VAL("time",time);
+			ExchangeMarked();
+			time = Timer();
+			//received cells are adjacent to the outer layer of ghost cells
+			{
+				MarkerType busy = CreateMarker();
+				element_set ref_cur;
+				element_set & ref_old = ghost_layers_recv[layers-1];
+				for(element_set::iterator it = ref_old.begin(); it != ref_old.end(); ++it) SetMarker(*it,busy);
+				if( layers > 1 ) for(element_set::iterator it = ghost_layers_recv[layers-2].begin(); it != ghost_layers_recv[layers-2].end(); ++it) SetMarker(*it,busy);
+				for(element_set::iterator it = ref_old.begin(); it != ref_old.end(); ++it)
+				{
+					ElementArray<Element> adj_bridge = Element(this,*it)->getAdjElements(bridge);
+					for(ElementArray<Element>::iterator jt = adj_bridge.begin(); jt != adj_bridge.end(); ++jt)
+					{
+						ElementArray<Element> adj = jt->getAdjElements(CELL);
+						for(ElementArray<Element>::iterator kt = adj.begin(); kt != adj.end(); ++kt)
+							if( !kt->GetMarker(busy) && kt->GetStatus() == Element::Ghost )
+							{
+								kt->SetMarker(busy);
+								ref_cur.push_back(*kt);
+							}
+					}
+				}
+				for(element_set::iterator it = ref_old.begin(); it != ref_old.end(); ++it) RemMarker(*it,busy);
+				if( layers > 1 ) for(element_set::iterator it = ghost_layers_recv[layers-2].begin(); it != ghost_layers_recv[layers-2].end(); ++it) RemMarker(*it,busy);
+				if( !ref_cur.empty() ) RemMarkerArray(&ref_cur[0],static_cast<enumerator>(ref_cur.size()),busy);
+				ReleaseMarker(busy);
+				ghost_layers_recv.push_back(element_set());
+				ghost_layers_recv.back().swap(ref_cur);
+			}
+			time = Timer() - time;
+			REPORT_STR("Determine received layer");
+			REPORT_VAL("time",time);
+			Integer(GetHandle(),tag_layers) = layers+1;
+		}
+#else //USE_MPI
+		(void) bridge;
+#endif //USE_MPI
+		EXIT_FUNC();
+	}
+	
+	void Mesh::RemoveGhostLayer()
+	{
+		if( m_state == Serial ) return;
+		ENTER_FUNC();
+#if defined(USE_MPI)
+		Storage::integer layers = Integer(GetHandle(),tag_layers);
+		ElementType bridge = Integer(GetHandle(),tag_bridge);
+		if( layers == 1 ) RemoveGhost();
+		else if( layers > 1 && Integrate(ghost_layers_valid ? 0 : 1) > 0 )
+		{
+			REPORT_STR("Layers were altered, fall back to ExchangeGhost");
+			ExchangeGhost(layers-1,bridge);
+		}
+		else if( layers > 1 )
+		{
+			if( ghost_layers_recv.size() != static_cast<size_t>(layers) ) ComputeGhostLayersRecv(layers,bridge);
+			element_set del_ghost;
+			del_ghost.swap(ghost_layers_recv.back());
+			ghost_layers_recv.pop_back();
+			remove_invalid_elements(this,del_ghost);
+			RemoveGhostElements(del_ghost.empty() ? NULL : &del_ghost[0],static_cast<enumerator>(del_ghost.size()));
+			for(std::map<int, std::vector<element_set> >::iterator it = ghost_layers_sent.begin(); it != ghost_layers_sent.end(); ++it)
+			{
+				if( it->second.size() == static_cast<size_t>(layers) ) it->second.pop_back();
+				for(std::vector<element_set>::iterator jt = it->second.begin(); jt != it->second.end(); ++jt)
+					remove_invalid_elements(this,*jt);
+			}
+			for(std::vector<element_set>::iterator jt = ghost_layers_recv.begin(); jt != ghost_layers_recv.end(); ++jt)
+				remove_invalid_elements(this,*jt);
+			Integer(GetHandle(),tag_layers) = layers-1;
+		}
+#endif //USE_MPI
+		EXIT_FUNC();
+	}
+	
 	void Mesh::Redistribute()
 	{
 		if( m_state == Serial ) return;
@@ -4536,6 +5164,9 @@ namespace INMOST
 		Tag tag_new_processors = CreateTag("TEMPORARY_NEW_PROCESSORS",DATA_INTEGER,CELL | FACE | EDGE | NODE, NONE);
 		ElementType bridge = Integer(GetHandle(),tag_bridge);
 		Storage::integer layers = Integer(GetHandle(),tag_layers);
+		ghost_layers_sent.clear();
+		ghost_layers_recv.clear();
+		ghost_layers_valid = false;
 		
 		ExchangeData(tag_new_owner,CELL,0);
 		
@@ -0,0 +1,233 @@
+#ifdef _MSC_VER //kill some warnings
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+#include "inmost.h"
+#include <sstream>
+#include <iomanip>
+
+namespace INMOST
+{
+	struct TraceRecord
+	{
+		const char * name;
+		double start, duration, mpi_time;
+		size_t bytes_sent, bytes_recv, elements;
+		size_t id; //position in trace_stats
+		int depth;
+	};
+
+	struct TraceStatistics
+	{
+		size_t calls, bytes_sent, bytes_recv, elements;
+		double time, mpi_time;
+		TraceStatistics() : calls(0), bytes_sent(0), bytes_recv(0), elements(0), time(0), mpi_time(0) {}
+	};
+
+	struct TraceMerged
+	{
+		size_t calls, bytes_sent, bytes_recv, elements;
+		double time_max, time_sum, mpi_max, mpi_sum;
+		TraceMerged() : calls(0), bytes_sent(0), bytes_recv(0), elements(0), time_max(0), time_sum(0), mpi_max(0), mpi_sum(0) {}
+	};
+
+	static bool merged_by_mpi(const std::pair<std::string,TraceMerged> & a, const std::pair<std::string,TraceMerged> & b)
+	{
+		return a.second.mpi_max > b.second.mpi_max;
+	}
+
+	//state of the tracer, functions are expected to be called from a single thread
+	static std::vector<TraceRecord> trace_ring; //ring buffer of finished events
+	static size_t trace_head = 0; //position of the next event in ring buffer
+	static size_t trace_count = 0; //number of valid events in ring buffer
+	static std::vector<TraceRecord> trace_stack; //started events
+	static std::vector<TraceStatistics> trace_stats; //statistics per function
+	static std::vector<std::string> trace_names; //function name for each entry of trace_stats
+	static std::map<std::string,size_t> trace_ids; //position of the function name in trace_stats
+	static std::map<const char *,size_t> trace_ids_cache; //same for name pointers, usually string literals
+	static double trace_origin = 0; //time of the first Enable
+
+	bool Trace::enabled = false;
+
+	void Trace::Enable(size_t capacity)
+	{
+		if( trace_ring.size() != capacity )
+		{
+			trace_ring.resize(capacity);
+			trace_head = trace_count = 0;
+		}
+		if( trace_origin == 0 ) trace_origin = Timer();
+		enabled = true;
+	}
+
+	void Trace::Disable()
+	{
+		enabled = false;
+	}
+
+	void Trace::Clear()
+	{
+		trace_head = trace_count = 0;
+		trace_stack.clear();
+		std::fill(trace_stats.begin(),trace_stats.end(),TraceStatistics());
+	}
+
+	static size_t TraceIdentifier(const char * name)
+	{
+		std::map<const char *,size_t>::iterator it = trace_ids_cache.find(name);
+		if( it != trace_ids_cache.end() ) return it->second;
+		std::map<std::string,size_t>::iterator jt = trace_ids.find(name);
+		size_t id;
+		if( jt != trace_ids.end() ) id = jt->second;
+		else
+		{
+			id = trace_stats.size();
+			trace_ids[name] = id;
+			trace_names.push_back(name);
+			trace_stats.push_back(TraceStatistics());
+		}
+		trace_ids_cache[name] = id;
+		return id;
+	}
+
+	void Trace::Begin(const char * name)
+	{
+		TraceRecord r;
+		r.name = name;
+		r.id = TraceIdentifier(name);
+		r.start = Timer();
+		r.duration = r.mpi_time = 0;
+		r.bytes_sent = r.bytes_recv = r.elements = 0;
+		r.depth = static_cast<int>(trace_stack.size());
+		trace_stack.push_back(r);
+	}
+
+	void Trace::End()
+	{
+		if( trace_stack.empty() ) return;
+		TraceRecord & r = trace_stack.back();
+		r.duration = Timer() - r.start;
+		TraceStatistics & s = trace_stats[r.id];
+		s.calls++;
+		s.time += r.duration;
+		s.mpi_time += r.mpi_time;
+		s.bytes_sent += r.bytes_sent;
+		s.bytes_recv += r.bytes_recv;
+		s.elements += r.elements;
+		if( !trace_ring.empty() )
+		{
+			trace_ring[trace_head] = r;
+			trace_head = (trace_head+1) % trace_ring.size();
+			if( trace_count < trace_ring.size() ) trace_count++;
+		}
+		trace_stack.pop_back();
+	}
+
+	void Trace::MPITime(double seconds)
+	{
+		if( !trace_stack.empty() ) trace_stack.back().mpi_time += seconds;
+	}
+
+	void Trace::Bytes(size_t sent, size_t received)
+	{
+		if( !trace_stack.empty() )
+		{
+			trace_stack.back().bytes_sent += sent;
+			trace_stack.back().bytes_recv += received;
+		}
+	}
+
+	void Trace::Elements(size_t count)
+	{
+		if( !trace_stack.empty() ) trace_stack.back().elements += count;
+	}
+
+	void Trace::WriteChromeTrace(std::string file, int rank)
+	{
+		std::ofstream out(file.c_str());
+		if( out.fail() ) throw BadFileName;
+		out << "{\"traceEvents\":[\n";
+		out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << rank << ",\"tid\":0,\"args\":{\"name\":\"rank " << rank << "\"}}";
+		out << std::fixed << std::setprecision(3);
+		size_t first = (trace_head + trace_ring.size() - trace_count) % std::max<size_t>(trace_ring.size(),1);
+		for(size_t k = 0; k < trace_count; ++k)
+		{
+			const TraceRecord & r = trace_ring[(first+k) % trace_ring.size()];
+			out << ",\n{\"name\":\"" << r.name << "\",\"ph\":\"X\",\"pid\":" << rank << ",\"tid\":0";
+			out << ",\"ts\":" << (r.start - trace_origin)*1.0e+6 << ",\"dur\":" << r.duration*1.0e+6;
+			out << ",\"args\":{\"mpi_us\":" << r.mpi_time*1.0e+6;
+			out << ",\"bytes_sent\":" << r.bytes_sent << ",\"bytes_recv\":" << r.bytes_recv;
+			out << ",\"elements\":" << r.elements << ",\"depth\":" << r.depth << "}}";
+		}
+		out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+		out.close();
+	}
+
+	void Trace::WriteSummary(std::string file, INMOST_MPI_Comm comm)
+	{
+		int rank = 0, size = 1;
+		std::stringstream local;
+		local << std::setprecision(17);
+		for(size_t k = 0; k < trace_stats.size(); ++k) if( trace_stats[k].calls )
+		{
+			const TraceStatistics & s = trace_stats[k];
+			local << trace_names[k] << " " << s.calls << " " << s.time << " " << s.mpi_time << " ";
+			local << s.bytes_sent << " " << s.bytes_recv << " " << s.elements << "\n";
+		}
+		std::string all = local.str();
+#if defined(USE_MPI)
+		int flag = 0, finalized = 0;
+		MPI_Initialized(&flag);
+		MPI_Finalized(&finalized);
+		if( flag && !finalized )
+		{
+			MPI_Comm_rank(comm,&rank);
+			MPI_Comm_size(comm,&size);
+			int len = static_cast<int>(all.size());
+			std::vector<int> lens(size,0), displs(size+1,0);
+			MPI_Gather(&len,1,MPI_INT,&lens[0],1,MPI_INT,0,comm);
+			for(int k = 0; k < size; ++k) displs[k+1] = displs[k] + lens[k];
+			std::vector<char> recv(rank == 0 ? displs[size] + 1 : 1);
+			MPI_Gatherv(all.empty() ? NULL : &all[0],len,MPI_CHAR,&recv[0],&lens[0],&displs[0],MPI_CHAR,0,comm);
+			if( rank == 0 ) all.assign(recv.begin(),recv.begin()+displs[size]);
+		}
+#else //USE_MPI
+		(void) comm;
+#endif //USE_MPI
+		if( rank != 0 ) return;
+		std::map<std::string,TraceMerged> merged;
+		std::stringstream in(all);
+		std::string name;
+		TraceStatistics s;
+		while( in >> name >> s.calls >> s.time >> s.mpi_time >> s.bytes_sent >> s.bytes_recv >> s.elements )
+		{
+			TraceMerged & m = merged[name];
+			m.calls += s.calls;
+			m.bytes_sent += s.bytes_sent;
+			m.bytes_recv += s.bytes_recv;
+			m.elements += s.elements;
+			m.time_max = std::max(m.time_max,s.time);
+			m.time_sum += s.time;
+			m.mpi_max = std::max(m.mpi_max,s.mpi_time);
+			m.mpi_sum += s.mpi_time;
+		}
+		std::vector< std::pair<std::string,TraceMerged> > order(merged.begin(),merged.end());
+		std::sort(order.begin(),order.end(),merged_by_mpi);
+		std::ofstream out(file.c_str());
+		if( out.fail() ) throw BadFileName;
+		out << "# processors " << size << ", time and MPI time in seconds (max and average over processors)\n";
+		out << "# MPI time, bytes and elements are accounted only in the function itself, time includes nested calls\n";
+		out << std::left << std::setw(32) << "# function" << std::right;
+		out << std::setw(10) << "calls" << std::setw(14) << "time max" << std::setw(14) << "time avg";
+		out << std::setw(14) << "MPI max" << std::setw(14) << "MPI avg";
+		out << std::setw(16) << "bytes sent" << std::setw(16) << "bytes recv" << std::setw(14) << "elements" << "\n";
+		for(size_t k = 0; k < order.size(); ++k)
+		{
+			const TraceMerged & m = order[k].second;
+			out << std::left << std::setw(32) << order[k].first << std::right;
+			out << std::setw(10) << m.calls << std::setw(14) << m.time_max << std::setw(14) << m.time_sum/size;
+			out << std::setw(14) << m.mpi_max << std::setw(14) << m.mpi_sum/size;
+			out << std::setw(16) << m.bytes_sent << std::setw(16) << m.bytes_recv << std::setw(14) << m.elements << "\n";
+		}
+		out.close();
+	}
+}
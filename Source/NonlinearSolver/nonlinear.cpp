@@ -1 +1,260 @@
-#include "inmost_nonlinear.h"
\ No newline at end of file
+#include "inmost.h"
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#if defined(USE_NONLINEAR) && defined(USE_AUTODIFF) && defined(USE_SOLVER)
+namespace INMOST
+{
+	NonlinearSolver::NonlinearSolver(Solver & _S)
+	: S(&_S), action(FINISHED), residual(0.0), reason("")
+	{
+		maximum_iterations = 50;
+		absolute_tolerance = 1.0e-9;
+		relative_tolerance = 1.0e-8;
+		divergence_tolerance = 1.0e+20;
+		line_search = 8;
+		sufficient_decrease = 1.0e-4;
+		adaptive_forcing = 1;
+		forcing_initial = 0.5;
+		forcing_maximum = 0.9;
+		forcing_gamma = 0.9;
+		forcing_alpha = 2.0;
+		preconditioner_lag = 3;
+		lag_reduction = 0.5;
+		lag_iterations = 2.0;
+		verbosity = 0;
+	}
+
+	NonlinearSolver::NonlinearSolver(const NonlinearSolver & other)
+	{
+		*this = other;
+	}
+
+	NonlinearSolver & NonlinearSolver::operator =(NonlinearSolver const & other)
+	{
+		S = other.S;
+		action = other.action;
+		residual = other.residual;
+		reason = other.reason;
+		history = other.history;
+		maximum_iterations = other.maximum_iterations;
+		absolute_tolerance = other.absolute_tolerance;
+		relative_tolerance = other.relative_tolerance;
+		divergence_tolerance = other.divergence_tolerance;
+		line_search = other.line_search;
+		sufficient_decrease = other.sufficient_decrease;
+		adaptive_forcing = other.adaptive_forcing;
+		forcing_initial = other.forcing_initial;
+		forcing_maximum = other.forcing_maximum;
+		forcing_gamma = other.forcing_gamma;
+		forcing_alpha = other.forcing_alpha;
+		preconditioner_lag = other.preconditioner_lag;
+		lag_reduction = other.lag_reduction;
+		lag_iterations = other.lag_iterations;
+		verbosity = other.verbosity;
+		return *this;
+	}
+
+	NonlinearSolver::~NonlinearSolver() {}
+
+	void NonlinearSolver::SetParameterEnum(std::string name, INMOST_DATA_ENUM_TYPE value)
+	{
+		if( name == "maximum_iterations" ) maximum_iterations = value;
+		else if( name == "line_search" ) line_search = value;
+		else if( name == "adaptive_forcing" ) adaptive_forcing = value;
+		else if( name == "preconditioner_lag" ) preconditioner_lag = value;
+		else if( name == "verbosity" ) verbosity = value;
+		else std::cout << "Parameter " << name << " of integral type is unknown" << std::endl;
+	}
+
+	void NonlinearSolver::SetParameterReal(std::string name, INMOST_DATA_REAL_TYPE value)
+	{
+		if( name == "absolute_tolerance" ) absolute_tolerance = value;
+		else if( name == "relative_tolerance" ) relative_tolerance = value;
+		else if( name == "divergence_tolerance" ) divergence_tolerance = value;
+		else if( name == "sufficient_decrease" ) sufficient_decrease = value;
+		else if( name == "forcing_initial" ) forcing_initial = value;
+		else if( name == "forcing_maximum" ) forcing_maximum = value;
+		else if( name == "forcing_gamma" ) forcing_gamma = value;
+		else if( name == "forcing_alpha" ) forcing_alpha = value;
+		else if( name == "lag_reduction" ) lag_reduction = value;
+		else if( name == "lag_iterations" ) lag_iterations = value;
+		else std::cout << "Parameter " << name << " of real type is unknown" << std::endl;
+	}
+
+	INMOST_DATA_REAL_TYPE NonlinearSolver::Assemble(NonlinearProblem & P, Residual & R, IterationInfo & info)
+	{
+		double t = Timer();
+		action = COMPUTE_FUNCTION | COMPUTE_JACOBIAN;
+		R.Clear();
+		P.Assemble(R,action);
+		INMOST_DATA_REAL_TYPE norm = R.Norm();
+		info.assembly_time += Timer() - t;
+		return norm;
+	}
+
+	bool NonlinearSolver::Update(NonlinearProblem & P, const Sparse::Vector & dx, INMOST_DATA_REAL_TYPE alpha, IterationInfo & info)
+	{
+		double t = Timer();
+		bool ret = P.Update(dx,alpha);
+		info.update_time += Timer() - t;
+		return ret;
+	}
+
+	bool NonlinearSolver::Solve(NonlinearProblem & P, Residual & R)
+	{
+		INMOST_DATA_ENUM_TYPE beg, end;
+		R.GetInterval(beg,end);
+		Sparse::Vector dx("",beg,end,R.GetResidual().GetCommunicator());
+		int rank = 0;
+#if defined(USE_MPI)
+		MPI_Comm_rank(R.GetResidual().GetCommunicator(),&rank);
+#endif
+		bool success = false, have_preconditioner = false, pattern_set = false;
+		INMOST_DATA_ENUM_TYPE lag = 0, fresh_iterations = 0;
+		INMOST_DATA_REAL_TYPE norm, norm0, norm_prev = 0, forcing = forcing_initial, forcing_prev = forcing_initial;
+		IterationInfo info;
+		memset(&info,0,sizeof(IterationInfo));
+		history.clear();
+		norm = norm0 = Assemble(P,R,info);
+		while( true )
+		{
+			if( norm != norm )
+			{
+				reason = "residual is not a number";
+				break;
+			}
+			if( norm < absolute_tolerance )
+			{
+				reason = "converged to absolute tolerance";
+				success = true;
+				break;
+			}
+			if( norm < relative_tolerance*norm0 )
+			{
+				reason = "converged to relative tolerance";
+				success = true;
+				break;
+			}
+			if( norm > divergence_tolerance )
+			{
+				reason = "diverged";
+				break;
+			}
+			if( history.size() >= maximum_iterations )
+			{
+				reason = "reached maximum number of iterations";
+				break;
+			}
+			info.residual = norm;
+			//Eisenstat-Walker forcing term, choice 2 with safeguards
+			if( adaptive_forcing && !history.empty() )
+			{
+				INMOST_DATA_REAL_TYPE safeguard = forcing_gamma*::pow(forcing_prev,forcing_alpha);
+				forcing = forcing_gamma*::pow(norm/norm_prev,forcing_alpha);
+				if( safeguard > 0.1 ) forcing = std::max(forcing,safeguard);
+				//do not oversolve on the last iteration
+				forcing = std::max(forcing,0.5*std::max(absolute_tolerance,relative_tolerance*norm0)/norm);
+				forcing = std::min(forcing,forcing_maximum);
+			}
+			else forcing = forcing_initial;
+			info.forcing = forcing;
+			S->SetParameterReal("relative_tolerance",forcing);
+			//keep preconditioner while nonlinear and linear iterations converge fast,
+			//without frozen pattern the matrix is set up from scratch and the preconditioner is rebuilt anyway
+			bool reuse = R.isPatternFrozen() && have_preconditioner && lag < preconditioner_lag &&
+				norm < lag_reduction*norm_prev &&
+				history.back().linear_iterations <= lag_iterations*std::max<INMOST_DATA_ENUM_TYPE>(fresh_iterations,1);
+			double t = Timer();
+			S->SetMatrix(R.GetJacobian(),!(pattern_set && R.isPatternFrozen()),reuse);
+			info.setup_time += Timer() - t;
+			pattern_set = true;
+			std::fill(dx.Begin(),dx.End(),0.0);
+			t = Timer();
+			bool solved = S->Solve(R.GetResidual(),dx);
+			info.solve_time += Timer() - t;
+			info.linear_iterations += S->Iterations();
+			if( !solved && reuse )
+			{
+				//lagged preconditioner failed, build a new one
+				reuse = false;
+				t = Timer();
+				S->SetMatrix(R.GetJacobian(),!R.isPatternFrozen(),false);
+				info.setup_time += Timer() - t;
+				std::fill(dx.Begin(),dx.End(),0.0);
+				t = Timer();
+				solved = S->Solve(R.GetResidual(),dx);
+				info.solve_time += Timer() - t;
+				info.linear_iterations += S->Iterations();
+			}
+			if( !solved )
+			{
+				reason = "linear solver failed: " + S->ReturnReason();
+				break;
+			}
+			info.reused = reuse;
+			if( reuse ) lag++;
+			else
+			{
+				lag = 0;
+				fresh_iterations = S->Iterations();
+				have_preconditioner = true;
+			}
+			//backtracking line search
+			INMOST_DATA_REAL_TYPE step = 1.0, applied = 0.0, norm_new = norm;
+			bool accepted = false;
+			for(INMOST_DATA_ENUM_TYPE k = 0; ; ++k)
+			{
+				bool admissible = Update(P,dx,applied-step,info);
+				applied = step;
+				if( admissible )
+				{
+					norm_new = Assemble(P,R,info);
+					if( !line_search || norm_new <= (1.0 - sufficient_decrease*step*(1.0-forcing))*norm )
+					{
+						accepted = true;
+						break;
+					}
+				}
+				if( k >= line_search ) break;
+				//minimum of quadratic model of ||R||^2 along the step, safeguarded
+				INMOST_DATA_REAL_TYPE next = 0.5*step;
+				if( admissible && norm_new == norm_new )
+				{
+					INMOST_DATA_REAL_TYPE phi0 = norm*norm, phi1 = norm_new*norm_new;
+					INMOST_DATA_REAL_TYPE den = phi1 - phi0 + 2.0*phi0*step;
+					if( den > 0 ) next = phi0*step*step/den;
+					next = std::min(std::max(next,0.1*step),0.5*step);
+				}
+				step = next;
+				info.line_search++;
+			}
+			info.step = step;
+			history.push_back(info);
+			if( verbosity && rank == 0 )
+			{
+				std::cout << "iteration " << history.size() << " residual " << norm << " forcing " << forcing;
+				std::cout << " linear iterations " << info.linear_iterations << (info.reused ? " reused" : "");
+				std::cout << " step " << step << " assembly " << info.assembly_time << " setup " << info.setup_time;
+				std::cout << " solve " << info.solve_time << " update " << info.update_time << std::endl;
+			}
+			if( !accepted )
+			{
+				reason = "line search failed to reduce the residual";
+				norm = norm_new;
+				break;
+			}
+			norm_prev = norm;
+			forcing_prev = forcing;
+			norm = norm_new;
+			memset(&info,0,sizeof(IterationInfo));
+		}
+		if( verbosity && rank == 0 )
+			std::cout << "nonlinear solver: " << reason << " residual " << norm << " iterations " << history.size() << std::endl;
+		residual = norm;
+		action = FINISHED;
+		return success;
+	}
+}
+#endif //USE_NONLINEAR && USE_AUTODIFF && USE_SOLVER
@@ -23,10 +23,10 @@
 #define ENTER_FUNC() long double all_time = Timer(); m->WriteTab(m->GetStream()) << "<FUNCTION name=\"" << __FUNCTION__ << "\" id=\"func" << m->GetFuncID()++ << "\">" << std::endl; m->Enter();
 #define EXIT_FUNC() m->WriteTab(m->GetStream()) << "<TIME>" << Timer() - all_time << "</TIME>" << std::endl; m->Exit(); m->WriteTab(m->GetStream()) << "</FUNCTION>" << std::endl;
 #else
-#define REPORT_MPI(x) x
+#define REPORT_MPI(x) {TraceMPI trace_mpi; x;}
 #define REPORT_STR(x) {}
 #define REPORT_VAL(str,x) {}
-#define ENTER_FUNC() {}
+#define ENTER_FUNC() TraceScope trace_scope(__FUNCTION__);
 #define EXIT_FUNC() {}
 #endif
 
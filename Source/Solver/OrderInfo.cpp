@@ -71,6 +71,8 @@ namespace INMOST {
         global_overlap.resize(size * 2);
         global_to_proc.resize(size + 1);
         m.GetInterval(mbeg, mend);
+        matrix_exchange_recv.clear();
+        matrix_exchange_send.clear();
         global_to_proc[0] = 0;
         initial_matrix_begin = mbeg;
         initial_matrix_end = mend;
@@ -343,6 +345,21 @@ namespace INMOST {
                 recv_row_sizes.resize(total_recv);
 
                 INMOST_DATA_ENUM_TYPE j = 1, q = 0, f = 0, total_rows_send = 0, total_rows_recv = 0;
+                //remember rows exchanged on this layer, to refresh their values in UpdateMatrix
+                for (INMOST_DATA_ENUM_TYPE k = 0; k < vector_exchange_recv[0]; k++) {
+                    matrix_exchange_recv.push_back(vector_exchange_recv[j]);
+                    matrix_exchange_recv.push_back(vector_exchange_recv[j + 1]);
+                    for (INMOST_DATA_ENUM_TYPE r = 0; r < vector_exchange_recv[j + 1]; r++)
+                        matrix_exchange_recv.push_back(global_to_local[vector_exchange_recv[j + 2 + r]]);
+                    j += vector_exchange_recv[j + 1] + 2;
+                }
+                j = 1;
+                for (INMOST_DATA_ENUM_TYPE k = 0; k < vector_exchange_send[0]; k++) {
+                    matrix_exchange_send.insert(matrix_exchange_send.end(), vector_exchange_send.begin() + j,
+                                                vector_exchange_send.begin() + j + vector_exchange_send[j + 1] + 2);
+                    j += vector_exchange_send[j + 1] + 2;
+                }
+                j = 1;
                 for (INMOST_DATA_ENUM_TYPE k = 0; k < vector_exchange_recv[0]; k++) //recv sizes of rows
                 {
                     GUARD_MPI(MPI_Irecv(&recv_row_sizes[q], vector_exchange_recv[j + 1], INMOST_MPI_DATA_ENUM_TYPE,
@@ -463,6 +480,87 @@ namespace INMOST {
 #endif
     }
 
+    bool Solver::OrderInfo::UpdateMatrix(Sparse::Matrix &m, const Sparse::Matrix &A) {
+        INMOST_DATA_ENUM_TYPE mbeg, mend;
+        A.GetInterval(mbeg, mend);
+        int same = (have_matrix && mbeg == initial_matrix_begin && mend == initial_matrix_end) ? 1 : 0;
+        //compare patterns, indices outside of the local interval were renumbered by PrepareMatrix
+        for (INMOST_DATA_ENUM_TYPE k = mbeg; k < mend && same; ++k) {
+            const Sparse::Row &r = A[k], &q = m[k];
+            if (r.Size() != q.Size()) same = 0;
+            else for (INMOST_DATA_ENUM_TYPE j = 0; j < r.Size(); ++j) {
+                    INMOST_DATA_ENUM_TYPE ind = q.GetIndex(j);
+                    if (ind >= local_matrix_end && ind - local_matrix_end < extended_indexes.size())
+                        ind = extended_indexes[ind - local_matrix_end];
+                    if (ind != r.GetIndex(j)) {
+                        same = 0;
+                        break;
+                    }
+                }
+        }
+#if defined(USE_MPI)
+        if (size > 1) {
+            int ierr = 0, tmp = same;
+            GUARD_MPI(MPI_Allreduce(&tmp, &same, 1, MPI_INT, MPI_MIN, comm));
+        }
+#endif
+        if (!same) return false;
+        for (INMOST_DATA_ENUM_TYPE k = mbeg; k < mend; ++k) {
+            const Sparse::Row &r = A[k];
+            Sparse::Row &q = m[k];
+            for (INMOST_DATA_ENUM_TYPE j = 0; j < r.Size(); ++j)
+                q.GetValue(j) = r.GetValue(j);
+        }
+#if defined(USE_MPI)
+        if (!matrix_exchange_recv.empty() || !matrix_exchange_send.empty()) {
+            int ierr = 0;
+            std::vector<INMOST_DATA_REAL_TYPE> send_values, recv_values;
+            std::vector<INMOST_DATA_ENUM_TYPE> recv_offsets;
+            std::vector<MPI_Request> requests;
+            INMOST_DATA_ENUM_TYPE j, f;
+            //row sizes are the same on both sides, since the rows were copied by PrepareMatrix
+            for (j = 0; j < matrix_exchange_recv.size(); j += matrix_exchange_recv[j + 1] + 2) {
+                recv_offsets.push_back(static_cast<INMOST_DATA_ENUM_TYPE>(recv_values.size()));
+                for (INMOST_DATA_ENUM_TYPE r = 0; r < matrix_exchange_recv[j + 1]; r++)
+                    recv_values.resize(recv_values.size() + m[matrix_exchange_recv[j + 2 + r]].Size());
+            }
+            recv_offsets.push_back(static_cast<INMOST_DATA_ENUM_TYPE>(recv_values.size()));
+            requests.reserve(recv_offsets.size() + matrix_exchange_send.size());
+            for (j = 0, f = 0; j < matrix_exchange_recv.size(); j += matrix_exchange_recv[j + 1] + 2, ++f) {
+                requests.push_back(MPI_REQUEST_NULL);
+                GUARD_MPI(MPI_Irecv(recv_values.empty() ? NULL : &recv_values[recv_offsets[f]],
+                                    recv_offsets[f + 1] - recv_offsets[f], INMOST_MPI_DATA_REAL_TYPE,
+                                    matrix_exchange_recv[j], 5 * size + matrix_exchange_recv[j], comm,
+                                    &requests.back()));
+            }
+            std::vector<INMOST_DATA_ENUM_TYPE> send_offsets(1, 0);
+            for (j = 0; j < matrix_exchange_send.size(); j += matrix_exchange_send[j + 1] + 2) {
+                for (INMOST_DATA_ENUM_TYPE r = 0; r < matrix_exchange_send[j + 1]; r++) {
+                    const Sparse::Row &q = m[matrix_exchange_send[j + 2 + r]];
+                    for (INMOST_DATA_ENUM_TYPE l = 0; l < q.Size(); ++l)
+                        send_values.push_back(q.GetValue(l));
+                }
+                send_offsets.push_back(static_cast<INMOST_DATA_ENUM_TYPE>(send_values.size()));
+            }
+            for (j = 0, f = 0; j < matrix_exchange_send.size(); j += matrix_exchange_send[j + 1] + 2, ++f) {
+                requests.push_back(MPI_REQUEST_NULL);
+                GUARD_MPI(MPI_Isend(send_values.empty() ? NULL : &send_values[send_offsets[f]],
+                                    send_offsets[f + 1] - send_offsets[f], INMOST_MPI_DATA_REAL_TYPE,
+                                    matrix_exchange_send[j], 5 * size + rank, comm, &requests.back()));
+            }
+            if (!requests.empty()) GUARD_MPI(MPI_Waitall(static_cast<int>(requests.size()), &requests[0], MPI_STATUSES_IGNORE));
+            for (j = 0, f = 0; j < matrix_exchange_recv.size(); j += matrix_exchange_recv[j + 1] + 2) {
+                for (INMOST_DATA_ENUM_TYPE r = 0; r < matrix_exchange_recv[j + 1]; r++) {
+                    Sparse::Row &q = m[matrix_exchange_recv[j + 2 + r]];
+                    for (INMOST_DATA_ENUM_TYPE l = 0; l < q.Size(); ++l)
+                        q.GetValue(l) = recv_values[f++];
+                }
+            }
+        }
+#endif
+        return true;
+    }
+
     void Solver::OrderInfo::RestoreMatrix(Sparse::Matrix &m) {
         //restore matrix size
         m.SetInterval(initial_matrix_begin, initial_matrix_end);
@@ -494,6 +592,8 @@ namespace INMOST {
         global_overlap.clear();
         vector_exchange_recv.clear();
         vector_exchange_send.clear();
+        matrix_exchange_recv.clear();
+        matrix_exchange_send.clear();
         send_storage.clear();
         recv_storage.clear();
         send_requests.clear();
@@ -524,6 +624,8 @@ namespace INMOST {
             global_overlap(),
             vector_exchange_recv(),
             vector_exchange_send(),
+            matrix_exchange_recv(),
+            matrix_exchange_send(),
             send_storage(),
             recv_storage(),
             send_requests(),
@@ -544,6 +646,7 @@ namespace INMOST {
     Solver::OrderInfo::OrderInfo(const OrderInfo &other)
             : global_to_proc(other.global_to_proc), global_overlap(other.global_overlap),
               vector_exchange_recv(other.vector_exchange_recv), vector_exchange_send(other.vector_exchange_send),
+              matrix_exchange_recv(other.matrix_exchange_recv), matrix_exchange_send(other.matrix_exchange_send),
               extended_indexes(other.extended_indexes) {
 #if defined(USE_MPI)
         if (other.comm == INMOST_MPI_COMM_WORLD)
@@ -579,6 +682,8 @@ namespace INMOST {
         global_overlap = other.global_overlap;
         vector_exchange_recv = other.vector_exchange_recv;
         vector_exchange_send = other.vector_exchange_send;
+        matrix_exchange_recv = other.matrix_exchange_recv;
+        matrix_exchange_send = other.matrix_exchange_send;
         extended_indexes = other.extended_indexes;
         rank = other.rank;
         size = other.size;
@@ -39,6 +39,11 @@ namespace INMOST {
 
         virtual void SetMatrix(Sparse::Matrix &A, bool ModifiedPattern, bool OldPreconditioner) = 0;
 
+        virtual void SetOperator(Sparse::AbstractOperator *op) {
+            (void) op;
+            throw INMOST::SolverUnsupportedOperation;
+        };
+
         virtual bool Solve(INMOST::Sparse::Vector &RHS, INMOST::Sparse::Vector &SOL) = 0;
 
         virtual bool Clear() = 0;
@@ -122,10 +122,16 @@ namespace INMOST {
     }
 
     void Solver::SetMatrix(Sparse::Matrix &A, bool ModifiedPattern, bool OldPreconditioner) {
+        TraceScope trace_scope("Solver::SetMatrix");
         solver->SetMatrix(A, ModifiedPattern, OldPreconditioner);
     }
 
+    void Solver::SetOperator(Sparse::AbstractOperator *op) {
+        solver->SetOperator(op);
+    }
+
     bool Solver::Solve(INMOST::Sparse::Vector &RHS, INMOST::Sparse::Vector &SOL) {
+        TraceScope trace_scope("Solver::Solve");
         if (!solver->isMatrixSet()) throw MatrixNotSetInSolver;
         if (RHS.GetCommunicator() != solver->GetCommunicator() ||
             SOL.GetCommunicator() != solver->GetCommunicator())
@@ -45,6 +45,21 @@ namespace INMOST {
 
     }
 
+    bool SolverInner::ReplaceMatrix(Sparse::Matrix &A, bool ModifiedPattern, INMOST_DATA_ENUM_TYPE overlap) {
+        if (matrix != NULL && !ModifiedPattern && info.UpdateMatrix(*matrix, A))
+            return true;
+        if (matrix != NULL) {
+            delete matrix;
+        }
+        matrix = new Sparse::Matrix(A);
+        info.PrepareMatrix(*matrix, overlap);
+        return false;
+    }
+
+    void SolverInner::SetOperator(Sparse::AbstractOperator *op) {
+        solver->ReplaceOperator(op);
+    }
+
     bool SolverInner::Solve(Sparse::Vector &RHS, Sparse::Vector &SOL) {
         solver->EnumParameter("maxits") = maximum_iterations;
         solver->RealParameter("rtol") = rtol;
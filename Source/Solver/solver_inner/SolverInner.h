@@ -17,6 +17,12 @@ namespace INMOST {
 
         INMOST_DATA_ENUM_TYPE maximum_iterations;
         INMOST_DATA_REAL_TYPE atol, rtol, dtol;
+
+        /// Store a copy of the matrix and prepare it for the parallel solution with given overlap.
+        /// If the pattern was not modified, values are written into the stored matrix
+        /// and the parallel structures are reused.
+        /// @return True if the stored matrix structure was reused.
+        bool ReplaceMatrix(Sparse::Matrix &A, bool ModifiedPattern, INMOST_DATA_ENUM_TYPE overlap);
     public:
         SolverInner();
 
@@ -28,6 +34,8 @@ namespace INMOST {
 
         virtual void SetMatrix(Sparse::Matrix &A, bool ModifiedPattern, bool OldPreconditioner) = 0;
 
+        virtual void SetOperator(Sparse::AbstractOperator *op);
+
         virtual bool Solve(Sparse::Vector &RHS, Sparse::Vector &SOL);
 
         virtual bool Clear();
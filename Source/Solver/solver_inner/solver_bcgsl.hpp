@@ -441,6 +441,13 @@ namespace INMOST
         INMOST_DATA_REAL_TYPE * tau, * sigma, * gamma, *theta1, * theta2, * theta3;
         Sparse::Vector r_tilde, x0, t, * u, * r;
         Sparse::Matrix * Alink;
+        Sparse::AbstractOperator * Oplink; ///< Operator used in products in place of the matrix, if set.
+        /// Product y = alpha*A*x + beta*y with the operator or with the matrix.
+        void MatVec(INMOST_DATA_REAL_TYPE alpha, Sparse::Vector & x, INMOST_DATA_REAL_TYPE beta, Sparse::Vector & y)
+        {
+            if (Oplink != NULL) Oplink->MatVec(alpha,x,beta,y);
+            else Alink->MatVec(alpha,x,beta,y);
+        }
         Method * prec;
         std::string reason;
         Solver::OrderInfo * info;
@@ -479,6 +486,7 @@ namespace INMOST
                 :rtol(1e-8), atol(1e-9), divtol(1e+40), maxits(1500),l(2),prec(prec),info(&info)
         {
             Alink = NULL;
+            Oplink = NULL;
             init = false;
         }
         bool Initialize()
@@ -531,6 +539,7 @@ namespace INMOST
             last_it = b->last_it;
             resid = b->resid;
             Alink = b->Alink;
+            Oplink = b->Oplink;
             info = b->info;
             if (init) Finalize();
             if (b->prec != NULL)
@@ -560,12 +569,12 @@ namespace INMOST
             {
                 prec->Solve(Input, t);
                 info->Update(t);
-                Alink->MatVec(1.0,t,0,Output);
+                MatVec(1.0,t,0,Output);
                 info->Update(Output);
             }
             else
             {
-                Alink->MatVec(1.0,Input,0,Output);
+                MatVec(1.0,Input,0,Output);
                 info->Update(Output);
             }
         }
@@ -595,7 +604,7 @@ namespace INMOST
             std::copy(RHS.Begin(),RHS.End(),r[0].Begin());
             {
                 // r[0] = r[0] - A x
-                Alink->MatVec(-1,SOL,1,r[0]); //global multiplication, r probably needs an update
+                MatVec(-1,SOL,1,r[0]); //global multiplication, r probably needs an update
                 info->Update(r[0]); // r is good
                 std::copy(SOL.Begin(),SOL.End(),x0.Begin()); //x0 = x
                 std::fill(SOL.Begin(),SOL.End(),0.0); //x = 0
@@ -1289,6 +1298,10 @@ namespace INMOST
             if( last_resid < atol || last_resid < rtol*resid0 ) return true;
             return false;
         }
+        /// Use the matrix-free operator in products in place of the matrix,
+        /// the matrix is still used to construct the preconditioner.
+        /// @param op Operator or NULL to return to the matrix.
+        void ReplaceOperator(Sparse::AbstractOperator * op) { Oplink = op; }
         bool ReplaceMAT(Sparse::Matrix & A) { if (isInitialized()) Finalize(); if (prec != NULL) prec->ReplaceMAT(A);  Alink = &A; return true; }
         bool ReplaceRHS(Sparse::Vector & RHS) { (void) RHS; return true; }
         bool ReplaceSOL(Sparse::Vector & SOL) { (void) SOL; return true; }
@@ -1304,6 +1317,13 @@ namespace INMOST
         INMOST_DATA_REAL_TYPE resid;
         Sparse::Vector r0, p, y, s, t, z, r, v;
         Sparse::Matrix * Alink;
+        Sparse::AbstractOperator * Oplink; ///< Operator used in products in place of the matrix, if set.
+        /// Product y = alpha*A*x + beta*y with the operator or with the matrix.
+        void MatVec(INMOST_DATA_REAL_TYPE alpha, Sparse::Vector & x, INMOST_DATA_REAL_TYPE beta, Sparse::Vector & y)
+        {
+            if (Oplink != NULL) Oplink->MatVec(alpha,x,beta,y);
+            else Alink->MatVec(alpha,x,beta,y);
+        }
         Method * prec;
         Solver::OrderInfo * info;
         bool init;
@@ -1336,6 +1356,7 @@ namespace INMOST
         BCGS_solver(Method * prec, Solver::OrderInfo & info)
                 :rtol(1e-8), atol(1e-11), divtol(1e+40), iters(0), maxits(1500),prec(prec),info(&info)
         {
+            Oplink = NULL;
             init = false;
         }
         bool Initialize()
@@ -1376,6 +1397,7 @@ namespace INMOST
             last_it = b->last_it;
             resid = b->resid;
             Alink = b->Alink;
+            Oplink = b->Oplink;
             if (b->prec != NULL)
             {
                 if (prec == NULL) prec = b->prec->Duplicate();
@@ -1421,7 +1443,7 @@ namespace INMOST
 
             std::copy(RHS.Begin(),RHS.End(),r.Begin());
             {
-                Alink->MatVec(-1,SOL,1,r); //global multiplication, r probably needs an update
+                MatVec(-1,SOL,1,r); //global multiplication, r probably needs an update
                 info->Update(r); // r is good
             }
             std::copy(r.Begin(),r.End(),r0.Begin());
@@ -1601,12 +1623,12 @@ namespace INMOST
                     {
                         prec->Solve(p, y);
                         info->Update(y);
-                        Alink->MatVec(1,y,0,v); // global multiplication, y should be updated, v probably needs an update
+                        MatVec(1,y,0,v); // global multiplication, y should be updated, v probably needs an update
                         info->Update(v);
                     }
                     else
                     {
-                        Alink->MatVec(1,p,0,v); // global multiplication, y should be updated, v probably needs an update
+                        MatVec(1,p,0,v); // global multiplication, y should be updated, v probably needs an update
                         info->Update(v);
                     }
 
@@ -1670,12 +1692,12 @@ namespace INMOST
                     {
                         prec->Solve(s, z);
                         info->Update(z);
-                        Alink->MatVec(1.0,z,0,t); // global multiplication, z should be updated, t probably needs an update
+                        MatVec(1.0,z,0,t); // global multiplication, z should be updated, t probably needs an update
                         info->Update(t);
                     }
                     else
                     {
-                        Alink->MatVec(1.0,s,0,t); // global multiplication, z should be updated, t probably needs an update
+                        MatVec(1.0,s,0,t); // global multiplication, z should be updated, t probably needs an update
                         info->Update(t);
                     }
 
@@ -1855,6 +1877,10 @@ namespace INMOST
             if( last_resid < atol || last_resid < rtol*resid0 ) return true;
             return false;
         }
+        /// Use the matrix-free operator in products in place of the matrix,
+        /// the matrix is still used to construct the preconditioner.
+        /// @param op Operator or NULL to return to the matrix.
+        void ReplaceOperator(Sparse::AbstractOperator * op) { Oplink = op; }
         bool ReplaceMAT(Sparse::Matrix & A) { if (isInitialized()) Finalize();  if (prec != NULL) prec->ReplaceMAT(A);  Alink = &A; return true; }
         bool ReplaceRHS(Sparse::Vector & RHS) {(void)RHS; return true; }
         bool ReplaceSOL(Sparse::Vector & SOL) {(void)SOL; return true; }
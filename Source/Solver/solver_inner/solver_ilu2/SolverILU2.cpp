@@ -21,11 +21,9 @@ namespace INMOST {
     }
 
     void SolverILU2::SetMatrix(Sparse::Matrix &A, bool ModifiedPattern, bool OldPreconditioner) {
-        if (matrix != NULL) {
-            delete matrix;
-        }
-        matrix = new Sparse::Matrix(A);
-        info.PrepareMatrix(*matrix, schwartz_overlap);
+        //with the old preconditioner the solver keeps working on the stored matrix with updated values
+        if (ReplaceMatrix(A, ModifiedPattern, schwartz_overlap) && OldPreconditioner && solver->isInitialized())
+            return;
         solver->ReplaceMAT(*matrix);
 
         solver->RealParameter(":tau") = drop_tolerance;
@@ -22,11 +22,9 @@ namespace INMOST {
     }
 
     void SolverMPTILU2::SetMatrix(Sparse::Matrix &A, bool ModifiedPattern, bool OldPreconditioner) {
-        if (matrix != NULL) {
-            delete matrix;
-        }
-        matrix = new Sparse::Matrix(A);
-        info.PrepareMatrix(*matrix, schwartz_overlap);
+        //with the old preconditioner the solver keeps working on the stored matrix with updated values
+        if (ReplaceMatrix(A, ModifiedPattern, schwartz_overlap) && OldPreconditioner && solver->isInitialized())
+            return;
         solver->ReplaceMAT(*matrix);
 
         solver->RealParameter(":tau") = drop_tolerance;
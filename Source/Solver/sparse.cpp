@@ -308,23 +308,216 @@ namespace INMOST
 			}
 			r.Resize(k);
 		}
+		void RowMerger::AddToRow(INMOST_DATA_REAL_TYPE coef, Row & r)
+		{
+			assert(r.isSorted());
+			if( coef == 0.0 ) r.Zero();
+			else if( coef != 1.0 ) for(Row::iterator it = r.Begin(); it != r.End(); ++it) it->second *= coef;
+			INMOST_DATA_ENUM_TYPE size = r.Size(), i = LinkedList.begin()->first, k = 0;
+			while( i != EOL )
+			{
+				INMOST_DATA_ENUM_TYPE ind = UnmapIndex(i-1);
+				if( Sorted ) //both lists are sorted
+					while( k < size && r.GetIndex(k) < ind ) ++k;
+				else
+				{
+					INMOST_DATA_ENUM_TYPE lo = 0, hi = size, mid;
+					while( lo < hi )
+					{
+						mid = (lo + hi) >> 1;
+						if( r.GetIndex(mid) < ind ) lo = mid + 1;
+						else hi = mid;
+					}
+					k = lo;
+				}
+				if( k < size && r.GetIndex(k) == ind )
+					r.GetValue(k) += LinkedList[i].second;
+				else r.Push(ind,LinkedList[i].second); //extend the pattern
+				i = LinkedList[i].first;
+			}
+			if( r.Size() != size ) std::sort(r.Begin(),r.End());
+		}
+////////class Direction
+		Direction::Direction(INMOST_MPI_Comm _comm) : comm(_comm), IntervalBeg(0), IntervalEnd(0) {}
+
+		Direction::Direction(INMOST_DATA_ENUM_TYPE interval_begin, INMOST_DATA_ENUM_TYPE interval_end, const std::vector<INMOST_DATA_ENUM_TYPE> & Pre, const std::vector<INMOST_DATA_ENUM_TYPE> & Post, INMOST_MPI_Comm _comm)
+		: comm(_comm)
+		{
+			Resize(interval_begin,interval_end,Pre,Post);
+		}
+
+		INMOST_DATA_ENUM_TYPE Direction::MapNonlocal(INMOST_DATA_ENUM_TYPE pos) const
+		{
+			if( pos < IntervalBeg )
+			{
+				std::vector< INMOST_DATA_ENUM_TYPE >::const_iterator search = std::lower_bound(NonlocalPre.begin(),NonlocalPre.end(),pos);
+				assert(search != NonlocalPre.end() && *search == pos); //is there such index?
+				return static_cast<INMOST_DATA_ENUM_TYPE>(search - NonlocalPre.begin());
+			}
+			std::vector< INMOST_DATA_ENUM_TYPE >::const_iterator search = std::lower_bound(NonlocalPost.begin(),NonlocalPost.end(),pos);
+			assert(search != NonlocalPost.end() && *search == pos); //is there such index?
+			return static_cast<INMOST_DATA_ENUM_TYPE>(NonlocalPre.size() + IntervalEnd - IntervalBeg + (search - NonlocalPost.begin()));
+		}
+
+		void Direction::Resize(INMOST_DATA_ENUM_TYPE interval_begin, INMOST_DATA_ENUM_TYPE interval_end, const std::vector<INMOST_DATA_ENUM_TYPE> & Pre, const std::vector<INMOST_DATA_ENUM_TYPE> & Post)
+		{
+			assert(interval_begin <= interval_end);
+			IntervalBeg = interval_begin;
+			IntervalEnd = interval_end;
+			NonlocalPre = Pre;
+			NonlocalPost = Post;
+			Values.assign(NonlocalPre.size() + IntervalEnd - IntervalBeg + NonlocalPost.size(),0.0);
+			exchange_recv.clear();
+			exchange_send.clear();
+#if defined(USE_MPI)
+			int size, rank;
+			MPI_Comm_size(comm,&size);
+			MPI_Comm_rank(comm,&rank);
+			if( size > 1 )
+			{
+				INMOST_DATA_ENUM_TYPE local[2] = {IntervalBeg, IntervalEnd}, k, q = 0;
+				std::vector<INMOST_DATA_ENUM_TYPE> intervals(size*2), nrecv(size,0), nsend(size,0), request(NonlocalPre);
+				request.insert(request.end(),NonlocalPost.begin(),NonlocalPost.end());
+				MPI_Allgather(local,2,INMOST_MPI_DATA_ENUM_TYPE,&intervals[0],2,INMOST_MPI_DATA_ENUM_TYPE,comm);
+				//intervals follow the order of processors, requested indices are sorted
+				for(k = 0; k < request.size(); ++k)
+				{
+					while( q < static_cast<INMOST_DATA_ENUM_TYPE>(size) && !(request[k] >= intervals[2*q] && request[k] < intervals[2*q+1]) ) ++q;
+					if( q == static_cast<INMOST_DATA_ENUM_TYPE>(size) || q == static_cast<INMOST_DATA_ENUM_TYPE>(rank) ) throw DataCorruptedInSolver;
+					nrecv[q]++;
+				}
+				MPI_Alltoall(&nrecv[0],1,INMOST_MPI_DATA_ENUM_TYPE,&nsend[0],1,INMOST_MPI_DATA_ENUM_TYPE,comm);
+				std::vector<MPI_Request> requests;
+				for(q = 0; q < static_cast<INMOST_DATA_ENUM_TYPE>(size); ++q) if( nsend[q] )
+				{
+					exchange_send.push_back(q);
+					exchange_send.push_back(nsend[q]);
+					exchange_send.resize(exchange_send.size()+nsend[q]);
+				}
+				for(q = 0, k = 0; q < static_cast<INMOST_DATA_ENUM_TYPE>(size); ++q) if( nrecv[q] )
+				{
+					exchange_recv.push_back(q);
+					exchange_recv.push_back(nrecv[q]);
+					requests.push_back(MPI_REQUEST_NULL);
+					MPI_Isend(&request[k],nrecv[q],INMOST_MPI_DATA_ENUM_TYPE,q,rank*size+q,comm,&requests.back());
+					k += nrecv[q];
+				}
+				for(k = 0; k < exchange_send.size(); k += exchange_send[k+1]+2)
+				{
+					requests.push_back(MPI_REQUEST_NULL);
+					MPI_Irecv(&exchange_send[k+2],exchange_send[k+1],INMOST_MPI_DATA_ENUM_TYPE,exchange_send[k],exchange_send[k]*size+rank,comm,&requests.back());
+				}
+				if( !requests.empty() ) MPI_Waitall(static_cast<int>(requests.size()),&requests[0],MPI_STATUSES_IGNORE);
+			}
+#endif //USE_MPI
+		}
+
+		void Direction::Update()
+		{
+#if defined(USE_MPI)
+			if( exchange_recv.empty() && exchange_send.empty() ) return;
+			int size, rank;
+			MPI_Comm_size(comm,&size);
+			MPI_Comm_rank(comm,&rank);
+			INMOST_DATA_ENUM_TYPE k, l, pos = 0, npre = static_cast<INMOST_DATA_ENUM_TYPE>(NonlocalPre.size());
+			std::vector<MPI_Request> requests;
+			std::vector<INMOST_DATA_REAL_TYPE> send_storage;
+			for(k = 0; k < exchange_send.size(); k += exchange_send[k+1]+2)
+				for(l = 0; l < exchange_send[k+1]; ++l)
+					send_storage.push_back((*this)[exchange_send[k+2+l]]);
+			//values of a processor are either all before or all after the owned interval
+			for(k = 0; k < exchange_recv.size(); k += 2)
+			{
+				requests.push_back(MPI_REQUEST_NULL);
+				MPI_Irecv(&Values[pos < npre ? pos : pos + IntervalEnd - IntervalBeg],exchange_recv[k+1],INMOST_MPI_DATA_REAL_TYPE,exchange_recv[k],exchange_recv[k]*size+rank,comm,&requests.back());
+				pos += exchange_recv[k+1];
+			}
+			for(k = 0, pos = 0; k < exchange_send.size(); k += exchange_send[k+1]+2)
+			{
+				requests.push_back(MPI_REQUEST_NULL);
+				MPI_Isend(&send_storage[pos],exchange_send[k+1],INMOST_MPI_DATA_REAL_TYPE,exchange_send[k],rank*size+exchange_send[k],comm,&requests.back());
+				pos += exchange_send[k+1];
+			}
+			MPI_Waitall(static_cast<int>(requests.size()),&requests[0],MPI_STATUSES_IGNORE);
+#endif //USE_MPI
+		}
+#if defined(USE_SOLVER)
+		void Direction::SetValues(const Vector & v)
+		{
+			for(INMOST_DATA_ENUM_TYPE k = IntervalBeg; k < IntervalEnd; ++k)
+				(*this)[k] = v[k];
+			Update();
+		}
+#endif //USE_SOLVER
 ////////class HessianRow
 
+		/// Comparison of row entries by index only.
+		static bool RowEntryLess(const Row::entry & a, const Row::entry & b)
+		{
+			return a.first < b.first;
+		}
+
+		/// Find value of the entry in the row, binary search is used for sorted row.
+		static INMOST_DATA_REAL_TYPE RowLookup(const Row & r, INMOST_DATA_ENUM_TYPE ind, bool sorted)
+		{
+			if( !sorted ) return r.get_safe(ind);
+			Row::const_iterator it = std::lower_bound(r.Begin(),r.End(),Row::make_entry(ind,0.0),RowEntryLess);
+			if( it != r.End() && it->first == ind ) return it->second;
+			return 0.0;
+		}
+
+		/// Comparison of hessian entries by index only.
+		struct HessianEntryLess
+		{
+			bool operator()(const HessianRow::entry & a, const HessianRow::entry & b) const {return a.first < b.first;}
+		};
+
 		void   HessianRow::RowVec(INMOST_DATA_REAL_TYPE alpha, const Row & rU, INMOST_DATA_REAL_TYPE beta, Row & rJ) const
 		{
-			INMOST_DATA_ENUM_TYPE end = rU.Size();
-			for(INMOST_DATA_ENUM_TYPE i = 0; i < end; i++) rJ.GetValue(i) *= beta;
-			for(INMOST_DATA_ENUM_TYPE i = 0; i < end; i++)
+			// only upper triangle is stored and off-diagonal entries
+			// hold both halves, each of the halves goes to it's own position
+			bool sorted = rU.isSorted();
+			Row contrib, merged;
+			INMOST_DATA_ENUM_TYPE q = 0;
+			contrib.Resize(2*Size());
+			for(INMOST_DATA_ENUM_TYPE k = 0; k < Size(); k++)
 			{
-				const index & ind = GetIndex(i);
-				if( ind.first == ind.second )
-					rJ[ind.first] += alpha*rU.get_safe(ind.first)*GetValue(i);
+				const index & ind = GetIndex(k);
+				INMOST_DATA_REAL_TYPE v = alpha*GetValue(k), u;
+				if( ind.first != ind.second ) v *= 0.5;
+				u = RowLookup(rU,ind.second,sorted);
+				if( u )
+				{
+					contrib.GetIndex(q) = ind.first;
+					contrib.GetValue(q) = v*u;
+					q++;
+				}
+				if( ind.first == ind.second ) continue;
+				u = RowLookup(rU,ind.first,sorted);
+				if( u )
+				{
+					contrib.GetIndex(q) = ind.second;
+					contrib.GetValue(q) = v*u;
+					q++;
+				}
+			}
+			std::sort(contrib.Begin(),contrib.Begin()+q,RowEntryLess);
+			INMOST_DATA_ENUM_TYPE n = 0;
+			for(INMOST_DATA_ENUM_TYPE k = 0; k < q; k++)
+			{
+				if( n > 0 && contrib.GetIndex(n-1) == contrib.GetIndex(k) )
+					contrib.GetValue(n-1) += contrib.GetValue(k);
 				else
 				{
-					rJ[ind.first ] += alpha*rU.get_safe(ind.second)*GetValue(i);
-					rJ[ind.second] += alpha*rU.get_safe(ind.first )*GetValue(i);
+					contrib.GetIndex(n) = contrib.GetIndex(k);
+					contrib.GetValue(n) = contrib.GetValue(k);
+					n++;
 				}
 			}
+			contrib.Resize(n);
+			if( !rJ.isSorted() ) std::sort(rJ.Begin(),rJ.End());
+			Row::MergeSortedRows(1.0,contrib,beta,rJ,merged);
+			rJ.Swap(merged);
 		}
 
 		bool HessianRow::isSorted() const
@@ -566,6 +759,72 @@ namespace INMOST
 			output.Resize(q);
 		}
 
+////////class HessianRowMerger
+
+		void HessianRowMerger::Push(HessianRow::index ind, INMOST_DATA_REAL_TYPE val)
+		{
+			//continue current sorted run if possible
+			if( Runs.empty() || !(Entries.back().first < ind) ) Runs.push_back(Entries.size());
+			Entries.push_back(HessianRow::make_entry(ind,val));
+		}
+
+		void HessianRowMerger::AddRow(INMOST_DATA_REAL_TYPE coef, const HessianRow & r)
+		{
+			if( r.Empty() ) return;
+			size_t q = Entries.size();
+			bool sorted = true;
+			Runs.push_back(q);
+			Entries.resize(q+r.Size());
+			for(HessianRow::const_iterator it = r.Begin(); it != r.End(); ++it, ++q)
+			{
+				Entries[q].first = it->first;
+				Entries[q].second = coef*it->second;
+				if( sorted && q > Runs.back() && Entries[q].first < Entries[q-1].first ) sorted = false;
+			}
+			if( !sorted ) std::sort(Entries.begin()+Runs.back(),Entries.end(),HessianEntryLess());
+		}
+
+		void HessianRowMerger::RetrieveRow(HessianRow & r)
+		{
+			HessianEntryLess less;
+			//merge neighbouring sorted runs until one is left, each pass halves the number of runs
+			while( Runs.size() > 1 )
+			{
+				Merged.clear();
+				MergedRuns.clear();
+				for(size_t k = 0; k < Runs.size(); k += 2)
+				{
+					size_t i = Runs[k], iend = k+1 < Runs.size() ? Runs[k+1] : Entries.size();
+					size_t j = iend, jend = k+2 < Runs.size() ? Runs[k+2] : Entries.size();
+					MergedRuns.push_back(Merged.size());
+					while( i < iend || j < jend )
+					{
+						const HessianRow::entry & e = (j == jend || (i < iend && !less(Entries[j],Entries[i]))) ? Entries[i++] : Entries[j++];
+						if( Merged.size() > MergedRuns.back() && Merged.back().first == e.first )
+							Merged.back().second += e.second;
+						else Merged.push_back(e);
+					}
+				}
+				Entries.swap(Merged);
+				Runs.swap(MergedRuns);
+			}
+			//single run may still contain repeated indices
+			size_t q = 0;
+			for(size_t k = 0; k < Entries.size(); ++k)
+			{
+				if( q > 0 && Entries[q-1].first == Entries[k].first )
+					Entries[q-1].second += Entries[k].second;
+				else Entries[q++] = Entries[k];
+			}
+			Entries.resize(q);
+			r.Resize(static_cast<INMOST_DATA_ENUM_TYPE>(q));
+			for(size_t k = 0; k < q; ++k)
+			{
+				r.GetIndex(static_cast<INMOST_DATA_ENUM_TYPE>(k)) = Entries[k].first;
+				r.GetValue(static_cast<INMOST_DATA_ENUM_TYPE>(k)) = Entries[k].second;
+			}
+		}
+
 ////////class Row
 #if defined(USE_SOLVER)
 		INMOST_DATA_REAL_TYPE   Row::RowVec(Vector & x) const
@@ -639,6 +898,26 @@ namespace INMOST
 			}
 			output.Resize(q);
 		}
+		
+		void Row::AddToPattern(INMOST_DATA_REAL_TYPE alpha, const Row & other)
+		{
+			assert(isSorted());
+			INMOST_DATA_ENUM_TYPE size = Size();
+			for(INMOST_DATA_ENUM_TYPE j = 0; j < other.Size(); ++j)
+			{
+				INMOST_DATA_ENUM_TYPE ind = other.GetIndex(j), lo = 0, hi = size, mid;
+				while( lo < hi )
+				{
+					mid = (lo + hi) >> 1;
+					if( GetIndex(mid) < ind ) lo = mid + 1;
+					else hi = mid;
+				}
+				if( lo < size && GetIndex(lo) == ind )
+					GetValue(lo) += alpha*other.GetValue(j);
+				else (*this)[ind] += alpha*other.GetValue(j); //extend the pattern
+			}
+			if( Size() != size ) std::sort(Begin(),End());
+		}
 #endif //defined(USE_SOLVER) || defined(USE_AUTODIFF)
 
 
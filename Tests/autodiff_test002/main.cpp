@@ -3,6 +3,21 @@
 #include "inmost.h"
 using namespace INMOST;
 
+// Print the gradient in the row next to the original one and report the entries that differ.
+static bool check_gradient(const char * name, const Sparse::Row & row, double dx, double dy, double dz, double dt)
+{
+	const char * names[4] = {"dx","dy","dz","dt"};
+	double orig[4] = {dx,dy,dz,dt};
+	bool error = false;
+	std::cout << name << ":" << std::endl;
+	std::cout << std::setw(10) << "derivative " << std::setw(10) << "original " << std::setw(10) << "computed" << std::endl;
+	for(INMOST_DATA_ENUM_TYPE k = 0; k < 4; ++k)
+		std::cout << std::setw(9) << names[k] << " " << std::setw(10) << orig[k] << std::setw(10) << row.get_safe(k) << std::endl;
+	for(INMOST_DATA_ENUM_TYPE k = 0; k < 4; ++k)
+		if (std::abs(orig[k] - row.get_safe(k)) > 1.0e-9) error = true, std::cout << "Error in " << names[k] << ": " << std::abs(orig[k] - row.get_safe(k)) << " original " << orig[k] << " computed " << row.get_safe(k) << std::endl;
+	return error;
+}
+
 int main(int argc,char ** argv)
 {
 	int test = 0;
@@ -15,8 +30,16 @@ int main(int argc,char ** argv)
 	double t = 0.1;
 	double dx, dy, dz, dt, dxdx, dydy, dzdz, dtdt, dxdy, dxdz, dydz, dxdt, dydt, dzdt;
 	unknown vx(x,0), vy(y,1), vz(z,2), vt(t,3);
+	INMOST_DATA_ENUM_TYPE map[4] = {0,1,2,3};
+	fixed_multivar_expression<4> fx(x,0,map), fy(y,1,map), fz(z,2,map), ft(t,3,map);
 	hessian_variable f;
 	variable f2;
+	fixed_multivar_expression<4> f3;
+	Tape tape;
+	tape_variable tx(tape,vx), ty(tape,vy), tz(tape,vz), tt(tape,vt);
+	tape_variable f4(tape);
+	CompiledExpression code;
+	code_variable cx = code.Input(), cy = code.Input(), cz = code.Input(), ct = code.Input();
 
 
 	if( test == 0 )
@@ -45,6 +68,9 @@ int main(int argc,char ** argv)
 		
 		f = (vx*vx*vx*vy*vy*vz + vx*sin(2 * pi*vx*vz)*sin(2 * pi*vx*vy)*sin(2 * pi*vz))*exp(-vt);
 		f2 = (vx*vx*vx*vy*vy*vz + vx*sin(2 * pi*vx*vz)*sin(2 * pi*vx*vy)*sin(2 * pi*vz))*exp(-vt);
+		f3 = (fx*fx*fx*fy*fy*fz + fx*sin(2 * pi*fx*fz)*sin(2 * pi*fx*fy)*sin(2 * pi*fz))*exp(-ft);
+		code.Output((cx*cx*cx*cy*cy*cz + cx*sin(2 * pi*cx*cz)*sin(2 * pi*cx*cy)*sin(2 * pi*cz))*exp(-ct));
+		f4 = (tx*tx*tx*ty*ty*tz + tx*sin(2 * pi*tx*tz)*sin(2 * pi*tx*ty)*sin(2 * pi*tz))*exp(-tt);
 	}
 	else if (test == 1)
 	{
@@ -72,6 +98,9 @@ int main(int argc,char ** argv)
 
 		f = (vx*vx*vx*vy*vy*vz + vx*sin(2 * pi*vx*vz)*sin(2 * pi*vx*vy)*sin(2 * pi*vz))*vt;
 		f2 = (vx*vx*vx*vy*vy*vz + vx*sin(2 * pi*vx*vz)*sin(2 * pi*vx*vy)*sin(2 * pi*vz))*vt;
+		f3 = (fx*fx*fx*fy*fy*fz + fx*sin(2 * pi*fx*fz)*sin(2 * pi*fx*fy)*sin(2 * pi*fz))*ft;
+		code.Output((cx*cx*cx*cy*cy*cz + cx*sin(2 * pi*cx*cz)*sin(2 * pi*cx*cy)*sin(2 * pi*cz))*ct);
+		f4 = (tx*tx*tx*ty*ty*tz + tx*sin(2 * pi*tx*tz)*sin(2 * pi*tx*ty)*sin(2 * pi*tz))*tt;
 	}
 	else if (test == 2)
 	{
@@ -98,6 +127,9 @@ int main(int argc,char ** argv)
 
 		f = (vx*vx*vx*vy*vy*vz + vx*sin(2 * pi*vx*vz)*sin(2 * pi*vx*vy)*sin(2 * pi*vz));
 		f2 = (vx*vx*vx*vy*vy*vz + vx*sin(2 * pi*vx*vz)*sin(2 * pi*vx*vy)*sin(2 * pi*vz));
+		f3 = (fx*fx*fx*fy*fy*fz + fx*sin(2 * pi*fx*fz)*sin(2 * pi*fx*fy)*sin(2 * pi*fz));
+		code.Output((cx*cx*cx*cy*cy*cz + cx*sin(2 * pi*cx*cz)*sin(2 * pi*cx*cy)*sin(2 * pi*cz)));
+		f4 = (tx*tx*tx*ty*ty*tz + tx*sin(2 * pi*tx*tz)*sin(2 * pi*tx*ty)*sin(2 * pi*tz));
 	}
 	else if (test == 3)
 	{
@@ -124,6 +156,9 @@ int main(int argc,char ** argv)
 
 		f = (vx*sin(2 * pi*vx*vz)*sin(2 * pi*vx*vy)*sin(2 * pi*vz));
 		f2 = (vx*sin(2 * pi*vx*vz)*sin(2 * pi*vx*vy)*sin(2 * pi*vz));
+		f3 = (fx*sin(2 * pi*fx*fz)*sin(2 * pi*fx*fy)*sin(2 * pi*fz));
+		code.Output((cx*sin(2 * pi*cx*cz)*sin(2 * pi*cx*cy)*sin(2 * pi*cz)));
+		f4 = (tx*sin(2 * pi*tx*tz)*sin(2 * pi*tx*ty)*sin(2 * pi*tz));
 	}
 	else if (test == 4)
 	{
@@ -144,6 +179,9 @@ int main(int argc,char ** argv)
 
 		f = (vx*sin(2 * pi*vz));
 		f2 = (vx*sin(2 * pi*vz));
+		f3 = (fx*sin(2 * pi*fz));
+		code.Output((cx*sin(2 * pi*cz)));
+		f4 = (tx*sin(2 * pi*tz));
 	}
 	else if (test == 5)
 	{
@@ -164,6 +202,9 @@ int main(int argc,char ** argv)
 
 		f = (vx*sin(2 * pi*vx*vz));
 		f2 = (vx*sin(2 * pi*vx*vz));
+		f3 = (fx*sin(2 * pi*fx*fz));
+		code.Output((cx*sin(2 * pi*cx*cz)));
+		f4 = (tx*sin(2 * pi*tx*tz));
 	}
 	else if (test == 6)
 	{
@@ -184,6 +225,9 @@ int main(int argc,char ** argv)
 
 		f = (vx*sin(2 * pi*vx*vy)*sin(2 * pi*vz));
 		f2 = (vx*sin(2 * pi*vx*vy)*sin(2 * pi*vz));
+		f3 = (fx*sin(2 * pi*fx*fy)*sin(2 * pi*fz));
+		code.Output((cx*sin(2 * pi*cx*cy)*sin(2 * pi*cz)));
+		f4 = (tx*sin(2 * pi*tx*ty)*sin(2 * pi*tz));
 	}
 	else if( test == 7 )
 	{
@@ -203,6 +247,9 @@ int main(int argc,char ** argv)
 		dtdt = exp(-t)*(sin(8*((z-0.5)*(z-0.5)+(y-0.5)*(y-0.5)+(x-0.5)*(x-0.5)))+1);
 		f = (sin(((vx-0.5)*(vx-0.5) + (vy-0.5)*(vy-0.5) + (vz-0.5)*(vz-0.5))*8)+1)*exp(-vt);
 		f2 = (sin(((vx-0.5)*(vx-0.5) + (vy-0.5)*(vy-0.5) + (vz-0.5)*(vz-0.5))*8)+1)*exp(-vt);
+		f3 = (sin(((fx-0.5)*(fx-0.5) + (fy-0.5)*(fy-0.5) + (fz-0.5)*(fz-0.5))*8)+1)*exp(-ft);
+		code.Output((sin(((cx-0.5)*(cx-0.5) + (cy-0.5)*(cy-0.5) + (cz-0.5)*(cz-0.5))*8)+1)*exp(-ct));
+		f4 = (sin(((tx-0.5)*(tx-0.5) + (ty-0.5)*(ty-0.5) + (tz-0.5)*(tz-0.5))*8)+1)*exp(-tt);
 	}
 	//mixed derivative computed twice: dxdy and dydx
 	dxdy *= 2;
@@ -259,21 +306,72 @@ int main(int argc,char ** argv)
 	if( std::abs(dzdz-vdzdz) > 1.0e-9 ) error = true, std::cout << "Error in dzdz: " << std::abs(dzdz-vdzdz) << " original " << dzdz << " computed " << vdzdz << std::endl;
 	if (std::abs(dzdt - vdzdt) > 1.0e-9) error = true, std::cout << "Error in dzdt: " << std::abs(dzdt - vdzdt) << " original " << dzdt << " computed " << vdzdt << std::endl;
 	if (std::abs(dtdt - vdtdt) > 1.0e-9) error = true, std::cout << "Error in dtdt: " << std::abs(dtdt - vdtdt) << " original " << dtdt << " computed " << vdtdt << std::endl;
+	{
+		//symmetric product of hessian by a row, off-diagonal entries hold both halves
+		double u[4] = {1,2,3,4}, hu[4];
+		Sparse::Row U, HU;
+		Sparse::HessianRowMerger merger;
+		for(int k = 0; k < 4; ++k) U.Push(k,u[k]);
+		hu[0] = dxdx*u[0] + 0.5*(dxdy*u[1] + dxdz*u[2] + dxdt*u[3]);
+		hu[1] = dydy*u[1] + 0.5*(dxdy*u[0] + dydz*u[2] + dydt*u[3]);
+		hu[2] = dzdz*u[2] + 0.5*(dxdz*u[0] + dydz*u[1] + dzdt*u[3]);
+		hu[3] = dtdt*u[3] + 0.5*(dxdt*u[0] + dydt*u[1] + dzdt*u[2]);
+		//gather the same row twice, product should be twice as large
+		merger.AddRow(1.0,f.GetHessianRow());
+		merger.AddRow(1.0,f.GetHessianRow());
+		Sparse::HessianRow H2;
+		merger.RetrieveRow(H2);
+		H2.RowVec(0.5,U,0.0,HU);
+		std::cout << "RowVec:" << std::endl;
+		for(int k = 0; k < 4; ++k)
+		{
+			std::cout << std::setw(10) << k << std::setw(10) << hu[k] << std::setw(10) << HU.get_safe(k) << std::endl;
+			if( std::abs(hu[k]-HU.get_safe(k)) > 1.0e-9 ) error = true, std::cout << "Error in RowVec at " << k << ": " << std::abs(hu[k]-HU.get_safe(k)) << " original " << hu[k] << " computed " << HU.get_safe(k) << std::endl;
+		}
+	}
 	//if( error ) return -1;
-	vdx = f2.GetRow()[0];
-	vdy = f2.GetRow()[1];
-	vdz = f2.GetRow()[2];
-	vdt = f2.GetRow()[3];
-	std::cout << "GetJacobian:" << std::endl;
-	std::cout << std::setw(10) << "derivative " << std::setw(10) << "original " << std::setw(10) << "computed" << std::endl;
-	std::cout << std::setw(10) << "dx " << std::setw(10) << dx << std::setw(10) << vdx << std::endl;
-	std::cout << std::setw(10) << "dy " << std::setw(10) << dy << std::setw(10) << vdy << std::endl;
-	std::cout << std::setw(10) << "dz " << std::setw(10) << dz << std::setw(10) << vdz << std::endl;
-	std::cout << std::setw(10) << "dt " << std::setw(10) << dt << std::setw(10) << vdt << std::endl;
-	if (std::abs(dx - vdx) > 1.0e-9) error = true, std::cout << "Error in dx: " << std::abs(dx - vdx) << " original " << dx << " computed " << vdx << std::endl;
-	if (std::abs(dy - vdy) > 1.0e-9) error = true, std::cout << "Error in dy: " << std::abs(dy - vdy) << " original " << dy << " computed " << vdy << std::endl;
-	if (std::abs(dz - vdz) > 1.0e-9) error = true, std::cout << "Error in dz: " << std::abs(dz - vdz) << " original " << dz << " computed " << vdz << std::endl;
-	if (std::abs(dt - vdt) > 1.0e-9) error = true, std::cout << "Error in dt: " << std::abs(dt - vdt) << " original " << dt << " computed " << vdt << std::endl;
+	if( check_gradient("GetJacobian",f2.GetRow(),dx,dy,dz,dt) ) error = true;
+	f2 = f3;
+	if( check_gradient("Fixed",f2.GetRow(),dx,dy,dz,dt) ) error = true;
+	//chain of statements on the tape should not change the gradient
+	f4 *= tt;
+	f4 /= tt;
+	f4 += tx;
+	f4 -= tx;
+	f2 = f4;
+	if( check_gradient("Tape",f2.GetRow(),dx,dy,dz,dt) ) error = true;
+	//several uses of the variables in one expression are swept once
+	{
+		Sparse::Row r;
+		tape.Gradient(3.0*f4 - f4*tt/tt - f4 + 0.0*tx,1.0,r);
+		if( check_gradient("Tape expression",r,dx,dy,dz,dt) ) error = true;
+	}
+	//evaluation in batch crosses the boundary of blocks
+	ExpressionBatch batch(code,100);
+	for(INMOST_DATA_ENUM_TYPE l = 0; l < batch.Size(); ++l)
+	{
+		batch.SetInput(l,0,x,0);
+		batch.SetInput(l,1,y,1);
+		batch.SetInput(l,2,z,2);
+		batch.SetInput(l,3,t,3);
+	}
+	batch.Evaluate();
+	f2 = batch(batch.Size()-1);
+	if( check_gradient("Compiled",f2.GetRow(),dx,dy,dz,dt) ) error = true;
+	//variables with different maps, unknowns outside of the map and slots out of range are rejected
+	{
+		INMOST_DATA_ENUM_TYPE other[4] = {0,1,2,3}, part[4] = {0,1,2,ENUMUNDEF};
+		fixed_multivar_expression<4> gx(x,0,other);
+		int thrown = 0;
+		try { f3 = fx*gx; } catch(ErrorType e) { if( e == MapMismatch ) thrown++; }
+		try { f3 = fixed_multivar_expression<4>(vx*vt,part); } catch(ErrorType e) { if( e == MapMismatch ) thrown++; }
+		try { f3 = fixed_multivar_expression<4>(x,4,map); } catch(ErrorType e) { if( e == MapMismatch ) thrown++; }
+		//constants and variables of the same map are combined
+		f3 = fixed_multivar_expression<4>(vx*vz,map)*2.0 + fx;
+		if( thrown != 3 ) error = true, std::cout << "Error in maps: " << 3-thrown << " mismatches were not reported" << std::endl;
+		if( std::abs(f3.GetDerivative(0) - (2*z+1)) > 1.0e-9 || std::abs(f3.GetDerivative(2) - 2*x) > 1.0e-9 )
+			error = true, std::cout << "Error in maps: wrong derivatives " << f3.GetDerivative(0) << " " << f3.GetDerivative(2) << std::endl;
+	}
 	if (error) return -1;
 
 	return 0;
@@ -0,0 +1,456 @@
+#include <cstdio>
+#include <cmath>
+#include <cstdlib>
+
+#include "inmost.h"
+using namespace INMOST;
+
+typedef INMOST_DATA_REAL_TYPE real;
+typedef INMOST_DATA_ENUM_TYPE enumerator;
+
+// Residual of nonlinear diffusion on n x n grid, rows are split between processors.
+// The row is formed by assignment, subtractions, multiplication and division by expressions,
+// so that all ways to write derivatives into a row with frozen pattern are used.
+const enumerator n = 30;
+
+static real value(enumerator i, real t) {return 1.5 + sin(0.1*i + t);}
+
+static void assemble(Residual & R, real t)
+{
+	R.Clear();
+	for(enumerator i = R.GetFirstIndex(); i < R.GetLastIndex(); ++i)
+	{
+		enumerator ix = i % n, iy = i / n, nb[4], nnb = 0;
+		if( ix > 0 ) nb[nnb++] = i-1;
+		if( ix+1 < n ) nb[nnb++] = i+1;
+		if( iy > 0 ) nb[nnb++] = i-n;
+		if( iy+1 < n ) nb[nnb++] = i+n;
+		unknown c(value(i,t),i);
+		R[i] = c*c*c + 4.0*c;
+		for(enumerator k = 0; k < nnb; ++k)
+		{
+			unknown u(value(nb[k],t),nb[k]);
+			R[i] -= u*(1.0 + 0.1*u*u);
+		}
+		R[i] *= 1.0 + 0.01*c;
+		R[i] /= 2.0 + 0.1*c*c;
+	}
+}
+
+// Compare values of rows, entries that are present only in one of the rows should be zero.
+static int compare(const Residual & A, const Residual & B, real tol)
+{
+	int errors = 0;
+	for(enumerator i = A.GetFirstIndex(); i < A.GetLastIndex(); ++i)
+	{
+		const Sparse::Row & a = A.GetJacobian()[i], & b = B.GetJacobian()[i];
+		if( fabs(A.GetResidual()[i] - B.GetResidual()[i]) > tol ) errors++;
+		for(Sparse::Row::const_iterator it = a.Begin(); it != a.End(); ++it)
+			if( fabs(it->second - b.get_safe(it->first)) > tol ) errors++;
+		for(Sparse::Row::const_iterator it = b.Begin(); it != b.End(); ++it)
+			if( fabs(it->second - a.get_safe(it->first)) > tol ) errors++;
+	}
+	return errors;
+}
+
+// Second assembly into the frozen pattern gives the same jacobian as assembly from scratch,
+// the pattern is not reallocated.
+static int test_frozen(enumerator beg, enumerator end)
+{
+	int errors = 0;
+	Residual R("",beg,end), F("",beg,end);
+	assemble(R,0.0);
+	std::vector<enumerator> sizes;
+	for(enumerator i = beg; i < end; ++i) sizes.push_back(R.GetJacobian()[i].Size());
+	R.FreezePattern();
+	assemble(R,0.7);
+	assemble(F,0.7);
+	for(enumerator i = beg; i < end; ++i)
+		if( R.GetJacobian()[i].Size() != sizes[i-beg] || !R.GetJacobian()[i].isSorted() ) errors++;
+	if( errors ) std::cout << "pattern changed in " << errors << " rows" << std::endl;
+	int diff = compare(R,F,1.0e-13);
+	if( diff ) std::cout << diff << " values differ" << std::endl;
+	return errors + diff;
+}
+
+// Solution with values written into the matrix stored by the solver is the same as with
+// the matrix replaced in the solver with the same history, solution with the preconditioner
+// of the old matrix is close to it.
+static int test_solver(enumerator beg, enumerator end, int rank)
+{
+	int errors = 0;
+	Residual R("",beg,end);
+	Sparse::Vector xa("",beg,end), xb("",beg,end), xc("",beg,end);
+	Solver Sa("inner_ilu2"), Sb("inner_ilu2");
+	Sa.SetParameter("absolute_tolerance","1.0e-13");
+	Sb.SetParameter("absolute_tolerance","1.0e-13");
+	assemble(R,0.0);
+	R.FreezePattern();
+	Sa.SetMatrix(R.GetJacobian());
+	Sb.SetMatrix(R.GetJacobian());
+	if( !Sa.Solve(R.GetResidual(),xa) ) errors++;
+	if( !Sb.Solve(R.GetResidual(),xb) ) errors++;
+	assemble(R,0.7);
+	Sa.SetMatrix(R.GetJacobian(),false);
+	if( !Sa.Solve(R.GetResidual(),xa) ) errors++;
+	Sb.SetMatrix(R.GetJacobian(),true);
+	if( !Sb.Solve(R.GetResidual(),xb) ) errors++;
+	//the factorization of the first matrix is used with the values of the second one
+	assemble(R,0.0);
+	Sa.SetMatrix(R.GetJacobian());
+	assemble(R,0.7);
+	Sa.SetMatrix(R.GetJacobian(),false,true);
+	if( !Sa.Solve(R.GetResidual(),xc) ) errors++;
+	if( errors && rank == 0 ) std::cout << "solver failed" << std::endl;
+	real diff[2] = {0,0};
+	for(enumerator i = beg; i < end; ++i)
+	{
+		diff[0] = std::max(diff[0],fabs(xa[i] - xb[i]));
+		diff[1] = std::max(diff[1],fabs(xc[i] - xb[i]));
+	}
+#if defined(USE_MPI)
+	real tmp[2] = {diff[0],diff[1]};
+	MPI_Allreduce(tmp,diff,2,MPI_DOUBLE,MPI_MAX,MPI_COMM_WORLD);
+#endif
+	if( rank == 0 ) std::cout << "difference with replaced matrix " << diff[0] << " with old preconditioner " << diff[1] << std::endl;
+	if( diff[0] != 0.0 ) errors++;
+	if( diff[1] > 1.0e-8 ) errors++;
+	return errors;
+}
+
+// Fluxes with several outputs are evaluated in a batch, as in ADBenchmark: inputs are the unknowns
+// of the cell, of the neighbour and of the upstream cell, which is one of the two, so that the same
+// unknown enters several inputs. Transmissibility is a parameter input without index.
+// Rows assembled from the batch are the same as assembled from variables.
+static int test_compiled(enumerator beg, enumerator end)
+{
+	int errors = 0;
+	const int m = 2;
+	CompiledExpression flux;
+	std::vector<code_variable> xc(m), xn(m), xu(m);
+	for(int q = 0; q < m; ++q) xc[q] = flux.Input();
+	for(int q = 0; q < m; ++q) xn[q] = flux.Input();
+	for(int q = 0; q < m; ++q) xu[q] = flux.Input();
+	code_variable T = flux.Input();
+	code_variable cmob = flux.Constant(1.0);
+	for(int l = 0; l < m; ++l)
+		cmob *= pow(xu[l],2.0) + 0.1;
+	for(int q = 0; q < m; ++q)
+		flux.Output(T*(xc[q] - xn[q])*cmob);
+	enumerator cb = beg/m, ce = (end+m-1)/m, faces = 0;
+	for(enumerator c = cb; c < ce; ++c)
+	{
+		if( c > 0 ) faces++;
+		if( c+1 < n*n/m ) faces++;
+	}
+	ExpressionBatch batch(flux,faces);
+	std::vector<real> x(n*n);
+	for(enumerator k = 0; k < n*n; ++k) x[k] = value(k,0.3);
+	enumerator p = 0;
+	for(enumerator c = cb; c < ce; ++c)
+		for(int s = -1; s <= 1; s += 2)
+		{
+			enumerator nb = c+s;
+			if( (s < 0 && c == 0) || (s > 0 && c+1 >= n*n/m) ) continue;
+			enumerator up = x[c*m] > x[nb*m] ? c : nb;
+			for(int q = 0; q < m; ++q)
+			{
+				batch.SetInput(p,q,x[c*m+q],c*m+q);
+				batch.SetInput(p,m+q,x[nb*m+q],nb*m+q);
+				batch.SetInput(p,2*m+q,x[up*m+q],up*m+q);
+			}
+			batch.SetInput(p,3*m,1.0+0.1*c);
+			p++;
+		}
+	batch.Evaluate();
+	Residual A("",beg,end), B("",beg,end);
+	p = 0;
+	for(enumerator c = cb; c < ce; ++c)
+		for(int s = -1; s <= 1; s += 2)
+		{
+			enumerator nb = c+s;
+			if( (s < 0 && c == 0) || (s > 0 && c+1 >= n*n/m) ) continue;
+			enumerator up = x[c*m] > x[nb*m] ? c : nb;
+			variable mob(1.0);
+			for(int l = 0; l < m; ++l)
+				mob *= pow(unknown(x[up*m+l],up*m+l),2.0) + 0.1;
+			for(int q = 0; q < m; ++q) if( c*m+q >= beg && c*m+q < end )
+			{
+				A[c*m+q] += batch(p,q);
+				B[c*m+q] += (1.0+0.1*c)*(unknown(x[c*m+q],c*m+q) - unknown(x[nb*m+q],nb*m+q))*mob;
+			}
+			p++;
+		}
+	int diff = compare(A,B,1.0e-12);
+	if( diff ) std::cout << diff << " values differ" << std::endl;
+	errors += diff;
+	//second order derivatives are not computed
+	bool thrown = false;
+	try
+	{
+		Sparse::Row J;
+		Sparse::HessianRow H;
+		batch(0,0).GetHessian(1.0,J,1.0,H);
+	}
+	catch(ErrorType e)
+	{
+		thrown = (e == NotImplemented);
+	}
+	if( !thrown && faces )
+	{
+		std::cout << "hessian of compiled value did not throw" << std::endl;
+		errors++;
+	}
+	return errors;
+}
+
+#if defined(USE_MESH)
+// Same as the grid above, but unknowns are cell values of a mesh, enumerated by Automatizator.
+static void assemble_mesh(Mesh & m, Residual & R, Automatizator & aut, INMOST_DATA_ENUM_TYPE iu, Tag u, real t)
+{
+	dynamic_variable U(aut,iu);
+	for(Mesh::iteratorCell it = m.BeginCell(); it != m.EndCell(); ++it)
+	{
+		real cnt[3];
+		it->Centroid(cnt);
+		it->Real(u) = 1.5 + sin(cnt[0] + 2*cnt[1] + 3*cnt[2] + t);
+	}
+	R.Clear();
+	for(Mesh::iteratorCell it = m.BeginCell(); it != m.EndCell(); ++it)
+	{
+		Cell c = it->self();
+		enumerator i = aut.GetIndex(c,iu);
+		R[i] = U(c)*U(c)*U(c) + 4.0*U(c);
+		ElementArray<Cell> adj = c.NeighbouringCells();
+		for(ElementArray<Cell>::size_type k = 0; k < adj.size(); ++k)
+			R[i] -= U(adj[k])*(1.0 + 0.1*U(adj[k])*U(adj[k]));
+		R[i] *= 1.0 + 0.01*U(c);
+		R[i] /= 2.0 + 0.1*U(c)*U(c);
+	}
+}
+
+static int test_frozen_mesh(std::string file)
+{
+	int errors = 0;
+	Mesh m;
+	m.Load(file);
+	Tag u = m.CreateTag("u",DATA_REAL,CELL,NONE,1);
+	Automatizator aut;
+	Automatizator::MakeCurrent(&aut);
+	INMOST_DATA_ENUM_TYPE iu = aut.RegisterTag(u,CELL);
+	aut.EnumerateEntries();
+	Residual R("",aut.GetFirstIndex(),aut.GetLastIndex()), F("",aut.GetFirstIndex(),aut.GetLastIndex());
+	assemble_mesh(m,R,aut,iu,u,0.0);
+	std::vector<enumerator> sizes;
+	for(enumerator i = R.GetFirstIndex(); i < R.GetLastIndex(); ++i) sizes.push_back(R.GetJacobian()[i].Size());
+	R.FreezePattern();
+	assemble_mesh(m,R,aut,iu,u,0.7);
+	assemble_mesh(m,F,aut,iu,u,0.7);
+	for(enumerator i = R.GetFirstIndex(); i < R.GetLastIndex(); ++i)
+		if( R.GetJacobian()[i].Size() != sizes[i-R.GetFirstIndex()] || !R.GetJacobian()[i].isSorted() ) errors++;
+	if( errors ) std::cout << "pattern changed in " << errors << " rows" << std::endl;
+	int diff = compare(R,F,1.0e-13);
+	if( diff ) std::cout << diff << " values differ" << std::endl;
+	Automatizator::MakeCurrent(NULL);
+	return errors + diff;
+}
+
+// Nonlinear two-point flux through the face is added to the rows of both cells.
+struct FaceKernel
+{
+	Residual & R;
+	Automatizator & aut;
+	dynamic_variable & U;
+	INMOST_DATA_ENUM_TYPE iu;
+	FaceKernel(Residual & R, Automatizator & aut, dynamic_variable & U, INMOST_DATA_ENUM_TYPE iu)
+	: R(R), aut(aut), U(U), iu(iu) {}
+	void operator()(Element e)
+	{
+		Face f = e.getAsFace();
+		Cell c1 = f.BackCell(), c2 = f.FrontCell();
+		if( !c2.isValid() )
+		{
+			R[aut.GetIndex(c1,iu)] += f.Area()*U(c1)*U(c1);
+			return;
+		}
+		variable flux = f.Area()*(U(c1) - U(c2))*(1.0 + 0.5*(U(c1)*U(c1) + U(c2)*U(c2)));
+		R[aut.GetIndex(c1,iu)] += flux;
+		R[aut.GetIndex(c2,iu)] -= flux;
+	}
+};
+
+// Every face is colored once and faces of one color share no cell. Assembly over the colors
+// matches the plain loop over faces up to rounding and does not depend on the number of threads.
+static int test_coloring(std::string file)
+{
+	int errors = 0;
+	Mesh m;
+	m.Load(file);
+	ElementColoring colors(&m,FACE,CELL);
+	std::vector<int> face_count(m.FaceLastLocalID(),0);
+	std::vector<INMOST_DATA_ENUM_TYPE> cell_color(m.CellLastLocalID(),ENUMUNDEF);
+	int shared = 0, count = 0;
+	for(INMOST_DATA_ENUM_TYPE c = 0; c < colors.GetColors(); ++c)
+		for(INMOST_DATA_ENUM_TYPE k = 0; k < colors.Size(c); ++k)
+		{
+			Face f = colors.GetElement(c,k).getAsFace();
+			face_count[f.LocalID()]++;
+			ElementArray<Cell> cells = f.getCells();
+			for(ElementArray<Cell>::size_type q = 0; q < cells.size(); ++q)
+			{
+				if( cell_color[cells[q].LocalID()] == c ) shared++;
+				cell_color[cells[q].LocalID()] = c;
+			}
+		}
+	for(Mesh::iteratorFace it = m.BeginFace(); it != m.EndFace(); ++it)
+		if( face_count[it->LocalID()] != 1 ) count++;
+	std::cout << m.NumberOfFaces() << " faces " << colors.Size() << " colored " << colors.GetColors() << " colors" << std::endl;
+	if( count || colors.Size() != static_cast<INMOST_DATA_ENUM_TYPE>(m.NumberOfFaces()) )
+	{
+		std::cout << count << " faces are not colored once" << std::endl;
+		errors++;
+	}
+	if( shared )
+	{
+		std::cout << shared << " cells are shared by faces of one color" << std::endl;
+		errors++;
+	}
+	Tag u = m.CreateTag("u",DATA_REAL,CELL,NONE,1);
+	Automatizator aut;
+	Automatizator::MakeCurrent(&aut);
+	INMOST_DATA_ENUM_TYPE iu = aut.RegisterTag(u,CELL);
+#if defined(USE_OMP)
+	//row mergers are allocated for the maximal number of threads on enumeration
+	int threads[3] = {1,2,5}, max_threads = omp_get_max_threads();
+	omp_set_num_threads(threads[2]);
+#endif
+	aut.EnumerateEntries();
+	for(Mesh::iteratorCell it = m.BeginCell(); it != m.EndCell(); ++it)
+	{
+		real cnt[3];
+		it->Centroid(cnt);
+		it->Real(u) = 1.5 + sin(cnt[0] + 2*cnt[1] + 3*cnt[2]);
+	}
+	dynamic_variable U(aut,iu);
+	Residual F("",aut.GetFirstIndex(),aut.GetLastIndex()), R("",aut.GetFirstIndex(),aut.GetLastIndex());
+	FaceKernel serial(F,aut,U,iu), colored(R,aut,U,iu);
+	for(Mesh::iteratorFace it = m.BeginFace(); it != m.EndFace(); ++it) serial(it->self());
+	colors.Apply(colored);
+	int diff = compare(R,F,1.0e-12);
+	if( diff )
+	{
+		std::cout << diff << " values differ from the loop over faces" << std::endl;
+		errors++;
+	}
+#if defined(USE_OMP)
+	for(int k = 0; k < 3; ++k)
+	{
+		Residual T("",aut.GetFirstIndex(),aut.GetLastIndex());
+		FaceKernel kernel(T,aut,U,iu);
+		omp_set_num_threads(threads[k]);
+		colors.Apply(kernel);
+		diff = compare(T,R,0.0);
+		if( diff )
+		{
+			std::cout << diff << " values differ with " << threads[k] << " threads" << std::endl;
+			errors++;
+		}
+	}
+	omp_set_num_threads(max_threads);
+#endif
+	Automatizator::MakeCurrent(NULL);
+	return errors;
+}
+
+// Unknowns of several entries are numbered together on each element, the indices of the owned
+// unknowns are a permutation of the local interval and agree with the unknowns.
+static int test_enumeration(std::string file, Automatizator::EnumerationOrder order)
+{
+	int errors = 0;
+	Mesh m;
+	m.Load(file);
+	Tag a = m.CreateTag("a",DATA_REAL,CELL,NONE,1);
+	Tag b = m.CreateTag("b",DATA_REAL,CELL|FACE,NONE,2);
+	Tag c = m.CreateTag("c",DATA_REAL,FACE,NONE,1);
+	for(Mesh::iteratorElement it = m.BeginElement(CELL|FACE); it != m.EndElement(); ++it)
+	{
+		if( it->GetElementType() == CELL ) it->Real(a) = it->LocalID();
+		else it->Real(c) = -it->LocalID();
+		it->RealArray(b)[0] = 0.5*it->LocalID();
+		it->RealArray(b)[1] = 0.25*it->LocalID();
+	}
+	Automatizator aut;
+	INMOST_DATA_ENUM_TYPE regs[3];
+	regs[0] = aut.RegisterTag(a,CELL);
+	regs[1] = aut.RegisterTag(b,CELL|FACE);
+	regs[2] = aut.RegisterTag(c,FACE);
+	aut.SetEnumerationOrder(order);
+	aut.EnumerateEntries();
+	std::vector<enumerator> all;
+	int scattered = 0, mismatch = 0;
+	for(Mesh::iteratorElement it = m.BeginElement(CELL|FACE); it != m.EndElement(); ++it) if( it->GetStatus() != Element::Ghost )
+	{
+		std::vector<enumerator> local;
+		for(int r = 0; r < 3; ++r) if( aut.GetEntry(regs[r]).isValid(it->self()) )
+		{
+			for(enumerator q = 0; q < aut.GetEntry(regs[r]).Size(it->self()); ++q)
+			{
+				enumerator ind = aut.GetIndex(it->self(),regs[r],q);
+				unknown u = aut.GetUnknown(it->self(),regs[r],q);
+				Sparse::Row row;
+				u.GetJacobian(1.0,row);
+				if( row.Size() != 1 || row.GetIndex(0) != ind || row.GetValue(0) != 1.0 || u.GetValue() != aut.GetValue(it->self(),regs[r],q) ) mismatch++;
+				local.push_back(ind);
+			}
+		}
+		std::sort(local.begin(),local.end());
+		if( local.back() - local.front() + 1 != local.size() ) scattered++;
+		all.insert(all.end(),local.begin(),local.end());
+	}
+	std::sort(all.begin(),all.end());
+	int wrong = 0;
+	if( all.size() != aut.GetLastIndex() - aut.GetFirstIndex() ) wrong++;
+	else for(size_t k = 0; k < all.size(); ++k)
+		if( all[k] != aut.GetFirstIndex() + k ) wrong++;
+	std::cout << all.size() << " unknowns in [" << aut.GetFirstIndex() << "," << aut.GetLastIndex() << ")";
+	std::cout << " scattered elements " << scattered << " mismatched unknowns " << mismatch << " wrong indices " << wrong << std::endl;
+	if( scattered ) errors++;
+	if( mismatch ) errors++;
+	if( wrong ) errors++;
+	return errors;
+}
+#endif //USE_MESH
+
+int main(int argc,char ** argv)
+{
+	int test = 0, errors = 0, rank = 0, size = 1;
+	if (argc > 1)  test = atoi(argv[1]);
+	Solver::Initialize(&argc,&argv,"");
+#if defined(USE_MPI)
+	MPI_Comm_rank(MPI_COMM_WORLD,&rank);
+	MPI_Comm_size(MPI_COMM_WORLD,&size);
+#endif
+	enumerator beg = n*n*rank/size, end = n*n*(rank+1)/size;
+	if( test == 0 ) errors = test_frozen(beg,end);
+	else if( test == 1 ) errors = test_solver(beg,end,rank);
+	else if( test == 6 ) errors = test_compiled(beg,end);
+#if defined(USE_MESH)
+	else if( test == 2 && argc > 2 ) errors = test_frozen_mesh(argv[2]);
+	else if( test == 3 && argc > 2 ) errors = test_coloring(argv[2]);
+	else if( test == 4 && argc > 2 ) errors = test_enumeration(argv[2],Automatizator::EnumerateInterleaved);
+	else if( test == 5 && argc > 2 ) errors = test_enumeration(argv[2],Automatizator::EnumerateInterleavedCurve);
+#endif
+#if defined(USE_MPI)
+	int tmp = errors;
+	MPI_Allreduce(&tmp,&errors,1,MPI_INT,MPI_SUM,MPI_COMM_WORLD);
+#endif
+	Solver::Finalize();
+	if( rank == 0 )
+	{
+		if( errors )
+			std::cout << "There were " << errors << " errors" << std::endl;
+		else
+			std::cout << "There were no errors" << std::endl;
+	}
+	return errors ? -1 : 0;
+}
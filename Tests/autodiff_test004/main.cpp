@@ -0,0 +1,170 @@
+#include <cstdio>
+#include <cmath>
+#include <cstdlib>
+
+#include "inmost.h"
+using namespace INMOST;
+
+typedef INMOST_DATA_REAL_TYPE real;
+typedef INMOST_DATA_ENUM_TYPE enumerator;
+
+// Residual of nonlinear diffusion on n x n grid, rows are split between processors.
+const enumerator n = 30;
+
+static real value(enumerator i, real t) {return 1.5 + sin(0.1*i + t);}
+
+static real direction(enumerator i) {return cos(0.3*i) + 0.5;}
+
+// The same assembly is used for Residual and for JacobianOperator.
+template<typename ResidualType>
+static void assemble(ResidualType & R, real t)
+{
+	for(enumerator i = R.GetFirstIndex(); i < R.GetLastIndex(); ++i)
+	{
+		enumerator ix = i % n, iy = i / n, nb[4], nnb = 0;
+		if( ix > 0 ) nb[nnb++] = i-1;
+		if( ix+1 < n ) nb[nnb++] = i+1;
+		if( iy > 0 ) nb[nnb++] = i-n;
+		if( iy+1 < n ) nb[nnb++] = i+n;
+		unknown c(value(i,t),i);
+		R[i] = c*c*c + 4.0*c;
+		for(enumerator k = 0; k < nnb; ++k)
+		{
+			unknown u(value(nb[k],t),nb[k]);
+			R[i] -= u*(1.0 + 0.1*u*u);
+		}
+		R[i] *= 1.0 + 0.01*c;
+		R[i] /= 2.0 + 0.1*c*c;
+	}
+}
+
+class DiffusionOperator : public JacobianOperator
+{
+	real t;
+public:
+	DiffusionOperator(enumerator beg, enumerator end, const std::vector<enumerator> & Pre, const std::vector<enumerator> & Post, real t)
+	: JacobianOperator(beg,end,Pre,Post), t(t) {}
+	void Assemble() {assemble(*this,t);}
+};
+
+// Indices of unknowns of other processors referenced by the rows of the local partition.
+static void nonlocal(enumerator beg, enumerator end, std::vector<enumerator> & Pre, std::vector<enumerator> & Post)
+{
+	for(enumerator i = (beg > n ? beg-n : 0); i < beg; ++i) Pre.push_back(i);
+	for(enumerator i = end; i < std::min(end+n,n*n); ++i) Post.push_back(i);
+}
+
+// Product of the operator with a vector is equal to the product of the assembled jacobian,
+// the residual evaluated by the operator is equal to the assembled one.
+static int test_matvec(enumerator beg, enumerator end, int rank)
+{
+	int errors = 0;
+	std::vector<enumerator> Pre, Post;
+	nonlocal(beg,end,Pre,Post);
+	Residual R("",beg,end);
+	assemble(R,0.7);
+	DiffusionOperator op(beg,end,Pre,Post,0.7);
+	Sparse::Vector x("",beg,end), y("",beg,end);
+	for(enumerator i = beg; i < end; ++i)
+	{
+		x[i] = direction(i);
+		y[i] = 1.0;
+	}
+	op.MatVec(2.0,x,0.5,y);
+	real diff[2] = {0,0};
+	for(enumerator i = beg; i < end; ++i)
+	{
+		real Jx = 0;
+		const Sparse::Row & r = R.GetJacobian()[i];
+		for(Sparse::Row::const_iterator it = r.Begin(); it != r.End(); ++it)
+			Jx += it->second*direction(it->first);
+		diff[0] = std::max(diff[0],fabs(y[i] - (0.5 + 2.0*Jx)));
+		diff[1] = std::max(diff[1],fabs(op.GetResidual()[i] - R.GetResidual()[i]));
+	}
+#if defined(USE_MPI)
+	real tmp[2] = {diff[0],diff[1]};
+	MPI_Allreduce(tmp,diff,2,MPI_DOUBLE,MPI_MAX,MPI_COMM_WORLD);
+#endif
+	if( rank == 0 ) std::cout << "difference of product " << diff[0] << " of residual " << diff[1] << std::endl;
+	if( diff[0] > 1.0e-12 ) errors++;
+	if( diff[1] > 1.0e-12 ) errors++;
+	//the row of derivatives is not stored along the direction
+	bool thrown = false;
+	try
+	{
+		op[beg].GetRow();
+	}
+	catch(ErrorType e)
+	{
+		thrown = (e == JacobianNotStored);
+	}
+	if( !thrown && beg < end )
+	{
+		std::cout << "access to the row along the direction did not throw" << std::endl;
+		errors++;
+	}
+	return errors;
+}
+
+// Solution with the operator in place of the matrix is close to the solution with the matrix,
+// the preconditioner is built from the jacobian at another state. The overlap of the
+// additive Schwarz method extends and renumbers the vectors given to the operator in parallel.
+static int test_solve(enumerator beg, enumerator end, int rank, std::string overlap)
+{
+	int errors = 0;
+	std::vector<enumerator> Pre, Post;
+	nonlocal(beg,end,Pre,Post);
+	Residual R("",beg,end), P("",beg,end);
+	assemble(R,0.7);
+	assemble(P,0.0);
+	DiffusionOperator op(beg,end,Pre,Post,0.7);
+	Sparse::Vector xa("",beg,end), xb("",beg,end);
+	Solver Sa("inner_ilu2"), Sb("inner_ilu2");
+	Sa.SetParameter("absolute_tolerance","1.0e-13");
+	Sb.SetParameter("absolute_tolerance","1.0e-13");
+	Sa.SetParameter("schwartz_overlap",overlap);
+	Sb.SetParameter("schwartz_overlap",overlap);
+	Sa.SetMatrix(R.GetJacobian());
+	if( !Sa.Solve(R.GetResidual(),xa) ) errors++;
+	Sb.SetMatrix(P.GetJacobian());
+	Sb.SetOperator(&op);
+	if( !Sb.Solve(R.GetResidual(),xb) ) errors++;
+	if( errors && rank == 0 ) std::cout << "solver failed" << std::endl;
+	real diff = 0;
+	for(enumerator i = beg; i < end; ++i)
+		diff = std::max(diff,fabs(xa[i] - xb[i]));
+#if defined(USE_MPI)
+	real tmp = diff;
+	MPI_Allreduce(&tmp,&diff,1,MPI_DOUBLE,MPI_MAX,MPI_COMM_WORLD);
+#endif
+	if( rank == 0 ) std::cout << "difference of solutions " << diff << " iterations " << Sa.Iterations() << " " << Sb.Iterations() << std::endl;
+	if( diff > 1.0e-10 ) errors++;
+	return errors;
+}
+
+int main(int argc,char ** argv)
+{
+	int test = 0, errors = 0, rank = 0, size = 1;
+	if (argc > 1)  test = atoi(argv[1]);
+	Solver::Initialize(&argc,&argv,"");
+#if defined(USE_MPI)
+	MPI_Comm_rank(MPI_COMM_WORLD,&rank);
+	MPI_Comm_size(MPI_COMM_WORLD,&size);
+#endif
+	enumerator beg = n*n*rank/size, end = n*n*(rank+1)/size;
+	if( test == 0 ) errors = test_matvec(beg,end,rank);
+	else if( test == 1 ) errors = test_solve(beg,end,rank,argc > 2 ? argv[2] : "0");
+#if defined(USE_MPI)
+	int tmp = errors;
+	MPI_Allreduce(&tmp,&errors,1,MPI_INT,MPI_SUM,MPI_COMM_WORLD);
+#endif
+	Solver::Finalize();
+	if( rank == 0 )
+	{
+		if( errors )
+			std::cout << "There were " << errors << " errors" << std::endl;
+		else
+			std::cout << "There were no errors" << std::endl;
+	}
+	return errors ? -1 : 0;
+}
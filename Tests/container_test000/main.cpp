@@ -0,0 +1,117 @@
+#include <cstdio>
+#include <cstdlib>
+#include "inmost.h"
+using namespace INMOST;
+
+typedef Sparse::Row::entry entry;
+const unsigned stacked = 4;
+typedef small_array<entry,stacked> entries;
+
+static entry make_entry(unsigned k)
+{
+	entry e;
+	e.first = k;
+	e.second = 0.5*k + 1.0;
+	return e;
+}
+
+static entries make_array(unsigned n, unsigned shift)
+{
+	entries a;
+	for(unsigned k = 0; k < n; ++k) a.push_back(make_entry(k+shift));
+	return a;
+}
+
+// Check that the array holds n entries starting from make_entry(shift).
+static int check(const entries & a, unsigned n, unsigned shift, const char * what)
+{
+	int errors = 0;
+	if( a.size() != n || a.capacity() < n ) errors++;
+	else for(unsigned k = 0; k < n; ++k)
+		if( a[k].first != k+shift || a[k].second != 0.5*(k+shift) + 1.0 ) errors++;
+	if( errors ) std::cout << what << ": size " << a.size() << " capacity " << a.capacity() << " expected " << n << " entries from " << shift << std::endl;
+	return errors ? 1 : 0;
+}
+
+// Entries spill from the object into allocated memory on push_back, the contents is preserved.
+static int test_push_back()
+{
+	int errors = 0;
+	entries a;
+	for(unsigned k = 0; k < stacked; ++k) a.push_back(make_entry(k));
+	if( a.capacity() != stacked ) errors++, std::cout << "push_back: allocated before spill" << std::endl;
+	errors += check(a,stacked,0,"push_back within object");
+	for(unsigned k = stacked; k < 5*stacked; ++k) a.push_back(make_entry(k));
+	errors += check(a,5*stacked,0,"push_back after spill");
+	unsigned capacity = a.capacity();
+	a.clear();
+	if( a.capacity() != capacity || !a.empty() ) errors++, std::cout << "clear: memory was not kept" << std::endl;
+	a.push_back(make_entry(7));
+	errors += check(a,1,7,"push_back after clear");
+	a.shrink();
+	if( a.capacity() != stacked || !a.empty() ) errors++, std::cout << "shrink: memory was not released" << std::endl;
+	a.resize(2*stacked,make_entry(3));
+	if( a.size() != 2*stacked || a[2*stacked-1].first != 3 ) errors++, std::cout << "resize: wrong contents" << std::endl;
+	entries b(a), c;
+	c = a;
+	if( b.size() != a.size() || c.size() != a.size() || b.data() == a.data() || c.data() == a.data() ) errors++, std::cout << "copy: memory is shared" << std::endl;
+	return errors;
+}
+
+// Swap of all combinations of arrays inside of the object and in allocated memory.
+static int test_swap()
+{
+	int errors = 0;
+	for(int q = 0; q < 4; ++q)
+	{
+		unsigned na = (q & 1) ? 3*stacked : stacked-1, nb = (q & 2) ? 2*stacked+1 : 1;
+		entries a = make_array(na,10), b = make_array(nb,100);
+		a.swap(b);
+		errors += check(a,nb,100,"swap first");
+		errors += check(b,na,10,"swap second");
+		b.swap(a);
+		errors += check(a,na,10,"swap back first");
+		errors += check(b,nb,100,"swap back second");
+		//arrays stay usable after swap
+		a.push_back(make_entry(na+10));
+		b.push_back(make_entry(nb+100));
+		errors += check(a,na+1,10,"push_back after swap first");
+		errors += check(b,nb+1,100,"push_back after swap second");
+	}
+	return errors;
+}
+
+// Move passes allocated memory without copy, arrays inside of the object are copied.
+static int test_move()
+{
+	int errors = 0;
+	entries a = make_array(3*stacked,20), b = make_array(2*stacked,50), c = make_array(stacked,70);
+	const entry * heap = a.data();
+	a.move(b);
+	errors += check(b,3*stacked,20,"move from memory");
+	if( b.data() != heap ) errors++, std::cout << "move: memory was copied" << std::endl;
+	if( !a.empty() || a.capacity() != stacked ) errors++, std::cout << "move: source is not empty" << std::endl;
+	c.move(a);
+	errors += check(a,stacked,70,"move from object");
+	if( !c.empty() ) errors++, std::cout << "move: source is not empty" << std::endl;
+	a.move(a);
+	errors += check(a,stacked,70,"move into itself");
+	//moved arrays stay usable
+	c.push_back(make_entry(1));
+	a.push_back(make_entry(stacked+70));
+	errors += check(c,1,1,"push_back after move");
+	errors += check(a,stacked+1,70,"push_back after move");
+	return errors;
+}
+
+int main(int argc,char ** argv)
+{
+	(void)argc;
+	(void)argv;
+	int errors = test_push_back() + test_swap() + test_move();
+	if( errors )
+		std::cout << "There were " << errors << " errors" << std::endl;
+	else
+		std::cout << "There were no errors" << std::endl;
+	return errors ? -1 : 0;
+}
@@ -0,0 +1,124 @@
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+
+#include "inmost.h"
+using namespace INMOST;
+
+typedef Storage::real real;
+
+// Value of tag as real number, loaders may change integer data into real data.
+static real get_value(const Storage & e, const Tag & t, int k)
+{
+	if( t.GetDataType() == DATA_INTEGER ) return e.IntegerArray(t)[k];
+	return e.RealArray(t)[k];
+}
+
+// Write the mesh with tags that are checked against geometry after it is loaded back.
+int main(int argc,char ** argv)
+{
+	int errors = 0;
+	if( argc < 3 )
+	{
+		std::cout << "usage: " << argv[0] << " input_mesh output_mesh [vtk_binary|async]" << std::endl;
+		return -1;
+	}
+	Mesh::Initialize(&argc,&argv);
+	{
+		Mesh m;
+		m.Load(argv[1]);
+		Tag center = m.CreateTag("cell_center",DATA_REAL,CELL,NONE,3);
+		Tag nnodes = m.CreateTag("cell_nodes",DATA_INTEGER,CELL,NONE,1);
+		Tag sum = m.CreateTag("node_sum",DATA_REAL,NODE,NONE,1);
+		//name with characters that should be escaped in xml
+		std::string output(argv[2]), quoted_name = "cell \"nodes\" <&>";
+		std::transform(output.begin(),output.end(),output.begin(),::tolower);
+		bool xml = output.find(".vtu") != std::string::npos || output.find(".pvtu") != std::string::npos;
+		Tag quoted;
+		if( xml ) quoted = m.CreateTag(quoted_name,DATA_INTEGER,CELL,NONE,1);
+		for(Mesh::iteratorCell it = m.BeginCell(); it != m.EndCell(); ++it)
+		{
+			it->Centroid(&it->RealArray(center)[0]);
+			it->Integer(nnodes) = it->nbAdjElements(NODE);
+			if( xml ) it->Integer(quoted) = it->nbAdjElements(NODE);
+		}
+		for(Mesh::iteratorNode it = m.BeginNode(); it != m.EndNode(); ++it)
+			it->Real(sum) = it->Coords()[0] + 2*it->Coords()[1] + 3*it->Coords()[2];
+		if( argc > 3 && std::string(argv[3]) == "async" )
+		{
+			int id = m.SaveAsync(argv[2]);
+			//the snapshot should not depend on the later changes
+			for(Mesh::iteratorNode it = m.BeginNode(); it != m.EndNode(); ++it) it->Real(sum) = -1;
+			while( !m.TestOutput(id) );
+			m.WaitOutput(id);
+			for(Mesh::iteratorNode it = m.BeginNode(); it != m.EndNode(); ++it)
+				it->Real(sum) = it->Coords()[0] + 2*it->Coords()[1] + 3*it->Coords()[2];
+		}
+		else
+		{
+			if( argc > 3 ) m.SetFileOption("VTK_BINARY",argv[3]);
+			m.Save(argv[2]);
+		}
+
+		Mesh l;
+		l.Load(argv[2]);
+		std::cout << "nodes " << m.NumberOfNodes() << " " << l.NumberOfNodes();
+		std::cout << " faces " << m.NumberOfFaces() << " " << l.NumberOfFaces();
+		std::cout << " cells " << m.NumberOfCells() << " " << l.NumberOfCells() << std::endl;
+		if( m.NumberOfNodes() != l.NumberOfNodes() ||
+			m.NumberOfFaces() != l.NumberOfFaces() ||
+			m.NumberOfCells() != l.NumberOfCells() )
+		{
+			std::cout << "number of elements differ" << std::endl;
+			errors++;
+		}
+		if( !l.HaveTag("cell_center") || !l.HaveTag("cell_nodes") || !l.HaveTag("node_sum") || (xml && !l.HaveTag(quoted_name)) )
+		{
+			std::cout << "tags are not loaded" << std::endl;
+			errors++;
+		}
+		else
+		{
+			//ascii output keeps only some digits
+			real tol = (std::string(argv[2]).find(".vtk") != std::string::npos && (argc < 4 || std::string(argv[3]) != "1")) ? 1.0e-5 : 1.0e-12;
+			Tag lcenter = l.GetTag("cell_center");
+			Tag lnnodes = l.GetTag("cell_nodes");
+			Tag lsum = l.GetTag("node_sum");
+			Tag lquoted = xml ? l.GetTag(quoted_name) : Tag();
+			if( !lcenter.isDefined(CELL) || lcenter.GetSize() != 3 || !lnnodes.isDefined(CELL) || !lsum.isDefined(NODE) )
+			{
+				std::cout << "tags are defined on wrong elements or have wrong size" << std::endl;
+				errors++;
+			}
+			else
+			{
+				int bad_cells = 0, bad_nodes = 0;
+				for(Mesh::iteratorCell it = l.BeginCell(); it != l.EndCell(); ++it)
+				{
+					real cnt[3];
+					it->Centroid(cnt);
+					for(int k = 0; k < 3; ++k)
+						if( fabs(get_value(it->self(),lcenter,k) - cnt[k]) > tol ) bad_cells++;
+					if( get_value(it->self(),lnnodes,0) != it->nbAdjElements(NODE) ) bad_cells++;
+					if( xml && get_value(it->self(),lquoted,0) != it->nbAdjElements(NODE) ) bad_cells++;
+				}
+				for(Mesh::iteratorNode it = l.BeginNode(); it != l.EndNode(); ++it)
+				{
+					Storage::real_array c = it->Coords();
+					if( fabs(get_value(it->self(),lsum,0) - (c[0] + 2*c[1] + 3*c[2])) > tol ) bad_nodes++;
+				}
+				if( bad_cells || bad_nodes )
+				{
+					std::cout << "data differs on " << bad_cells << " cells and " << bad_nodes << " nodes" << std::endl;
+					errors++;
+				}
+			}
+		}
+	}
+	Mesh::Finalize();
+	if( errors )
+		std::cout << "There were " << errors << " errors" << std::endl;
+	else
+		std::cout << "There were no errors" << std::endl;
+	return errors ? -1 : 0;
+}
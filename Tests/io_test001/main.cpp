@@ -0,0 +1,207 @@
+#include <cstdio>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <clocale>
+#include <string>
+#include <vector>
+
+#include "inmost.h"
+#include "io.hpp"
+using namespace INMOST;
+
+// Numbers are compared bit by bit and by the number of parsed characters with strtod and strtoll.
+static int check_real(const std::string & str)
+{
+	double v = 0, r;
+	char * rend;
+	r = strtod(str.c_str(),&rend);
+	const char * q = io_parse_real(str.c_str(),str.c_str()+str.size(),v);
+	int rlen = static_cast<int>(rend - str.c_str());
+	int len = q ? static_cast<int>(q - str.c_str()) : 0;
+	if( len != rlen || (rlen && memcmp(&v,&r,sizeof(double))) )
+	{
+		printf("real \"%s\": got %.17g length %d, strtod %.17g length %d\n",str.c_str(),v,len,r,rlen);
+		return 1;
+	}
+	return 0;
+}
+
+static int check_integer(const std::string & str)
+{
+	long long v = 0, r;
+	char * rend;
+	r = strtoll(str.c_str(),&rend,10);
+	const char * q = io_parse_integer(str.c_str(),str.c_str()+str.size(),v);
+	int rlen = static_cast<int>(rend - str.c_str());
+	int len = q ? static_cast<int>(q - str.c_str()) : 0;
+	if( len != rlen || (rlen && v != r) )
+	{
+		printf("integer \"%s\": got %lld length %d, strtoll %lld length %d\n",str.c_str(),v,len,r,rlen);
+		return 1;
+	}
+	return 0;
+}
+
+static unsigned int lcg_state = 12345;
+
+static unsigned int lcg()
+{
+	lcg_state = lcg_state*1103515245u + 12345u;
+	return (lcg_state >> 8) & 0xffffff;
+}
+
+static std::string random_number()
+{
+	std::string ret;
+	char buf[64];
+	if( lcg() % 2 ) ret += '-';
+	int ndigits = 1 + lcg() % 30;
+	int dot = lcg() % (ndigits+1);
+	for(int k = 0; k < ndigits; ++k)
+	{
+		if( k == dot ) ret += '.';
+		ret += static_cast<char>('0' + lcg() % 10);
+	}
+	if( lcg() % 2 )
+	{
+		sprintf(buf,"%c%d",lcg() % 2 ? 'e' : 'E',static_cast<int>(lcg() % 700) - 350);
+		ret += buf;
+	}
+	return ret;
+}
+
+static int test_numbers()
+{
+	int errors = 0;
+	const char * reals[] =
+	{
+		"0", "-0", "+7", "1", "3.14159", ".5", "5.", "-.25e-1", "1e10", "1E-10",
+		"1.5e+22", "1.5e23", "1e-22", "1e-23", "0.1", "0.30000000000000004",
+		"123456789012345", "1234567890123456", "9007199254740993", "1234567890123456789012",
+		"0.000000000000000000000000000001", "12345678901234567890.123456789e-5",
+		"1.00000000000000011102230246251565404236316680908203125",
+		"3.141592653589793238462643383279502884197169399375105820974944592307816406286208998628034825342117067982148086513282306647",
+		"2.2250738585072014e-308", "2.2250738585072011e-308", "4.9e-324", "2.4703282292062327e-324",
+		"2.4703282292062328e-324", "1e-400", "1e400", "1.7976931348623157e308", "-1.7976931348623159e308",
+		"1e", "1e+", "1e-", "2E+x", "1.5x", "7 8", "  \t-2.5e3", "1.25\r\n", "-", ".", "e5", "", "x"
+	};
+	for(size_t k = 0; k < sizeof(reals)/sizeof(reals[0]); ++k)
+		errors += check_real(reals[k]);
+	for(int k = 0; k < 20000; ++k)
+		errors += check_real(random_number());
+	for(int k = 0; k < 20000; ++k)
+	{
+		char buf[64];
+		double v = (static_cast<double>(lcg()) / 0xffffff - 0.5) * pow(10.0,static_cast<int>(lcg() % 80) - 40);
+		sprintf(buf,"%.17g",v);
+		errors += check_real(buf);
+		sprintf(buf,"%14e",v);
+		errors += check_real(buf);
+		sprintf(buf,"%.10f",v);
+		errors += check_real(buf);
+	}
+	const char * integers[] = {"0", "-0", "+15", "-123456789", "9223372036854775807", " 42", "\r\n7", "12ab", "-", "", "x"};
+	for(size_t k = 0; k < sizeof(integers)/sizeof(integers[0]); ++k)
+		errors += check_integer(integers[k]);
+	return errors;
+}
+
+// The file is read by blocks of the minimal size, so that numbers and lines cross the ends of the blocks.
+static int test_tokenizer()
+{
+	int errors = 0;
+	std::string text, mantissa(600,'3');
+	std::vector<std::string> words;
+	for(int k = 0; k < 2000; ++k)
+	{
+		std::string w = random_number();
+		if( k % 97 == 0 ) w = "0." + mantissa + "e-3";
+		words.push_back(w);
+		text += w;
+		text += (k % 7 == 0) ? "\r\n" : (k % 3 == 0 ? "\t" : " ");
+	}
+	text += "  last\r\nline one\r\nline two";
+	const char * fname = "io_test001.txt";
+	FILE * f = fopen(fname,"wb");
+	if( !f )
+	{
+		printf("cannot write %s\n",fname);
+		return 1;
+	}
+	fwrite(text.c_str(),1,text.size(),f);
+	fclose(f);
+	for(int pass = 0; pass < 2; ++pass)
+	{
+		FILE * in = NULL;
+		io_tokenizer * t;
+		if( pass == 0 )
+		{
+			in = fopen(fname,"rb");
+			t = new io_tokenizer(in,1);
+		}
+		else t = new io_tokenizer(text);
+		for(size_t k = 0; k < words.size(); ++k)
+		{
+			double v = 0, r = strtod(words[k].c_str(),NULL);
+			if( !t->read_real(v) || memcmp(&v,&r,sizeof(double)) )
+			{
+				printf("pass %d word %d \"%s\": got %.17g, strtod %.17g\n",pass,static_cast<int>(k),words[k].c_str(),v,r);
+				errors++;
+				break;
+			}
+		}
+		char str[1024];
+		int ival;
+		if( t->read_integer(ival) )
+		{
+			printf("pass %d: integer is read from a word\n",pass);
+			errors++;
+		}
+		if( !t->read_word(str,1024) || strcmp(str,"last") )
+		{
+			printf("pass %d: expected word \"last\", got \"%s\"\n",pass,str);
+			errors++;
+		}
+		//rest of the line after the word
+		if( !t->getline(str,1024) || strcmp(str,"\r\n") )
+		{
+			printf("pass %d: expected end of line after the word\n",pass);
+			errors++;
+		}
+		if( !t->getline(str,1024) || strcmp(str,"line one\r\n") )
+		{
+			printf("pass %d: expected \"line one\" with CRLF, got \"%s\"\n",pass,str);
+			errors++;
+		}
+		if( !t->getline(str,1024) || strcmp(str,"line two") )
+		{
+			printf("pass %d: expected \"line two\" without new line at the end of file, got \"%s\"\n",pass,str);
+			errors++;
+		}
+		if( t->getline(str,1024) || !t->eof() || t->skip_space() )
+		{
+			printf("pass %d: expected end of file\n",pass);
+			errors++;
+		}
+		delete t;
+		if( in ) fclose(in);
+	}
+	remove(fname);
+	return errors;
+}
+
+int main(int argc,char ** argv)
+{
+	int errors = 0;
+	int test = argc > 1 ? atoi(argv[1]) : 0;
+	//strtod is locale dependent, the tokenizer always expects the point
+	setlocale(LC_NUMERIC,"C");
+	if( test == 0 ) errors = test_numbers();
+	else if( test == 1 ) errors = test_tokenizer();
+	if( errors )
+		printf("There were %d errors\n",errors);
+	else
+		printf("There were no errors\n");
+	return errors ? -1 : 0;
+}
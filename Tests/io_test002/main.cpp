@@ -0,0 +1,192 @@
+#include <cstdio>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "inmost.h"
+using namespace INMOST;
+
+typedef Storage::real real;
+
+// Box of nx*ny*nz blocks with a fault in the middle, ZCORN spans two data records of binary file.
+const int nx = 6, ny = 5, nz = 5;
+
+static void put_big_endian(FILE * f, unsigned long long v, int bytes)
+{
+	unsigned char buf[8];
+	for(int k = bytes-1; k >= 0; --k)
+	{
+		buf[k] = static_cast<unsigned char>(v & 0xff);
+		v >>= 8;
+	}
+	fwrite(buf,1,bytes,f);
+}
+
+// Keyword of unformatted Eclipse file, data is written in Fortran records of at most 1000 numbers,
+// type is either INTE, REAL or DOUB.
+static void write_keyword(FILE * f, const char * name, const char * type, const std::vector<double> & vals)
+{
+	char head[12];
+	int n = static_cast<int>(vals.size()), size = strcmp(type,"DOUB") ? 4 : 8;
+	memset(head,' ',8);
+	memcpy(head,name,strlen(name));
+	memcpy(head+8,type,4);
+	put_big_endian(f,16,4);
+	fwrite(head,1,8,f);
+	put_big_endian(f,n,4);
+	fwrite(head+8,1,4,f);
+	put_big_endian(f,16,4);
+	for(int q = 0; q < n; q += 1000)
+	{
+		int len = std::min(n-q,1000);
+		put_big_endian(f,len*size,4);
+		for(int k = q; k < q+len; ++k)
+		{
+			if( size == 8 )
+			{
+				unsigned long long v;
+				memcpy(&v,&vals[k],8);
+				put_big_endian(f,v,8);
+			}
+			else if( !strcmp(type,"REAL") )
+			{
+				float r = static_cast<float>(vals[k]);
+				unsigned int v;
+				memcpy(&v,&r,4);
+				put_big_endian(f,v,4);
+			}
+			else put_big_endian(f,static_cast<unsigned int>(static_cast<int>(vals[k])),4);
+		}
+		put_big_endian(f,len*size,4);
+	}
+}
+
+// Keyword of GRDECL file.
+static void write_text(FILE * f, const char * name, const std::vector<double> & vals)
+{
+	fprintf(f,"%s\n",name);
+	for(size_t k = 0; k < vals.size(); ++k)
+		fprintf(f,"%.17g%s",vals[k],k % 6 == 5 ? "\n" : " ");
+	fprintf(f,"\n/\n");
+}
+
+// Write the same grid into GRDECL file and into EGRID and INIT files, in the INIT file properties
+// are given only for active blocks.
+static void write_grids()
+{
+	std::vector<double> head(100,0.0), coord, zcorn(8*nx*ny*nz), actnum, permx, poro, satnum;
+	for(int j = 0; j <= ny; ++j)
+		for(int i = 0; i <= nx; ++i)
+		{
+			//coordinates are exact in single precision of EGRID
+			double x = i*10.0 + 0.5*j, y = j*12.0;
+			double top[6] = {x, y, 1000.0, x+1.0, y+0.5, 1100.0};
+			coord.insert(coord.end(),top,top+6);
+		}
+	for(int k = 0; k < nz; ++k)
+		for(int l = 0; l < 2; ++l)
+			for(int j = 0; j < ny; ++j)
+				for(int jj = 0; jj < 2; ++jj)
+					for(int i = 0; i < nx; ++i)
+						for(int ii = 0; ii < 2; ++ii)
+							zcorn[k*nx*ny*8 + l*nx*ny*4 + (2*j+jj)*nx*2 + 2*i+ii] = 1000.0 + (k+l)*15.0 + 0.25*(i+ii) + 0.5*(j+jj) + (i >= nx/2 ? 3.0 : 0.0);
+	for(int q = 0; q < nx*ny*nz; ++q)
+	{
+		actnum.push_back(q % 7 == 3 ? 0 : 1);
+		permx.push_back(100.0 + q);
+		poro.push_back(0.1 + 0.001*q);
+		satnum.push_back(1 + q % 3);
+	}
+	FILE * f = fopen("io_test002.grdecl","w");
+	fprintf(f,"SPECGRID\n%d %d %d 1 F /\n",nx,ny,nz);
+	write_text(f,"COORD",coord);
+	write_text(f,"ZCORN",zcorn);
+	write_text(f,"ACTNUM",actnum);
+	write_text(f,"PERMX",permx);
+	write_text(f,"PORO",poro);
+	write_text(f,"SATNUM",satnum);
+	fclose(f);
+	f = fopen("io_test002.EGRID","wb");
+	head[0] = 1; head[1] = nx; head[2] = ny; head[3] = nz;
+	write_keyword(f,"GRIDHEAD","INTE",head);
+	write_keyword(f,"COORD","REAL",coord);
+	write_keyword(f,"ZCORN","DOUB",zcorn);
+	write_keyword(f,"ACTNUM","INTE",actnum);
+	write_keyword(f,"ENDGRID","INTE",std::vector<double>());
+	fclose(f);
+	std::vector<double> apermx, aporo, asatnum;
+	for(int q = 0; q < nx*ny*nz; ++q) if( actnum[q] )
+	{
+		apermx.push_back(permx[q]);
+		aporo.push_back(poro[q]);
+		asatnum.push_back(satnum[q]);
+	}
+	f = fopen("io_test002.INIT","wb");
+	write_keyword(f,"PORV","REAL",std::vector<double>(nx*ny*nz,1.0));
+	write_keyword(f,"PERMX","REAL",apermx);
+	write_keyword(f,"PORO","DOUB",aporo);
+	write_keyword(f,"SATNUM","INTE",asatnum);
+	fclose(f);
+}
+
+// Sums over cells that are owned by processor.
+static void integrals(Mesh & m, real sums[6])
+{
+	memset(sums,0,sizeof(real)*6);
+	Tag perm = m.HaveTag("PERM") ? m.GetTag("PERM") : Tag();
+	Tag poro = m.HaveTag("PORO") ? m.GetTag("PORO") : Tag();
+	Tag satnum = m.HaveTag("SATNUM") ? m.GetTag("SATNUM") : Tag();
+	for(Mesh::iteratorCell it = m.BeginCell(); it != m.EndCell(); ++it) if( it->GetStatus() != Element::Ghost )
+	{
+		sums[0] += 1;
+		sums[1] += it->Volume();
+		if( perm.isValid() ) sums[2] += it->RealArray(perm)[0];
+		if( poro.isValid() ) sums[3] += it->Real(poro);
+		if( satnum.isValid() ) sums[4] += it->Integer(satnum);
+	}
+	sums[5] = m.NumberOfFaces();
+	m.Integrate(sums,6);
+}
+
+// Grid and properties loaded from binary EGRID and INIT files should be the same as loaded from GRDECL file.
+int main(int argc,char ** argv)
+{
+	int errors = 0;
+	Mesh::Initialize(&argc,&argv);
+	{
+		Mesh m, l;
+		m.SetCommunicator(INMOST_MPI_COMM_WORLD);
+		l.SetCommunicator(INMOST_MPI_COMM_WORLD);
+		if( m.GetProcessorRank() == 0 ) write_grids();
+		m.Integrate(0); //wait until the files are written
+		m.Load("io_test002.grdecl");
+		l.Load("io_test002.EGRID");
+		real a[6], b[6];
+		const char * names[6] = {"cells","volume","perm","poro","satnum","faces"};
+		integrals(m,a);
+		integrals(l,b);
+		for(int k = 0; k < 6; ++k)
+		{
+			if( m.GetProcessorRank() == 0 ) std::cout << names[k] << " " << a[k] << " " << b[k] << std::endl;
+			if( fabs(a[k] - b[k]) > 1.0e-9*(1+fabs(a[k])) || a[k] == 0 )
+			{
+				if( m.GetProcessorRank() == 0 ) std::cout << names[k] << " differ" << std::endl;
+				errors++;
+			}
+		}
+		m.Integrate(0);
+		if( m.GetProcessorRank() == 0 )
+		{
+			remove("io_test002.grdecl");
+			remove("io_test002.EGRID");
+			remove("io_test002.INIT");
+		}
+	}
+	Mesh::Finalize();
+	if( errors )
+		std::cout << "There were " << errors << " errors" << std::endl;
+	else
+		std::cout << "There were no errors" << std::endl;
+	return errors ? -1 : 0;
+}
@@ -0,0 +1,71 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+
+#include "inmost.h"
+using namespace INMOST;
+
+typedef Storage::real real;
+
+// Position of the first node within tolerance by linear search.
+static int brute_find(Mesh & m, const std::vector<HandleType> & nodes, const real * xyz)
+{
+	Mesh::CentroidComparator cmp(&m);
+	for(size_t k = 0; k < nodes.size(); ++k)
+		if( cmp.Compare(m.RealArrayDF(nodes[k],m.CoordsTag()).data(),xyz) == 0 )
+			return static_cast<int>(k);
+	return -1;
+}
+
+// Nodes of a grid with given offset and step are searched by Mesh::NodeMatcher with given tolerance.
+int main(int argc,char ** argv)
+{
+	int errors = 0;
+	real offset = argc > 1 ? atof(argv[1]) : 0.0;
+	real h = argc > 2 ? atof(argv[2]) : 1.0;
+	real eps = argc > 3 ? atof(argv[3]) : 1.0e-5;
+	const int n = 30;
+	Mesh::Initialize(&argc,&argv);
+	{
+		Mesh m;
+		m.SetDimensions(3);
+		m.SetEpsilon(eps);
+		std::vector<HandleType> nodes;
+		for(int i = 0; i < n; ++i)
+			for(int j = 0; j < n; ++j)
+				for(int k = 0; k < n; ++k)
+				{
+					real xyz[3] = {offset + i*h, offset - j*h, offset + k*h};
+					nodes.push_back(m.CreateNode(xyz).GetHandle());
+					//duplicates should be matched to the first node
+					if( (i+j+k) % 10 == 0 ) nodes.push_back(m.CreateNode(xyz).GetHandle());
+				}
+		Mesh::NodeMatcher matcher(&m,nodes);
+		int wrong = 0, missed = 0, extra = 0, outside = 0;
+		for(size_t q = 0; q < nodes.size(); ++q)
+		{
+			Storage::real_array c = m.RealArrayDF(nodes[q],m.CoordsTag());
+			real xyz[3] = {c[0] + 0.9*eps, c[1] - 0.9*eps, c[2]};
+			int find = matcher.Find(xyz);
+			if( find == -1 ) missed++;
+			else if( find > static_cast<int>(q) || (q % 97 == 0 && brute_find(m,nodes,xyz) != find) ) wrong++;
+			//nearest node is half of the step away
+			xyz[1] = c[1] + 0.5*h;
+			if( matcher.Find(xyz) != -1 ) extra++;
+		}
+		//compare with linear search on points near the nodes and outside of the grid
+		for(int q = 0; q < 200; ++q)
+		{
+			real xyz[3] = {offset + (rand() % (n+4) - 2)*h, offset - (rand() % (n+4) - 2)*h, offset + (rand() % (n+4) - 2)*h};
+			if( matcher.Find(xyz) != brute_find(m,nodes,xyz) ) outside++;
+		}
+		std::cout << nodes.size() << " nodes, wrong " << wrong << " missed " << missed << " extra " << extra << " outside " << outside << std::endl;
+		if( wrong || missed || extra || outside ) errors++;
+	}
+	Mesh::Finalize();
+	if( errors )
+		std::cout << "There were " << errors << " errors" << std::endl;
+	else
+		std::cout << "There were no errors" << std::endl;
+	return errors ? -1 : 0;
+}
@@ -0,0 +1,235 @@
+#include <cstdio>
+#include <cmath>
+#include <cstdlib>
+
+#include "inmost.h"
+using namespace INMOST;
+
+typedef INMOST_DATA_REAL_TYPE real;
+typedef INMOST_DATA_ENUM_TYPE enumerator;
+
+// Bratu problem -u'' = lambda exp(u), u(0) = u(1) = 0
+// or, if steep is set, -eps u'' + z/sqrt(1+z^2) = 0 with z = steep (u - 1), where full Newton step diverges
+class Problem : public NonlinearProblem
+{
+	std::vector<real> u;
+	real h, lambda, steep;
+public:
+	Problem(enumerator n, real lambda, real steep)
+	: u(n,0.0), h(1.0/(n+1)), lambda(lambda), steep(steep) {}
+	void Assemble(Residual & R, RequestedAction action)
+	{
+		(void)action;
+		enumerator n = static_cast<enumerator>(u.size());
+		for(enumerator i = 0; i < n; ++i)
+		{
+			unknown c(u[i],i);
+			variable l = i > 0 ? variable(unknown(u[i-1],i-1)) : variable(0.0);
+			variable r = i+1 < n ? variable(unknown(u[i+1],i+1)) : variable(0.0);
+			if( steep )
+			{
+				variable z = steep*(c-1.0);
+				R[i] = 1.0e-3*(2.0*c - l - r)/(h*h) + z/sqrt(1.0+z*z);
+			}
+			else
+				R[i] = (2.0*c - l - r)/(h*h) - lambda*exp(c);
+		}
+	}
+	bool Update(const Sparse::Vector & dx, real alpha)
+	{
+		for(enumerator i = 0; i < u.size(); ++i)
+			u[i] += alpha*dx[i];
+		return true;
+	}
+};
+
+// Print statistics of the iterations and check that the preconditioner was kept only
+// while the residual dropped by "lag_reduction" and the linear iterations stayed within
+// "lag_iterations" times the iterations with the fresh preconditioner, at most "preconditioner_lag"
+// iterations in a row. Default parameters are assumed. Setup of the matrix with the kept
+// preconditioner only copies the values, it should take less time than the setup with factorization.
+static int check_history(const NonlinearSolver & N, enumerator & reused, enumerator & reductions)
+{
+	int errors = 0;
+	enumerator linear = 0, fresh = 0, lag = 0;
+	double assembly = 0, setup = 0, solve = 0, setup_fresh = 0, setup_reused = 0;
+	reused = reductions = 0;
+	for(enumerator k = 0; k < N.GetIterations(); ++k)
+	{
+		const NonlinearSolver::IterationInfo & info = N.GetIteration(k);
+		linear += info.linear_iterations;
+		reused += info.reused ? 1 : 0;
+		reductions += info.line_search;
+		assembly += info.assembly_time;
+		setup += info.setup_time;
+		solve += info.solve_time;
+		if( info.reused )
+		{
+			if( k == 0 || ++lag > 3 || !(info.residual < 0.5*N.GetIteration(k-1).residual) ||
+				N.GetIteration(k-1).linear_iterations > 2*std::max<enumerator>(fresh,1) )
+			{
+				std::cout << "preconditioner was kept on iteration " << k+1 << std::endl;
+				errors++;
+			}
+			setup_reused += info.setup_time;
+		}
+		else
+		{
+			fresh = info.linear_iterations;
+			lag = 0;
+			setup_fresh += info.setup_time;
+		}
+	}
+	if( reused && setup_reused/reused >= setup_fresh/(N.GetIterations()-reused) )
+	{
+		std::cout << "setup with kept preconditioner " << setup_reused/reused << " is not faster than " << setup_fresh/(N.GetIterations()-reused) << std::endl;
+		errors++;
+	}
+	std::cout << N.GetReason() << " residual " << N.GetResidual() << " iterations " << N.GetIterations() << std::endl;
+	std::cout << "linear iterations " << linear << " reused preconditioner " << reused << " step reductions " << reductions << std::endl;
+	std::cout << "assembly " << assembly << " setup " << setup << " solve " << solve << std::endl;
+	return errors;
+}
+
+// Exact newton (0), inexact newton (1), line search (2) and inexact newton without frozen pattern (4).
+static int test_grid(int test)
+{
+	int errors = 0;
+	enumerator n = 200, reused, reductions;
+	Problem P(n,3.0,test == 2 ? 20.0 : 0.0);
+	Residual R("",0,n);
+	if( test != 4 ) R.FreezePattern();
+	Solver S("inner_ilu2");
+	S.SetParameter("absolute_tolerance","1.0e-12");
+	NonlinearSolver N(S);
+	N.SetParameterEnum("verbosity",1);
+	N.SetParameterReal("relative_tolerance",1.0e-10);
+	if( test == 0 ) //exact newton without line search
+	{
+		N.SetParameterEnum("adaptive_forcing",0);
+		N.SetParameterEnum("preconditioner_lag",0);
+		N.SetParameterEnum("line_search",0);
+		N.SetParameterReal("forcing_initial",1.0e-12);
+	}
+	if( !N.Solve(P,R) ) errors++;
+	errors += check_history(N,reused,reductions);
+	if( (test == 0 || test == 4) && reused )
+	{
+		std::cout << "preconditioner was reused without lagging or frozen pattern" << std::endl;
+		errors++;
+	}
+	if( test == 1 && !reused )
+	{
+		std::cout << "preconditioner was not reused" << std::endl;
+		errors++;
+	}
+	if( test == 2 && !reductions )
+	{
+		std::cout << "line search was not used" << std::endl;
+		errors++;
+	}
+	return errors;
+}
+
+#if defined(USE_MESH)
+// Cell-centered nonlinear diffusion with reaction on a mesh, the source is chosen so that
+// the discrete solution is the given function of cell centers. Unknowns are registered with
+// Automatizator and changed by Automatizator::UpdateSolution.
+class MeshProblem : public NonlinearProblem
+{
+	Mesh & m;
+	Automatizator & aut;
+	enumerator iu;
+	Tag source;
+public:
+	MeshProblem(Mesh & m, Automatizator & aut, enumerator iu, Tag source)
+	: m(m), aut(aut), iu(iu), source(source) {}
+	void Assemble(Residual & R, RequestedAction action)
+	{
+		(void)action;
+		dynamic_variable U(aut,iu);
+		for(Mesh::iteratorCell it = m.BeginCell(); it != m.EndCell(); ++it) if( it->GetStatus() != Element::Ghost )
+		{
+			Cell c = it->self();
+			enumerator i = aut.GetIndex(c,iu);
+			R[i] = U(c)*U(c)*U(c) + U(c) - c.Real(source);
+			ElementArray<Cell> adj = c.NeighbouringCells();
+			for(ElementArray<Cell>::size_type k = 0; k < adj.size(); ++k)
+				R[i] += (U(c) - U(adj[k]))*(1.0 + 0.5*(U(c)*U(c) + U(adj[k])*U(adj[k])));
+		}
+	}
+	bool Update(const Sparse::Vector & dx, real alpha)
+	{
+		aut.UpdateSolution(dx,alpha);
+		return true;
+	}
+};
+
+static real exact(const Cell & c)
+{
+	real cnt[3];
+	c.Centroid(cnt);
+	return 1.0 + 0.5*sin(cnt[0] + 2*cnt[1] + 3*cnt[2]);
+}
+
+static int test_mesh(std::string file)
+{
+	int errors = 0;
+	enumerator reused, reductions;
+	Mesh m;
+	m.Load(file);
+	Tag u = m.CreateTag("u",DATA_REAL,CELL,NONE,1);
+	Tag source = m.CreateTag("source",DATA_REAL,CELL,NONE,1);
+	Automatizator aut;
+	Automatizator::MakeCurrent(&aut);
+	enumerator iu = aut.RegisterTag(u,CELL);
+	aut.EnumerateEntries();
+	MeshProblem P(m,aut,iu,source);
+	Residual R("",aut.GetFirstIndex(),aut.GetLastIndex());
+	//residual at the exact solution without source gives the source
+	for(Mesh::iteratorCell it = m.BeginCell(); it != m.EndCell(); ++it)
+	{
+		it->Real(u) = exact(it->self());
+		it->Real(source) = 0.0;
+	}
+	P.Assemble(R,COMPUTE_FUNCTION);
+	for(Mesh::iteratorCell it = m.BeginCell(); it != m.EndCell(); ++it)
+	{
+		it->Real(source) = R.GetResidual()[aut.GetIndex(it->self(),iu)];
+		it->Real(u) = 0.0;
+	}
+	R.Clear();
+	R.FreezePattern();
+	Solver S("inner_ilu2");
+	S.SetParameter("absolute_tolerance","1.0e-12");
+	NonlinearSolver N(S);
+	N.SetParameterEnum("verbosity",1);
+	N.SetParameterReal("relative_tolerance",1.0e-10);
+	if( !N.Solve(P,R) ) errors++;
+	errors += check_history(N,reused,reductions);
+	real diff = 0;
+	for(Mesh::iteratorCell it = m.BeginCell(); it != m.EndCell(); ++it)
+		diff = std::max(diff,fabs(it->Real(u) - exact(it->self())));
+	std::cout << m.NumberOfCells() << " cells, difference with exact solution " << diff << std::endl;
+	if( diff > 1.0e-8 ) errors++;
+	Automatizator::MakeCurrent(NULL);
+	return errors;
+}
+#endif
+
+int main(int argc,char ** argv)
+{
+	int test = 0, errors = 0;
+	if (argc > 1)  test = atoi(argv[1]);
+	Solver::Initialize(&argc,&argv,"");
+	if( (test >= 0 && test <= 2) || test == 4 ) errors = test_grid(test);
+#if defined(USE_MESH)
+	else if( test == 3 && argc > 2 ) errors = test_mesh(argv[2]);
+#endif
+	Solver::Finalize();
+	if( errors )
+		std::cout << "There were " << errors << " errors" << std::endl;
+	else
+		std::cout << "There were no errors" << std::endl;
+	return errors ? -1 : 0;
+}
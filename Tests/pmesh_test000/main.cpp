@@ -1,5 +1,7 @@
 #include <cstdio>
 #include <cmath>
+#include <sstream>
+#include <map>
 
 #include "inmost.h"
 using namespace INMOST;
@@ -10,6 +12,8 @@ int main(int argc,char ** argv)
 	Mesh::Initialize(&argc,&argv);
 	Mesh * m = new Mesh(); // Create an empty mesh
 	m->SetCommunicator(INMOST_MPI_COMM_WORLD); // Set the MPI communicator for the mesh
+	if( argc > 2 ) m->SetSharedMemoryExchange(atoi(argv[2]) != 0); // Exchange through shared memory within the node
+	if( argc > 3 ) m->SetMessageCompression(true,atoi(argv[3])); // Compress messages starting from given size
 	int rank = m->GetProcessorRank(),  nproc = m->GetProcessorsNumber();
 
 	/* Expected serial mesh with IxJxK box grid, you can try different prime values, like 13x17x19 */
@@ -23,9 +27,12 @@ int main(int argc,char ** argv)
 	m->AssignGlobalID(CELL);
 	// Copy them in order to check later
 	Tag idcopy = m->CreateTag("ID_copy",DATA_INTEGER,CELL,NONE,1);
+	// Real data should be transfered bit-exact
+	Tag realcopy = m->CreateTag("Real_copy",DATA_REAL,CELL,NONE,1);
 	for(Mesh::iteratorCell it = m->BeginCell(); it != m->EndCell(); ++it)
 	{
 	    it->Integer(idcopy) = it->GlobalID();
+	    it->Real(realcopy) = sin(it->GlobalID()+0.5);
 	}
 
 	// Create Tag to verify RedistributeTag
@@ -58,13 +65,331 @@ int main(int argc,char ** argv)
 				std::cout << "Permut: " << permut << ", proc: " << rank << ", cell: " << it->GlobalID() << ", idcopy: " << it->Integer(idcopy) << std::endl;
 				errors++;
 			}
+			if( it->Real(realcopy) != sin(it->GlobalID()+0.5) )
+			{
+				std::cout << "Permut: " << permut << ", proc: " << rank << ", cell: " << it->GlobalID() << ", realcopy: " << it->Real(realcopy) << std::endl;
+				errors++;
+			}
+		}
+	}
+
+	// Save and load the mesh streaming through a small buffer, each processor should get back it's part
+	for(int strategy = 0; strategy < 2; strategy++)
+	{
+		m->SetFileOption("PMF_BUFFER_SIZE","100");
+		m->SetParallelFileStrategy(strategy);
+		m->Save("pmesh_test000.pmf");
+		Mesh * l = new Mesh();
+		l->SetCommunicator(INMOST_MPI_COMM_WORLD);
+		l->SetFileOption("PMF_BUFFER_SIZE","100");
+		l->SetParallelFileStrategy(1-strategy); // Files should not depend on the strategy
+		l->Load("pmesh_test000.pmf");
+		if( l->NumberOfCells() != m->NumberOfCells() )
+		{
+			std::cout << "Load: strategy: " << strategy << ", proc: " << rank << ", cells: " << l->NumberOfCells() << " expected " << m->NumberOfCells() << std::endl;
+			errors++;
+		}
+		Tag lidcopy = l->GetTag("ID_copy"), lrealcopy = l->GetTag("Real_copy");
+		for(Mesh::iteratorCell it = l->BeginCell(); it != l->EndCell(); ++it)
+		{
+			if( it->Real(lrealcopy) != sin(it->Integer(lidcopy)+0.5) )
+			{
+				std::cout << "Load: strategy: " << strategy << ", proc: " << rank << ", cell: " << it->Integer(lidcopy) << ", realcopy: " << it->Real(lrealcopy) << std::endl;
+				errors++;
+			}
+		}
+		delete l;
+	}
+	// Load only one of the tags, data of the other is skipped
+	{
+		Mesh * l = new Mesh();
+		l->SetCommunicator(INMOST_MPI_COMM_WORLD);
+		l->SetFileOption("PMF_BUFFER_SIZE","100");
+		l->SetFileOption("SET_TAGS_LOAD","ID_copy");
+		l->Load("pmesh_test000.pmf");
+		if( l->HaveTag("Real_copy") || !l->HaveTag("ID_copy") || l->NumberOfCells() != m->NumberOfCells() )
+		{
+			std::cout << "Load tags: proc: " << rank << ", cells: " << l->NumberOfCells() << " expected " << m->NumberOfCells() << std::endl;
+			errors++;
+		}
+		else
+		{
+			// Skipped sections should not shift the data of the loaded tag, cells come in the order they were written
+			Tag lidcopy = l->GetTag("ID_copy");
+			Mesh::iteratorCell jt = l->BeginCell();
+			for(Mesh::iteratorCell it = m->BeginCell(); it != m->EndCell(); ++it, ++jt)
+			{
+				if( jt->Integer(lidcopy) != it->Integer(idcopy) )
+				{
+					std::cout << "Load tags: proc: " << rank << ", cell: " << it->Integer(idcopy) << ", loaded ID_copy: " << jt->Integer(lidcopy) << std::endl;
+					errors++;
+				}
+			}
+		}
+		delete l;
+	}
+	if( rank == 0 ) remove("pmesh_test000.pmf");
+
+	// Save asynchronously, the snapshot should not see changes made after the call
+	{
+		int id = m->SaveAsync("pmesh_test000_async.pmf");
+		for(Mesh::iteratorCell it = m->BeginCell(); it != m->EndCell(); ++it) it->Real(realcopy) = -1;
+		m->TestOutput(id);
+		m->WaitOutput(id);
+		Mesh * l = new Mesh();
+		l->SetCommunicator(INMOST_MPI_COMM_WORLD);
+		l->Load("pmesh_test000_async.pmf");
+		Tag lidcopy = l->GetTag("ID_copy"), lrealcopy = l->GetTag("Real_copy");
+		for(Mesh::iteratorCell it = l->BeginCell(); it != l->EndCell(); ++it)
+		{
+			if( it->Real(lrealcopy) != sin(it->Integer(lidcopy)+0.5) )
+			{
+				std::cout << "SaveAsync: proc: " << rank << ", cell: " << it->Integer(lidcopy) << ", realcopy: " << it->Real(lrealcopy) << std::endl;
+				errors++;
+			}
 		}
+		delete l;
+		if( rank == 0 ) remove("pmesh_test000_async.pmf");
+	}
+
+	// Write time series with changing data, then open it and read steps in arbitrary order
+	{
+		std::vector<Tag> changing(1,realcopy);
+		m->CreateSeries("pmesh_test000_series.pmf");
+		for(int step = 0; step < 3; step++)
+		{
+			for(Mesh::iteratorCell it = m->BeginCell(); it != m->EndCell(); ++it)
+				it->Real(realcopy) = sin(it->Integer(idcopy)+step+0.5);
+			m->AppendSeries("pmesh_test000_series.pmf",changing,0.1*step);
+		}
+		Mesh * l = new Mesh();
+		l->SetCommunicator(INMOST_MPI_COMM_WORLD);
+		l->Load("pmesh_test000_series.pmf");
+		std::vector<Storage::real> times = l->GetSeriesTimes("pmesh_test000_series.pmf");
+		if( times.size() != 3 )
+		{
+			std::cout << "Series: proc: " << rank << ", steps: " << times.size() << " expected 3" << std::endl;
+			errors++;
+		}
+		Tag lidcopy = l->GetTag("ID_copy"), lrealcopy = l->GetTag("Real_copy");
+		for(int step = 2; step >= 0; step -= 2)
+		{
+			Storage::real time = l->LoadSeries("pmesh_test000_series.pmf",step);
+			for(Mesh::iteratorCell it = l->BeginCell(); it != l->EndCell(); ++it)
+			{
+				if( it->Real(lrealcopy) != sin(it->Integer(lidcopy)+step+0.5) || time != 0.1*step )
+				{
+					std::cout << "Series: step: " << step << ", proc: " << rank << ", cell: " << it->Integer(lidcopy) << ", realcopy: " << it->Real(lrealcopy) << std::endl;
+					errors++;
+				}
+			}
+		}
+		delete l;
+		if( rank == 0 ) remove("pmesh_test000_series.pmf");
+		if( nproc == 1 ) remove("pmesh_test000_series.pmf.steps");
+		else
+		{
+			std::stringstream steps;
+			steps << "pmesh_test000_series.pmf." << rank << ".steps";
+			remove(steps.str().c_str());
+		}
+	}
+
+	// Write binary MSH 4.1 box of 3x3x3 hexahedra split into two blocks, then load it by all processors
+	{
+		if( rank == 0 )
+		{
+			FILE * f = fopen("pmesh_test000.msh","wb");
+			int one = 1, ihdr[3];
+			unsigned long long shdr[4], rec[9];
+			double xyz[3];
+			fprintf(f,"$MeshFormat\n4.1 1 %d\n",(int)sizeof(unsigned long long));
+			fwrite(&one,sizeof(int),1,f);
+			fprintf(f,"\n$EndMeshFormat\n$Nodes\n");
+			shdr[0] = 1; shdr[1] = shdr[3] = 64; shdr[2] = 1;
+			ihdr[0] = 3; ihdr[1] = 1; ihdr[2] = 0;
+			fwrite(shdr,sizeof(unsigned long long),4,f);
+			fwrite(ihdr,sizeof(int),3,f);
+			fwrite(&shdr[1],sizeof(unsigned long long),1,f);
+			for(unsigned long long k = 1; k <= 64; ++k) fwrite(&k,sizeof(unsigned long long),1,f);
+			for(int k = 0; k < 64; ++k)
+			{
+				xyz[0] = k%4; xyz[1] = (k/4)%4; xyz[2] = k/16;
+				fwrite(xyz,sizeof(double),3,f);
+			}
+			fprintf(f,"\n$EndNodes\n$Elements\n");
+			shdr[0] = 2; shdr[1] = shdr[3] = 27;
+			fwrite(shdr,sizeof(unsigned long long),4,f);
+			for(int k = 0; k < 27; ++k)
+			{
+				if( k == 0 || k == 13 )
+				{
+					ihdr[2] = 5;
+					shdr[0] = k ? 14 : 13;
+					fwrite(ihdr,sizeof(int),3,f);
+					fwrite(shdr,sizeof(unsigned long long),1,f);
+				}
+				unsigned long long n = k%3 + (k/3)%3*4 + k/9*16 + 1;
+				rec[0] = k+1;
+				rec[1] = n; rec[2] = n+1; rec[3] = n+5; rec[4] = n+4;
+				rec[5] = n+16; rec[6] = n+17; rec[7] = n+21; rec[8] = n+20;
+				fwrite(rec,sizeof(unsigned long long),9,f);
+			}
+			fprintf(f,"\n$EndElements\n");
+			fclose(f);
+		}
+		m->Integrate(0); // wait until the file is written
+		Mesh * l = new Mesh();
+		l->SetCommunicator(INMOST_MPI_COMM_WORLD);
+		l->SetFileOption("GMSH_PARTITION","TRUE");
+		l->Load("pmesh_test000.msh");
+		if( l->TotalNumberOf(CELL) != 27 || (nproc > 1 && l->NumberOfCells() == 27) )
+		{
+			std::cout << "MSH 4.1: proc: " << rank << ", cells: " << l->NumberOfCells() << ", total: " << l->TotalNumberOf(CELL) << " expected 27" << std::endl;
+			errors++;
+		}
+		delete l;
+		if( rank == 0 ) remove("pmesh_test000.msh");
+	}
+
+	// Write text MSH 4.1 box with physical tags of volumes and of the bottom surface in $Entities, then load it by all processors
+	{
+		if( rank == 0 )
+		{
+			FILE * f = fopen("pmesh_test000_text.msh","w");
+			fprintf(f,"$MeshFormat\n4.1 0 8\n$EndMeshFormat\n");
+			fprintf(f,"$Entities\n0 0 1 2\n1 0 0 0 3 3 0 1 5 0\n1 0 0 0 3 3 2 1 7 1 1\n2 0 0 1 3 3 3 1 8 0\n$EndEntities\n");
+			fprintf(f,"$Nodes\n1 64 1 64\n3 1 0 64\n");
+			for(int k = 1; k <= 64; ++k) fprintf(f,"%d\n",k);
+			for(int k = 0; k < 64; ++k) fprintf(f,"%d %d %d\n",k%4,(k/4)%4,k/16);
+			fprintf(f,"$EndNodes\n$Elements\n3 36 1 36\n2 1 3 9\n");
+			for(int k = 0; k < 9; ++k)
+			{
+				int n = k%3 + k/3*4 + 1;
+				fprintf(f,"%d %d %d %d %d\n",k+28,n,n+1,n+5,n+4);
+			}
+			for(int k = 0; k < 27; ++k)
+			{
+				if( k == 0 || k == 13 ) fprintf(f,"3 %d 5 %d\n",k ? 2 : 1,k ? 14 : 13);
+				int n = k%3 + (k/3)%3*4 + k/9*16 + 1;
+				fprintf(f,"%d %d %d %d %d %d %d %d %d\n",k+1,n,n+1,n+5,n+4,n+16,n+17,n+21,n+20);
+			}
+			fprintf(f,"$EndElements\n");
+			fclose(f);
+		}
+		m->Integrate(0); // wait until the file is written
+		Mesh * l = new Mesh();
+		l->SetCommunicator(INMOST_MPI_COMM_WORLD);
+		l->SetFileOption("GMSH_PARTITION","TRUE");
+		l->Load("pmesh_test000_text.msh");
+		Tag gmsh_tags = l->GetTag("GMSH_TAGS");
+		int physical[3] = {0,0,0};
+		for(Mesh::iteratorCell it = l->BeginCell(); it != l->EndCell(); ++it) if( it->Integer(l->OwnerTag()) == rank )
+		{
+			Storage::integer_array ptags = it->IntegerArray(gmsh_tags);
+			if( ptags[0] == (ptags[1] == 1 ? 7 : 8) ) physical[ptags[1]-1]++;
+		}
+		for(Mesh::iteratorFace it = l->BeginFace(); it != l->EndFace(); ++it) if( it->Integer(l->OwnerTag()) == rank && it->HaveData(gmsh_tags) )
+		{
+			Storage::integer_array ptags = it->IntegerArray(gmsh_tags);
+			if( ptags[0] == 5 && ptags[1] == 1 ) physical[2]++;
+		}
+		for(int k = 0; k < 3; ++k) physical[k] = l->Integrate(physical[k]);
+		if( l->TotalNumberOf(CELL) != 27 || (nproc > 1 && l->NumberOfCells() == 27) || physical[0] != 13 || physical[1] != 14 || physical[2] != 9 )
+		{
+			std::cout << "MSH 4.1 text: proc: " << rank << ", cells: " << l->NumberOfCells() << ", total: " << l->TotalNumberOf(CELL) << " expected 27";
+			std::cout << ", physical: " << physical[0] << " " << physical[1] << " " << physical[2] << " expected 13 14 9" << std::endl;
+			errors++;
+		}
+		delete l;
+		if( rank == 0 ) remove("pmesh_test000_text.msh");
 	}
 
 	// Obtain 1 layer of ghost cells
 	m->ExchangeGhost(1,FACE);
 	std::cout << "Ghost: proc: " << rank << ", cells: " << m->NumberOfCells() << std::endl;
 
+	// Grow and trim layers one at a time, the result should match ExchangeGhost
+	{
+		int ncells1 = m->NumberOfCells();
+		m->AddGhostLayer();
+		int ncells2 = m->NumberOfCells();
+		// Remember status and owner of each cell and check data exchange on the added layer
+		std::map<Storage::integer, std::pair<int,int> > layers;
+		Tag layerdata = m->CreateTag("Layer_data",DATA_REAL,CELL,NONE,1);
+		for(Mesh::iteratorCell it = m->BeginCell(); it != m->EndCell(); ++it)
+		{
+			layers[it->GlobalID()] = std::make_pair((int)it->GetStatus(),(int)it->Integer(m->OwnerTag()));
+			it->Real(layerdata) = (it->GetStatus() == Element::Ghost) ? -1.0 : cos(it->GlobalID()+0.5);
+			if( (it->GetStatus() == Element::Ghost) != (it->Integer(m->OwnerTag()) != rank) )
+			{
+				std::cout << "AddGhostLayer: proc: " << rank << ", cell: " << it->GlobalID() << ", owner: " << it->Integer(m->OwnerTag()) << ", status: " << Element::StatusName(it->GetStatus()) << std::endl;
+				errors++;
+			}
+		}
+		m->ExchangeData(layerdata,CELL,0);
+		for(Mesh::iteratorCell it = m->BeginCell(); it != m->EndCell(); ++it)
+		{
+			if( it->Real(layerdata) != cos(it->GlobalID()+0.5) )
+			{
+				std::cout << "AddGhostLayer: proc: " << rank << ", cell: " << it->GlobalID() << ", data: " << it->Real(layerdata) << std::endl;
+				errors++;
+			}
+		}
+		m->DeleteTag(layerdata);
+		m->RemoveGhostLayer();
+		if( m->NumberOfCells() != ncells1 )
+		{
+			std::cout << "RemoveGhostLayer: proc: " << rank << ", cells: " << m->NumberOfCells() << " expected " << ncells1 << std::endl;
+			errors++;
+		}
+		m->ExchangeGhost(2,FACE);
+		if( m->NumberOfCells() != ncells2 )
+		{
+			std::cout << "AddGhostLayer: proc: " << rank << ", cells: " << ncells2 << " expected " << m->NumberOfCells() << std::endl;
+			errors++;
+		}
+		for(Mesh::iteratorCell it = m->BeginCell(); it != m->EndCell(); ++it)
+		{
+			std::map<Storage::integer, std::pair<int,int> >::iterator q = layers.find(it->GlobalID());
+			if( q == layers.end() || q->second.first != (int)it->GetStatus() || q->second.second != (int)it->Integer(m->OwnerTag()) )
+			{
+				std::cout << "AddGhostLayer: proc: " << rank << ", cell: " << it->GlobalID() << ", owner: " << it->Integer(m->OwnerTag()) << ", status: " << Element::StatusName(it->GetStatus()) << " differ from ExchangeGhost" << std::endl;
+				errors++;
+			}
+		}
+		m->RemoveGhostLayer();
+		if( m->NumberOfCells() != ncells1 )
+		{
+			std::cout << "RemoveGhostLayer: proc: " << rank << ", cells: " << m->NumberOfCells() << " expected " << ncells1 << std::endl;
+			errors++;
+		}
+	}
+
+	// Numbering along space filling curve should still give each cell a unique number
+	{
+		m->SetNumberingOrder(Mesh::NumberingSpaceFillingCurve);
+		Tag sfcnum = m->CreateTag("SFC_number",DATA_INTEGER,CELL,NONE,1);
+		int last = m->Enumerate(CELL,sfcnum);
+		Storage::integer sum = 0;
+		for(Mesh::iteratorCell it = m->BeginCell(); it != m->EndCell(); ++it)
+		{
+			if( it->Integer(sfcnum) < 0 || it->Integer(sfcnum) >= total )
+			{
+				std::cout << "Enumerate: proc: " << rank << ", cell: " << it->GlobalID() << ", number: " << it->Integer(sfcnum) << std::endl;
+				errors++;
+			}
+			if( it->GetStatus() != Element::Ghost ) sum += it->Integer(sfcnum);
+		}
+		sum = m->Integrate(sum);
+		if( last != total || sum != total*(total-1)/2 )
+		{
+			std::cout << "Enumerate: proc: " << rank << ", last: " << last << ", sum: " << sum << std::endl;
+			errors++;
+		}
+		m->SetNumberingOrder(Mesh::NumberingDefault);
+	}
+
 	if( nproc == 2 )  // In case np=2 and simple box 3x3x3 these should cover the whole mesh, let's check that!
 	{
 		int * mask = new int[total];